@@ -82,8 +82,10 @@ Provides: %{name}
 # BXI
 Requires: backtrace
 Requires: net-snmp
+Requires: zlib
 
 BuildRequires: backtrace-devel
+BuildRequires: zlib-devel
 
 # External
 Requires: zeromq
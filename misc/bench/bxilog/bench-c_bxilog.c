@@ -96,10 +96,20 @@ static void * logging_thread(void * param) {
 int main(int argc, char * argv[]) {
     UNUSED(argc);
 
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s threads_nb seconds_to_run\n", basename(argv[0]));
+    if (argc < 3 || argc > 5) {
+        fprintf(stderr, "Usage: %s threads_nb seconds_to_run [zmq|ring [workers_nb]]\n",
+                basename(argv[0]));
         exit(1);
     }
+    bxilog_transport_e transport = BXILOG_TRANSPORT_ZMQ;
+    if (argc >= 4 && 0 == strcmp("ring", argv[3])) {
+        transport = BXILOG_TRANSPORT_RING;
+    } else if (argc >= 4 && 0 != strcmp("zmq", argv[3])) {
+        fprintf(stderr, "Unknown transport: %s\n", argv[3]);
+        exit(1);
+    }
+    // Threads formatting the logs of the file handler
+    size_t workers_nb = (argc == 5) ? (size_t) atoi(argv[4]) : 1;
     struct timespec start;
     bxitime_get(CLOCK_MONOTONIC, &start);
 
@@ -113,9 +123,11 @@ int main(int argc, char * argv[]) {
 
     
     bxilog_config_p config = bxilog_config_new(progname);
+    config->transport = transport;
     bxilog_config_add_handler(config, BXILOG_FILE_HANDLER,
                               BXILOG_FILTERS_ALL_ALL,
                               progname, filename, BXI_TRUNC_OPEN_FLAGS);
+    config->handlers_params[0]->workers_nb = workers_nb;
 
 //    bxilog_config_add_handler(config, BXILOG_FILE_HANDLER_STDIO,
 //                              BXILOG_FILTERS_ALL_ALL,
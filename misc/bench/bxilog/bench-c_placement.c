@@ -0,0 +1,185 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: Jul 16, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+/*
+ * Logging jitter seen by pinned application threads.
+ *
+ * Each application thread is pinned to a CPU and repeats a fixed amount of
+ * computation followed by a log. The duration of each step is measured: the
+ * handler thread running on an application CPU, or its buffers lying on the other
+ * NUMA node, shows up in the highest percentiles.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <libgen.h>
+
+#include <bxi/base/err.h>
+#include <bxi/base/log.h>
+#include <bxi/base/log/file_handler.h>
+#include <bxi/base/mem.h>
+#include <bxi/base/str.h>
+#include <bxi/base/time.h>
+
+// Iterations of the computation between two logs
+#define WORK_NB 20000
+
+// Maximum number of steps measured per thread
+#define SAMPLES_MAX (1024 * 1024)
+
+SET_LOGGER(logger, "bench.placement")
+
+static volatile bool AGAIN = true;
+
+typedef struct {
+    int cpu;
+    double * samples;
+    size_t samples_nb;
+} app_thread_s;
+
+static double _work(size_t n) {
+    double x = 1.0;
+    for (size_t i = 0; i < n; i++) x = x * 1.0000001 + 1e-9;
+    return x;
+}
+
+static void * app_thread(void * param) {
+    app_thread_s * app = param;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(app->cpu, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    assert(0 == rc);
+
+    volatile double sink = 0;
+    while (AGAIN && app->samples_nb < SAMPLES_MAX) {
+        struct timespec start;
+        bxierr_p err = bxitime_get(CLOCK_MONOTONIC, &start);
+        bxierr_abort_ifko(err);
+
+        sink += _work(WORK_NB);
+        DEBUG(logger, "Step %zu on cpu %d: %g", app->samples_nb, app->cpu, sink);
+
+        err = bxitime_duration(CLOCK_MONOTONIC, start, &app->samples[app->samples_nb]);
+        bxierr_abort_ifko(err);
+        app->samples_nb++;
+    }
+    return NULL;
+}
+
+static int _cmp(const void * a, const void * b) {
+    const double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char * argv[]) {
+    if (argc != 6) {
+        fprintf(stderr,
+                "Usage: %s app_cpus handler_cpus|any numa_node|-1 seconds zmq|ring\n"
+                "\n"
+                "app_cpus: comma separated list of CPUs running an application thread\n"
+                "handler_cpus: CPU list of the handler thread (e.g. 0-3,8)\n"
+                "numa_node: NUMA node of the handler buffers and rings\n",
+                basename(argv[0]));
+        exit(1);
+    }
+    bxilog_transport_e transport = BXILOG_TRANSPORT_ZMQ;
+    if (0 == strcmp("ring", argv[5])) {
+        transport = BXILOG_TRANSPORT_RING;
+    } else if (0 != strcmp("zmq", argv[5])) {
+        fprintf(stderr, "Unknown transport: %s\n", argv[5]);
+        exit(1);
+    }
+
+    size_t apps_nb = 1;
+    for (const char * s = argv[1]; '\0' != *s; s++) if (',' == *s) apps_nb++;
+    app_thread_s apps[apps_nb];
+    char * cpus = strdup(argv[1]);
+    char * saveptr = NULL;
+    char * token = strtok_r(cpus, ",", &saveptr);
+    for (size_t i = 0; i < apps_nb; i++) {
+        apps[i].cpu = atoi(token);
+        apps[i].samples = bximem_calloc(SAMPLES_MAX * sizeof(*apps[i].samples));
+        apps[i].samples_nb = 0;
+        token = strtok_r(NULL, ",", &saveptr);
+    }
+    BXIFREE(cpus);
+
+    char * fullprogname = strdup(argv[0]);
+    char * progname = basename(fullprogname);
+    char * filename = bxistr_new("/tmp/%s%s", progname, ".log");
+
+    bxilog_config_p config = bxilog_config_new(progname);
+    config->transport = transport;
+    bxilog_config_add_handler(config, BXILOG_FILE_HANDLER,
+                              BXILOG_FILTERS_ALL_ALL,
+                              progname, filename, BXI_TRUNC_OPEN_FLAGS);
+    bxilog_handler_param_p param = config->handlers_params[0];
+    if (0 != strcmp("any", argv[2])) param->cpus = strdup(argv[2]);
+    param->numa_node = atoi(argv[3]);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_abort_ifko(err);
+
+    pthread_t threads[apps_nb];
+    for (size_t i = 0; i < apps_nb; i++) {
+        int rc = pthread_create(&threads[i], NULL, app_thread, &apps[i]);
+        assert(0 == rc);
+    }
+    sleep((unsigned) atoi(argv[4]));
+    AGAIN = false;
+    for (size_t i = 0; i < apps_nb; i++) pthread_join(threads[i], NULL);
+
+    err = bxilog_finalize(true);
+    bxierr_abort_ifko(err);
+
+    // All steps of all application threads together
+    size_t n = 0;
+    for (size_t i = 0; i < apps_nb; i++) n += apps[i].samples_nb;
+    double * samples = bximem_calloc(n * sizeof(*samples));
+    double total = 0;
+    size_t k = 0;
+    for (size_t i = 0; i < apps_nb; i++) {
+        memcpy(samples + k, apps[i].samples, apps[i].samples_nb * sizeof(*samples));
+        k += apps[i].samples_nb;
+        for (size_t j = 0; j < apps[i].samples_nb; j++) total += apps[i].samples[j];
+        BXIFREE(apps[i].samples);
+    }
+    qsort(samples, n, sizeof(*samples), _cmp);
+
+    printf("%zu steps: min=%gs, average=%gs, p50=%gs, p99=%gs, p99.9=%gs, max=%gs\n",
+           n, samples[0], total / (double) n, samples[n / 2],
+           samples[(size_t) ((double) n * 0.99)], samples[(size_t) ((double) n * 0.999)],
+           samples[n - 1]);
+    fprintf(stderr, "steps\tmin\tavg\tp50\tp99\tp99.9\tmax\n");
+    fprintf(stderr, "%zu\t%.9lf\t%.9lf\t%.9lf\t%.9lf\t%.9lf\t%.9lf\n",
+            n, samples[0], total / (double) n, samples[n / 2],
+            samples[(size_t) ((double) n * 0.99)], samples[(size_t) ((double) n * 0.999)],
+            samples[n - 1]);
+
+    BXIFREE(samples);
+    unlink(filename);
+    BXIFREE(filename);
+    BXIFREE(fullprogname);
+
+    return 0;
+}
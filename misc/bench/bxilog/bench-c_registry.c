@@ -0,0 +1,139 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: Jul 16, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+/*
+ * Startup cost of the logger registry.
+ *
+ * Registers as many loggers as SET_LOGGER() constructors would do at load time,
+ * initializes bxilog (which configures all of them), then looks them up by name
+ * from several threads as language bindings do.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <libgen.h>
+
+#include <bxi/base/err.h>
+#include <bxi/base/log.h>
+#include <bxi/base/log/null_handler.h>
+#include <bxi/base/mem.h>
+#include <bxi/base/str.h>
+#include <bxi/base/time.h>
+
+static size_t LOGGERS_NB;
+static size_t LOOKUPS_NB;
+
+static char * _name(size_t i) {
+    // Names sharing long prefixes, as real ones do
+    return bxistr_new("bxi.bench.registry.component%zu.module%zu", i % 97, i);
+}
+
+static double _since(struct timespec start) {
+    double duration;
+    bxierr_p err = bxitime_duration(CLOCK_MONOTONIC, start, &duration);
+    bxierr_abort_ifko(err);
+    return duration;
+}
+
+static void * lookup_thread(void * param) {
+    size_t rank = (size_t) param;
+    char ** names = bximem_calloc(LOGGERS_NB * sizeof(*names));
+    for (size_t i = 0; i < LOGGERS_NB; i++) names[i] = _name(i);
+
+    for (size_t i = 0; i < LOOKUPS_NB; i++) {
+        bxilog_logger_p logger;
+        bxierr_p err = bxilog_registry_get(names[(i * 7919 + rank) % LOGGERS_NB], &logger);
+        bxierr_abort_ifko(err);
+    }
+
+    for (size_t i = 0; i < LOGGERS_NB; i++) BXIFREE(names[i]);
+    BXIFREE(names);
+    return NULL;
+}
+
+int main(int argc, char * argv[]) {
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s loggers_nb threads_nb lookups_per_thread\n",
+                basename(argv[0]));
+        exit(1);
+    }
+    LOGGERS_NB = (size_t) atol(argv[1]);
+    const size_t threads_nb = (size_t) atol(argv[2]);
+    LOOKUPS_NB = (size_t) atol(argv[3]);
+
+    // What SET_LOGGER() does for each logger in each loaded library
+    struct bxilog_logger_s * loggers = bximem_calloc(LOGGERS_NB * sizeof(*loggers));
+    struct timespec start;
+    bxitime_get(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < LOGGERS_NB; i++) {
+        loggers[i].name = _name(i);
+        loggers[i].name_length = strlen(loggers[i].name) + 1;
+        loggers[i].level = BXILOG_LOWEST;
+        bxilog_registry_add(&loggers[i]);
+    }
+    const double register_duration = _since(start);
+
+    char * fullprogname = strdup(argv[0]);
+    char * progname = basename(fullprogname);
+    bxilog_filters_p filters;
+    bxierr_p err = bxilog_filters_parse(":output,bxi.bench:debug,"
+                                        "bxi.bench.registry.component1:fine,"
+                                        "bxi.bench.registry.component42:lowest",
+                                        &filters);
+    bxierr_abort_ifko(err);
+    bxilog_config_p config = bxilog_config_new(progname);
+    bxilog_config_add_handler(config, BXILOG_NULL_HANDLER, filters);
+
+    bxitime_get(CLOCK_MONOTONIC, &start);
+    err = bxilog_init(config);
+    bxierr_abort_ifko(err);
+    const double init_duration = _since(start);
+
+    pthread_t threads[threads_nb];
+    bxitime_get(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < threads_nb; i++) {
+        int rc = pthread_create(&threads[i], NULL, lookup_thread, (void *) i);
+        assert(0 == rc);
+    }
+    for (size_t i = 0; i < threads_nb; i++) pthread_join(threads[i], NULL);
+    const double lookup_duration = _since(start);
+
+    err = bxilog_finalize(true);
+    bxierr_abort_ifko(err);
+
+    char * register_str = bxitime_duration_str(register_duration);
+    char * init_str = bxitime_duration_str(init_duration);
+    char * lookup_str = bxitime_duration_str(lookup_duration);
+    fprintf(stderr, "loggers\tthreads\tlookups\tregister\tinit\tlookup\n");
+    fprintf(stderr, "%zu\t%zu\t%zu\t%s\t%s\t%s\n",
+            LOGGERS_NB, threads_nb, threads_nb * LOOKUPS_NB,
+            register_str, init_str, lookup_str);
+    BXIFREE(register_str);
+    BXIFREE(init_str);
+    BXIFREE(lookup_str);
+
+    for (size_t i = 0; i < LOGGERS_NB; i++) {
+        bxilog_registry_del(&loggers[i]);
+        BXIFREE(loggers[i].name);
+    }
+    BXIFREE(loggers);
+    BXIFREE(fullprogname);
+
+    return 0;
+}
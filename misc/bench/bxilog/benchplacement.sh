@@ -0,0 +1,38 @@
+#!/bin/bash
+
+# Compare the jitter seen by application threads for several placements of the
+# handler thread: anywhere, sharing the application CPUs, and on each of the first
+# two NUMA nodes along with its buffers and rings. Application CPUs should be on
+# node 0 so that the last two lines compare local and remote placement.
+# Each line gives the placement, the transport and the statistics printed by the
+# benchmark on its last stderr line.
+
+if test $# -ne 3; then
+	echo "Usage: $(basename $0) app_cpus runs duration"
+	exit 1
+fi
+
+app_cpus=$1
+runs=$2
+duration=$3
+
+BENCH=./bench-c_placement
+NODES=/sys/devices/system/node
+
+node0=$(cat $NODES/node0/cpulist 2>/dev/null)
+node1=$(cat $NODES/node1/cpulist 2>/dev/null)
+
+placements="any:any:-1 shared:$app_cpus:-1"
+test -n "$node0" && placements="$placements local:$node0:0"
+test -n "$node1" && placements="$placements remote:$node1:1"
+
+echo -e "placement\ttransport\tsteps\tmin\tavg\tp50\tp99\tp99.9\tmax"
+for run in $(seq 1 $runs); do
+	for placement in $placements; do
+		IFS=: read name cpus node <<< "$placement"
+		for transport in zmq ring;do
+			echo -en "$name\t$transport\t"
+			$BENCH $app_cpus $cpus $node $duration $transport 2>&1 >/dev/null | tail -n 1
+		done
+	done
+done
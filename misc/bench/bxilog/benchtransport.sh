@@ -0,0 +1,26 @@
+#!/bin/bash
+
+# Compare the zmq and the ring transports for an increasing number of threads.
+# Each line gives the transport, the number of threads and the statistics printed
+# by the benchmark on its last stderr line.
+
+if test $# -ne 3; then
+	echo "Usage: $(basename $0) threadsmax runs duration"
+	exit 1
+fi
+
+threadsmax=$1
+runs=$2
+duration=$3
+
+BENCH=./bench-c_bxilog
+
+echo -e "transport\tthreads\tlogs\tduration\tmin\tmax\tsize"
+for thread in $(seq 1 $threadsmax);do
+	for run in $(seq 1 $runs); do
+		for transport in zmq ring;do
+			echo -en "$transport\t$thread\t"
+			$BENCH $thread $duration $transport 2>&1 >/dev/null | tail -n 1
+		done
+	done
+done
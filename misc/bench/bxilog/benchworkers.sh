@@ -0,0 +1,27 @@
+#!/bin/bash
+
+# Throughput of a single file handler for an increasing number of formatting
+# threads. Each line gives the transport, the number of formatting threads and the
+# statistics printed by the benchmark on its last stderr line.
+
+if test $# -ne 4; then
+	echo "Usage: $(basename $0) threads workersmax runs duration"
+	exit 1
+fi
+
+threads=$1
+workersmax=$2
+runs=$3
+duration=$4
+
+BENCH=./bench-c_bxilog
+
+echo -e "transport\tworkers\tlogs\tduration\tmin\tmax\tsize"
+for workers in $(seq 1 $workersmax);do
+	for run in $(seq 1 $runs); do
+		for transport in zmq ring;do
+			echo -en "$transport\t$workers\t"
+			$BENCH $threads $duration $transport $workers 2>&1 >/dev/null | tail -n 1
+		done
+	done
+done
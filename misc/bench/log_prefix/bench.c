@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+
+// Build with: gcc -O2 -std=gnu99 -o bench bench.c
+//
+// Cost of the prefix of each line written by the bxilog file handler:
+//   O|20140918T090752.472145261|0011297.0011302=01792:unit_t|unit_t.c:308@_dummy|bxiclib.test|
+// The formatters below are copies of the ones of src/log/file_handler.c, before and
+// after the calendar second cache and the digit tables. The output of each one is
+// checked against the snprintf() one.
+
+#define numof(a) (sizeof(a) / sizeof(a[0]))
+
+#define RECORDS_NB 100000
+#define LOOPS_NB 50
+// Records logged within the same second
+#define RECORDS_PER_SEC 1000
+
+typedef struct {
+    char level;
+    struct timespec time;
+    int pid;
+    int tid;
+    uintptr_t rank;
+    int line;
+} record_s;
+
+static const char PROGNAME[] = "unit_t";
+static const char FILENAME[] = "unit_t.c";
+static const char FUNCNAME[] = "_dummy";
+static const char LOGGERNAME[] = "bxiclib.test";
+
+static record_s records[RECORDS_NB];
+static char out[256];
+
+/* The original one: localtime_r() and snprintf() for each line. */
+
+static const char LOG_FMT[] = "%c|%0*d%0*d%0*dT%0*d%0*d%0*d.%0*ld|%0*u.%0*u=%0*" PRIxPTR ":%s|%s:%d@%s|%s|";
+
+static size_t fmt_snprintf(const record_s * r, struct tm * tm, char * buf) {
+    localtime_r(&r->time.tv_sec, tm);
+    return (size_t) snprintf(buf, sizeof(out), LOG_FMT, r->level,
+                             4, tm->tm_year + 1900, 2, tm->tm_mon + 1, 2, tm->tm_mday,
+                             2, tm->tm_hour, 2, tm->tm_min, 2, tm->tm_sec,
+                             9, r->time.tv_nsec, 7, r->pid, 7, r->tid, 5, r->rank,
+                             PROGNAME, FILENAME, r->line, FUNCNAME, LOGGERNAME);
+}
+
+/* The calendar second cached, snprintf() for each line. */
+
+static time_t cached_sec = -1;
+static struct tm cached_tm;
+
+static size_t fmt_cached(const record_s * r, struct tm * tm, char * buf) {
+    (void) tm;
+    if (r->time.tv_sec != cached_sec) {
+        localtime_r(&r->time.tv_sec, &cached_tm);
+        cached_sec = r->time.tv_sec;
+    }
+    const struct tm * now = &cached_tm;
+    return (size_t) snprintf(buf, sizeof(out), LOG_FMT, r->level,
+                             4, now->tm_year + 1900, 2, now->tm_mon + 1, 2, now->tm_mday,
+                             2, now->tm_hour, 2, now->tm_min, 2, now->tm_sec,
+                             9, r->time.tv_nsec, 7, r->pid, 7, r->tid, 5, r->rank,
+                             PROGNAME, FILENAME, r->line, FUNCNAME, LOGGERNAME);
+}
+
+/* The current one: cached calendar string, digit tables and fragments copies. */
+
+static const char DIGIT_PAIRS[] = "00010203040506070809"
+                                  "10111213141516171819"
+                                  "20212223242526272829"
+                                  "30313233343536373839"
+                                  "40414243444546474849"
+                                  "50515253545556575859"
+                                  "60616263646566676869"
+                                  "70717273747576777879"
+                                  "80818283848586878889"
+                                  "90919293949596979899";
+static const uint32_t POW10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000,
+                                  10000000, 100000000, 1000000000 };
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+static inline size_t dec_width(uint32_t value, size_t min) {
+    size_t width = min;
+    while (width < numof(POW10) && value >= POW10[width]) width++;
+    return width;
+}
+
+static inline void put_dec(char * p, size_t width, uint32_t value) {
+    char * q = p + width;
+    while (q - p >= 2) {
+        q -= 2;
+        memcpy(q, DIGIT_PAIRS + 2 * (value % 100), 2);
+        value /= 100;
+    }
+    if (q > p) *--q = (char) ('0' + value % 10);
+}
+
+static inline size_t hex_width(uintptr_t value, size_t min) {
+    if (0 == value) return min;
+    size_t width = (8 * sizeof(unsigned long) - (size_t) __builtin_clzl(value) + 3) / 4;
+    return (width < min) ? min : width;
+}
+
+static inline void put_hex(char * p, size_t width, uintptr_t value) {
+    for (char * q = p + width; q > p; value >>= 4) *--q = HEX_DIGITS[value & 0xf];
+}
+
+static time_t date_sec = -1;
+static char date[15];
+// ":progname|", its NULL terminating byte excluded from its length
+static char progname_frag[sizeof(PROGNAME) + 2];
+static const size_t progname_frag_len = sizeof(PROGNAME) + 1;
+
+static size_t fmt_tables(const record_s * r, struct tm * tm, char * buf) {
+    if (r->time.tv_sec != date_sec) {
+        localtime_r(&r->time.tv_sec, tm);
+        put_dec(date, 4, (uint32_t) tm->tm_year + 1900);
+        put_dec(date + 4, 2, (uint32_t) tm->tm_mon + 1);
+        put_dec(date + 6, 2, (uint32_t) tm->tm_mday);
+        date[8] = 'T';
+        put_dec(date + 9, 2, (uint32_t) tm->tm_hour);
+        put_dec(date + 11, 2, (uint32_t) tm->tm_min);
+        put_dec(date + 13, 2, (uint32_t) tm->tm_sec);
+        date_sec = r->time.tv_sec;
+    }
+    char * p = buf;
+    size_t width;
+    *p++ = r->level;
+    *p++ = '|';
+    memcpy(p, date, sizeof(date));
+    p += sizeof(date);
+    *p++ = '.';
+    put_dec(p, 9, (uint32_t) r->time.tv_nsec);
+    p += 9;
+    *p++ = '|';
+    width = dec_width((uint32_t) r->pid, 7);
+    put_dec(p, width, (uint32_t) r->pid);
+    p += width;
+    *p++ = '.';
+    width = dec_width((uint32_t) r->tid, 7);
+    put_dec(p, width, (uint32_t) r->tid);
+    p += width;
+    *p++ = '=';
+    width = hex_width(r->rank, 5);
+    put_hex(p, width, r->rank);
+    p += width;
+    memcpy(p, progname_frag, progname_frag_len);
+    p += progname_frag_len;
+    memcpy(p, FILENAME, sizeof(FILENAME) - 1);
+    p += sizeof(FILENAME) - 1;
+    *p++ = ':';
+    width = dec_width((uint32_t) r->line, 1);
+    put_dec(p, width, (uint32_t) r->line);
+    p += width;
+    *p++ = '@';
+    memcpy(p, FUNCNAME, sizeof(FUNCNAME) - 1);
+    p += sizeof(FUNCNAME) - 1;
+    *p++ = '|';
+    memcpy(p, LOGGERNAME, sizeof(LOGGERNAME) - 1);
+    p += sizeof(LOGGERNAME) - 1;
+    *p++ = '|';
+    *p = '\0';
+    return (size_t) (p - buf);
+}
+
+/* Structure to control calling of functions. */
+typedef struct {
+    size_t (*fnptr)(const record_s *, struct tm *, char *);
+    char *desc;
+} tFn;
+
+static tFn fn[] = {
+    { fmt_snprintf, "localtime_r + snprintf" },
+    { fmt_cached,   "   cached + snprintf" },
+    { fmt_tables,   "     cached + tables" },
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+int main(void) {
+    snprintf(progname_frag, sizeof(progname_frag), ":%s|", PROGNAME);
+
+    const char levels[] = "PACEWNOIDFTL";
+    time_t start = time(NULL);
+    srand((unsigned) start);
+    for (size_t i = 0; i < RECORDS_NB; i++) {
+        records[i].level = levels[(size_t) rand() % (numof(levels) - 1)];
+        records[i].time.tv_sec = start + (time_t) (i / RECORDS_PER_SEC);
+        records[i].time.tv_nsec = rand() % 1000000000;
+        records[i].pid = 11297;
+        records[i].tid = 11297 + rand() % 64;
+        records[i].rank = (uintptr_t) (rand() % 0x10000);
+        records[i].line = 1 + rand() % 5000;
+    }
+
+    /* Check outputs are the same. */
+    struct tm tm;
+    char expected[sizeof(out)];
+    for (size_t i = 0; i < RECORDS_NB; i++) {
+        size_t n = fmt_snprintf(&records[i], &tm, expected);
+        for (size_t f = 1; f < numof(fn); f++) {
+            size_t m = (fn[f].fnptr)(&records[i], &tm, out);
+            if (n != m || 0 != memcmp(expected, out, n)) {
+                printf("Mismatch error [%s] record %zu:\n%s\n%s\n",
+                       fn[f].desc, i, expected, out);
+                return 1;
+            }
+        }
+    }
+
+    /* Print out results. */
+    for (size_t f = 0; f < numof(fn); f++) {
+        size_t total = 0;
+        double begin = now();
+        for (size_t l = 0; l < LOOPS_NB; l++) {
+            for (size_t i = 0; i < RECORDS_NB; i++) {
+                total += (fn[f].fnptr)(&records[i], &tm, out);
+            }
+        }
+        double duration = now() - begin;
+        printf("Time per line for %s: %6.1f ns (%zu bytes)\n", fn[f].desc,
+               duration * 1e9 / (RECORDS_NB * LOOPS_NB), total);
+    }
+
+    return 0;
+}
@@ -3,7 +3,11 @@
 #include <errno.h>
 #include <stdint.h>
 #include <time.h>
+#include <unistd.h>
 
+#include <bxi/base/time.h>
+
+// Build with: gcc -O2 -o benchclock benchclock.c -lbxibase
 
 void display_res(clockid_t id, char * clock_name) {
     int rc;
@@ -39,11 +43,53 @@ void bench_clock(clockid_t id, char * clock_name, size_t loop) {
            result, calls_per_ns, ns_per_call, loop, clock_name);
 }
 
+void bench_fast(size_t loop) {
+    struct timespec start;
+    int rc = clock_gettime(CLOCK_MONOTONIC, &start);
+    if (rc) perror("Calling clock_gettime() failed\n");
+
+    // Prevent the compiler from removing the loop
+    volatile uint64_t ticks;
+    for (size_t i = 0; i < loop; i++) {
+        ticks = bxitime_fast_ticks();
+    }
+    (void) ticks;
 
-void main(int argc, char** argv) {
+    struct timespec end;
+    rc = clock_gettime(CLOCK_MONOTONIC, &end);
+    if (rc) perror("Calling clock_gettime() failed\n");
 
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s calls_nb\n", argv[0]);
+    uint64_t result = (end.tv_sec - start.tv_sec) * 1e9 + end.tv_nsec - start.tv_nsec;
+    double calls_per_ns = (double) loop / (double) result/1e-9;
+    double ns_per_call = (double) result / (double) loop;
+
+    printf("%lu ns\t%g calls/s\t%g ns/call\t %zu calls to bxitime_fast_ticks()\n",
+           result, calls_per_ns, ns_per_call, loop);
+}
+
+void check_drift(unsigned seconds) {
+    // Compare converted fast ticks with CLOCK_REALTIME once per second:
+    // the drift must stay bounded thanks to periodic re-anchoring.
+    for (unsigned i = 0; i <= seconds; i++) {
+        struct timespec before, fast, after;
+        clock_gettime(CLOCK_REALTIME, &before);
+        uint64_t ticks = bxitime_fast_ticks();
+        clock_gettime(CLOCK_REALTIME, &after);
+        bxitime_fast_to_timespec(ticks, &fast);
+
+        int64_t before_ns = before.tv_sec * 1000000000l + before.tv_nsec;
+        int64_t after_ns = after.tv_sec * 1000000000l + after.tv_nsec;
+        int64_t fast_ns = fast.tv_sec * 1000000000l + fast.tv_nsec;
+        int64_t drift = fast_ns - (before_ns + (after_ns - before_ns) / 2);
+        printf("%us\tdrift: %ld ns\n", i, drift);
+        if (i < seconds) sleep(1);
+    }
+}
+
+int main(int argc, char** argv) {
+
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "Usage: %s calls_nb [drift_seconds]\n", argv[0]);
         exit(1);
     }
 
@@ -61,7 +107,13 @@ void main(int argc, char** argv) {
     bench_clock(CLOCK_MONOTONIC, "CLOCK_MONOTONIC", calls_nb);
     bench_clock(CLOCK_MONOTONIC_COARSE, "CLOCK_MONOTONIC_COARSE", calls_nb);
     bench_clock(CLOCK_MONOTONIC_RAW, "CLOCK_MONOTONIC_RAW", calls_nb);
+    bench_fast(calls_nb);
+
+    unsigned seconds = (argc == 3) ? (unsigned) atoi(argv[2]) : 5;
+    printf("Fast clock drift against CLOCK_REALTIME:\n");
+    check_drift(seconds);
 
+    return 0;
 }
 
 
@@ -366,9 +366,13 @@ typedef struct bxierr_s * bxierr_p;
  */
 struct bxierr_s {
     int    code;                            //!< the error code
-    char * backtrace;                       //!< the backtrace
+    char * backtrace;                       //!< the backtrace, NULL until the error
+                                            //!< is reported (see bxierr_str())
     size_t backtrace_len;                   //!< the backtrace string length (including
                                             //!< the NULL terminating byte)
+    void ** bt_pcs;                         //!< the return addresses of the backtrace
+    int bt_pcs_nb;                          //!< the number of return addresses
+    int bt_tid;                             //!< the thread the error was created in
     void * data;                            //!< some data related to the error
     void (*add_to_report)(bxierr_p,         //!< add this error to the given report
                           bxierr_report_p,
@@ -25,6 +25,7 @@ void free(void *ptr);
 #include "bxi/base/log/thread.h"
 #include "bxi/base/log/filter.h"
 #include "bxi/base/log/registry.h"
+#include "bxi/base/log/stats.h"
 
 
 /**
@@ -228,6 +229,61 @@ bool bxilog_is_ready();
  */
 bxierr_p bxilog_flush(void);
 
+/**
+ * Replace the filters of the given handler while the library is running.
+ *
+ * The level of each registered logger is computed again according to the new
+ * filters (see `bxilog_logger_reconfigure()`). Records already sent to the handler
+ * are processed, in order, with the previous filters: none of them is lost.
+ * There is no need to call `bxilog_finalize()` and `bxilog_init()` again.
+ *
+ * @note the given filters are owned by the library from now on, even on error.
+ *
+ * @param[in] handler_rank the rank of the handler, in the order of
+ *            `bxilog_config_add_handler()` calls
+ * @param[in] filters the new filters of the handler
+ *
+ * @return BXIERR_OK on success, anything else is an error. On error, the handler
+ *         keeps its previous filters.
+ */
+bxierr_p bxilog_reconfigure_filters(size_t handler_rank, bxilog_filters_p filters);
+
+/**
+ * Start a new handler while the library is running.
+ *
+ * Threads already logging connect to the new handler on their next log: there is
+ * no need to call `bxilog_finalize()` and `bxilog_init()` again.
+ *
+ * Handler ranks are never reused until `bxilog_finalize()`: at most
+ * `bxilog_config_s.handlers_max` handlers can be added until then, including the
+ * ones of the configuration given to `bxilog_init()`.
+ *
+ * @note the given filters are owned by the library from now on, even on error.
+ *
+ * @param[in] handler the handler to start
+ * @param[in] filters the filters of the handler
+ * @param[out] rank the rank of the new handler (see `bxilog_remove_handler()`)
+ * @param[in] ... the handler specific parameters,
+ *            as given to `bxilog_config_add_handler()`
+ *
+ * @return BXIERR_OK on success, anything else is an error.
+ */
+bxierr_p bxilog_add_handler(bxilog_handler_p handler, bxilog_filters_p filters,
+                            size_t * rank, ...);
+
+/**
+ * Stop the given handler while the library is running.
+ *
+ * Records are not sent to the handler anymore. It processes the ones it has
+ * already received, then it exits.
+ *
+ * @param[in] handler_rank the rank of the handler, in the order of
+ *            `bxilog_config_add_handler()` and `bxilog_add_handler()` calls
+ *
+ * @return BXIERR_OK on success, anything else is an error.
+ */
+bxierr_p bxilog_remove_handler(size_t handler_rank);
+
 
 /**
  * Write the set of registered loggers along with the list of bxilog_level_e to
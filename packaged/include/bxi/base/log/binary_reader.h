@@ -0,0 +1,139 @@
+/* -*- coding: utf-8 -*-  */
+
+#ifndef BXILOG_BINARY_READER_H_
+#define BXILOG_BINARY_READER_H_
+
+#ifndef BXICFFI
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+#include "bxi/base/mem.h"
+#include "bxi/base/err.h"
+
+#include "bxi/base/log/level.h"
+
+/**
+ * @file    binary_reader.h
+ * @author Pierre Vignéras <pierre.vigneras@bull.net>
+ * @copyright 2018 Bull S.A.S.  -  All rights reserved.\n
+ *         This is not Free or Open Source software.\n
+ *         Please contact Bull SAS for details about its license.\n
+ *         Bull - Rue Jean Jaures - B.P. 68 - 78340 Les Clayes-sous-Bois
+ * @brief  BXI Binary Log Files Reader
+ *
+ * Files written by the ::BXILOG_BINARY_FILE_HANDLER hold the records themselves
+ * instead of their text: names are given once, timestamps are differences with the
+ * previous record and numbers are variable length integers. With short messages,
+ * they are less than half the size of text files, and much cheaper to produce.
+ *
+ * A reader gives back each record of such a file, in order, and turns it into the
+ * lines the ::BXILOG_FILE_HANDLER would have written. The `bxilog-cat` command does
+ * that for a whole file.
+ *
+ * Files compressed with gzip, by the archiver or by the handler itself (see
+ * bxilog_handler_param_s::compress_level), are read as they are.
+ */
+
+// *********************************************************************************
+// ********************************** Defines **************************************
+// *********************************************************************************
+
+// *********************************************************************************
+// ********************************** Types   **************************************
+// *********************************************************************************
+
+/**
+ * A record read from a binary log file.
+ *
+ * Strings are NULL terminated.
+ */
+typedef struct {
+    bxilog_level_e level;               //!< log level
+    int64_t sec;                        //!< log timestamp, seconds since the Epoch
+    int32_t nsec;                       //!< and nanoseconds
+    uint32_t pid;                       //!< process pid
+    uint32_t tid;                       //!< kernel thread id
+    uint64_t thread_rank;               //!< user thread rank
+    int line_nb;                        //!< line nb
+    const char * progname;              //!< the program name
+    const char * filename;              //!< the file name
+    const char * funcname;              //!< the function name
+    const char * loggername;            //!< the logger name
+    const char * logmsg;                //!< the log message
+    size_t logmsg_len;                  //!< its length, NULL terminating byte excluded
+} bxilog_binary_entry_s;
+
+/**
+ * A binary log file record object.
+ */
+typedef bxilog_binary_entry_s * bxilog_binary_entry_p;
+
+/**
+ * A binary log file reader.
+ */
+typedef struct bxilog_binary_reader_s bxilog_binary_reader_s;
+
+/**
+ * A binary log file reader object.
+ */
+typedef bxilog_binary_reader_s * bxilog_binary_reader_p;
+
+// *********************************************************************************
+// ********************************** Global Variables *****************************
+// *********************************************************************************
+
+
+// *********************************************************************************
+// ********************************** Interface ************************************
+// *********************************************************************************
+
+/**
+ * Open the given binary log file.
+ *
+ * @param[in] filename the file to read, "-" for the standard input
+ * @param[out] result the reader, to be destroyed with `bxilog_binary_reader_destroy()`
+ *
+ * @return BXIERR_OK if ok, anything else on error.
+ */
+bxierr_p bxilog_binary_reader_new(const char * filename,
+                                  bxilog_binary_reader_p * result);
+
+/**
+ * Read the next record.
+ *
+ * Files being written may end with an incomplete record: it is reported as an
+ * error, the records before it are given as usual.
+ *
+ * @param[in] self the reader
+ * @param[out] entry the record, valid until the next call, NULL at the end of file
+ *
+ * @return BXIERR_OK if ok, anything else on error.
+ */
+bxierr_p bxilog_binary_reader_next(bxilog_binary_reader_p self,
+                                   bxilog_binary_entry_p * entry);
+
+/**
+ * Format the given record as the ::BXILOG_FILE_HANDLER does, one line per line of
+ * its message, each one ending with a newline.
+ *
+ * @param[in] entry the record
+ * @param[inout] buf a buffer reused from call to call (NULL the first time), to be
+ *               released with `BXIFREE()`
+ * @param[inout] buf_size its size
+ *
+ * @return the length of the text in `*buf`
+ */
+size_t bxilog_binary_entry_text(const bxilog_binary_entry_p entry,
+                                char ** buf, size_t * buf_size);
+
+/**
+ * Close the given reader.
+ *
+ * @param[inout] self_p a pointer on the reader to close, it is nullified
+ *
+ * @return BXIERR_OK if ok, anything else on error.
+ */
+bxierr_p bxilog_binary_reader_destroy(bxilog_binary_reader_p * self_p);
+
+#endif /* BXILOG_BINARY_READER_H_ */
@@ -53,6 +53,16 @@
 // ********************************** Types   **************************************
 // *********************************************************************************
 
+/**
+ * The transport used to send log records from business code threads to handlers.
+ *
+ * @see bxilog_config_s
+ */
+typedef enum {
+    BXILOG_TRANSPORT_ZMQ = 0,       //!< A ZMQ inproc socket per thread (default)
+    BXILOG_TRANSPORT_RING = 1,      //!< A lock-free ring per thread and per handler
+} bxilog_transport_e;
+
 /**
  * The bxilog configuration structure.
  */
@@ -60,7 +70,20 @@ typedef struct {
     int data_hwm;                               //!< ZMQ High Water Mark of data zocket
     int ctrl_hwm;                               //!< ZMQ High Water Mark of control zocket
     size_t tsd_log_buf_size;                    //!< Size in bytes of the logging buffer
+    bxilog_transport_e transport;               //!< Transport used for log records
+    size_t ring_size;                           //!< Size in bytes of each ring when
+                                                //!< transport is BXILOG_TRANSPORT_RING
+    bool deferred_format;                       //!< When true, log messages are
+                                                //!< formatted by handler threads:
+                                                //!< format strings must then be
+                                                //!< static (string literals)
+    bool fast_clock;                            //!< When true, records are timestamped
+                                                //!< with bxitime_fast_ticks(), handler
+                                                //!< threads convert it to wall clock
     size_t handlers_nb;                         //!< Number of logging handlers
+    size_t handlers_max;                        //!< Maximum number of handlers
+                                                //!< added, bxilog_add_handler()
+                                                //!< included, until bxilog_finalize()
     const char * progname;                      //!< Program name used by bxilog_init()
                                                 //!< to set the process name (on linux
                                                 //!< at least)
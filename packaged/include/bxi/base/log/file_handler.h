@@ -55,10 +55,22 @@
  *       are specified for appending/truncating the file respectively.
  */
 extern const bxilog_handler_p BXILOG_FILE_HANDLER;
+/**
+ * The Binary File Handler.
+ *
+ * Same as ::BXILOG_FILE_HANDLER, with the same parameters, but records are written
+ * in a compact binary format instead of text lines. Such files are read back with
+ * `bxilog-cat` or the reader of binary_reader.h.
+ *
+ * Records are encoded by the handler thread alone: bxilog_handler_param_s.workers_nb
+ * is ignored.
+ */
+extern const bxilog_handler_p BXILOG_BINARY_FILE_HANDLER;
 extern const bxilog_handler_p BXILOG_FILE_HANDLER_STDIO;
 extern const char BXILOG_FILE_HANDLER_LOG_LEVEL_STR[];
 #else
 extern bxilog_handler_p BXILOG_FILE_HANDLER;
+extern bxilog_handler_p BXILOG_BINARY_FILE_HANDLER;
 extern bxilog_handler_p BXILOG_FILE_HANDLER_STDIO;
 extern char BXILOG_FILE_HANDLER_LOG_LEVEL_STR[];
 #endif
@@ -24,6 +24,10 @@
  *
  * Filters are used to remove logging messages at various steps in the logging process.
  *
+ * The level of a logger is given by the filter with the longest prefix of its name.
+ * A set of filters can be compiled into a prefix trie so this lookup costs
+ * the length of the name only, whatever the number of filters.
+ *
  */
 
 // *********************************************************************************
@@ -55,6 +59,18 @@ typedef struct bxilog_filters_s bxilog_filters_s;
  */
 typedef bxilog_filters_s * bxilog_filters_p;
 
+/**
+ * A compiled set of filters (opaque).
+ *
+ * @see bxilog_filters_compile()
+ */
+typedef struct bxilog_filters_trie_s bxilog_filters_trie_s;
+
+/**
+ * A compiled set of filters instance.
+ */
+typedef bxilog_filters_trie_s * bxilog_filters_trie_p;
+
 
 /**
  * A filter.
@@ -166,4 +182,48 @@ void bxilog_filters_add(bxilog_filters_p * filters,
  */
 bxierr_p bxilog_filters_parse(char * format, bxilog_filters_p * result);
 
+/**
+ * Merge the given sets of filters.
+ *
+ * For any logger name, the level given by the result is the highest level given by
+ * each set. The result is sorted by prefix.
+ *
+ * @param[in] filters_array an array of sets of filters
+ * @param[in] n the number of sets in filters_array
+ *
+ * @return a new set of filters
+ */
+bxilog_filters_p bxilog_filters_merge(bxilog_filters_p * filters_array, size_t n);
+
+/**
+ * Compile the given set of filters into a prefix trie.
+ *
+ * When several filters have the same prefix, the last one wins.
+ * The trie does not depend on the filters: they can be modified or released.
+ *
+ * @param[in] filters a set of filters
+ *
+ * @return the compiled filters, to be destroyed with `bxilog_filters_trie_destroy()`
+ */
+bxilog_filters_trie_p bxilog_filters_compile(bxilog_filters_p filters);
+
+/**
+ * Destroy the given compiled filters.
+ *
+ * @param[inout] trie_p a pointer on the compiled filters, it is nullified
+ */
+void bxilog_filters_trie_destroy(bxilog_filters_trie_p * trie_p);
+
+/**
+ * Find the filter with the longest prefix of the given logger name.
+ *
+ * @param[in] trie the compiled filters
+ * @param[in] name the logger name
+ * @param[out] level the level of the filter found, unchanged if none is found
+ *
+ * @return true if a filter matches the given name, false otherwise
+ */
+bool bxilog_filters_trie_match(bxilog_filters_trie_p trie,
+                               const char * name, bxilog_level_e * level);
+
 #endif /* BXILOG_H_ */
@@ -93,6 +93,10 @@ typedef struct {
 #endif
     uintptr_t thread_rank;              //!< user thread rank
     int line_nb;                        //!< line nb
+    int flags;                          //!< internal flags, always 0 in records
+                                        //!< given to handlers
+    size_t callsite_id;                 //!< internal callsite id
+    size_t logger_id;                   //!< internal logger id, 0 if unknown
     size_t filename_len;                //!< file name length
     size_t funcname_len;                //!< function name length
     size_t logname_len;                 //!< logger name length
@@ -104,10 +108,50 @@ typedef struct {
  */
 typedef bxilog_record_s * bxilog_record_p;
 
+/**
+ * A record and its strings, as given to a log handler processing logs by batch.
+ *
+ * @see bxilog_handler_s_f::process_logs
+ */
+typedef struct {
+    bxilog_record_p record;             //!< the logging record
+    char * filename;                    //!< the file name
+    char * funcname;                    //!< the function name
+    char * loggername;                  //!< the logger name
+    char * logmsg;                      //!< the actual log message
+} bxilog_log_s;
+
+/**
+ * A bxilog log object.
+ */
+typedef bxilog_log_s * bxilog_log_p;
+
+/**
+ * What a business code thread does when a handler is too slow to keep up with the
+ * records produced.
+ *
+ * Policies are applied with the ring transport (see ::BXILOG_TRANSPORT_RING) only:
+ * with the zmq transport, records sent to a handler which has reached its high water
+ * mark are dropped silently.
+ */
+typedef enum {
+    BXILOG_OVERFLOW_BLOCK=0,            //!< Wait until the handler makes some room
+    BXILOG_OVERFLOW_DROP_NEWEST=1,      //!< Drop the record being produced
+    BXILOG_OVERFLOW_DROP_OLDEST=2,      //!< Drop the oldest records the handler has
+                                        //!< not taken yet, just enough to make room,
+                                        //!< without waiting. The record being
+                                        //!< produced is dropped when the handler
+                                        //!< holds all pending ones.
+    BXILOG_OVERFLOW_DROP_BELOW_LEVEL=3, //!< Drop the record being produced if its
+                                        //!< level is less important than the
+                                        //!< handler overflow_level, wait otherwise
+} bxilog_overflow_policy_e;
+
 typedef enum {
     BXI_LOG_HANDLER_NOT_READY=0,
     BXI_LOG_HANDLER_READY=1,
     BXI_LOG_HANDLER_ERROR=2,
+    BXI_LOG_HANDLER_REMOVED=3,          //!< See bxilog_remove_handler()
 } bxilog_handler_state_e;
 
 
@@ -133,8 +177,75 @@ struct bxilog_handler_param_s {
     size_t ierr_max;                    //!< Maximal number of internal errors before
                                         //!< exiting
     long flush_freq_ms;                 //!< Implicit flush frequency
+    bxilog_overflow_policy_e overflow_policy;   //!< What to do when the handler
+                                                //!< is too slow, records dropped
+                                                //!< are reported at flush time
+                                                //!< (ring transport only)
+    bxilog_level_e overflow_level;      //!< See ::BXILOG_OVERFLOW_DROP_BELOW_LEVEL
+    bxilog_level_e prio_level;          //!< Records at least as important go through
+                                        //!< the priority queue, drained before the
+                                        //!< other one. ::BXILOG_OFF, the default,
+                                        //!< disables it: each producer thread uses
+                                        //!< a second ring or zocket per handler
+                                        //!< otherwise, and the order of records of
+                                        //!< different queues is not kept. With the
+                                        //!< default, serious records, such as the
+                                        //!< CRITICAL one logged on a fatal signal,
+                                        //!< wait behind the other ones in the bulk
+                                        //!< queue, and might be dropped with them
+                                        //!< depending on overflow_policy.
+    int prio_hwm;                       //!< ZMQ High Water Mark for the priority socket
+    bxilog_overflow_policy_e prio_overflow_policy;  //!< The overflow_policy of the
+                                                    //!< priority queue
     char * data_url;                    //!< The data zocket URL
     char * ctrl_url;                    //!< The control zocket URL
+    char * prio_url;                    //!< The priority zocket URL
+    char * cpus;                        //!< CPUs the handler thread runs on, as a
+                                        //!< list such as "0-3,8" (see cpuset(7)),
+                                        //!< NULL for no binding. Freed by
+                                        //!< bxilog_handler_clean_param().
+    int sched_policy;                   //!< Scheduling policy of the handler thread
+                                        //!< (SCHED_OTHER, SCHED_BATCH, SCHED_IDLE,
+                                        //!< SCHED_FIFO or SCHED_RR, see sched(7))
+    int sched_priority;                 //!< Its static priority (SCHED_FIFO and
+                                        //!< SCHED_RR only)
+    int nice;                           //!< Its nice value, 0 keeps the inherited one
+    int numa_node;                      //!< NUMA node of the handler buffers and
+                                        //!< rings, -1 for the default placement.
+                                        //!< When cpus is NULL, the handler thread
+                                        //!< runs on the CPUs of this node.
+    size_t workers_nb;                  //!< Number of threads formatting logs in
+                                        //!< parallel, the handler thread included,
+                                        //!< for handlers supporting it (the file
+                                        //!< handler). Records of a given business
+                                        //!< code thread are formatted by the same
+                                        //!< one and written in their order. They
+                                        //!< run on the handler thread CPUs.
+    size_t write_buffers_nb;            //!< Number of output buffers of handlers
+                                        //!< writing to a file (the file handler).
+                                        //!< With more than one, filled buffers are
+                                        //!< written by a dedicated thread while the
+                                        //!< handler thread fills the next one: it
+                                        //!< waits for a slow write only once all of
+                                        //!< them are pending.
+    size_t rotate_size;                 //!< Size in bytes from which the log file
+                                        //!< is rotated, 0 for none (file handler
+                                        //!< only). It is renamed
+                                        //!< "<filename>.<YYYYMMDDTHHMMSS>" between
+                                        //!< two writes and a new one is opened.
+    long rotate_period_s;               //!< Age in seconds from which the log file
+                                        //!< is rotated, 0 for none
+    size_t rotate_keep;                 //!< Number of rotated files kept, the
+                                        //!< oldest ones being removed, 0 for all
+    bool rotate_compress;               //!< Whether rotated files are compressed
+                                        //!< with gzip. Compression and removal are
+                                        //!< done by a dedicated thread.
+    int compress_level;                 //!< zlib level (1 to 9) of the compression
+                                        //!< of the log file itself, 0 for none
+                                        //!< (file handler only). Each flush ends a
+                                        //!< gzip member: zcat reads the file while
+                                        //!< it is written. rotate_size counts bytes
+                                        //!< before compression.
     bxilog_filters_p filters;           //!< The filters
     size_t rank;                        //!< identifier of the handler
     bxilog_handler_state_e status;      //!< handler status
@@ -218,6 +329,21 @@ struct bxilog_handler_s_f {
                             char * logmsg,
                             bxilog_handler_param_p param);
 
+    /**
+     * This function is called with a batch of logs, it is optional.
+     *
+     * When it is defined, process_log() is not used: records accepted by the
+     * filters are gathered while the handler thread drains what business code
+     * threads have produced, and are given at once. Logs are valid until this
+     * function returns.
+     *
+     * @param[in] logs the logs to process, in the order they have been received
+     * @param[in] logs_nb the number of logs (never 0)
+     * @param[in] param the log handler parameter as returned by param_new()
+     */
+    bxierr_p (*process_logs)(bxilog_log_p logs, size_t logs_nb,
+                             bxilog_handler_param_p param);
+
     /**
      * Process an internal error, that is an error raised in the handler code itself.
      *
@@ -5,6 +5,8 @@
 
 #ifndef BXICFFI
 #include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
 #endif
 
 
@@ -35,51 +37,51 @@
 /**
  * Produce a log at the `BXILOG_LOWEST` level
  */
-#define LOWEST(logger, ...) bxilog_logger_log(logger, BXILOG_LOWEST, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__);
+#define LOWEST(logger, ...) bxilog_callsite_log(logger, BXILOG_LOWEST, __VA_ARGS__);
 /**
  * Produce a log at the `BXILOG_TRACE` level
  */
-#define TRACE(logger, ...) bxilog_logger_log(logger, BXILOG_TRACE, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__);
+#define TRACE(logger, ...) bxilog_callsite_log(logger, BXILOG_TRACE, __VA_ARGS__);
 /**
  * Produce a log at the `BXILOG_FINE` level
  */
-#define FINE(logger, ...) bxilog_logger_log(logger, BXILOG_FINE, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define FINE(logger, ...) bxilog_callsite_log(logger, BXILOG_FINE, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_DEBUG` level
  */
-#define DEBUG(logger, ...) bxilog_logger_log(logger, BXILOG_DEBUG, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define DEBUG(logger, ...) bxilog_callsite_log(logger, BXILOG_DEBUG, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_INFO` level
  */
-#define INFO(logger, ...)  bxilog_logger_log(logger, BXILOG_INFO, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define INFO(logger, ...)  bxilog_callsite_log(logger, BXILOG_INFO, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_OUTPUT` level
  */
-#define OUT(logger, ...)   bxilog_logger_log(logger, BXILOG_OUTPUT, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define OUT(logger, ...)   bxilog_callsite_log(logger, BXILOG_OUTPUT, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_NOTICE` level
  */
-#define NOTICE(logger, ...)  bxilog_logger_log(logger, BXILOG_NOTICE, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define NOTICE(logger, ...)  bxilog_callsite_log(logger, BXILOG_NOTICE, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_WARNING` level
  */
-#define WARNING(logger, ...)  bxilog_logger_log(logger, BXILOG_WARNING, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define WARNING(logger, ...)  bxilog_callsite_log(logger, BXILOG_WARNING, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_ERROR` level
  */
-#define ERROR(logger, ...)   bxilog_logger_log(logger, BXILOG_ERROR, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define ERROR(logger, ...)   bxilog_callsite_log(logger, BXILOG_ERROR, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_CRITICAL` level
  */
-#define CRITICAL(logger, ...)  bxilog_logger_log(logger, BXILOG_CRITICAL, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define CRITICAL(logger, ...)  bxilog_callsite_log(logger, BXILOG_CRITICAL, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_ALERT` level
  */
-#define ALERT(logger, ...)  bxilog_logger_log(logger, BXILOG_ALERT, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define ALERT(logger, ...)  bxilog_callsite_log(logger, BXILOG_ALERT, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_PANIC` level
  */
-#define PANIC(logger, ...)  bxilog_logger_log(logger, BXILOG_PANIC, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define PANIC(logger, ...)  bxilog_callsite_log(logger, BXILOG_PANIC, __VA_ARGS__)
 
 
 
@@ -102,6 +104,110 @@
         }                                                                               \
     } while(false);
 
+/**
+ * Create a log using the given logger at the given level from a static callsite.
+ *
+ * The callsite (source file, function, line) is described once by a static
+ * descriptor registered on first use: records then only carry its identifier
+ * instead of the strings.
+ *
+ * @see `bxilog_logger_log_callsite()`
+ */
+#define bxilog_callsite_log(logger, lvl, ...) do {\
+        if (bxilog_logger_is_enabled_for((logger), (lvl))) {                            \
+            static bxilog_callsite_s __callsite__ = {                                   \
+                                    (char *)__FILE__, ARRAYLEN(__FILE__),               \
+                                    __func__, ARRAYLEN(__func__),                       \
+                                    __LINE__, (lvl), NULL, 0                            \
+            };                                                                          \
+            bxierr_p __err__ = bxilog_logger_log_callsite((logger), (lvl),              \
+                                                          &__callsite__, __VA_ARGS__);  \
+            if (bxierr_isko(__err__)) {                                                 \
+                bxierr_report(&__err__, STDOUT_FILENO);                                 \
+            }                                                                           \
+        }                                                                               \
+    } while(false);
+
+/**
+ * Produce a log from this callsite once every n calls (the first one included).
+ *
+ * Suppressed calls only cost two atomic increments. The number of suppressed calls
+ * is logged with the next log produced.
+ *
+ * Example: `LOG_EVERY_N(LOGGER, BXILOG_WARNING, 1000, "Link %d is down", link);`
+ */
+#define LOG_EVERY_N(logger, lvl, n, ...) \
+    bxilog_ratelimit_log(logger, lvl, BXILOG_RATELIMIT_EVERY_N, n, __VA_ARGS__)
+
+/**
+ * Produce a log from this callsite for its first n calls only.
+ *
+ * Suppressed calls only cost an atomic increment, and are not reported.
+ *
+ * @see LOG_EVERY_N()
+ */
+#define LOG_FIRST_N(logger, lvl, n, ...) \
+    bxilog_ratelimit_log(logger, lvl, BXILOG_RATELIMIT_FIRST_N, n, __VA_ARGS__)
+
+/**
+ * Produce at most n logs per second from this callsite.
+ *
+ * Each call reads the coarse monotonic clock. The number of suppressed calls is
+ * logged with the next log produced, or every `BXILOG_RATELIMIT_SUMMARY_PERIOD`
+ * seconds when calls keep being suppressed.
+ *
+ * @see LOG_EVERY_N()
+ */
+#define LOG_PER_SECOND(logger, lvl, n, ...) \
+    bxilog_ratelimit_log(logger, lvl, BXILOG_RATELIMIT_PER_SECOND, n, __VA_ARGS__)
+
+/**
+ * Produce a log from this callsite with a probability of 1/n.
+ *
+ * @see LOG_EVERY_N()
+ */
+#define LOG_SAMPLED(logger, lvl, n, ...) \
+    bxilog_ratelimit_log(logger, lvl, BXILOG_RATELIMIT_SAMPLED, n, __VA_ARGS__)
+
+/**
+ * Create a log using the given logger at the given level from a static callsite,
+ * subject to the given rate limit.
+ *
+ * The rate limiter state is kept in static storage for each callsite.
+ *
+ * @see `bxilog_ratelimit_check()`
+ * @see `bxilog_ratelimit_summary()`
+ */
+#define bxilog_ratelimit_log(logger, lvl, kind, n, ...) do {\
+        if (bxilog_logger_is_enabled_for((logger), (lvl))) {                            \
+            static bxilog_callsite_s __callsite__ = {                                   \
+                                    (char *)__FILE__, ARRAYLEN(__FILE__),               \
+                                    __func__, ARRAYLEN(__func__),                       \
+                                    __LINE__, (lvl), NULL, 0                            \
+            };                                                                          \
+            static bxilog_ratelimit_s __ratelimit__;                                    \
+            const bxilog_ratelimit_result_e __rl__ =                                    \
+                                bxilog_ratelimit_check(&__ratelimit__, (kind), (n));    \
+            if (BXILOG_RATELIMIT_SUPPRESS != __rl__) {                                  \
+                bxierr_p __err__ = bxilog_ratelimit_summary((logger), (lvl),            \
+                                                            &__callsite__,              \
+                                                            &__ratelimit__);            \
+                if (BXILOG_RATELIMIT_LOG == __rl__ && bxierr_isok(__err__)) {           \
+                    __err__ = bxilog_logger_log_callsite((logger), (lvl),               \
+                                                         &__callsite__, __VA_ARGS__);   \
+                }                                                                       \
+                if (bxierr_isko(__err__)) {                                             \
+                    bxierr_report(&__err__, STDOUT_FILENO);                             \
+                }                                                                       \
+            }                                                                           \
+        }                                                                               \
+    } while(false);
+
+/**
+ * The period in seconds at which the number of calls suppressed by a
+ * `LOG_PER_SECOND()` callsite is logged when the callsite does not produce any log.
+ */
+#define BXILOG_RATELIMIT_SUMMARY_PERIOD 10
 
 /**
  * Defines a new logger as a global variable
@@ -166,6 +272,14 @@ struct bxilog_logger_s {
     const char * name;              //!< Logger name
     size_t name_length;             //!< Logger name length, including NULL ending byte
     bxilog_level_e level;           //!< Logger level
+    size_t id;                      //!< Registry identifier, 0 until registered
+#ifndef BXICFFI
+    /**
+     * For each level, the handlers whose filters drop the records of this logger:
+     * bit i stands for the handler of rank i. Set by `bxilog_logger_reconfigure()`.
+     */
+    uint64_t handlers_skip[BXILOG_LOWEST + 1];
+#endif
 };
 
 
@@ -177,6 +291,70 @@ struct bxilog_logger_s {
  */
 typedef struct bxilog_logger_s * bxilog_logger_p;
 
+#ifndef BXICFFI
+/**
+ * A static callsite descriptor, defined by the logging macros.
+ *
+ * @see bxilog_callsite_log()
+ */
+typedef struct {
+    const char * fullfilename;      //!< Source file name
+    size_t fullfilename_len;        //!< Its length, including NULL ending byte
+    const char * funcname;          //!< Function name
+    size_t funcname_len;            //!< Its length, including NULL ending byte
+    int line;                       //!< Line number
+    bxilog_level_e level;           //!< Log level
+    bxilog_logger_p logger;         //!< Logger used when the callsite was registered
+    size_t id;                      //!< Callsite identifier, 0 until registered
+} bxilog_callsite_s;
+
+/**
+ * A static callsite descriptor "object".
+ */
+typedef bxilog_callsite_s * bxilog_callsite_p;
+
+/**
+ * The rate limits available for a callsite.
+ *
+ * @see LOG_EVERY_N()
+ */
+typedef enum {
+    BXILOG_RATELIMIT_EVERY_N,           //!< One log every n calls
+    BXILOG_RATELIMIT_FIRST_N,           //!< The first n calls only
+    BXILOG_RATELIMIT_PER_SECOND,        //!< At most n logs per second
+    BXILOG_RATELIMIT_SAMPLED,           //!< One log every n calls on average, randomly
+} bxilog_ratelimit_e;
+
+/**
+ * What to do for a given call of a rate limited callsite.
+ */
+typedef enum {
+    BXILOG_RATELIMIT_SUPPRESS,          //!< Nothing
+    BXILOG_RATELIMIT_LOG,               //!< Produce the log
+    BXILOG_RATELIMIT_SUMMARY,           //!< Only log the number of suppressed calls
+} bxilog_ratelimit_result_e;
+
+/**
+ * The state of a rate limited callsite, defined in static storage by the
+ * rate limited logging macros.
+ *
+ * All fields are updated with atomic operations.
+ */
+typedef struct {
+    uint64_t calls;                     //!< Number of calls
+    uint64_t suppressed;                //!< Calls suppressed since the last summary
+    int64_t second;                     //!< Current second (BXILOG_RATELIMIT_PER_SECOND)
+    uint64_t second_calls;              //!< Calls during the current second
+    int64_t next_summary;               //!< When the next summary is due (in seconds,
+                                        //!< BXILOG_RATELIMIT_PER_SECOND)
+} bxilog_ratelimit_s;
+
+/**
+ * A rate limited callsite state "object".
+ */
+typedef bxilog_ratelimit_s * bxilog_ratelimit_p;
+#endif
+
 
 // *********************************************************************************
 // ********************************** Global Variables *****************************
@@ -299,6 +477,49 @@ bxierr_p bxilog_logger_vlog_nolevelcheck(const bxilog_logger_p logger, const bxi
                                          const char * fmt, va_list arglist);
 #endif
 
+#ifndef BXICFFI
+/**
+ * Log the number of calls suppressed by the given rate limited callsite, if any,
+ * and reset it.
+ *
+ * @param[in] logger the logger to perform the log with
+ * @param[in] level the level at which the log must be emitted
+ * @param[inout] callsite the static callsite descriptor
+ * @param[inout] ratelimit the callsite rate limiter state
+ *
+ * @return BXIERR_OK on success, any other value is an error
+ *
+ * @see bxilog_ratelimit_log()
+ */
+bxierr_p bxilog_ratelimit_summary(const bxilog_logger_p logger,
+                                  const bxilog_level_e level,
+                                  bxilog_callsite_p callsite,
+                                  bxilog_ratelimit_p ratelimit);
+
+/**
+ * Create a log unconditionally from the given static callsite.
+ *
+ * The callsite is registered on first use. The record then carries the callsite
+ * identifier only, instead of the file, function and logger names.
+ * When the callsite is used with another logger than the one it has been
+ * registered with, this is equivalent to `bxilog_logger_log_nolevelcheck()`.
+ *
+ * @param[in] logger the logger to perform the log with
+ * @param[in] level the level at which the log must be emitted
+ * @param[inout] callsite the static callsite descriptor
+ * @param[in] fmt the printf like format of the message
+ *
+ * @return BXIERR_OK on success, any other value is an error
+ *
+ * @see bxilog_callsite_log()
+ */
+bxierr_p bxilog_logger_log_callsite(const bxilog_logger_p logger,
+                                    const bxilog_level_e level,
+                                    bxilog_callsite_p callsite,
+                                    const char * fmt, ...)
+                                    __attribute__ ((format (printf, 4, 5)));
+#endif
+
 /**
  * Get the log level of the given logger
  *
@@ -342,6 +563,77 @@ inline bool bxilog_logger_is_enabled_for(const bxilog_logger_p logger,
 bool bxilog_logger_is_enabled_for(const bxilog_logger_p logger, const bxilog_level_e level);
 #endif
 
+#ifndef BXICFFI
+/**
+ * Account a call of a rate limited callsite and tell what to do.
+ *
+ * @param[inout] ratelimit the callsite rate limiter state
+ * @param[in] kind the rate limit
+ * @param[in] n the rate limit parameter
+ *
+ * @return what the callsite must do
+ *
+ * @see bxilog_ratelimit_log()
+ */
+inline bxilog_ratelimit_result_e bxilog_ratelimit_check(const bxilog_ratelimit_p ratelimit,
+                                                        const bxilog_ratelimit_e kind,
+                                                        const uint64_t n) {
+    const uint64_t calls = __atomic_fetch_add(&ratelimit->calls, 1, __ATOMIC_RELAXED);
+    bool log;
+    struct timespec now = {.tv_sec = 0, .tv_nsec = 0};
+
+    switch (kind) {
+        case BXILOG_RATELIMIT_EVERY_N:
+            log = (0 == n) || (0 == calls % n);
+            break;
+        case BXILOG_RATELIMIT_FIRST_N:
+            // No summary: there is no next log to report the suppressed calls with
+            return (calls < n) ? BXILOG_RATELIMIT_LOG : BXILOG_RATELIMIT_SUPPRESS;
+        case BXILOG_RATELIMIT_PER_SECOND: {
+            int rc = clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+            bxiassert(0 == rc);
+            int64_t second = __atomic_load_n(&ratelimit->second, __ATOMIC_RELAXED);
+            if (now.tv_sec != second &&
+                __atomic_compare_exchange_n(&ratelimit->second, &second, now.tv_sec,
+                                            false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                __atomic_store_n(&ratelimit->second_calls, 0, __ATOMIC_RELAXED);
+            }
+            log = __atomic_fetch_add(&ratelimit->second_calls, 1, __ATOMIC_RELAXED) < n;
+            break;
+        }
+        case BXILOG_RATELIMIT_SAMPLED: {
+            // Scramble the call number (splitmix64 finalizer) instead of sharing
+            // a random generator state between threads
+            uint64_t z = calls + 0x9e3779b97f4a7c15ull;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            z ^= z >> 31;
+            log = (0 == n) || (0 == z % n);
+            break;
+        }
+        default:
+            log = true;
+    }
+    if (log) return BXILOG_RATELIMIT_LOG;
+
+    __atomic_fetch_add(&ratelimit->suppressed, 1, __ATOMIC_RELAXED);
+    // Other rate limits report them with the next log, only this one may go
+    // without any log for long
+    if (BXILOG_RATELIMIT_PER_SECOND != kind) return BXILOG_RATELIMIT_SUPPRESS;
+
+    int64_t next = __atomic_load_n(&ratelimit->next_summary, __ATOMIC_RELAXED);
+    if (now.tv_sec < next) return BXILOG_RATELIMIT_SUPPRESS;
+    // Only one thread produces the summary
+    if (!__atomic_compare_exchange_n(&ratelimit->next_summary, &next,
+                                     now.tv_sec + BXILOG_RATELIMIT_SUMMARY_PERIOD,
+                                     false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        return BXILOG_RATELIMIT_SUPPRESS;
+    }
+    // The first suppressed call only arms the period
+    return (0 == next) ? BXILOG_RATELIMIT_SUPPRESS : BXILOG_RATELIMIT_SUMMARY;
+}
+#endif
+
 
 
 #endif /* BXILOG_H_ */
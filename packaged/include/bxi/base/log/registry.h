@@ -47,6 +47,9 @@
  *
  * This is used by macro `SET_LOGGER()`. Use `SET_LOGGER()` instead.
  *
+ * The logger is given its identifier on its first registration. Identifiers are
+ * dense and never reused.
+ *
  * @param[in] logger the logger to register with.
  */
 void bxilog_registry_add(bxilog_logger_p logger);
@@ -0,0 +1,113 @@
+/* -*- coding: utf-8 -*-  */
+
+#ifndef BXILOG_STATS_H_
+#define BXILOG_STATS_H_
+
+#ifndef BXICFFI
+#include <stddef.h>
+#endif
+
+#include "bxi/base/mem.h"
+#include "bxi/base/err.h"
+
+#include "bxi/base/log/level.h"
+
+/**
+ * @file    stats.h
+ * @author Pierre Vignéras <pierre.vigneras@bull.net>
+ * @copyright 2018 Bull S.A.S.  -  All rights reserved.\n
+ *         This is not Free or Open Source software.\n
+ *         Please contact Bull SAS for details about its license.\n
+ *         Bull - Rue Jean Jaures - B.P. 68 - 78340 Les Clayes-sous-Bois
+ * @brief  BXI Logging Statistics
+ *
+ * Each thread counts the logs it produces, by logger and by level, without any lock.
+ * When a thread exits, its counters are added to a global total.
+ *
+ * Statistics are computed on demand only: `bxilog_stats_get()` aggregates
+ * the counters of all threads, living or not.
+ */
+
+// *********************************************************************************
+// ********************************** Defines **************************************
+// *********************************************************************************
+
+/**
+ * Number of logging levels (`BXILOG_LOWEST + 1`).
+ *
+ * This must be a literal for the Python binding.
+ */
+#define BXILOG_STATS_LEVELS_NB 13
+
+// *********************************************************************************
+// ********************************** Types   **************************************
+// *********************************************************************************
+
+/**
+ * Statistics of a given logger.
+ */
+typedef struct {
+    char * name;                                //!< the logger name
+    size_t log_nb;                              //!< number of logs produced
+    size_t bytes;                               //!< size of the messages produced
+    size_t level_nb[BXILOG_STATS_LEVELS_NB];    //!< number of logs by level
+} bxilog_logger_stats_s;
+
+/**
+ * A logger statistics object.
+ */
+typedef bxilog_logger_stats_s * bxilog_logger_stats_p;
+
+/**
+ * Statistics of all threads.
+ */
+typedef struct {
+    size_t threads_nb;                          //!< threads which have used bxilog
+    size_t log_nb;                              //!< number of logs produced
+    size_t bytes;                               //!< size of the messages produced
+    size_t min_log_size;                        //!< smallest message size (0 if none)
+    size_t max_log_size;                        //!< largest message size
+    size_t rsz_log_nb;                          //!< number of buffer resizing
+    size_t level_nb[BXILOG_STATS_LEVELS_NB];    //!< number of logs by level
+    size_t loggers_nb;                          //!< number of loggers used
+    bxilog_logger_stats_p loggers;              //!< loggers statistics, by name
+} bxilog_stats_s;
+
+/**
+ * A statistics object.
+ */
+typedef bxilog_stats_s * bxilog_stats_p;
+
+// *********************************************************************************
+// ********************************** Global Variables *****************************
+// *********************************************************************************
+
+
+// *********************************************************************************
+// ********************************** Interface ************************************
+// *********************************************************************************
+
+/**
+ * Return the statistics of all logs produced so far.
+ *
+ * Counters of living threads are read while they might still be updated: the
+ * result is a consistent snapshot for each counter, not for the whole set.
+ *
+ * Statistics are kept across `bxilog_init()`/`bxilog_finalize()` cycles.
+ *
+ * @param[out] result the statistics, to be destroyed with `bxilog_stats_destroy()`
+ *
+ * @return BXIERR_OK if ok, anything else on error.
+ *
+ * @see bxilog_stats_destroy()
+ */
+bxierr_p bxilog_stats_get(bxilog_stats_p * result);
+
+/**
+ * Release the given statistics.
+ *
+ * @param[inout] stats_p a pointer on the statistics to release, it is nullified
+ */
+void bxilog_stats_destroy(bxilog_stats_p * stats_p);
+
+#endif /* BXILOG_STATS_H_ */
@@ -16,6 +16,7 @@
 
 #ifndef BXICFFI
 #include <time.h>
+#include <stdint.h>
 #endif
 
 #include "bxi/base/err.h"
@@ -33,6 +34,14 @@
 
 #define BXITIME_NOW NULL
 
+/**
+ * Period (in nanoseconds) after which the fast clock is anchored again
+ * to CLOCK_REALTIME.
+ *
+ * @see bxitime_fast_to_timespec()
+ */
+#define BXITIME_FAST_ANCHOR_PERIOD 1000000000l
+
 
 // *********************************************************************************
 // ********************************** Types   **************************************
@@ -141,4 +150,46 @@ bxierr_p bxitime_str(struct timespec * time, char ** result);
  */
 char * bxitime_duration_str(double duration);
 
+#ifndef BXICFFI
+/**
+ * Return the current value of the fast clock.
+ *
+ * The fast clock is the CPU time stamp counter when it can be used (invariant TSC on
+ * x86_64, virtual counter on aarch64), CLOCK_MONOTONIC_RAW otherwise. Its value is
+ * opaque: use bxitime_fast_to_timespec() to convert it to a wall clock time.
+ *
+ * Reading it is much cheaper than bxitime_get() and it never fails. The first call
+ * calibrates the clock (around one millisecond), unless bxitime_fast_calibrate()
+ * has been called before.
+ *
+ * @return the current value of the fast clock
+ */
+uint64_t bxitime_fast_ticks(void);
+
+/**
+ * Calibrate the fast clock, if not done already.
+ *
+ * It takes around one millisecond: calling it at initialization time keeps this
+ * delay out of the first bxitime_fast_ticks() call.
+ *
+ * This function is thread-safe.
+ */
+void bxitime_fast_calibrate(void);
+
+/**
+ * Convert the given fast clock value (returned by bxitime_fast_ticks())
+ * into a CLOCK_REALTIME timestamp.
+ *
+ * The conversion is anchored to CLOCK_REALTIME and the fast clock frequency is
+ * measured again every BXITIME_FAST_ANCHOR_PERIOD nanoseconds by the converting
+ * threads.
+ *
+ * This function is thread-safe.
+ *
+ * @param[in] ticks a value returned by bxitime_fast_ticks()
+ * @param[out] time the timespec data structure to fill with the result
+ */
+void bxitime_fast_to_timespec(uint64_t ticks, struct timespec * time);
+#endif
+
 #endif /* BXIMISC_H_ */
@@ -386,7 +386,9 @@ bxierr_p bxizmq_data_snd(const void * data, size_t size, void * zocket,
  * This means that the given *data pointer should not be used afterwards!
  *
  * The given data will be freed using the given 'ffn' function with the data
- * and the given hint in parameter. If you need a simple free(data)
+ * and the given hint in parameter, whether the data has been sent or not.
+ * Therefore, a reference counted buffer can be sent to several zockets: each call
+ * releases exactly one reference. If you need a simple free(data)
  * without the hint, use bxizmq_data_free() as in the following:
  *
  *      bxizmq_snd_msg_zc(data, size, zocket, flags, retries_max, delay_ns,
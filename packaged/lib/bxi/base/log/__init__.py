@@ -71,6 +71,15 @@ except BXILogConfigError:
     logging.output("Dynamic reconfiguration of the logging system")
 ~~~~~~~~~
 
+Changing the logging levels only does not require such a cleanup: the filters of
+a given handler can be replaced while logging with reconfigure_filters().
+Pending logs are not lost, and handlers are not restarted:
+
+~~~~~~~~~{.py}
+# Handlers are ranked in the order of the 'handlers' configuration entry
+logging.reconfigure_filters(0, ':output,bxi.foo:debug')
+~~~~~~~~~
+
 Configuration
 ---------------
 
@@ -448,6 +457,43 @@ def flush():
     bxierr.BXICError.raise_if_ko(err_p)
 
 
+def reconfigure_filters(handler_rank, filters):
+    """
+    Replace the filters of the given handler without reinitializing the logging system.
+
+    The level of each logger is computed again according to the new filters.
+
+    @param[in] handler_rank the rank of the handler, in the order of the 'handlers'
+                            configuration entry
+    @param[in] filters the new filters, as a string (see ::bxilog_filters_parse())
+                       or as returned by bxi.base.log.filter.parse_filters()
+
+    @return
+    """
+    from . import filter as bxilogfilter
+    if isinstance(filters, six.string_types):
+        filters = bxilogfilter.parse_filters(filters)
+    # The C library owns the filters from now on
+    err_p = __BXIBASE_CAPI__.bxilog_reconfigure_filters(handler_rank, filters._cstruct)
+    bxierr.BXICError.raise_if_ko(err_p)
+
+
+def remove_handler(handler_rank):
+    """
+    Stop the given handler without reinitializing the logging system.
+
+    Records already sent to the handler are processed before it exits.
+    Ranks of other handlers are left unchanged.
+
+    @param[in] handler_rank the rank of the handler, in the order of the 'handlers'
+                            configuration entry
+
+    @return
+    """
+    err_p = __BXIBASE_CAPI__.bxilog_remove_handler(handler_rank)
+    bxierr.BXICError.raise_if_ko(err_p)
+
+
 def get_all_loggers_iter():
     """
     Return an iterator over all loggers.
@@ -462,6 +508,43 @@ def get_all_loggers_iter():
         yield bxilogger.BXILogger(loggers_array[i])
 
 
+def get_stats():
+    """
+    Return the statistics of all logs produced so far.
+
+    Counts are given by level name in the 'levels' dictionaries.
+
+    @return a dictionary with global counters and a 'loggers' dictionary
+            of per-logger counters (indexed by logger name)
+    """
+    stats_p = __FFI__.new('bxilog_stats_p[1]')
+    err_p = __BXIBASE_CAPI__.bxilog_stats_get(stats_p)
+    bxierr.BXICError.raise_if_ko(err_p)
+
+    def _levels(level_nb):
+        return dict((LEVEL_NAMES[i], level_nb[i]) for i in range(len(LEVEL_NAMES)))
+
+    try:
+        stats = stats_p[0]
+        loggers = dict()
+        for i in range(stats.loggers_nb):
+            logger = stats.loggers[i]
+            name = __FFI__.string(logger.name).decode('utf-8', 'replace')
+            loggers[name] = {'log_nb': logger.log_nb,
+                             'bytes': logger.bytes,
+                             'levels': _levels(logger.level_nb)}
+        return {'threads_nb': stats.threads_nb,
+                'log_nb': stats.log_nb,
+                'bytes': stats.bytes,
+                'min_log_size': stats.min_log_size,
+                'max_log_size': stats.max_log_size,
+                'rsz_log_nb': stats.rsz_log_nb,
+                'levels': _levels(stats.level_nb),
+                'loggers': loggers}
+    finally:
+        __BXIBASE_CAPI__.bxilog_stats_destroy(stats_p)
+
+
 def get_default_logger():
     """
     Return the root logger.
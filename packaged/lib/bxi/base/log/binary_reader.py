@@ -0,0 +1,119 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+"""
+@file binary_reader.py bxilog binary log files reader
+@author Pierre Vignéras <<pierre.vigneras@bull.net>>
+@copyright 2018 Bull S.A.S.  -  All rights reserved.\n
+           This is not Free or Open Source software.\n
+           Please contact Bull SAS for details about its license.\n
+           Bull - Rue Jean Jaures - B.P. 68 - 78340 Les Clayes-sous-Bois
+@namespace bxi.base.log.binary_reader bxilog binary log files reader
+
+Read the files written by the ::BXILOG_BINARY_FILE_HANDLER:
+
+    with BinaryReader('/tmp/foo.bxilog') as reader:
+        for entry in reader:
+            print(entry.loggername, entry.logmsg)
+
+"""
+from __future__ import print_function
+
+import collections
+
+import bxi.base as bxibase
+import bxi.base.err as bxierr
+
+
+# Find the C library
+__FFI__ = bxibase.get_ffi()
+__BXIBASE_CAPI__ = bxibase.get_capi()
+
+"""
+A record read from a binary log file.
+
+@see ::bxilog_binary_entry_s
+"""
+Entry = collections.namedtuple('Entry', ['level', 'sec', 'nsec', 'pid', 'tid',
+                                         'thread_rank', 'line_nb', 'progname',
+                                         'filename', 'funcname', 'loggername',
+                                         'logmsg', 'text'])
+
+
+def _str(cstr):
+    return __FFI__.string(cstr).decode('utf-8', 'replace')
+
+
+class BinaryReader(object):
+    """
+    Wraps the ::bxilog_binary_reader_p object.
+
+    Iterating over a reader gives its records as Entry objects, the text field
+    holding the lines the ::BXILOG_FILE_HANDLER would have written.
+    """
+
+    def __init__(self, filename):
+        """
+        Open the given binary log file.
+
+        @param[in] filename the file to read, '-' for the standard input
+        @exception bxi.base.err.BXICError if the file can't be opened
+        """
+        reader_p = __FFI__.new('bxilog_binary_reader_p[1]')
+        err_p = __BXIBASE_CAPI__.bxilog_binary_reader_new(filename.encode('utf-8'),
+                                                          reader_p)
+        bxierr.BXICError.raise_if_ko(err_p)
+        self._reader_p = reader_p
+        self._buf_p = __FFI__.new('char *[1]')
+        self._buf_size_p = __FFI__.new('size_t[1]')
+
+    def __iter__(self):
+        entry_p = __FFI__.new('bxilog_binary_entry_p[1]')
+        while True:
+            err_p = __BXIBASE_CAPI__.bxilog_binary_reader_next(self._reader_p[0],
+                                                               entry_p)
+            bxierr.BXICError.raise_if_ko(err_p)
+            entry = entry_p[0]
+            if entry == __FFI__.NULL:
+                return
+            yield self._entry(entry)
+
+    def _entry(self, entry):
+        length = __BXIBASE_CAPI__.bxilog_binary_entry_text(entry,
+                                                           self._buf_p,
+                                                           self._buf_size_p)
+        text = __FFI__.buffer(self._buf_p[0], length)[:].decode('utf-8', 'replace')
+        logmsg = __FFI__.buffer(entry.logmsg, entry.logmsg_len)[:]
+        return Entry(level=entry.level,
+                     sec=entry.sec,
+                     nsec=entry.nsec,
+                     pid=entry.pid,
+                     tid=entry.tid,
+                     thread_rank=entry.thread_rank,
+                     line_nb=entry.line_nb,
+                     progname=_str(entry.progname),
+                     filename=_str(entry.filename),
+                     funcname=_str(entry.funcname),
+                     loggername=_str(entry.loggername),
+                     logmsg=logmsg.decode('utf-8', 'replace'),
+                     text=text)
+
+    def close(self):
+        """
+        Close the reader.
+
+        @exception bxi.base.err.BXICError if closing the file fails
+        """
+        if self._reader_p[0] == __FFI__.NULL:
+            return
+        if self._buf_p[0] != __FFI__.NULL:
+            __BXIBASE_CAPI__.free(self._buf_p[0])
+            self._buf_p[0] = __FFI__.NULL
+        err_p = __BXIBASE_CAPI__.bxilog_binary_reader_destroy(self._reader_p)
+        bxierr.BXICError.raise_if_ko(err_p)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        self.close()
+        return False
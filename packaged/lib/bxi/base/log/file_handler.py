@@ -33,6 +33,14 @@ FILTERS_AUTO = 'auto'
 STDOUT = '-'
 STDERR = '+'
 
+"""
+Values of the 'format' option: text lines, or records read back with bxilog-cat.
+
+@see ::BXILOG_BINARY_FILE_HANDLER
+"""
+FORMAT_TEXT = 'text'
+FORMAT_BINARY = 'binary'
+
 
 def add_handler(configobj, section_name, c_config):
     """
@@ -50,6 +58,11 @@ def add_handler(configobj, section_name, c_config):
         filename = os.path.abspath(filename)
     section['path'] = filename
     append = section.as_bool('append')
+    fmt = section.get('format', FORMAT_TEXT)
+    if fmt not in [FORMAT_TEXT, FORMAT_BINARY]:
+        raise bxierr.BXIError("Unknown file handler format '%s' in section %s, "
+                              "expecting '%s' or '%s'" % (fmt, section_name,
+                                                          FORMAT_TEXT, FORMAT_BINARY))
 
     if filters_str == FILTERS_AUTO:
         # Compute file filters automatically according to console handler filters
@@ -82,8 +95,11 @@ def add_handler(configobj, section_name, c_config):
     open_flags = __FFI__.cast('int',
                               os.O_CREAT |
                               (os.O_APPEND if append else os.O_TRUNC))
+    handler = __BXIBASE_CAPI__.BXILOG_FILE_HANDLER
+    if fmt == FORMAT_BINARY:
+        handler = __BXIBASE_CAPI__.BXILOG_BINARY_FILE_HANDLER
     __BXIBASE_CAPI__.bxilog_config_add_handler(c_config,
-                                               __BXIBASE_CAPI__.BXILOG_FILE_HANDLER,
+                                               handler,
                                                file_filters._cstruct,
                                                c_config.progname,
                                                filename,
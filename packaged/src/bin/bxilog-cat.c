@@ -0,0 +1,87 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+/*
+ * Print the records of binary log files as the text lines the file handler would
+ * have written, as cat does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sysexits.h>
+
+#include <bxi/base/err.h>
+#include <bxi/base/mem.h>
+#include <bxi/base/log/binary_reader.h>
+
+// Lines are written a buffer at a time
+#define OUT_BUF_SIZE (1024 * 1024)
+
+static bxierr_p _cat(const char * filename, char ** buf, size_t * buf_size) {
+    bxilog_binary_reader_p reader;
+    bxierr_p err = bxilog_binary_reader_new(filename, &reader), err2;
+    if (bxierr_isko(err)) return err;
+
+    while (true) {
+        bxilog_binary_entry_p entry;
+        err2 = bxilog_binary_reader_next(reader, &entry);
+        BXIERR_CHAIN(err, err2);
+        if (bxierr_isko(err) || NULL == entry) break;
+
+        const size_t len = bxilog_binary_entry_text(entry, buf, buf_size);
+        if (len != fwrite(*buf, 1, len, stdout)) {
+            err2 = bxierr_errno("Writing to the standard output failed");
+            BXIERR_CHAIN(err, err2);
+            break;
+        }
+    }
+
+    err2 = bxilog_binary_reader_destroy(&reader);
+    BXIERR_CHAIN(err, err2);
+
+    return err;
+}
+
+int main(int argc, char * argv[]) {
+    if (2 <= argc && (0 == strcmp("-h", argv[1]) || 0 == strcmp("--help", argv[1]))) {
+        printf("Usage: %s [file...]\n\n"
+               "Print binary log files as text, the standard input when no file "
+               "or '-' is given.\n", basename(argv[0]));
+        return EX_OK;
+    }
+
+    setvbuf(stdout, NULL, _IOFBF, OUT_BUF_SIZE);
+
+    int rc = EX_OK;
+    char * buf = NULL;
+    size_t buf_size = 0;
+    const int files_nb = (1 == argc) ? 1 : argc - 1;
+    for (int i = 0; i < files_nb; i++) {
+        const char * filename = (1 == argc) ? "-" : argv[i + 1];
+        bxierr_p err = _cat(filename, &buf, &buf_size);
+        if (bxierr_isko(err)) {
+            // What has been read so far is printed before the error
+            fflush(stdout);
+            fprintf(stderr, "%s: %s\n", basename(argv[0]), err->msg);
+            bxierr_destroy(&err);
+            rc = EX_DATAERR;
+        }
+    }
+    BXIFREE(buf);
+
+    if (0 != fflush(stdout)) rc = EX_IOERR;
+    return rc;
+}
@@ -17,6 +17,7 @@
 #include <stdio.h>
 #include <errno.h>
 #include <signal.h>
+#include <pthread.h>
 #include <sys/syscall.h>
 #include <backtrace.h>
 #include <backtrace-supported.h>
@@ -31,6 +32,7 @@
 #define OK_MSG "No problem found - everything is ok"
 
 #define BACKTRACE_MAX 64 // Number of maximum depth of a backtrace
+#define BT_CACHE_INITIAL_SIZE 1024 // Initial number of slots of the address cache
 #define ERR_BT_PREFIX   "##trce## "
 #define ERR_CODE_PREFIX "##code## "
 #define ERR_MSG_PREFIX  "##mesg## "
@@ -40,6 +42,12 @@
 // ********************************** Types ****************************************
 // *********************************************************************************
 
+// An entry of the process-wide cache of symbolized addresses
+typedef struct {
+    uintptr_t pc;                   // 0 for an empty slot
+    char * str;                     // Human representation of pc (never freed)
+} bt_cache_entry_s;
+
 // *********************************************************************************
 // **************************** Static function declaration ************************
 // *********************************************************************************
@@ -47,7 +55,14 @@ static void _err_list_init(bxierr_list_p errlist);
 static int _bt_full_cb(void *data, uintptr_t pc,
                        const char *filename, int lineno, const char *function);
 static void _bt_error_cb(void *data, const char *msg, int errnum);
-static char** _pretty_backtrace(void* addresses[], int array_size);
+static int _get_tid(void);
+static size_t _bt_format(void * addresses[], int addresses_nb, int tid, char ** result);
+static const char * _bt_symbol(void * address);
+static char * _bt_cache_get(uintptr_t pc);
+static const char * _bt_cache_put(uintptr_t pc, char * str);
+static void _bt_symbolize(bxierr_p self);
+static void _bt_cache_lock(void);
+static void _bt_cache_unlock(void);
 static void __bt_init__(void);
 // *********************************************************************************
 // ********************************** Global Variables *****************************
@@ -66,6 +81,13 @@ const int BXIERR_CAUSED_BY_STR_LEN = ARRAYLEN(CAUSED_BY_STR);
 
 struct backtrace_state * BT_STATE = NULL;
 
+// Symbolizing an address is expensive: results are kept for the process lifetime.
+// Open addressing, linear probing, resized when half full.
+static pthread_mutex_t BT_CACHE_LOCK = PTHREAD_MUTEX_INITIALIZER;
+static bt_cache_entry_s * BT_CACHE = NULL;
+static size_t BT_CACHE_SIZE = 0;
+static size_t BT_CACHE_NB = 0;
+
 // *********************************************************************************
 // ********************************** Implementation   *****************************
 // *********************************************************************************
@@ -89,18 +111,23 @@ bxierr_p bxierr_new(int code,
                     const char * fmt,
                     ...) {
 
-    bxierr_p self = bximem_calloc(sizeof(*self));
-    self->code = code;
-
-    if(code & BXIERR_NO_BACKTRACE)
-    {
-        self->backtrace_len = 0;
-        self->backtrace = NULL;
-        self->code = self->code & (~BXIERR_NO_BACKTRACE);
-    }else{
-        char * tmp = NULL;
-        self->backtrace_len = bxierr_backtrace_str(&tmp);
-        self->backtrace = tmp;
+    // Only the return addresses are captured here, they are stored with the error
+    // itself. They are symbolized when the error is reported, if it ever is.
+    void * addresses[BACKTRACE_MAX];
+    int addresses_nb = 0;
+    if (!(code & BXIERR_NO_BACKTRACE)) addresses_nb = backtrace(addresses,
+                                                                BACKTRACE_MAX);
+
+    const size_t pcs_size = (size_t) addresses_nb * sizeof(*addresses);
+    bxierr_p self = bximem_calloc(sizeof(*self) + pcs_size);
+    self->code = code & (~BXIERR_NO_BACKTRACE);
+    self->backtrace_len = 0;
+    self->backtrace = NULL;
+    if (0 < addresses_nb) {
+        self->bt_pcs = (void **) (self + 1);
+        memcpy(self->bt_pcs, addresses, pcs_size);
+        self->bt_pcs_nb = addresses_nb;
+        self->bt_tid = _get_tid();
     }
     self->data = data;
     self->free_fn = free_fn;
@@ -215,6 +242,7 @@ void bxierr_report_add_from_limit(bxierr_p self, bxierr_report_p report, size_t
 
     char * result = bxistr_new(ERR_CODE_PREFIX"%d\n%s", self->code, final_msg);
 
+    _bt_symbolize(self);
     char * bt = (NULL == self->backtrace) ? "" : self->backtrace;
     size_t bt_len = (NULL == self->backtrace) ? 1 : (self->backtrace_len + 1);
 
@@ -361,59 +389,10 @@ bxierr_p bxierr_vfromidx(const int erridx,
 }
 
 size_t bxierr_backtrace_str(char ** result) {
-    *result = NULL;
-    size_t size;
-    errno = 0;
-    FILE * faked_file = open_memstream(result, &size);
-    if (NULL == faked_file) {
-        perror("Calling open_memstream() failed");
-        *result = strdup("Unavailable backtrace (open_memstream() failed)");
-        return strlen(*result) + 1;
-    }
     void *addresses[BACKTRACE_MAX];
-    sigset_t orig_set;
-    sigset_t mask;
-    sigfillset(&mask);
-    sigemptyset(&orig_set);
-
-    int rc = pthread_sigmask(SIG_BLOCK, &mask, &orig_set);
-    if (rc != 0) {
-        perror("Calling pthread_sigmask() failed");
-        *result = strdup("Unavailable backtrace (pthread_sigmask() failed)");
-        return strlen(*result) + 1;
-    }
     int c = backtrace(addresses, BACKTRACE_MAX);
-    errno = 0;
-    char **symbols = backtrace_symbols(addresses, c);
-    char **strings = _pretty_backtrace(addresses, c);
 
-    rc = pthread_sigmask(SIG_SETMASK, &orig_set, NULL);
-    if (rc != 0) {
-        perror("Calling pthread_sigmask() unblocking failed");
-    }
-
-#ifdef __linux__
-    pid_t tid = (pid_t) syscall(SYS_gettid);
-#else
-    int tid;
-    bxierr_p err = bxilog_get_thread_rank(&tid);
-    if (BXIERR_OK != err) tid = -1;
-#endif
-    const char * const truncated = (c == BACKTRACE_MAX) ? "(truncated) " : "";
-
-    fprintf(faked_file,
-            ERR_BT_PREFIX"Backtrace of tid %d: %d function calls %s\n",
-            tid, c, truncated);
-    for(int i = 0; i < c; i++) {
-        fprintf(faked_file, ERR_BT_PREFIX"[%02d] %s\n", i,
-                NULL == strings[i] ? symbols[i] : strings[i]);
-        BXIFREE(strings[i]);
-    }
-    fprintf(faked_file,ERR_BT_PREFIX"Backtrace end\n");
-    fclose(faked_file);
-    BXIFREE(symbols);
-    BXIFREE(strings);
-    return size;
+    return _bt_format(addresses, c, _get_tid(), result);
 }
 
 void bxierr_assert_fail(const char *assertion, const char *file,
@@ -564,18 +543,144 @@ void _err_list_init(bxierr_list_p errlist) {
 }
 
 
-char** _pretty_backtrace(void* addresses[], int array_size) {
-    // Used to return the strings generated from the addresses
-    char** backtrace_strings = bximem_calloc(sizeof(*backtrace_strings) * (unsigned)array_size);
-    for(int i = 0; i < array_size; i++) {
-        int rc = backtrace_pcinfo(BT_STATE,
-                                  (uintptr_t) addresses[i],
-                                  _bt_full_cb,
-                                  _bt_error_cb,
-                                  &backtrace_strings[i]);
-        bxiassert(0 == rc);
+int _get_tid(void) {
+#ifdef __linux__
+    return (int) syscall(SYS_gettid);
+#else
+    int tid;
+    bxierr_p err = bxilog_get_thread_rank(&tid);
+    if (BXIERR_OK != err) tid = -1;
+    return tid;
+#endif
+}
+
+size_t _bt_format(void * addresses[], const int addresses_nb, const int tid,
+                  char ** result) {
+    *result = NULL;
+    size_t size;
+    errno = 0;
+    FILE * faked_file = open_memstream(result, &size);
+    if (NULL == faked_file) {
+        perror("Calling open_memstream() failed");
+        *result = strdup("Unavailable backtrace (open_memstream() failed)");
+        return strlen(*result) + 1;
+    }
+    sigset_t orig_set;
+    sigset_t mask;
+    sigfillset(&mask);
+    sigemptyset(&orig_set);
+
+    int rc = pthread_sigmask(SIG_BLOCK, &mask, &orig_set);
+    if (rc != 0) {
+        perror("Calling pthread_sigmask() failed");
+        fclose(faked_file);
+        BXIFREE(*result);
+        *result = strdup("Unavailable backtrace (pthread_sigmask() failed)");
+        return strlen(*result) + 1;
+    }
+
+    const char * const truncated = (addresses_nb == BACKTRACE_MAX) ? "(truncated) " : "";
+
+    fprintf(faked_file,
+            ERR_BT_PREFIX"Backtrace of tid %d: %d function calls %s\n",
+            tid, addresses_nb, truncated);
+    for(int i = 0; i < addresses_nb; i++) {
+        fprintf(faked_file, ERR_BT_PREFIX"[%02d] %s\n", i, _bt_symbol(addresses[i]));
+    }
+    fprintf(faked_file,ERR_BT_PREFIX"Backtrace end\n");
+    fclose(faked_file);
+
+    rc = pthread_sigmask(SIG_SETMASK, &orig_set, NULL);
+    if (rc != 0) {
+        perror("Calling pthread_sigmask() unblocking failed");
+    }
+
+    return size;
+}
+
+const char * _bt_symbol(void * const address) {
+    const uintptr_t pc = (uintptr_t) address;
+    char * str = _bt_cache_get(pc);
+    if (NULL != str) return str;
+
+    int rc = backtrace_pcinfo(BT_STATE, pc, _bt_full_cb, _bt_error_cb, &str);
+    bxiassert(0 == rc);
+    if (NULL == str) {
+        // No debug information: use the dynamic symbol table
+        char ** symbols = backtrace_symbols(&address, 1);
+        str = (NULL == symbols) ? bxistr_new("%p", address) : strdup(symbols[0]);
+        BXIFREE(symbols);
+    }
+    return _bt_cache_put(pc, str);
+}
+
+char * _bt_cache_get(const uintptr_t pc) {
+    char * result = NULL;
+    _bt_cache_lock();
+    if (0 < BT_CACHE_SIZE) {
+        for (size_t i = pc % BT_CACHE_SIZE; 0 != BT_CACHE[i].pc;
+             i = (i + 1) % BT_CACHE_SIZE) {
+            if (pc == BT_CACHE[i].pc) {
+                result = BT_CACHE[i].str;
+                break;
+            }
+        }
+    }
+    _bt_cache_unlock();
+    return result;
+}
+
+// Return the string cached for the given address: the first one given is kept, as
+// other threads may be using it already
+const char * _bt_cache_put(const uintptr_t pc, char * str) {
+    _bt_cache_lock();
+    if (2 * (BT_CACHE_NB + 1) > BT_CACHE_SIZE) {
+        const size_t new_size = (0 == BT_CACHE_SIZE) ?
+                                    BT_CACHE_INITIAL_SIZE :
+                                    2 * BT_CACHE_SIZE;
+        bt_cache_entry_s * new_cache = bximem_calloc(new_size * sizeof(*new_cache));
+        for (size_t i = 0; i < BT_CACHE_SIZE; i++) {
+            if (0 == BT_CACHE[i].pc) continue;
+            size_t j = BT_CACHE[i].pc % new_size;
+            while (0 != new_cache[j].pc) j = (j + 1) % new_size;
+            new_cache[j] = BT_CACHE[i];
+        }
+        BXIFREE(BT_CACHE);
+        BT_CACHE = new_cache;
+        BT_CACHE_SIZE = new_size;
     }
-    return backtrace_strings;
+    size_t i = pc % BT_CACHE_SIZE;
+    while (0 != BT_CACHE[i].pc && pc != BT_CACHE[i].pc) i = (i + 1) % BT_CACHE_SIZE;
+    const char * result = str;
+    if (0 == BT_CACHE[i].pc) {
+        BT_CACHE[i].pc = pc;
+        BT_CACHE[i].str = str;
+        BT_CACHE_NB++;
+    } else {
+        // Another thread symbolized the same address meanwhile
+        result = BT_CACHE[i].str;
+        BXIFREE(str);
+    }
+    _bt_cache_unlock();
+    return result;
+}
+
+void _bt_symbolize(bxierr_p self) {
+    if (NULL != self->backtrace || 0 == self->bt_pcs_nb) return;
+
+    char * tmp = NULL;
+    self->backtrace_len = _bt_format(self->bt_pcs, self->bt_pcs_nb, self->bt_tid, &tmp);
+    self->backtrace = tmp;
+}
+
+void _bt_cache_lock(void) {
+    int rc = pthread_mutex_lock(&BT_CACHE_LOCK);
+    bxiassert(0 == rc);
+}
+
+void _bt_cache_unlock(void) {
+    int rc = pthread_mutex_unlock(&BT_CACHE_LOCK);
+    bxiassert(0 == rc);
 }
 
 __attribute__((constructor)) void __bt_init__(void) {
@@ -583,6 +688,13 @@ __attribute__((constructor)) void __bt_init__(void) {
                                       BACKTRACE_SUPPORTS_THREADS,
                                       _bt_error_cb, NULL);
     bxiassert(NULL != BT_STATE);
+    // The cache must remain usable in the child whatever the parent threads do
+    int rc = pthread_atfork(_bt_cache_lock, _bt_cache_unlock, _bt_cache_unlock);
+    bxiassert(0 == rc);
+    // The first call to backtrace() loads libgcc: do it now rather than in the
+    // middle of an error creation
+    void * address;
+    backtrace(&address, 1);
 }
 
 void _bt_error_cb(void *data, const char *msg, int errnum) {
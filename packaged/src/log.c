@@ -81,8 +81,10 @@ static bxierr_p _cleanup(void);
 
 static bxierr_p _start_handler_thread(bxilog_handler_p handler,
                                       bxilog_handler_param_p param);
-static bxierr_p _sync_handler();
+static bxierr_p _sync_handler(void * ctrl_zocket);
+static bxierr_p _stop_handler(size_t handler_rank, bxierr_p *handler_err);
 static bxierr_p _join_handler(size_t handler_rank, bxierr_p *handler_err);
+static bxierr_p _send_handler_filters(size_t handler_rank);
 static void _setprocname();
 static bxierr_p _zmq_str_rcv_timeout(void * zocket, char ** reply, long timeout);
 //*********************************************************************************
@@ -146,6 +148,9 @@ bxierr_p bxilog_init(bxilog_config_p config) {
 
     _setprocname(BXILOG__GLOBALS->config->progname);
 
+    // Calibrated now rather than by the first log call
+    if (BXILOG__GLOBALS->config->fast_clock) bxitime_fast_calibrate();
+
     err = bxilog__init_globals();
     if (bxierr_isko(err)) {
         BXILOG__GLOBALS->state = BROKEN;
@@ -278,7 +283,9 @@ bxierr_p bxilog_flush(void) {
     if (bxierr_isko(err)) return err;
     void * ctl_channel = tsd->ctrl_channel;
     bxierr_list_p errlist = bxierr_list_new();
-    for (size_t i = 0; i < BXILOG__GLOBALS->internal_handlers_nb; i++) {
+    // One request per handler the control channel is connected to
+    for (size_t i = 0; i < tsd->handlers_nb; i++) {
+        if (!tsd->connected[i]) continue;
 
         int ret = pthread_kill(BXILOG__GLOBALS->handlers_threads[i], 0);
         if (ESRCH == ret) continue;
@@ -318,6 +325,211 @@ bxierr_p bxilog_flush(void) {
     return BXIERR_OK;
 }
 
+bxierr_p bxilog_reconfigure_filters(size_t handler_rank, bxilog_filters_p filters) {
+    bxiassert(NULL != filters);
+    bxierr_p err = BXIERR_OK, err2;
+    int rc = pthread_mutex_lock(&BXILOG_INITIALIZED_MUTEX);
+    if (0 != rc) {
+        bxilog_filters_destroy(&filters);
+        return bxierr_fromidx(rc, NULL,
+                              "Calling pthread_mutex_lock() failed (rc=%d)", rc);
+    }
+
+    if (INITIALIZED != BXILOG__GLOBALS->state) {
+        err = bxierr_new(BXILOG_ILLEGAL_STATE_ERR,
+                         NULL, NULL, NULL, NULL,
+                         "Illegal state: %d", BXILOG__GLOBALS->state);
+        bxilog_filters_destroy(&filters);
+        goto UNLOCK;
+    }
+    if (handler_rank >= BXILOG__GLOBALS->internal_handlers_nb ||
+        BXI_LOG_HANDLER_REMOVED == BXILOG__GLOBALS->config->handlers_params[handler_rank]->status) {
+        err = bxierr_gen("No handler of rank %zu (%zu handlers)",
+                         handler_rank, BXILOG__GLOBALS->internal_handlers_nb);
+        bxilog_filters_destroy(&filters);
+        goto UNLOCK;
+    }
+
+    bxilog_handler_param_p param = BXILOG__GLOBALS->config->handlers_params[handler_rank];
+    bxilog_filters_p old = param->filters;
+    param->filters = filters;
+
+    // The handler is told first: it processes what it has already received with
+    // the old filters, then uses the new ones. Only then loggers are reconfigured,
+    // so records accepted by the new filters only are not sent before that.
+    err = _send_handler_filters(handler_rank);
+    if (bxierr_isko(err)) {
+        param->filters = old;
+        bxilog_filters_destroy(&filters);
+        goto UNLOCK;
+    }
+    err2 = bxilog__config_handler_filters(handler_rank);
+    BXIERR_CHAIN(err, err2);
+    bxilog_filters_destroy(&old);
+
+UNLOCK:
+    rc = pthread_mutex_unlock(&BXILOG_INITIALIZED_MUTEX);
+    if (0 != rc) {
+        BXILOG__GLOBALS->state = ILLEGAL;
+        err2 = bxierr_fromidx(rc, NULL,
+                              "Calling pthread_mutex_unlock() failed (rc=%d)", rc);
+        BXIERR_CHAIN(err, err2);
+    }
+
+    return err;
+}
+bxierr_p bxilog_add_handler(bxilog_handler_p handler, bxilog_filters_p filters,
+                            size_t * rank, ...) {
+    bxiassert(NULL != handler);
+    bxiassert(NULL != rank);
+    bxierr_p err = BXIERR_OK, err2;
+    int rc = pthread_mutex_lock(&BXILOG_INITIALIZED_MUTEX);
+    if (0 != rc) {
+        bxilog_filters_destroy(&filters);
+        return bxierr_fromidx(rc, NULL,
+                              "Calling pthread_mutex_lock() failed (rc=%d)", rc);
+    }
+
+    bxilog_config_p config = BXILOG__GLOBALS->config;
+    if (INITIALIZED != BXILOG__GLOBALS->state) {
+        err = bxierr_new(BXILOG_ILLEGAL_STATE_ERR,
+                         NULL, NULL, NULL, NULL,
+                         "Illegal state: %d", BXILOG__GLOBALS->state);
+        bxilog_filters_destroy(&filters);
+        goto UNLOCK;
+    }
+    // Ranks are not reused: threads might not have left a removed handler yet
+    const size_t new_rank = config->handlers_nb;
+    bxiassert(new_rank == BXILOG__GLOBALS->internal_handlers_nb);
+    if (new_rank >= config->handlers_max) {
+        err = bxierr_gen("Can't add handler %s: %zu handlers have already been added "
+                         "(see bxilog_config_s.handlers_max)",
+                         handler->name, config->handlers_max);
+        bxilog_filters_destroy(&filters);
+        goto UNLOCK;
+    }
+
+    va_list ap;
+    va_start(ap, rank);
+    bxilog_handler_param_p param = handler->param_new(handler, filters, ap);
+    va_end(ap);
+    // Room has been reserved by bxilog_init()
+    config->handlers[new_rank] = handler;
+    config->handlers_params[new_rank] = param;
+
+    if (NULL != BXILOG__GLOBALS->ring_sets) {
+        bxilog__ring_set_p set = &BXILOG__GLOBALS->ring_sets[new_rank];
+        err = bxilog__ring_set_init(set);
+        if (bxierr_isko(err)) {
+            if (NULL != handler->param_destroy) {
+                err2 = handler->param_destroy(&param);
+                BXIERR_CHAIN(err, err2);
+            }
+            goto UNLOCK;
+        }
+        set->overflow_policy = param->overflow_policy;
+        set->overflow_level = param->overflow_level;
+        set->prio_level = param->prio_level;
+        set->prio_overflow_policy = param->prio_overflow_policy;
+    }
+
+    err = _start_handler_thread(handler, param);
+    if (bxierr_isok(err)) {
+        // The thread-specific control channel is not connected to the new handler
+        void * zocket = NULL;
+        err = bxizmq_zocket_create_connected(BXILOG__GLOBALS->zmq_ctx, ZMQ_REQ,
+                                             param->ctrl_url, &zocket);
+        if (bxierr_isok(err)) err = _sync_handler(zocket);
+        err2 = bxizmq_zocket_destroy(&zocket);
+        BXIERR_CHAIN(err, err2);
+    }
+    if (BXILOG__GLOBALS->internal_handlers_nb == new_rank) {
+        // The thread has not been created, nothing has been published
+        if (NULL != BXILOG__GLOBALS->ring_sets) {
+            err2 = bxilog__ring_set_destroy(&BXILOG__GLOBALS->ring_sets[new_rank]);
+            BXIERR_CHAIN(err, err2);
+        }
+        if (NULL != handler->param_destroy) {
+            err2 = handler->param_destroy(&param);
+            BXIERR_CHAIN(err, err2);
+        }
+        goto UNLOCK;
+    }
+    if (bxierr_isko(err)) {
+        // A handler replying with an error has already been joined
+        if (BXI_LOG_HANDLER_ERROR != param->status) {
+            bxierr_p handler_err = BXIERR_OK;
+            err2 = _stop_handler(new_rank, &handler_err);
+            BXIERR_CHAIN(err, err2);
+            BXIERR_CHAIN(err, handler_err);
+        }
+        // It is released by bxilog_finalize()
+        param->status = BXI_LOG_HANDLER_REMOVED;
+    }
+
+    // Loggers are configured before threads send records to the handler
+    err2 = bxilog__config_handler_filters(new_rank);
+    BXIERR_CHAIN(err, err2);
+    __atomic_store_n(&config->handlers_nb, new_rank + 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&BXILOG__GLOBALS->handlers_gen, 1, __ATOMIC_RELEASE);
+    *rank = new_rank;
+
+UNLOCK:
+    rc = pthread_mutex_unlock(&BXILOG_INITIALIZED_MUTEX);
+    if (0 != rc) {
+        BXILOG__GLOBALS->state = ILLEGAL;
+        err2 = bxierr_fromidx(rc, NULL,
+                              "Calling pthread_mutex_unlock() failed (rc=%d)", rc);
+        BXIERR_CHAIN(err, err2);
+    }
+
+    return err;
+}
+
+bxierr_p bxilog_remove_handler(size_t handler_rank) {
+    bxierr_p err = BXIERR_OK, err2;
+    int rc = pthread_mutex_lock(&BXILOG_INITIALIZED_MUTEX);
+    if (0 != rc) return bxierr_fromidx(rc, NULL,
+                                       "Calling pthread_mutex_lock() failed (rc=%d)", rc);
+
+    if (INITIALIZED != BXILOG__GLOBALS->state) {
+        err = bxierr_new(BXILOG_ILLEGAL_STATE_ERR,
+                         NULL, NULL, NULL, NULL,
+                         "Illegal state: %d", BXILOG__GLOBALS->state);
+        goto UNLOCK;
+    }
+    if (handler_rank >= BXILOG__GLOBALS->internal_handlers_nb ||
+        BXI_LOG_HANDLER_REMOVED == BXILOG__GLOBALS->config->handlers_params[handler_rank]->status) {
+        err = bxierr_gen("No handler of rank %zu (%zu handlers)",
+                         handler_rank, BXILOG__GLOBALS->internal_handlers_nb);
+        goto UNLOCK;
+    }
+
+    // Records are not sent to the handler anymore: loggers skip it and threads
+    // leave it on their next log
+    bxilog_handler_param_p param = BXILOG__GLOBALS->config->handlers_params[handler_rank];
+    __atomic_store_n(&param->status, BXI_LOG_HANDLER_REMOVED, __ATOMIC_RELEASE);
+    err2 = bxilog__config_handler_filters(handler_rank);
+    BXIERR_CHAIN(err, err2);
+    __atomic_add_fetch(&BXILOG__GLOBALS->handlers_gen, 1, __ATOMIC_RELEASE);
+
+    // It processes the records it has already received before exiting
+    bxierr_p handler_err = BXIERR_OK;
+    err2 = _stop_handler(handler_rank, &handler_err);
+    BXIERR_CHAIN(err, err2);
+    BXIERR_CHAIN(err, handler_err);
+
+UNLOCK:
+    rc = pthread_mutex_unlock(&BXILOG_INITIALIZED_MUTEX);
+    if (0 != rc) {
+        BXILOG__GLOBALS->state = ILLEGAL;
+        err2 = bxierr_fromidx(rc, NULL,
+                              "Calling pthread_mutex_unlock() failed (rc=%d)", rc);
+        BXIERR_CHAIN(err, err2);
+    }
+
+    return err;
+}
 
 void bxilog_display_loggers(int fd) {
     char ** level_names;
@@ -369,7 +581,9 @@ void bxilog__wipeout() {
 
 bxierr_p bxilog__init_globals() {
     BXILOG__GLOBALS->pid = getpid();
-    pthread_t * threads = bximem_calloc(BXILOG__GLOBALS->config->handlers_nb * sizeof(*threads));
+    // Room is left for the handlers added later on (see bxilog_add_handler())
+    const size_t handlers_max = BXILOG__GLOBALS->config->handlers_max;
+    pthread_t * threads = bximem_calloc(handlers_max * sizeof(*threads));
     BXILOG__GLOBALS->internal_handlers_nb = 0;
     BXILOG__GLOBALS->handlers_threads = threads;
 
@@ -391,6 +605,25 @@ bxierr_p bxilog__init_globals() {
 
     BXILOG__GLOBALS->zmq_ctx = ctx;
 
+    if (BXILOG_TRANSPORT_RING == BXILOG__GLOBALS->config->transport) {
+        bxiassert(NULL == BXILOG__GLOBALS->ring_sets);
+        size_t n = BXILOG__GLOBALS->config->handlers_nb;
+        BXILOG__GLOBALS->ring_sets = bximem_calloc(handlers_max *
+                                                   sizeof(*BXILOG__GLOBALS->ring_sets));
+        // Make the whole array safe to destroy even if an initialization fails
+        for (size_t i = 0; i < handlers_max; i++) BXILOG__GLOBALS->ring_sets[i].wakeup_fd = -1;
+        for (size_t i = 0; i < n; i++) {
+            bxilog__ring_set_p set = &BXILOG__GLOBALS->ring_sets[i];
+            bxilog_handler_param_p param = BXILOG__GLOBALS->config->handlers_params[i];
+            err = bxilog__ring_set_init(set);
+            if (bxierr_isko(err)) return err;
+            set->overflow_policy = param->overflow_policy;
+            set->overflow_level = param->overflow_level;
+            set->prio_level = param->prio_level;
+            set->prio_overflow_policy = param->prio_overflow_policy;
+        }
+    }
+
     rc = pthread_once(&BXILOG__GLOBALS->tsd_key_once, bxilog__tsd_key_new);
     if (0 != rc) {
         BXILOG__GLOBALS->state = ILLEGAL;
@@ -424,6 +657,9 @@ bxierr_p bxilog__start_handlers(void) {
     }
 
     // Synchronizing handlers
+    tsd_p tsd;
+    bxierr_p fatal_err = bxilog__tsd_get(&tsd);
+    bxierr_abort_ifko(fatal_err);
     for (size_t i = 0; i < BXILOG__GLOBALS->config->handlers_nb; i++) {
         bxilog_handler_p handler = BXILOG__GLOBALS->config->handlers[i];
         if (NULL == handler) {
@@ -431,7 +667,9 @@ bxierr_p bxilog__start_handlers(void) {
             bxierr_list_append(errlist, ierr);
             continue;
         }
-        bxierr_p ierr = _sync_handler();
+        // We send only 1 message per handler but we don't know
+        // which one will get it. The one who replies will be synced.
+        bxierr_p ierr = _sync_handler(tsd->ctrl_channel);
         if (bxierr_isko(ierr)) bxierr_list_append(errlist, ierr);
     }
 
@@ -465,6 +703,10 @@ bxierr_p bxilog__finalize(void) {
     err2 = _cleanup();
     BXIERR_CHAIN(err, err2);
 
+    // Handlers are given contiguous ranks again on the next initialization
+    err2 = bxilog__config_release_removed();
+    BXIERR_CHAIN(err, err2);
+
     return err;
 }
 
@@ -476,63 +718,13 @@ bxierr_p bxilog__stop_handlers(void) {
     bxierr_list_p errlist = bxierr_list_new();
 
     for (size_t i = 0; i < BXILOG__GLOBALS->internal_handlers_nb; i++) {
-        pthread_t handler_thread = BXILOG__GLOBALS->handlers_threads[i];
-        int ret = pthread_kill(handler_thread, 0);
-
-        if (ESRCH == ret) continue;
-
-        char * url = BXILOG__GLOBALS->config->handlers_params[i]->ctrl_url;
-        bxiassert(NULL != url);
-
-        void * zocket = NULL;
-        err2 = bxizmq_zocket_create_connected(BXILOG__GLOBALS->zmq_ctx,
-                                              ZMQ_REQ,
-                                              url,
-                                              &zocket);
-        BXIERR_CHAIN(err, err2);
-        bxierr_abort_ifko(err);
-
-        err2 = bxizmq_str_snd(EXIT_CTRL_MSG_REQ, zocket, 0, 0, 0);
-        BXIERR_CHAIN(err, err2);
-
-        char * msg = NULL;
-        // FIXME: this _zmq_str_rcv_timeout() looks strange to me??
-        // We might be able to replace it by a normal call to the bxizmq library.
-        // For the moment, it seems to work though
-        while (ret != ESRCH && msg == NULL) {
-            bxierr_destroy(&err2);
-            ret = pthread_kill(handler_thread, 0);
-            err2 = _zmq_str_rcv_timeout(zocket, &msg, 500);
-            if (ret == ESRCH && msg == NULL) {
-                bxierr_destroy(&err2);
-                break;
-            }
-            if (bxierr_isko(err2)) {
-                bxierr_destroy(&err2);
-            } else {
-                break;
-            }
-        }
-
-        err2 = bxizmq_zocket_destroy(&zocket);
-        BXIERR_CHAIN(err, err2);
-
-        if (ESRCH == ret && msg == NULL) continue;
-
-        if (NULL == msg || 0 != strncmp(EXIT_CTRL_MSG_REP, msg, ARRAYLEN(EXIT_CTRL_MSG_REP) - 1)) {
-            // We just notify the end user there is a minor problem, but
-            // returning such an error is useless at this point, we want to exit.
-            bxierr_p tmp = bxierr_new(BXIZMQ_PROTOCOL_ERR, NULL, NULL, NULL, NULL,
-                                      "Wrong message received. Expected: %s, received: %s",
-                                      EXIT_CTRL_MSG_REP, msg);
-            bxierr_report(&tmp, STDERR_FILENO);
-            BXIFREE(msg);
+        // Already joined
+        if (BXI_LOG_HANDLER_REMOVED == BXILOG__GLOBALS->config->handlers_params[i]->status) {
             continue;
         }
-        BXIFREE(msg);
 
         bxierr_p handler_err;
-        err2 = _join_handler(i, &handler_err);
+        err2 = _stop_handler(i, &handler_err);
         BXIERR_CHAIN(err, err2);
 
         if (bxierr_isko(handler_err)) bxierr_list_append(errlist, handler_err);
@@ -618,6 +810,14 @@ bxierr_p _reset_globals() {
     BXILOG__GLOBALS->internal_handlers_nb = 0;
     BXIFREE(BXILOG__GLOBALS->handlers_threads);
 
+    if (NULL != BXILOG__GLOBALS->ring_sets) {
+        for (size_t i = 0; i < BXILOG__GLOBALS->config->handlers_nb; i++) {
+            err2 = bxilog__ring_set_destroy(&BXILOG__GLOBALS->ring_sets[i]);
+            BXIERR_CHAIN(err, err2);
+        }
+        BXIFREE(BXILOG__GLOBALS->ring_sets);
+    }
+
     return err;
 }
 
@@ -635,6 +835,17 @@ bxierr_p _cleanup(void) {
 void _check_set_params(bxilog_config_p config) {
     bxiassert(NULL != config->progname);
     bxiassert(0 < config->tsd_log_buf_size);
+    bxiassert(BXILOG_TRANSPORT_RING != config->transport || 0 < config->ring_size);
+
+    // Reserve room for the handlers added by bxilog_add_handler() so that
+    // readers never see those arrays reallocated
+    if (config->handlers_max < config->handlers_nb) config->handlers_max = config->handlers_nb;
+    config->handlers = bximem_realloc(config->handlers,
+                                      config->handlers_nb * sizeof(*config->handlers),
+                                      config->handlers_max * sizeof(*config->handlers));
+    config->handlers_params = bximem_realloc(config->handlers_params,
+                                             config->handlers_nb * sizeof(*config->handlers_params),
+                                             config->handlers_max * sizeof(*config->handlers_params));
 
     BXILOG__GLOBALS->config = config;
 }
@@ -673,27 +884,21 @@ bxierr_p _start_handler_thread(bxilog_handler_p handler, bxilog_handler_param_p
     return err;
 }
 
-bxierr_p _sync_handler() {
-    tsd_p tsd;
-    bxierr_p fatal_err = bxilog__tsd_get(&tsd);
-    bxierr_abort_ifko(fatal_err);
+bxierr_p _sync_handler(void * ctrl_zocket) {
+    bxierr_p err = BXIERR_OK, err2, fatal_err;
 
-    bxierr_p err = BXIERR_OK, err2;
-
-    // We send only 1 message per handler but we don't know
-    // which one will get it. The one who replies will be synced.
-    err2 = bxizmq_str_snd(READY_CTRL_MSG_REQ, tsd->ctrl_channel,
+    err2 = bxizmq_str_snd(READY_CTRL_MSG_REQ, ctrl_zocket,
                           ZMQ_DONTWAIT, 1000, 1e3); // Retry 1000, wait 1 µs max
     BXIERR_CHAIN(err, err2);
     if (bxierr_isko(err)) return err;
 
     char * msg;
-    err2 = bxizmq_str_rcv(tsd->ctrl_channel, 0, false, &msg);
+    err2 = bxizmq_str_rcv(ctrl_zocket, 0, false, &msg);
     BXIERR_CHAIN(err, err2);
     // We always expect the rank to be sent!
     size_t *rank = NULL;
     size_t received_size;
-    err2 = bxizmq_data_rcv((void**)&rank, sizeof(*rank), tsd->ctrl_channel,
+    err2 = bxizmq_data_rcv((void**)&rank, sizeof(*rank), ctrl_zocket,
                            0, true, &received_size);
     BXIERR_CHAIN(err, err2);
 
@@ -718,6 +923,108 @@ bxierr_p _sync_handler() {
     return err;
 }
 
+bxierr_p _send_handler_filters(size_t handler_rank) {
+    int ret = pthread_kill(BXILOG__GLOBALS->handlers_threads[handler_rank], 0);
+    if (ESRCH == ret) return bxierr_gen("Handler of rank %zu has exited", handler_rank);
+
+    // The thread-specific control channel is connected to all handlers:
+    // this one reaches the given handler only
+    char * url = BXILOG__GLOBALS->config->handlers_params[handler_rank]->ctrl_url;
+    bxierr_p err = BXIERR_OK, err2;
+    void * zocket = NULL;
+    err2 = bxizmq_zocket_create_connected(BXILOG__GLOBALS->zmq_ctx,
+                                          ZMQ_REQ, url, &zocket);
+    BXIERR_CHAIN(err, err2);
+    if (bxierr_isko(err)) return err;
+
+    err2 = bxizmq_str_snd(FILTERS_CTRL_MSG_REQ, zocket, 0, 0, 0);
+    BXIERR_CHAIN(err, err2);
+
+    char * reply = NULL;
+    if (bxierr_isok(err)) {
+        err2 = bxizmq_str_rcv(zocket, 0, false, &reply);
+        BXIERR_CHAIN(err, err2);
+    }
+    if (bxierr_isok(err) && 0 != strcmp(FILTERS_CTRL_MSG_REP, reply)) {
+        err2 = bxierr_new(BXILOG_IHT2BC_PROTO_ERR,
+                          NULL, NULL, NULL, NULL,
+                          "Wrong message received in reply "
+                          "to %s: %s. Expecting: %s",
+                          FILTERS_CTRL_MSG_REQ, reply,
+                          FILTERS_CTRL_MSG_REP);
+        BXIERR_CHAIN(err, err2);
+    }
+    BXIFREE(reply);
+
+    err2 = bxizmq_zocket_destroy(&zocket);
+    BXIERR_CHAIN(err, err2);
+
+    return err;
+}
+
+bxierr_p _stop_handler(size_t handler_rank, bxierr_p *handler_err) {
+    *handler_err = BXIERR_OK;
+    bxierr_p err = BXIERR_OK, err2;
+    pthread_t handler_thread = BXILOG__GLOBALS->handlers_threads[handler_rank];
+    int ret = pthread_kill(handler_thread, 0);
+
+    if (ESRCH == ret) return BXIERR_OK;
+
+    char * url = BXILOG__GLOBALS->config->handlers_params[handler_rank]->ctrl_url;
+    bxiassert(NULL != url);
+
+    void * zocket = NULL;
+    err2 = bxizmq_zocket_create_connected(BXILOG__GLOBALS->zmq_ctx,
+                                          ZMQ_REQ,
+                                          url,
+                                          &zocket);
+    BXIERR_CHAIN(err, err2);
+    bxierr_abort_ifko(err);
+
+    err2 = bxizmq_str_snd(EXIT_CTRL_MSG_REQ, zocket, 0, 0, 0);
+    BXIERR_CHAIN(err, err2);
+
+    char * msg = NULL;
+    // FIXME: this _zmq_str_rcv_timeout() looks strange to me??
+    // We might be able to replace it by a normal call to the bxizmq library.
+    // For the moment, it seems to work though
+    while (ret != ESRCH && msg == NULL) {
+        bxierr_destroy(&err2);
+        ret = pthread_kill(handler_thread, 0);
+        err2 = _zmq_str_rcv_timeout(zocket, &msg, 500);
+        if (ret == ESRCH && msg == NULL) {
+            bxierr_destroy(&err2);
+            break;
+        }
+        if (bxierr_isko(err2)) {
+            bxierr_destroy(&err2);
+        } else {
+            break;
+        }
+    }
+
+    err2 = bxizmq_zocket_destroy(&zocket);
+    BXIERR_CHAIN(err, err2);
+
+    if (ESRCH == ret && msg == NULL) return err;
+
+    if (NULL == msg || 0 != strncmp(EXIT_CTRL_MSG_REP, msg, ARRAYLEN(EXIT_CTRL_MSG_REP) - 1)) {
+        // We just notify the end user there is a minor problem, but
+        // returning such an error is useless at this point, we want to exit.
+        bxierr_p tmp = bxierr_new(BXIZMQ_PROTOCOL_ERR, NULL, NULL, NULL, NULL,
+                                  "Wrong message received. Expected: %s, received: %s",
+                                  EXIT_CTRL_MSG_REP, msg);
+        bxierr_report(&tmp, STDERR_FILENO);
+        BXIFREE(msg);
+        return err;
+    }
+    BXIFREE(msg);
+
+    err2 = _join_handler(handler_rank, handler_err);
+    BXIERR_CHAIN(err, err2);
+
+    return err;
+}
 
 bxierr_p _join_handler(size_t handler_rank, bxierr_p *handler_err) {
     int rc = pthread_join(BXILOG__GLOBALS->handlers_threads[handler_rank],
@@ -0,0 +1,346 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ctype.h>
+#include <libgen.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <signal.h>
+#include <zlib.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/mem.h"
+#include "bxi/base/str.h"
+
+#include "archiver_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+#define TMP_SUFFIX ".tmp"
+
+// Size of the chunks read from a segment being compressed
+#define CHUNK_SIZE (256 * 1024)
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+struct bxilog__archiver_s {
+    char * dirname;                 // Where segments are
+    char * basename;                // Segments are named "<basename>.<suffix>"
+    size_t keep;
+    bool compress;
+    char * chunk;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;            // Signaled when a segment is added
+    char ** pending;                // Segments not processed yet, in rotation order
+    size_t pending_nb;
+    size_t pending_max;
+    bool exit;
+    bxierr_set_p errset;            // Errors are reported on destruction only
+};
+
+//*********************************************************************************
+//********************************** Static Functions  ****************************
+//*********************************************************************************
+static void * _archiver_main(bxilog__archiver_p self);
+static bxierr_p _compress(bxilog__archiver_p self, const char * segment);
+static bxierr_p _prune(bxilog__archiver_p self);
+static bool _is_segment(bxilog__archiver_p self, const char * name);
+static int _segment_cmp(const void * a, const void * b);
+static size_t _stem_len(const char * name);
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Implementation    ****************************
+//*********************************************************************************
+
+bxierr_p bxilog__archiver_new(const char * filename, size_t keep, bool compress,
+                              bxilog__archiver_p * result) {
+    bxiassert(NULL != filename);
+    bxiassert(NULL != result);
+
+    bxilog__archiver_p self = bximem_calloc(sizeof(*self));
+    // dirname() and basename() may modify their argument
+    char * copy = strdup(filename);
+    self->dirname = strdup(dirname(copy));
+    BXIFREE(copy);
+    copy = strdup(filename);
+    self->basename = strdup(basename(copy));
+    BXIFREE(copy);
+    self->keep = keep;
+    self->compress = compress;
+    self->chunk = compress ? bximem_calloc(CHUNK_SIZE) : NULL;
+    self->errset = bxierr_set_new();
+
+    int rc = pthread_mutex_init(&self->mutex, NULL);
+    bxiassert(0 == rc);
+    rc = pthread_cond_init(&self->cond, NULL);
+    bxiassert(0 == rc);
+
+    // Signals are dealt with by other threads
+    sigset_t mask, old_mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+    rc = pthread_create(&self->thread, NULL,
+                        (void * (*) (void*)) _archiver_main, self);
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    if (0 != rc) {
+        pthread_cond_destroy(&self->cond);
+        pthread_mutex_destroy(&self->mutex);
+        bxierr_set_destroy(&self->errset);
+        BXIFREE(self->chunk);
+        BXIFREE(self->basename);
+        BXIFREE(self->dirname);
+        BXIFREE(self);
+        return bxierr_fromidx(rc, NULL,
+                              "Calling pthread_create() failed (rc=%d)", rc);
+    }
+
+    *result = self;
+    return BXIERR_OK;
+}
+
+void bxilog__archiver_add(bxilog__archiver_p self, char * segment) {
+    bxiassert(NULL != self);
+    bxiassert(NULL != segment);
+
+    pthread_mutex_lock(&self->mutex);
+    if (self->pending_nb == self->pending_max) {
+        size_t new_max = (0 == self->pending_max) ? 4 : 2 * self->pending_max;
+        self->pending = bximem_realloc(self->pending,
+                                       self->pending_max * sizeof(*self->pending),
+                                       new_max * sizeof(*self->pending));
+        self->pending_max = new_max;
+    }
+    self->pending[self->pending_nb++] = segment;
+    pthread_cond_signal(&self->cond);
+    pthread_mutex_unlock(&self->mutex);
+}
+
+bxierr_p bxilog__archiver_destroy(bxilog__archiver_p * self_p) {
+    bxiassert(NULL != self_p);
+
+    bxilog__archiver_p self = *self_p;
+    if (NULL == self) return BXIERR_OK;
+
+    pthread_mutex_lock(&self->mutex);
+    self->exit = true;
+    pthread_cond_signal(&self->cond);
+    pthread_mutex_unlock(&self->mutex);
+    pthread_join(self->thread, NULL);
+
+    bxierr_p err = BXIERR_OK;
+    if (0 < self->errset->distinct_err.errors_nb) {
+        err = bxierr_from_set(BXIERR_GROUP_CODE, self->errset,
+                              "Archiving rotated log files failed "
+                              "(%zu distinct errors)",
+                              self->errset->distinct_err.errors_nb);
+    } else {
+        bxierr_set_destroy(&self->errset);
+    }
+
+    pthread_cond_destroy(&self->cond);
+    pthread_mutex_destroy(&self->mutex);
+    BXIFREE(self->pending);
+    BXIFREE(self->chunk);
+    BXIFREE(self->basename);
+    BXIFREE(self->dirname);
+    BXIFREE(*self_p);
+
+    return err;
+}
+
+//*********************************************************************************
+//********************************** Static Helpers Implementation ****************
+//*********************************************************************************
+
+void * _archiver_main(bxilog__archiver_p self) {
+    pthread_mutex_lock(&self->mutex);
+    while (true) {
+        while (0 == self->pending_nb && !self->exit) {
+            pthread_cond_wait(&self->cond, &self->mutex);
+        }
+        if (0 == self->pending_nb) break;
+
+        // Take the oldest one, others may be added meanwhile
+        char * segment = self->pending[0];
+        self->pending_nb--;
+        memmove(self->pending, self->pending + 1,
+                self->pending_nb * sizeof(*self->pending));
+        pthread_mutex_unlock(&self->mutex);
+
+        bxierr_p err = self->compress ? _compress(self, segment) : BXIERR_OK;
+        if (bxierr_isko(err)) bxierr_set_add(self->errset, &err);
+        BXIFREE(segment);
+
+        if (0 < self->keep) {
+            err = _prune(self);
+            if (bxierr_isko(err)) bxierr_set_add(self->errset, &err);
+        }
+
+        pthread_mutex_lock(&self->mutex);
+    }
+    pthread_mutex_unlock(&self->mutex);
+
+    return NULL;
+}
+
+bxierr_p _compress(bxilog__archiver_p self, const char * segment) {
+    bxierr_p err = BXIERR_OK;
+
+    // The compressed segment appears once complete only
+    char * gz = bxistr_new("%s%s", segment, BXILOG__ARCHIVER_GZ_SUFFIX);
+    char * tmp = bxistr_new("%s%s", gz, TMP_SUFFIX);
+
+    errno = 0;
+    int in = open(segment, O_RDONLY);
+    if (-1 == in) {
+        err = bxierr_errno("Can't open rotated log file %s", segment);
+        goto END;
+    }
+    gzFile out = gzopen(tmp, "wb");
+    if (NULL == out) {
+        err = bxierr_errno("Calling gzopen(%s) failed", tmp);
+        close(in);
+        goto END;
+    }
+
+    while (true) {
+        errno = 0;
+        ssize_t n = read(in, self->chunk, CHUNK_SIZE);
+        if (0 > n && EINTR == errno) continue;
+        if (0 > n) {
+            err = bxierr_errno("Reading rotated log file %s failed", segment);
+            break;
+        }
+        if (0 == n) break;
+        if ((int) n != gzwrite(out, self->chunk, (unsigned) n)) {
+            int errnum;
+            const char * msg = gzerror(out, &errnum);
+            err = bxierr_gen("Calling gzwrite(%s) failed: %s", tmp, msg);
+            break;
+        }
+    }
+    close(in);
+    int rc = gzclose(out);
+    if (bxierr_isok(err) && Z_OK != rc) {
+        err = bxierr_gen("Calling gzclose(%s) failed (rc=%d)", tmp, rc);
+    }
+    if (bxierr_isko(err)) {
+        unlink(tmp);
+        goto END;
+    }
+
+    errno = 0;
+    if (0 != rename(tmp, gz)) {
+        err = bxierr_errno("Can't rename %s to %s", tmp, gz);
+        unlink(tmp);
+        goto END;
+    }
+    errno = 0;
+    if (0 != unlink(segment)) err = bxierr_errno("Can't remove %s", segment);
+
+END:
+    BXIFREE(tmp);
+    BXIFREE(gz);
+    return err;
+}
+
+bxierr_p _prune(bxilog__archiver_p self) {
+    errno = 0;
+    DIR * dir = opendir(self->dirname);
+    if (NULL == dir) return bxierr_errno("Can't read directory %s", self->dirname);
+
+    char ** names = NULL;
+    size_t names_nb = 0, names_max = 0;
+    struct dirent * entry;
+    while (NULL != (entry = readdir(dir))) {
+        if (!_is_segment(self, entry->d_name)) continue;
+        if (names_nb == names_max) {
+            size_t new_max = (0 == names_max) ? 16 : 2 * names_max;
+            names = bximem_realloc(names,
+                                   names_max * sizeof(*names),
+                                   new_max * sizeof(*names));
+            names_max = new_max;
+        }
+        names[names_nb++] = strdup(entry->d_name);
+    }
+    closedir(dir);
+
+    bxierr_p err = BXIERR_OK, err2;
+    if (names_nb > self->keep) {
+        // Oldest first
+        qsort(names, names_nb, sizeof(*names), _segment_cmp);
+        for (size_t i = 0; i < names_nb - self->keep; i++) {
+            char * path = bxistr_new("%s/%s", self->dirname, names[i]);
+            errno = 0;
+            if (0 != unlink(path) && ENOENT != errno) {
+                err2 = bxierr_errno("Can't remove %s", path);
+                BXIERR_CHAIN(err, err2);
+            }
+            BXIFREE(path);
+        }
+    }
+    for (size_t i = 0; i < names_nb; i++) BXIFREE(names[i]);
+    BXIFREE(names);
+
+    return err;
+}
+
+bool _is_segment(bxilog__archiver_p self, const char * name) {
+    // "<basename>.<digit>...", compressions in progress excluded
+    const size_t len = strlen(self->basename);
+    if (0 != strncmp(name, self->basename, len)) return false;
+    if ('.' != name[len] || !isdigit((unsigned char) name[len + 1])) return false;
+
+    const size_t name_len = strlen(name);
+    const size_t tmp_len = ARRAYLEN(TMP_SUFFIX) - 1;
+    return name_len < tmp_len || 0 != strcmp(name + name_len - tmp_len, TMP_SUFFIX);
+}
+
+int _segment_cmp(const void * a, const void * b) {
+    const char * x = *(const char * const *) a;
+    const char * y = *(const char * const *) b;
+
+    // The suffix of compressed segments does not count: "f.<date>" must come before
+    // "f.<date>.1" whether they are compressed or not, and "f.<date>.2" before
+    // "f.<date>.10"
+    char * x_stem = strndup(x, _stem_len(x));
+    char * y_stem = strndup(y, _stem_len(y));
+    int rc = strverscmp(x_stem, y_stem);
+    BXIFREE(x_stem);
+    BXIFREE(y_stem);
+    return rc;
+}
+
+size_t _stem_len(const char * name) {
+    const size_t len = strlen(name);
+    const size_t gz_len = ARRAYLEN(BXILOG__ARCHIVER_GZ_SUFFIX) - 1;
+    if (len > gz_len && 0 == strcmp(name + len - gz_len, BXILOG__ARCHIVER_GZ_SUFFIX)) {
+        return len - gz_len;
+    }
+    return len;
+}
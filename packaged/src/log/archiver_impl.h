@@ -0,0 +1,71 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#ifndef BXILOG_ARCHIVER_IMPL_H
+#define BXILOG_ARCHIVER_IMPL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "bxi/base/err.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// Suffix of compressed segments
+#define BXILOG__ARCHIVER_GZ_SUFFIX ".gz"
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+/*
+ * A thread processing the segments closed by the rotation of a log file: they are
+ * compressed, and the oldest ones are removed.
+ */
+typedef struct bxilog__archiver_s bxilog__archiver_s;
+typedef bxilog__archiver_s * bxilog__archiver_p;
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interface         ****************************
+//*********************************************************************************
+
+/*
+ * Start an archiver for the segments of the given log file, named
+ * "<filename>.<suffix>" (see bxilog__archiver_add()).
+ *
+ * At most keep segments are kept, 0 for all. When compress is true, each segment is
+ * replaced by its gzip version "<filename>.<suffix>.gz".
+ */
+bxierr_p bxilog__archiver_new(const char * filename, size_t keep, bool compress,
+                              bxilog__archiver_p * result);
+
+/*
+ * Give a closed segment to the archiver, which takes ownership of the given name.
+ *
+ * Never blocks on the processing of the segment.
+ */
+void bxilog__archiver_add(bxilog__archiver_p self, char * segment);
+
+/*
+ * Process the segments given so far, stop the archiver and return the errors
+ * encountered since its start.
+ */
+bxierr_p bxilog__archiver_destroy(bxilog__archiver_p * self_p);
+
+#endif
@@ -0,0 +1,248 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/mem.h"
+
+#include "bxi/base/log.h"
+
+#include "binary_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// Initial number of slots of the string table, a power of 2
+#define STRINGS_MIN 256
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+// An interned string, free when str is NULL
+typedef struct {
+    uint64_t hash;
+    char * str;
+    size_t len;
+    uint64_t id;
+} string_slot_s;
+
+struct bxilog__binenc_s {
+    char * progname;
+    size_t progname_len;
+    int64_t last_time;              // Nanoseconds, of the previous record encoded
+    string_slot_s * strings;        // Open addressing table of the names seen so far
+    size_t strings_max;
+    size_t strings_nb;
+    uint8_t * buf;                  // Output of the last call
+    size_t buf_size;
+};
+
+//*********************************************************************************
+//********************************** Static Functions  ****************************
+//*********************************************************************************
+static void _reserve(bxilog__binenc_p self, size_t size);
+static void _clear_strings(bxilog__binenc_p self);
+static uint64_t _intern(bxilog__binenc_p self, const char * str, size_t len,
+                        uint8_t ** p);
+static void _grow_strings(bxilog__binenc_p self);
+static uint64_t _hash(const char * str, size_t len);
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Implementation    ****************************
+//*********************************************************************************
+
+bxilog__binenc_p bxilog__binenc_new(const char * progname) {
+    bxiassert(NULL != progname);
+
+    bxilog__binenc_p self = bximem_calloc(sizeof(*self));
+    self->progname = strdup(progname);
+    self->progname_len = strlen(progname);
+    self->strings_max = STRINGS_MIN;
+    self->strings = bximem_calloc(self->strings_max * sizeof(*self->strings));
+
+    return self;
+}
+
+void bxilog__binenc_destroy(bxilog__binenc_p * self_p) {
+    bxiassert(NULL != self_p);
+
+    bxilog__binenc_p self = *self_p;
+    if (NULL == self) return;
+
+    _clear_strings(self);
+    BXIFREE(self->strings);
+    BXIFREE(self->buf);
+    BXIFREE(self->progname);
+    BXIFREE(*self_p);
+}
+
+size_t bxilog__binenc_header(bxilog__binenc_p self, const char ** out) {
+    bxiassert(NULL != self);
+    bxiassert(NULL != out);
+
+    _clear_strings(self);
+    self->last_time = 0;
+
+    _reserve(self, BXILOG__BINARY_MAGIC_LEN + 1 +
+                   BXILOG__BINARY_VARINT_MAX + self->progname_len);
+    uint8_t * p = self->buf;
+    memcpy(p, BXILOG__BINARY_MAGIC, BXILOG__BINARY_MAGIC_LEN);
+    p += BXILOG__BINARY_MAGIC_LEN;
+    *p++ = BXILOG__BINARY_VERSION;
+    p = bxilog__binary_put_varint(p, self->progname_len);
+    memcpy(p, self->progname, self->progname_len);
+    p += self->progname_len;
+
+    *out = (const char *) self->buf;
+    return (size_t) (p - self->buf);
+}
+
+size_t bxilog__binenc_record(bxilog__binenc_p self,
+                             const bxilog_record_p record,
+                             const char * filename,
+                             const char * funcname,
+                             const char * loggername,
+                             const char * logmsg,
+                             const char ** out) {
+    bxiassert(NULL != self);
+    bxiassert(NULL != record);
+    bxiassert(NULL != out);
+
+    // Exclude NULL terminating bytes from the lengths given in the record
+    const size_t filename_len = record->filename_len - 1;
+    const size_t funcname_len = record->funcname_len - 1;
+    const size_t logname_len = record->logname_len - 1;
+    const size_t logmsg_len = record->logmsg_len - 1;
+
+    // Three string chunks at most, then the record itself
+    _reserve(self, 3 * (1 + 2 * BXILOG__BINARY_VARINT_MAX) +
+                   filename_len + funcname_len + logname_len +
+                   2 + 9 * BXILOG__BINARY_VARINT_MAX + logmsg_len);
+    uint8_t * p = self->buf;
+
+    const uint64_t file_id = _intern(self, filename, filename_len, &p);
+    const uint64_t func_id = _intern(self, funcname, funcname_len, &p);
+    const uint64_t logger_id = _intern(self, loggername, logname_len, &p);
+
+    const int64_t time = (int64_t) record->detail_time.tv_sec * 1000000000 +
+                         (int64_t) record->detail_time.tv_nsec;
+
+    *p++ = BXILOG__BINARY_RECORD;
+    *p++ = (uint8_t) record->level;
+    p = bxilog__binary_put_varint(p, bxilog__binary_zigzag(time - self->last_time));
+    p = bxilog__binary_put_varint(p, (uint32_t) record->pid);
+#ifdef __linux__
+    p = bxilog__binary_put_varint(p, (uint32_t) record->tid);
+#else
+    p = bxilog__binary_put_varint(p, 0);
+#endif
+    p = bxilog__binary_put_varint(p, (uint64_t) record->thread_rank);
+    p = bxilog__binary_put_varint(p, bxilog__binary_zigzag(record->line_nb));
+    p = bxilog__binary_put_varint(p, file_id);
+    p = bxilog__binary_put_varint(p, func_id);
+    p = bxilog__binary_put_varint(p, logger_id);
+    p = bxilog__binary_put_varint(p, logmsg_len);
+    memcpy(p, logmsg, logmsg_len);
+    p += logmsg_len;
+
+    self->last_time = time;
+
+    *out = (const char *) self->buf;
+    return (size_t) (p - self->buf);
+}
+
+//*********************************************************************************
+//********************************** Static Helpers Implementation ****************
+//*********************************************************************************
+
+void _reserve(bxilog__binenc_p self, size_t size) {
+    if (self->buf_size >= size) return;
+
+    self->buf = bximem_realloc(self->buf, self->buf_size, size);
+    self->buf_size = size;
+}
+
+void _clear_strings(bxilog__binenc_p self) {
+    for (size_t i = 0; i < self->strings_max; i++) BXIFREE(self->strings[i].str);
+    self->strings_nb = 0;
+}
+
+// Return the id of the given string, and append its string chunk at *p when it is
+// seen for the first time
+uint64_t _intern(bxilog__binenc_p self, const char * str, size_t len, uint8_t ** p) {
+    const uint64_t hash = _hash(str, len);
+    size_t i = (size_t) hash & (self->strings_max - 1);
+    while (NULL != self->strings[i].str) {
+        const string_slot_s * slot = &self->strings[i];
+        if (slot->hash == hash && slot->len == len && 0 == memcmp(slot->str, str, len)) {
+            return slot->id;
+        }
+        i = (i + 1) & (self->strings_max - 1);
+    }
+
+    string_slot_s * slot = &self->strings[i];
+    slot->hash = hash;
+    slot->str = bximem_calloc(len + 1);
+    memcpy(slot->str, str, len);
+    slot->len = len;
+    slot->id = self->strings_nb++;
+    const uint64_t id = slot->id;
+
+    uint8_t * q = *p;
+    *q++ = BXILOG__BINARY_STRING;
+    q = bxilog__binary_put_varint(q, id);
+    q = bxilog__binary_put_varint(q, len);
+    memcpy(q, str, len);
+    *p = q + len;
+
+    // Keep the load factor below 3/4
+    if (4 * self->strings_nb >= 3 * self->strings_max) _grow_strings(self);
+
+    return id;
+}
+
+void _grow_strings(bxilog__binenc_p self) {
+    const size_t old_max = self->strings_max;
+    string_slot_s * old = self->strings;
+
+    self->strings_max = 2 * old_max;
+    self->strings = bximem_calloc(self->strings_max * sizeof(*self->strings));
+    for (size_t i = 0; i < old_max; i++) {
+        if (NULL == old[i].str) continue;
+        size_t j = (size_t) old[i].hash & (self->strings_max - 1);
+        while (NULL != self->strings[j].str) j = (j + 1) & (self->strings_max - 1);
+        self->strings[j] = old[i];
+    }
+    BXIFREE(old);
+}
+
+// FNV-1a
+uint64_t _hash(const char * str, size_t len) {
+    uint64_t hash = FNV_OFFSET;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t) str[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
@@ -0,0 +1,112 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#ifndef BXILOG_BINARY_IMPL_H
+#define BXILOG_BINARY_IMPL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bxi/base/log.h"
+
+/*
+ * Binary log stream, as written by the binary file handler:
+ *
+ *      stream := (header chunk*)*
+ *      header := MAGIC version:u8 progname:string
+ *      chunk  := STRING id:varint string
+ *              | RECORD level:u8 time:svarint pid:varint tid:varint rank:varint
+ *                       line:svarint file:varint func:varint logger:varint
+ *                       logmsg:string
+ *      string := len:varint byte*
+ *
+ * - varint: unsigned LEB128, svarint: zigzag encoded signed varint;
+ * - a header resets the reader: ids and timestamps start again (new file, rotation);
+ * - file, func and logger are ids given by previous STRING chunks of the stream;
+ * - time is the difference in nanoseconds with the previous record time, 0 for the
+ *   first record after a header.
+ */
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// Not a chunk tag: headers can be found in the middle of a stream
+#define BXILOG__BINARY_MAGIC "\x89" "BXILOG\n"
+#define BXILOG__BINARY_MAGIC_LEN (sizeof(BXILOG__BINARY_MAGIC) - 1)
+#define BXILOG__BINARY_VERSION 1
+
+#define BXILOG__BINARY_STRING 0x01
+#define BXILOG__BINARY_RECORD 0x02
+
+// Maximum size of an encoded 64 bits varint
+#define BXILOG__BINARY_VARINT_MAX 10
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+/*
+ * Encodes records of a given program into a binary stream.
+ */
+typedef struct bxilog__binenc_s bxilog__binenc_s;
+typedef bxilog__binenc_s * bxilog__binenc_p;
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interface         ****************************
+//*********************************************************************************
+
+bxilog__binenc_p bxilog__binenc_new(const char * progname);
+
+void bxilog__binenc_destroy(bxilog__binenc_p * self_p);
+
+/*
+ * Encode the header starting a new stream, in a buffer owned by the encoder and valid
+ * until its next call. Strings are given ids again.
+ */
+size_t bxilog__binenc_header(bxilog__binenc_p self, const char ** out);
+
+/*
+ * Encode the given record, preceded by the string chunks of the names seen for the
+ * first time, in a buffer owned by the encoder and valid until its next call.
+ */
+size_t bxilog__binenc_record(bxilog__binenc_p self,
+                             const bxilog_record_p record,
+                             const char * filename,
+                             const char * funcname,
+                             const char * loggername,
+                             const char * logmsg,
+                             const char ** out);
+
+static inline uint8_t * bxilog__binary_put_varint(uint8_t * p, uint64_t value) {
+    while (0x80 <= value) {
+        *p++ = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t) value;
+    return p;
+}
+
+static inline uint64_t bxilog__binary_zigzag(int64_t value) {
+    return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+static inline int64_t bxilog__binary_unzigzag(uint64_t value) {
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+#endif
@@ -0,0 +1,450 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/mem.h"
+#include "bxi/base/str.h"
+
+#include "bxi/base/log.h"
+#include "bxi/base/log/file_handler.h"
+#include "bxi/base/log/binary_reader.h"
+
+#include "binary_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// Buffer of the underlying stream, holding uncompressed bytes
+#define READ_BUF_SIZE (1024 * 1024)
+
+// printf() format of the file handler (see file_handler.c)
+#ifdef __linux__
+#define PREFIX_FMT "%c|%04d%02d%02dT%02d%02d%02d.%09" PRId32 "|%07" PRIu32 ".%07" PRIu32 \
+                   "=%05" PRIx64 ":%s|%s:%d@%s|%s|"
+#else
+#define PREFIX_FMT "%c|%04d%02d%02dT%02d%02d%02d.%09" PRId32 "|%07" PRIu32 ".%05" PRIu64 \
+                   ":%s|%s:%d@%s|%s|"
+#endif
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+struct bxilog_binary_reader_s {
+    char * filename;
+    gzFile file;                    // Reads files compressed or not
+    bool header_seen;
+    char * progname;
+    char ** strings;                // Indexed by their id in the current stream
+    size_t strings_nb;
+    size_t strings_max;
+    int64_t last_time;              // Nanoseconds, of the previous record read
+    char * logmsg;
+    size_t logmsg_size;
+    bxilog_binary_entry_s entry;
+};
+
+typedef struct {
+    char * prefix;
+    size_t prefix_len;
+    char ** buf;
+    size_t * buf_size;
+    size_t len;
+} text_line_param_s;
+
+//*********************************************************************************
+//********************************** Static Functions  ****************************
+//*********************************************************************************
+static bxierr_p _read_header(bxilog_binary_reader_p self);
+static bxierr_p _read_string_chunk(bxilog_binary_reader_p self);
+static bxierr_p _read_record(bxilog_binary_reader_p self);
+static bxierr_p _read_byte(bxilog_binary_reader_p self, uint8_t * byte);
+static bxierr_p _read_varint(bxilog_binary_reader_p self, uint64_t * value);
+static bxierr_p _read_string(bxilog_binary_reader_p self,
+                             char ** str, size_t * size, size_t * len);
+static bxierr_p _get_string(bxilog_binary_reader_p self, const char ** str);
+static bxierr_p _read_error(bxilog_binary_reader_p self);
+static bxierr_p _text_line(char * line, size_t line_len, bool last,
+                           text_line_param_s * param);
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Implementation    ****************************
+//*********************************************************************************
+
+bxierr_p bxilog_binary_reader_new(const char * filename,
+                                  bxilog_binary_reader_p * result) {
+    bxiassert(NULL != filename);
+    bxiassert(NULL != result);
+
+    gzFile file;
+    errno = 0;
+    if (0 == strcmp("-", filename)) {
+        // Closing the reader does not close the standard input
+        const int fd = dup(STDIN_FILENO);
+        if (-1 == fd) return bxierr_errno("Can't duplicate the standard input");
+        file = gzdopen(fd, "r");
+        if (NULL == file) close(fd);
+    } else {
+        file = gzopen(filename, "r");
+    }
+    if (NULL == file) return bxierr_errno("Can't open %s", filename);
+    // Records are read a few bytes at a time
+    gzbuffer(file, READ_BUF_SIZE);
+
+    bxilog_binary_reader_p self = bximem_calloc(sizeof(*self));
+    self->filename = strdup(filename);
+    self->file = file;
+
+    *result = self;
+    return BXIERR_OK;
+}
+
+bxierr_p bxilog_binary_reader_next(bxilog_binary_reader_p self,
+                                   bxilog_binary_entry_p * entry) {
+    bxiassert(NULL != self);
+    bxiassert(NULL != entry);
+
+    *entry = NULL;
+    while (true) {
+        errno = 0;
+        const int c = gzgetc(self->file);
+        if (-1 == c) return _read_error(self);
+
+        bxierr_p err;
+        if ((uint8_t) BXILOG__BINARY_MAGIC[0] == c) {
+            err = _read_header(self);
+            if (bxierr_isko(err)) return err;
+            continue;
+        }
+        if (!self->header_seen) {
+            return bxierr_gen("%s is not a bxilog binary file", self->filename);
+        }
+        switch (c) {
+            case BXILOG__BINARY_STRING:
+                err = _read_string_chunk(self);
+                if (bxierr_isko(err)) return err;
+                break;
+            case BXILOG__BINARY_RECORD:
+                err = _read_record(self);
+                if (bxierr_isko(err)) return err;
+                *entry = &self->entry;
+                return BXIERR_OK;
+            default:
+                return bxierr_gen("Unknown chunk 0x%02x at offset %ld of %s",
+                                  c, (long) gztell(self->file) - 1, self->filename);
+        }
+    }
+}
+
+size_t bxilog_binary_entry_text(const bxilog_binary_entry_p entry,
+                                char ** buf, size_t * buf_size) {
+    bxiassert(NULL != entry);
+    bxiassert(NULL != buf);
+    bxiassert(NULL != buf_size);
+
+    struct tm tm;
+    const time_t sec = (time_t) entry->sec;
+    localtime_r(&sec, &tm);
+
+    const char level = (BXILOG_LOWEST >= entry->level) ?
+                        BXILOG_FILE_HANDLER_LOG_LEVEL_STR[entry->level] : '?';
+    char * prefix = bxistr_new(PREFIX_FMT, level,
+                               tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                               tm.tm_hour, tm.tm_min, tm.tm_sec, entry->nsec,
+#ifdef __linux__
+                               entry->pid, entry->tid, entry->thread_rank,
+#else
+                               entry->pid, entry->thread_rank,
+#endif
+                               entry->progname, entry->filename, entry->line_nb,
+                               entry->funcname, entry->loggername);
+
+    text_line_param_s param = {
+                               .prefix = prefix,
+                               .prefix_len = strlen(prefix),
+                               .buf = buf,
+                               .buf_size = buf_size,
+                               .len = 0,
+    };
+    // Lines of a multi-line message share the same prefix
+    bxierr_p err = bxistr_apply_lines((char *) entry->logmsg, entry->logmsg_len,
+                                      (bxierr_p (*)(char*, size_t, bool, void*)) _text_line,
+                                      &param);
+    bxiassert(bxierr_isok(err));
+    BXIFREE(prefix);
+
+    return param.len;
+}
+
+bxierr_p bxilog_binary_reader_destroy(bxilog_binary_reader_p * self_p) {
+    bxiassert(NULL != self_p);
+
+    bxilog_binary_reader_p self = *self_p;
+    if (NULL == self) return BXIERR_OK;
+
+    bxierr_p err = BXIERR_OK;
+    errno = 0;
+    const int rc = gzclose(self->file);
+    if (Z_OK != rc) err = bxierr_gen("Closing %s failed (rc=%d)", self->filename, rc);
+    for (size_t i = 0; i < self->strings_nb; i++) BXIFREE(self->strings[i]);
+    BXIFREE(self->strings);
+    BXIFREE(self->progname);
+    BXIFREE(self->logmsg);
+    BXIFREE(self->filename);
+    BXIFREE(*self_p);
+
+    return err;
+}
+
+//*********************************************************************************
+//********************************** Static Helpers Implementation ****************
+//*********************************************************************************
+
+// The first byte of the magic has been read already
+bxierr_p _read_header(bxilog_binary_reader_p self) {
+    bxierr_p err;
+    for (size_t i = 1; i < BXILOG__BINARY_MAGIC_LEN; i++) {
+        uint8_t byte;
+        err = _read_byte(self, &byte);
+        if (bxierr_isko(err)) return err;
+        if ((uint8_t) BXILOG__BINARY_MAGIC[i] != byte) {
+            return bxierr_gen("%s is not a bxilog binary file", self->filename);
+        }
+    }
+    uint8_t version;
+    err = _read_byte(self, &version);
+    if (bxierr_isko(err)) return err;
+    if (BXILOG__BINARY_VERSION < version) {
+        return bxierr_gen("Unsupported version %u of bxilog binary file %s",
+                          version, self->filename);
+    }
+
+    size_t size = 0, len;
+    BXIFREE(self->progname);
+    err = _read_string(self, &self->progname, &size, &len);
+    if (bxierr_isko(err)) return err;
+
+    // A new stream: ids and timestamps start again
+    for (size_t i = 0; i < self->strings_nb; i++) BXIFREE(self->strings[i]);
+    self->strings_nb = 0;
+    self->last_time = 0;
+    self->header_seen = true;
+
+    return BXIERR_OK;
+}
+
+bxierr_p _read_string_chunk(bxilog_binary_reader_p self) {
+    uint64_t id;
+    bxierr_p err = _read_varint(self, &id);
+    if (bxierr_isko(err)) return err;
+    // Ids are given in order
+    if (id != self->strings_nb) {
+        return bxierr_gen("Unexpected string id %" PRIu64 " at offset %ld of %s",
+                          id, (long) gztell(self->file), self->filename);
+    }
+
+    char * str = NULL;
+    size_t size = 0, len;
+    err = _read_string(self, &str, &size, &len);
+    if (bxierr_isko(err)) {
+        BXIFREE(str);
+        return err;
+    }
+
+    if (self->strings_nb == self->strings_max) {
+        size_t new_max = (0 == self->strings_max) ? 64 : 2 * self->strings_max;
+        self->strings = bximem_realloc(self->strings,
+                                       self->strings_max * sizeof(*self->strings),
+                                       new_max * sizeof(*self->strings));
+        self->strings_max = new_max;
+    }
+    self->strings[self->strings_nb++] = str;
+
+    return BXIERR_OK;
+}
+
+bxierr_p _read_record(bxilog_binary_reader_p self) {
+    bxilog_binary_entry_p entry = &self->entry;
+    bxierr_p err;
+    uint8_t level;
+    uint64_t value;
+
+    err = _read_byte(self, &level);
+    if (bxierr_isko(err)) return err;
+    entry->level = (bxilog_level_e) level;
+
+    err = _read_varint(self, &value);
+    if (bxierr_isko(err)) return err;
+    const int64_t time = self->last_time + bxilog__binary_unzigzag(value);
+    self->last_time = time;
+    entry->sec = time / 1000000000;
+    entry->nsec = (int32_t) (time % 1000000000);
+
+    err = _read_varint(self, &value);
+    if (bxierr_isko(err)) return err;
+    entry->pid = (uint32_t) value;
+    err = _read_varint(self, &value);
+    if (bxierr_isko(err)) return err;
+    entry->tid = (uint32_t) value;
+    err = _read_varint(self, &entry->thread_rank);
+    if (bxierr_isko(err)) return err;
+    err = _read_varint(self, &value);
+    if (bxierr_isko(err)) return err;
+    entry->line_nb = (int) bxilog__binary_unzigzag(value);
+
+    err = _get_string(self, &entry->filename);
+    if (bxierr_isko(err)) return err;
+    err = _get_string(self, &entry->funcname);
+    if (bxierr_isko(err)) return err;
+    err = _get_string(self, &entry->loggername);
+    if (bxierr_isko(err)) return err;
+
+    err = _read_string(self, &self->logmsg, &self->logmsg_size, &entry->logmsg_len);
+    if (bxierr_isko(err)) return err;
+    entry->logmsg = self->logmsg;
+    entry->progname = self->progname;
+
+    return BXIERR_OK;
+}
+
+bxierr_p _read_byte(bxilog_binary_reader_p self, uint8_t * byte) {
+    errno = 0;
+    const int c = gzgetc(self->file);
+    if (-1 != c) {
+        *byte = (uint8_t) c;
+        return BXIERR_OK;
+    }
+    bxierr_p err = _read_error(self);
+    if (bxierr_isko(err)) return err;
+    return bxierr_gen("Truncated record at the end of %s", self->filename);
+}
+
+bxierr_p _read_varint(bxilog_binary_reader_p self, uint64_t * value) {
+    uint64_t result = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        uint8_t byte;
+        bxierr_p err = _read_byte(self, &byte);
+        if (bxierr_isko(err)) return err;
+        result |= (uint64_t) (byte & 0x7f) << shift;
+        if (0 == (byte & 0x80)) {
+            *value = result;
+            return BXIERR_OK;
+        }
+    }
+    return bxierr_gen("Invalid number at offset %ld of %s",
+                      (long) gztell(self->file), self->filename);
+}
+
+// Read a string in *str, reallocated if smaller than needed, and NULL terminate it
+bxierr_p _read_string(bxilog_binary_reader_p self,
+                      char ** str, size_t * size, size_t * len) {
+    uint64_t value;
+    bxierr_p err = _read_varint(self, &value);
+    if (bxierr_isko(err)) return err;
+
+    // gzread() returns an int
+    if (value >= INT_MAX) {
+        return bxierr_gen("Invalid string length %" PRIu64 " at offset %ld of %s",
+                          value, (long) gztell(self->file), self->filename);
+    }
+    *len = (size_t) value;
+
+    // Grown as bytes are read: a corrupt length does not allocate more than
+    // the file holds
+    size_t done = 0;
+    while (true) {
+        const size_t count = (*len - done < READ_BUF_SIZE) ? *len - done : READ_BUF_SIZE;
+        if (*size < done + count + 1) {
+            *str = bximem_realloc(*str, *size, done + count + 1);
+            *size = done + count + 1;
+        }
+        if (0 == count) break;
+
+        errno = 0;
+        if ((int) count != gzread(self->file, *str + done, (unsigned) count)) {
+            err = _read_error(self);
+            if (bxierr_isko(err)) return err;
+            return bxierr_gen("Truncated record at the end of %s", self->filename);
+        }
+        done += count;
+    }
+    (*str)[*len] = '\0';
+
+    return BXIERR_OK;
+}
+
+bxierr_p _get_string(bxilog_binary_reader_p self, const char ** str) {
+    uint64_t id;
+    bxierr_p err = _read_varint(self, &id);
+    if (bxierr_isko(err)) return err;
+    if (id >= self->strings_nb) {
+        return bxierr_gen("Unknown string id %" PRIu64 " at offset %ld of %s",
+                          id, (long) gztell(self->file), self->filename);
+    }
+    *str = self->strings[id];
+
+    return BXIERR_OK;
+}
+
+bxierr_p _text_line(char * line, size_t line_len, bool last,
+                    text_line_param_s * param) {
+    UNUSED(last);
+
+    const size_t size = param->prefix_len + line_len + 1; // Include the '\n'
+    if (*param->buf_size < param->len + size) {
+        const size_t new_size = 2 * (param->len + size);
+        *param->buf = bximem_realloc(*param->buf, *param->buf_size, new_size);
+        *param->buf_size = new_size;
+    }
+    char * p = *param->buf + param->len;
+    memcpy(p, param->prefix, param->prefix_len);
+    memcpy(p + param->prefix_len, line, line_len);
+    p[size - 1] = '\n';
+    param->len += size;
+
+    return BXIERR_OK;
+}
+
+// Reading stopped: BXIERR_OK at the end of the file, the error otherwise
+bxierr_p _read_error(bxilog_binary_reader_p self) {
+    int errnum;
+    const char * msg = gzerror(self->file, &errnum);
+    switch (errnum) {
+        case Z_OK:
+            return BXIERR_OK;
+        case Z_ERRNO:
+            return bxierr_errno("Reading %s failed", self->filename);
+        case Z_BUF_ERROR:
+            // A compressed file being written ends with an incomplete gzip member
+            return bxierr_gen("Truncated compressed data at the end of %s",
+                              self->filename);
+        default:
+            return bxierr_gen("Reading %s failed: %s", self->filename, msg);
+    }
+}
@@ -0,0 +1,134 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <stdatomic.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/mem.h"
+#include "bxi/base/str.h"
+
+#include "callsite_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+typedef _Atomic(bxilog__callsite_entry_p) * chunk_p;
+
+//*********************************************************************************
+//********************************** Static Functions  ****************************
+//*********************************************************************************
+
+static size_t _register(bxilog_logger_p logger, bxilog_callsite_p callsite);
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+// Serializes registrations, lookups do not take it
+static pthread_mutex_t CALLSITES_LOCK = PTHREAD_MUTEX_INITIALIZER;
+
+// The callsite table, indexed by id - 1. It lives as long as the process does:
+// callsite descriptors keep their identifier across bxilog_init()/bxilog_finalize().
+static _Atomic(chunk_p) CALLSITES[BXILOG__CALLSITE_CHUNKS_MAX];
+
+// Number of registered callsites
+static size_t CALLSITES_NB = 0;
+
+//*********************************************************************************
+//********************************** Implementation    ****************************
+//*********************************************************************************
+
+size_t bxilog__callsite_id(const bxilog_logger_p logger, const bxilog_callsite_p callsite) {
+    // Pairs with the release store in _register(): logger is set before id
+    size_t id = __atomic_load_n(&callsite->id, __ATOMIC_ACQUIRE);
+    if (0 == id) return _register(logger, callsite);
+
+    return (callsite->logger == logger) ? id : 0;
+}
+
+bxilog__callsite_entry_p bxilog__callsite_get(const size_t id) {
+    bxiassert(0 < id && id <= BXILOG__CALLSITE_CHUNK_SIZE * BXILOG__CALLSITE_CHUNKS_MAX);
+
+    const size_t idx = id - 1;
+    chunk_p chunk = atomic_load_explicit(&CALLSITES[idx / BXILOG__CALLSITE_CHUNK_SIZE],
+                                         memory_order_acquire);
+    bxiassert(NULL != chunk);
+    bxilog__callsite_entry_p entry;
+    entry = atomic_load_explicit(&chunk[idx % BXILOG__CALLSITE_CHUNK_SIZE],
+                                 memory_order_acquire);
+    bxiassert(NULL != entry);
+
+    return entry;
+}
+
+//*********************************************************************************
+//********************************** Static Helpers Implementation ****************
+//*********************************************************************************
+
+size_t _register(const bxilog_logger_p logger, const bxilog_callsite_p callsite) {
+    int rc = pthread_mutex_lock(&CALLSITES_LOCK);
+    bxiassert(0 == rc);
+
+    // Another thread might have registered it in the meantime
+    size_t id = __atomic_load_n(&callsite->id, __ATOMIC_RELAXED);
+    if (0 != id) goto UNLOCK;
+
+    if (BXILOG__CALLSITE_CHUNK_SIZE * BXILOG__CALLSITE_CHUNKS_MAX <= CALLSITES_NB) {
+        goto UNLOCK;
+    }
+
+    const size_t idx = CALLSITES_NB;
+    chunk_p chunk = atomic_load_explicit(&CALLSITES[idx / BXILOG__CALLSITE_CHUNK_SIZE],
+                                         memory_order_relaxed);
+    if (NULL == chunk) {
+        chunk = bximem_calloc(BXILOG__CALLSITE_CHUNK_SIZE * sizeof(*chunk));
+        atomic_store_explicit(&CALLSITES[idx / BXILOG__CALLSITE_CHUNK_SIZE], chunk,
+                              memory_order_release);
+    }
+
+    bxilog__callsite_entry_p entry = bximem_calloc(sizeof(*entry));
+    // The basename is computed once for all
+    const char * filename;
+    entry->filename_len = bxistr_rsub(callsite->fullfilename,
+                                      callsite->fullfilename_len,
+                                      '/', &filename);
+    entry->filename = bximem_calloc(entry->filename_len);
+    memcpy(entry->filename, filename, entry->filename_len);
+    entry->funcname = strdup(callsite->funcname);
+    entry->funcname_len = strlen(entry->funcname) + 1;
+    entry->logname = strdup(logger->name);
+    entry->logname_len = strlen(entry->logname) + 1;
+    entry->line = callsite->line;
+    entry->level = callsite->level;
+
+    atomic_store_explicit(&chunk[idx % BXILOG__CALLSITE_CHUNK_SIZE], entry,
+                          memory_order_release);
+    CALLSITES_NB++;
+    id = idx + 1;
+
+    callsite->logger = logger;
+    __atomic_store_n(&callsite->id, id, __ATOMIC_RELEASE);
+
+UNLOCK:
+    rc = pthread_mutex_unlock(&CALLSITES_LOCK);
+    bxiassert(0 == rc);
+
+    return (callsite->logger == logger) ? id : 0;
+}
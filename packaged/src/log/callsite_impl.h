@@ -0,0 +1,76 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#ifndef BXILOG_CALLSITE_IMPL_H
+#define BXILOG_CALLSITE_IMPL_H
+
+#include <stddef.h>
+
+#include "bxi/base/log/logger.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// The callsite table is made of chunks allocated on demand
+#define BXILOG__CALLSITE_CHUNK_SIZE 1024
+#define BXILOG__CALLSITE_CHUNKS_MAX 1024
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+/*
+ * A registered callsite: the strings a record would otherwise carry.
+ *
+ * Entries are never removed: strings are copied so they remain valid even if the
+ * descriptor comes from an unloaded shared object.
+ */
+typedef struct {
+    char * filename;                // The basename of the source file
+    size_t filename_len;            // Lengths include the NULL terminating byte
+    char * funcname;
+    size_t funcname_len;
+    char * logname;
+    size_t logname_len;
+    int line;
+    bxilog_level_e level;
+} bxilog__callsite_entry_s;
+
+typedef bxilog__callsite_entry_s * bxilog__callsite_entry_p;
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interface         ****************************
+//*********************************************************************************
+
+/*
+ * Producer: return the identifier of the given callsite used with the given logger,
+ * registering it on first use.
+ *
+ * Return 0 when the callsite can not be used: it has been registered with another
+ * logger, or the table is full.
+ */
+size_t bxilog__callsite_id(bxilog_logger_p logger, bxilog_callsite_p callsite);
+
+/*
+ * Consumer: return the entry of the given callsite identifier.
+ *
+ * This function is lock-free.
+ */
+bxilog__callsite_entry_p bxilog__callsite_get(size_t id);
+
+#endif
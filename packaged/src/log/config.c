@@ -27,6 +27,7 @@
 #include "bxi/base/log/config.h"
 
 #include "config_impl.h"
+#include "registry_impl.h"
 #include "log_impl.h"
 
 
@@ -42,6 +43,7 @@
 //********************************** Static Functions  ****************************
 //*********************************************************************************
 //--------------------------------- Generic Helpers --------------------------------
+static void _release_filters_tries(void);
 
 //*********************************************************************************
 //********************************** Global Variables  ****************************
@@ -137,7 +139,12 @@ bxilog_config_p bxilog_config_new(const char * const progname) {
     bxilog_config_p config = bximem_calloc(sizeof(*config));
     config->progname = strdup(progname);
     config->tsd_log_buf_size = 128;
+    config->transport = BXILOG_TRANSPORT_ZMQ;
+    config->ring_size = 64 * 1024;
+    config->deferred_format = false;
+    config->fast_clock = false;
     config->handlers_nb = 0;
+    config->handlers_max = 64;
     config->ctrl_hwm = 1000;
     config->data_hwm = 1000;
 
@@ -170,6 +177,9 @@ bxierr_p bxilog__config_destroy(bxilog_config_p * config_p) {
     bxierr_list_p errlist = bxierr_list_new();
     bxilog_config_p config = *config_p;
 
+    // The compiled filters go with the configuration they come from
+    _release_filters_tries();
+
     for (size_t i = 0; i < config->handlers_nb; i++) {
         bxilog_handler_param_p handler_param = config->handlers_params[i];
 
@@ -195,6 +205,19 @@ bxierr_p bxilog__config_loggers() {
     bxilog_logger_p *loggers;
     static char ** level_names;
     bxilog_level_names(&level_names);
+
+    // Filters are compiled once, so reconfiguring a logger costs the length of its
+    // name for each handler, whatever the number of filters
+    _release_filters_tries();
+    const bxilog_config_p config = BXILOG__GLOBALS->config;
+    // Room is left for the handlers added later on (see bxilog_add_handler())
+    bxilog_filters_trie_p * tries = bximem_calloc(config->handlers_max * sizeof(*tries));
+    for (size_t i = 0; i < config->handlers_nb; i++) {
+        tries[i] = bxilog_filters_compile(config->handlers_params[i]->filters);
+    }
+    BXILOG__GLOBALS->filters_tries_nb = config->handlers_nb;
+    BXILOG__GLOBALS->filters_tries = tries;
+
     size_t loggers_nb = bxilog_registry_getall(&loggers);
     for (size_t i = 0; i < loggers_nb; i++) {
 //        bxilog_level_e old_level = loggers[i]->level;
@@ -211,6 +234,70 @@ bxierr_p bxilog__config_loggers() {
     return BXIERR_OK;
 }
 
+bxierr_p bxilog__config_handler_filters(size_t handler_rank) {
+    const bxilog_config_p config = BXILOG__GLOBALS->config;
+    bxiassert(handler_rank < config->handlers_max);
+    bxiassert(NULL != BXILOG__GLOBALS->filters_tries);
+
+    // A removed handler does not accept any record
+    bxilog_handler_param_p param = config->handlers_params[handler_rank];
+    bxilog_filters_trie_p trie = (BXI_LOG_HANDLER_REMOVED == param->status) ?
+                                    NULL :
+                                    bxilog_filters_compile(param->filters);
+    bxilog_filters_trie_p old = __atomic_exchange_n(&BXILOG__GLOBALS->filters_tries[handler_rank],
+                                                    trie, __ATOMIC_ACQ_REL);
+    if (handler_rank >= BXILOG__GLOBALS->filters_tries_nb) {
+        __atomic_store_n(&BXILOG__GLOBALS->filters_tries_nb, handler_rank + 1,
+                         __ATOMIC_RELEASE);
+    }
+    // A logger being registered concurrently might still use the old trie:
+    // it is released once all loggers have been reconfigured under the registry lock
+    bxilog__registry_reconfigure();
+    bxilog_filters_trie_destroy(&old);
+
+    return BXIERR_OK;
+}
+
+bxierr_p bxilog__config_release_removed(void) {
+    const bxilog_config_p config = BXILOG__GLOBALS->config;
+    bxilog_filters_trie_p * tries = BXILOG__GLOBALS->filters_tries;
+    bxierr_list_p errlist = bxierr_list_new();
+
+    // Ranks of the remaining handlers are made contiguous again
+    size_t n = 0;
+    for (size_t i = 0; i < config->handlers_nb; i++) {
+        bxilog_handler_param_p param = config->handlers_params[i];
+        if (BXI_LOG_HANDLER_REMOVED != param->status) {
+            config->handlers[n] = config->handlers[i];
+            config->handlers_params[n] = param;
+            if (NULL != tries && n != i) {
+                tries[n] = tries[i];
+                tries[i] = NULL;
+            }
+            n++;
+            continue;
+        }
+        if (NULL != tries) bxilog_filters_trie_destroy(&tries[i]);
+        if (NULL != config->handlers[i]->param_destroy) {
+            bxierr_p err = config->handlers[i]->param_destroy(&param);
+            if (bxierr_isko(err)) bxierr_list_append(errlist, err);
+        }
+    }
+    if (n < config->handlers_nb) {
+        config->handlers_nb = n;
+        if (NULL != tries) BXILOG__GLOBALS->filters_tries_nb = n;
+        bxilog__registry_reconfigure();
+    }
+
+    if (errlist->errors_nb > 0) {
+        return bxierr_from_list(BXIERR_GROUP_CODE, errlist,
+                                "Errors encountered while destroying parameters "
+                                "of removed handlers");
+    }
+    bxierr_list_destroy(&errlist);
+    return BXIERR_OK;
+}
+
 bxierr_p bxilog_get_level_from_str(char * level_str, bxilog_level_e *level) {
     if (0 == strcasecmp("off", level_str)) {
         *level = BXILOG_OFF;
@@ -277,3 +364,15 @@ bxierr_p bxilog_get_level_from_str(char * level_str, bxilog_level_e *level) {
 //*********************************************************************************
 //********************************** Static Helpers Implementation ****************
 //*********************************************************************************
+
+void _release_filters_tries(void) {
+    bxilog_filters_trie_p * tries = BXILOG__GLOBALS->filters_tries;
+    if (NULL == tries) return;
+
+    BXILOG__GLOBALS->filters_tries = NULL;
+    for (size_t i = 0; i < BXILOG__GLOBALS->filters_tries_nb; i++) {
+        bxilog_filters_trie_destroy(&tries[i]);
+    }
+    BXILOG__GLOBALS->filters_tries_nb = 0;
+    BXIFREE(tries);
+}
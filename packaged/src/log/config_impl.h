@@ -36,5 +36,7 @@
 
 bxierr_p bxilog__config_destroy(bxilog_config_p * config_p);
 bxierr_p bxilog__config_loggers();
+bxierr_p bxilog__config_handler_filters(size_t handler_rank);
+bxierr_p bxilog__config_release_removed(void);
 
 #endif
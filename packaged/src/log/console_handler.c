@@ -97,6 +97,8 @@ static bxierr_p _process_log(bxilog_record_p record,
                              char * loggername,
                              char * logmsg,
                              bxilog_console_handler_param_p data);
+static bxierr_p _process_logs(bxilog_log_p logs, size_t logs_nb,
+                              bxilog_console_handler_param_p data);
 static bxierr_p _display_color(char * line,
                                size_t line_len,
                                bool last,
@@ -134,6 +136,8 @@ static const bxilog_handler_s BXILOG_CONSOLE_HANDLER_S = {
                                                char * loggername,
                                                char * logmsg,
                                                bxilog_handler_param_p param)) _process_log,
+                  .process_logs = (bxierr_p (*)(bxilog_log_p, size_t,
+                                                bxilog_handler_param_p)) _process_logs,
                   .process_ierr = (bxierr_p (*) (bxierr_p*, bxilog_handler_param_p)) _process_ierr,
                   .process_implicit_flush = (bxierr_p (*) (bxilog_handler_param_p)) _process_implicit_flush,
                   .process_explicit_flush = (bxierr_p (*) (bxilog_handler_param_p)) _process_explicit_flush,
@@ -384,6 +388,30 @@ inline bxierr_p _process_log(bxilog_record_p record,
     return err;
 }
 
+bxierr_p _process_logs(bxilog_log_p logs, size_t logs_nb,
+                       bxilog_console_handler_param_p data) {
+
+    bxierr_p err = BXIERR_OK, err2;
+    // A stream is locked once for all the logs displayed on it in a row
+    FILE * locked = NULL;
+    for (size_t i = 0; i < logs_nb; i++) {
+        FILE * out = (logs[i].record->level > data->stderr_level) ? stdout : stderr;
+        if (out != locked) {
+            if (NULL != locked) funlockfile(locked);
+            flockfile(out);
+            locked = out;
+        }
+        err2 = _process_log(logs[i].record,
+                            logs[i].filename, logs[i].funcname, logs[i].loggername,
+                            logs[i].logmsg,
+                            data);
+        BXIERR_CHAIN(err, err2);
+    }
+    if (NULL != locked) funlockfile(locked);
+
+    return err;
+}
+
 bxierr_p _process_ierr(bxierr_p *err, bxilog_console_handler_param_p data) {
     bxierr_p result = BXIERR_OK;
 
@@ -535,9 +563,7 @@ inline bxierr_p _display_nocolor(char * line,
                      param->loggername);
     }
 
-    for (size_t i = 0; i < line_len; i++) {
-        fputc(line[i], param->out);
-    }
+    fwrite(line, sizeof(*line), line_len, param->out);
     fputc('\n', param->out);
 
     UNUSED(rc);
@@ -571,9 +597,7 @@ inline bxierr_p _display_color(char * line,
                      data->colors[record->level]);
     }
 
-    for (size_t i = 0; i < line_len; i++) {
-        fputc(line[i], param->out);
-    }
+    fwrite(line, sizeof(*line), line_len, param->out);
     fputs(RESET_COLORS, param->out);
     fputc('\n', param->out);
 
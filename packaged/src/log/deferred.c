@@ -0,0 +1,377 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bxi/base/err.h"
+
+#include "deferred_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// Call snprintf() with the width and precision given as arguments if any
+#define SNPRINTF(dst, avail, spec, stars, star, value)                           \
+    ((0 == (stars)) ? snprintf((dst), (avail), (spec), (value)) :                \
+     (1 == (stars)) ? snprintf((dst), (avail), (spec), (star)[0], (value)) :     \
+                      snprintf((dst), (avail), (spec), (star)[0], (star)[1], (value)))
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+typedef enum {
+    ARG_NONE,           // "%%"
+    ARG_INT,            // d, i, o, u, x, X, c (and hh, h length modifiers)
+    ARG_LONG,           // l
+    ARG_LLONG,          // ll, q, L
+    ARG_SIZE,           // z, Z
+    ARG_INTMAX,         // j
+    ARG_PTRDIFF,        // t
+    ARG_DOUBLE,         // e, E, f, F, g, G, a, A
+    ARG_LDOUBLE,        // L
+    ARG_STR,            // s
+    ARG_PTR,            // p
+    ARG_UNSUPPORTED,
+} arg_type_e;
+
+typedef struct {
+    const char * start;         // The '%' character
+    size_t len;                 // The length of the specification
+    size_t stars;               // Number of '*' (width and precision as arguments)
+    bool prec_star;             // The precision is given as an argument
+    int prec;                   // The precision, -1 if none or given as an argument
+    arg_type_e type;            // The type of the converted argument
+} spec_s;
+
+typedef spec_s * spec_p;
+
+//*********************************************************************************
+//********************************** Static Functions  ****************************
+//*********************************************************************************
+
+static const char * _next_spec(const char * fmt, spec_p spec);
+static void _put(char * buf, size_t size, size_t * pos, const void * src, size_t len);
+static void _get(const char ** packed, const char * end, void * dst, size_t len);
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Implementation    ****************************
+//*********************************************************************************
+
+bool bxilog__deferred_supported(const char * fmt) {
+    if (NULL == fmt) return false;
+    spec_s spec;
+    while (NULL != (fmt = _next_spec(fmt, &spec))) {
+        if (ARG_UNSUPPORTED == spec.type) return false;
+    }
+    return true;
+}
+
+size_t bxilog__deferred_pack(char * const buf, const size_t size,
+                             const char * const fmt, va_list ap) {
+    size_t pos = 0;
+    _put(buf, size, &pos, &fmt, sizeof(fmt));
+
+    spec_s spec;
+    const char * next = fmt;
+    while (NULL != (next = _next_spec(next, &spec))) {
+        int prec = spec.prec;
+        for (size_t i = 0; i < spec.stars; i++) {
+            int star = va_arg(ap, int);
+            _put(buf, size, &pos, &star, sizeof(star));
+            if (spec.prec_star && i == spec.stars - 1) prec = star;
+        }
+        switch (spec.type) {
+            case ARG_NONE: break;
+            case ARG_INT: {
+                int value = va_arg(ap, int);
+                _put(buf, size, &pos, &value, sizeof(value));
+                break;
+            }
+            case ARG_LONG: {
+                long value = va_arg(ap, long);
+                _put(buf, size, &pos, &value, sizeof(value));
+                break;
+            }
+            case ARG_LLONG: {
+                long long value = va_arg(ap, long long);
+                _put(buf, size, &pos, &value, sizeof(value));
+                break;
+            }
+            case ARG_SIZE: {
+                size_t value = va_arg(ap, size_t);
+                _put(buf, size, &pos, &value, sizeof(value));
+                break;
+            }
+            case ARG_INTMAX: {
+                intmax_t value = va_arg(ap, intmax_t);
+                _put(buf, size, &pos, &value, sizeof(value));
+                break;
+            }
+            case ARG_PTRDIFF: {
+                ptrdiff_t value = va_arg(ap, ptrdiff_t);
+                _put(buf, size, &pos, &value, sizeof(value));
+                break;
+            }
+            case ARG_DOUBLE: {
+                double value = va_arg(ap, double);
+                _put(buf, size, &pos, &value, sizeof(value));
+                break;
+            }
+            case ARG_LDOUBLE: {
+                long double value = va_arg(ap, long double);
+                _put(buf, size, &pos, &value, sizeof(value));
+                break;
+            }
+            case ARG_PTR: {
+                void * value = va_arg(ap, void *);
+                _put(buf, size, &pos, &value, sizeof(value));
+                break;
+            }
+            case ARG_STR: {
+                const char * value = va_arg(ap, const char *);
+                // SIZE_MAX stands for NULL, printed "(null)" by the libc
+                size_t len = SIZE_MAX;
+                if (NULL != value) {
+                    // With a precision, the string might not be NULL terminated
+                    len = (0 <= prec) ? strnlen(value, (size_t) prec) : strlen(value);
+                }
+                _put(buf, size, &pos, &len, sizeof(len));
+                if (SIZE_MAX == len) break;
+                _put(buf, size, &pos, value, len);
+                _put(buf, size, &pos, "", 1);
+                break;
+            }
+            default:
+                bxiunreachable_statement;
+        }
+    }
+
+    return pos;
+}
+
+size_t bxilog__deferred_format(char * const buf, const size_t size,
+                               const char * packed, const size_t packed_len) {
+    const char * const end = packed + packed_len;
+    const char * fmt;
+    _get(&packed, end, &fmt, sizeof(fmt));
+
+    size_t pos = 0;
+    char spec_str[BXILOG__DEFERRED_SPEC_MAX];
+    spec_s spec;
+    const char * next = fmt;
+    while (NULL != (next = _next_spec(next, &spec))) {
+        // The text before the specification
+        _put(buf, size, &pos, fmt, (size_t) (spec.start - fmt));
+        fmt = next;
+
+        memcpy(spec_str, spec.start, spec.len);
+        spec_str[spec.len] = '\0';
+
+        int star[2];
+        for (size_t i = 0; i < spec.stars; i++) _get(&packed, end, &star[i], sizeof(*star));
+
+        char * const dst = (pos < size) ? buf + pos : NULL;
+        const size_t avail = (pos < size) ? size - pos : 0;
+        int n = 0;
+        switch (spec.type) {
+            case ARG_NONE: _put(buf, size, &pos, "%", 1); break;
+            case ARG_INT: {
+                int value;
+                _get(&packed, end, &value, sizeof(value));
+                n = SNPRINTF(dst, avail, spec_str, spec.stars, star, value);
+                break;
+            }
+            case ARG_LONG: {
+                long value;
+                _get(&packed, end, &value, sizeof(value));
+                n = SNPRINTF(dst, avail, spec_str, spec.stars, star, value);
+                break;
+            }
+            case ARG_LLONG: {
+                long long value;
+                _get(&packed, end, &value, sizeof(value));
+                n = SNPRINTF(dst, avail, spec_str, spec.stars, star, value);
+                break;
+            }
+            case ARG_SIZE: {
+                size_t value;
+                _get(&packed, end, &value, sizeof(value));
+                n = SNPRINTF(dst, avail, spec_str, spec.stars, star, value);
+                break;
+            }
+            case ARG_INTMAX: {
+                intmax_t value;
+                _get(&packed, end, &value, sizeof(value));
+                n = SNPRINTF(dst, avail, spec_str, spec.stars, star, value);
+                break;
+            }
+            case ARG_PTRDIFF: {
+                ptrdiff_t value;
+                _get(&packed, end, &value, sizeof(value));
+                n = SNPRINTF(dst, avail, spec_str, spec.stars, star, value);
+                break;
+            }
+            case ARG_DOUBLE: {
+                double value;
+                _get(&packed, end, &value, sizeof(value));
+                n = SNPRINTF(dst, avail, spec_str, spec.stars, star, value);
+                break;
+            }
+            case ARG_LDOUBLE: {
+                long double value;
+                _get(&packed, end, &value, sizeof(value));
+                n = SNPRINTF(dst, avail, spec_str, spec.stars, star, value);
+                break;
+            }
+            case ARG_PTR: {
+                void * value;
+                _get(&packed, end, &value, sizeof(value));
+                n = SNPRINTF(dst, avail, spec_str, spec.stars, star, value);
+                break;
+            }
+            case ARG_STR: {
+                size_t len;
+                _get(&packed, end, &len, sizeof(len));
+                const char * value = NULL;
+                if (SIZE_MAX != len) {
+                    bxiassert(packed + len < end);
+                    value = packed;
+                    packed += len + 1;
+                }
+                n = SNPRINTF(dst, avail, spec_str, spec.stars, star, value);
+                break;
+            }
+            default:
+                bxiunreachable_statement;
+        }
+        bxiassert(0 <= n);
+        pos += (size_t) n;
+    }
+    // The remaining text and the NULL terminating byte
+    _put(buf, size, &pos, fmt, strlen(fmt) + 1);
+    if (pos > size && 0 < size) buf[size - 1] = '\0';
+
+    return pos;
+}
+
+//*********************************************************************************
+//********************************** Static Helpers Implementation ****************
+//*********************************************************************************
+
+const char * _next_spec(const char * fmt, const spec_p spec) {
+    const char * p = strchr(fmt, '%');
+    if (NULL == p) return NULL;
+
+    spec->start = p;
+    spec->stars = 0;
+    spec->prec_star = false;
+    spec->prec = -1;
+    spec->type = ARG_UNSUPPORTED;
+    p++;
+
+    if ('%' == *p) {
+        spec->type = ARG_NONE;
+        spec->len = 2;
+        return p + 1;
+    }
+    // Flags
+    while (NULL != strchr("-+ #0'I", *p) && '\0' != *p) p++;
+    // Width
+    if ('*' == *p) {
+        spec->stars++;
+        p++;
+    } else {
+        while ('0' <= *p && *p <= '9') p++;
+    }
+    // Positional arguments ("%1$d") are not supported
+    if ('$' == *p) goto unsupported;
+    // Precision
+    if ('.' == *p) {
+        p++;
+        if ('*' == *p) {
+            spec->stars++;
+            spec->prec_star = true;
+            p++;
+        } else {
+            spec->prec = 0;
+            while ('0' <= *p && *p <= '9') spec->prec = spec->prec * 10 + (*p++ - '0');
+        }
+    }
+    // Length modifier
+    arg_type_e int_type = ARG_INT;
+    arg_type_e float_type = ARG_DOUBLE;
+    bool wide = false;
+    switch (*p) {
+        case 'h': p++; if ('h' == *p) p++; break;
+        case 'l':
+            p++;
+            if ('l' == *p) {
+                p++;
+                int_type = ARG_LLONG;
+            } else {
+                int_type = ARG_LONG;
+                wide = true;
+            }
+            break;
+        case 'q': p++; int_type = ARG_LLONG; break;
+        case 'L': p++; int_type = ARG_LLONG; float_type = ARG_LDOUBLE; break;
+        case 'j': p++; int_type = ARG_INTMAX; break;
+        case 'z': case 'Z': p++; int_type = ARG_SIZE; break;
+        case 't': p++; int_type = ARG_PTRDIFF; break;
+        default: break;
+    }
+    // Conversion
+    switch (*p) {
+        case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+            spec->type = int_type;
+            break;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            spec->type = float_type;
+            break;
+        case 'c': spec->type = wide ? ARG_UNSUPPORTED : ARG_INT; break;
+        case 's': spec->type = wide ? ARG_UNSUPPORTED : ARG_STR; break;
+        case 'p': spec->type = ARG_PTR; break;
+        case '\0': goto unsupported;
+        default: break;     // %n, %m, %C, %S, ...
+    }
+    p++;
+    spec->len = (size_t) (p - spec->start);
+    if (BXILOG__DEFERRED_SPEC_MAX <= spec->len) goto unsupported;
+    return p;
+
+unsupported:
+    spec->type = ARG_UNSUPPORTED;
+    spec->len = (size_t) (p - spec->start);
+    return ('\0' == *p) ? p : p + 1;
+}
+
+void _put(char * const buf, const size_t size, size_t * const pos,
+          const void * const src, const size_t len) {
+    if (*pos < size) memcpy(buf + *pos, src, (len < size - *pos) ? len : size - *pos);
+    *pos += len;
+}
+
+void _get(const char ** const packed, const char * const end,
+          void * const dst, const size_t len) {
+    bxiassert(*packed + len <= end);
+    memcpy(dst, *packed, len);
+    *packed += len;
+}
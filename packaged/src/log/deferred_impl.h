@@ -0,0 +1,67 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#ifndef BXILOG_DEFERRED_IMPL_H
+#define BXILOG_DEFERRED_IMPL_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// Longest conversion specification supported (e.g. "%-+#0'*.*lld")
+#define BXILOG__DEFERRED_SPEC_MAX 32
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interface         ****************************
+//*********************************************************************************
+
+/*
+ * Return true if the given format can be packed by bxilog__deferred_pack().
+ *
+ * Formats using positional arguments, %n, %m (errno would be the one of the
+ * handler thread) or wide characters are not supported.
+ */
+bool bxilog__deferred_supported(const char * fmt);
+
+/*
+ * Producer: pack the given format pointer and the arguments it describes into buf.
+ *
+ * Scalars are stored as is, strings are copied (with their NULL terminating byte).
+ * At most size bytes are written. Return the number of bytes required.
+ *
+ * The format is not copied: it must remain valid until the record is formatted.
+ */
+size_t bxilog__deferred_pack(char * buf, size_t size, const char * fmt, va_list ap);
+
+/*
+ * Consumer: format the given packed arguments into buf, as snprintf() would.
+ *
+ * At most size bytes are written and buf is NULL terminated if size is not 0.
+ * Return the number of bytes required, including the NULL terminating byte.
+ */
+size_t bxilog__deferred_format(char * buf, size_t size,
+                               const char * packed, size_t packed_len);
+
+#endif
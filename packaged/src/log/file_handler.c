@@ -22,7 +22,10 @@
 #include <sys/stat.h>
 #include <sys/uio.h>
 #include <sys/mman.h>
+#include <signal.h>
+#include <time.h>
 
+#include <zlib.h>
 
 #include "bxi/base/err.h"
 #include "bxi/base/mem.h"
@@ -33,6 +36,8 @@
 
 #include "handler_impl.h"
 #include "log_impl.h"
+#include "archiver_impl.h"
+#include "binary_impl.h"
 
 #include "bxi/base/log/file_handler.h"
 
@@ -45,6 +50,13 @@
 #define INTERNAL_LOGGER_NAME BXILOG_LIB_PREFIX "bxilog.handler.file"
 #define DEFAULT_BLOCKS_NB 4
 
+// Smaller batches are formatted by the handler thread alone: waking the workers up
+// would cost more than it saves
+#define WORKERS_BATCH_MIN 32
+
+// Suffix of rotated log files: "<filename>.YYYYMMDDTHHMMSS"
+#define SEGMENT_SUFFIX_FMT "%Y%m%dT%H%M%S"
+
 // WARNING: highly dependent on the log format
 #define YEAR_SIZE 4
 #define MONTH_SIZE 2
@@ -59,7 +71,7 @@
 
 // WARNING: highly dependent on the log format
 #ifdef __linux__
-// LOG_FMT "%c|%0*d%0*d%0*dT%0*d%0*d%0*d.%0*ld|%0*u.%0*u=%0*u:%s|%s:%d@%s|%s|%s\n";
+// printf() format: "%c|%0*d%0*d%0*dT%0*d%0*d%0*d.%0*ld|%0*u.%0*u=%0*u:%s|%s:%d@%s|%s|%s\n";
 // O|20140918T090752.472145261|11297.11302=01792:unit_t|unit_t.c:308@_dummy|bxiclib.test|msg
 
 #define FIXED_LOG_SIZE 2 + YEAR_SIZE + MONTH_SIZE + DAY_SIZE +\
@@ -75,18 +87,54 @@
                                                  // such as ':|:@||\n' in that order
 #endif
 
+// Calendar part of the timestamp: YYYYMMDDTHHMMSS
+#define DATE_SIZE YEAR_SIZE + MONTH_SIZE + DAY_SIZE +\
+                  1 + HOUR_SIZE + MINUTE_SIZE + SECOND_SIZE
+
+// Room for numbers wider than expected (pid, tid, rank and line number)
+#define PREFIX_SLACK 64
+
 #define _ilog(level, data, ...) _internal_log_func(level, data, __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
 
 //*********************************************************************************
 //********************************** Types ****************************************
 //*********************************************************************************
 typedef struct bxilog_file_handler_param_s_f * bxilog_file_handler_param_p;
+
+// What all lines of a record share
+typedef struct {
+    time_t sec;                     // Cache of the last localtime_r() call:
+    char date[DATE_SIZE];           // records processed in a row share their second
+    char * prefix;                  // Prefix of the lines of the current record
+    size_t prefix_size;
+} line_fmt_s;
+
+typedef line_fmt_s * line_fmt_p;
+
+// A thread formatting its share of a batch in its own buffer. The first one is the
+// handler thread itself.
+typedef struct {
+    bxilog_file_handler_param_p data;
+    pthread_t thread;
+    bxilog_log_p * logs;            // Logs of the batch given to this worker, in order
+    size_t logs_nb;
+    size_t logs_max;
+    char * buf;                     // Lines formatted from these logs
+    size_t buf_size;
+    size_t next_char;
+    line_fmt_s fmt;
+    bxierr_p err;
+} file_worker_s;
+
+typedef file_worker_s * file_worker_p;
 typedef struct bxilog_file_handler_param_s_f {
     bxilog_handler_param_s generic;
     int open_flags;
     char * filename;
     char * progname;
     size_t progname_len;
+    char * progname_frag;           // ":progname|" as copied in each line
+    size_t progname_frag_len;
     pid_t pid;
     int fd;                         // the file descriptor where log must be produced
 #ifdef __linux__
@@ -101,14 +149,49 @@ typedef struct bxilog_file_handler_param_s_f {
     size_t next_char;
     size_t buf_size;
     char * buf;
+    line_fmt_s fmt;
+    size_t workers_nb;              // Formatting threads, the handler one included
+    file_worker_p workers;
+    pthread_mutex_t workers_mutex;
+    pthread_cond_t workers_start;   // Signaled when a batch is ready to be formatted
+    pthread_cond_t workers_done;    // Signaled when the last worker is done with it
+    size_t workers_gen;             // Incremented for each batch
+    size_t workers_pending;         // Workers still formatting the current batch
+    bool workers_exit;
+    size_t io_bufs_nb;              // Output buffers, the one being filled included
+    char ** io_bufs;                // NULL when written from the handler thread
+    size_t * io_lens;               // Bytes to write from each buffer
+    bool * io_finish;               // Whether each buffer ends a gzip member
+    size_t io_submitted;            // Buffers given to the writer thread so far
+    size_t io_completed;            // Buffers it has written so far, in order
+    pthread_t io_thread;
+    pthread_mutex_t io_mutex;
+    pthread_cond_t io_submit_cond;  // Signaled when a buffer is given to the writer
+    pthread_cond_t io_complete_cond;// Signaled when it has written some buffers
+    bxierr_p io_err;                // Write errors, recorded by the handler thread
+    bxierr_p io_fatal;              // Errors making the handler exit (broken pipe)
+    bool io_exit;
+    bool rotate;                    // Whether rotation has been requested
+    size_t seg_bytes;               // Bytes given to the current file so far
+    size_t seg_base;                // Of which before the first record (header)
+    time_t seg_start;               // When the current file has been opened
+    bxilog__archiver_p archiver;    // NULL when rotated files are left as they are
+    bool binary;                    // Records are encoded instead of formatted
+    bxilog__binenc_p binenc;        // (see binary_impl.h)
+    z_stream * zstream;             // NULL when the file is not compressed
+    char * zbuf;                    // Compressed bytes to write
+    size_t zbuf_size;
+    size_t zlen;
+    bool zopen;                     // Whether a gzip member has been started
+    bool frame_end;                 // Whether the next buffer written ends it
 } bxilog_file_handler_param_s;
 
 typedef struct {
     const bxilog_file_handler_param_p data;
+    const file_worker_p worker;     // NULL when lines go straight to the file buffer
     const bxilog_record_p record;
-    const char * filename;
-    const char *funcname;
-    const char * loggername;
+    const char * prefix;            // Shared by all lines of the record
+    const size_t prefix_len;
     const char *logmsg;
 } log_single_line_param_s;
 
@@ -127,6 +210,25 @@ static bxierr_p _process_log(bxilog_record_p record,
                              char * loggername,
                              char * logmsg,
                              bxilog_file_handler_param_p data);
+static bxierr_p _process_logs(bxilog_log_p logs, size_t logs_nb,
+                              bxilog_file_handler_param_p data);
+static bxierr_p _format_log(bxilog_record_p record,
+                            char * filename,
+                            char * funcname,
+                            char * loggername,
+                            char * logmsg,
+                            bxilog_file_handler_param_p data,
+                            file_worker_p worker);
+static bxierr_p _encode_log(bxilog_record_p record,
+                            char * filename,
+                            char * funcname,
+                            char * loggername,
+                            char * logmsg,
+                            bxilog_file_handler_param_p data);
+static bxierr_p _encode_header(bxilog_file_handler_param_p data);
+static bxilog_handler_param_p _binary_param_new(bxilog_handler_p self,
+                                                bxilog_filters_p filters,
+                                                va_list ap);
 static bxierr_p _process_ierr(bxierr_p * err, bxilog_file_handler_param_p data);
 static bxierr_p _process_implicit_flush(bxilog_file_handler_param_p data);
 static bxierr_p _process_explicit_flush(bxilog_file_handler_param_p data);
@@ -136,30 +238,56 @@ static bxierr_p _param_destroy(bxilog_file_handler_param_p *data_p);
 
 static bxierr_p _get_file_fd(bxilog_file_handler_param_p data);
 
+static bxierr_p _start_workers(bxilog_file_handler_param_p data);
+static void _stop_workers(bxilog_file_handler_param_p data);
+static void * _worker_main(file_worker_p worker);
+static void _worker_format(file_worker_p worker);
+static size_t _worker_of(bxilog_file_handler_param_p data, bxilog_record_p record);
+static bxierr_p _process_logs_sharded(bxilog_log_p logs, size_t logs_nb,
+                                      bxilog_file_handler_param_p data);
+
 static bxierr_p _log_single_line(char * line,
                              size_t line_len,
                              bool last,
                              log_single_line_param_p param);
 
-static size_t _mkmsg(const size_t n, char buf[n],
-                     const char level,
-                     const struct timespec * const detail_time,
-                     const pid_t pid,
+static void _line_fmt_init(line_fmt_p fmt);
+static const char * _date(line_fmt_p fmt, time_t sec);
+static size_t _mkprefix(bxilog_file_handler_param_p data,
+                        line_fmt_p fmt,
+                        const bxilog_record_p record,
+                        const char * filename,
+                        const char * funcname,
+                        const char * loggername);
+static size_t _dec_width(uint32_t value, size_t min);
+static void _put_dec(char * p, size_t width, uint32_t value);
 #ifdef __linux__
-                     const pid_t tid,
+static size_t _hex_width(uintptr_t value, size_t min);
+static void _put_hex(char * p, size_t width, uintptr_t value);
 #endif
-                     const uintptr_t thread_rank,
-                     const char * const progname,
-                     const char * const filename,
-                     const int line_nb,
-                     const char * const funcname,
-                     const char * const loggername,
-                     const char * const logmsg,
-                     size_t line_len);
 
 static bxierr_p _flush(bxilog_file_handler_param_p data);
 static bxierr_p _write(bxilog_file_handler_param_p data, const void * buf, size_t count);
+static bxierr_p _append(bxilog_file_handler_param_p data, const char * buf, size_t count);
+static bxierr_p _start_writer(bxilog_file_handler_param_p data);
+static bxierr_p _stop_writer(bxilog_file_handler_param_p data);
+static void * _writer_main(bxilog_file_handler_param_p data);
+static bxierr_p _writev(bxilog_file_handler_param_p data,
+                        struct iovec * iov, int iovcnt,
+                        size_t * written);
+static bxierr_p _submit(bxilog_file_handler_param_p data);
+static bxierr_p _drain(bxilog_file_handler_param_p data);
+static bxierr_p _io_report(bxilog_file_handler_param_p data);
 static bxierr_p _sync(bxilog_file_handler_param_p data);
+static bxierr_p _start_zstream(bxilog_file_handler_param_p data);
+static void _deflate(bxilog_file_handler_param_p data,
+                     const void * in, size_t len, bool finish);
+static bxierr_p _end_frame(bxilog_file_handler_param_p data);
+static bxierr_p _close_frame(bxilog_file_handler_param_p data);
+static bxierr_p _write_zbuf(bxilog_file_handler_param_p data);
+static bool _rotation_due(bxilog_file_handler_param_p data);
+static void _rotate(bxilog_file_handler_param_p data);
+static char * _segment_name(bxilog_file_handler_param_p data);
 static void _tune_io(bxilog_file_handler_param_p data);
 static bxierr_p _internal_log_func(bxilog_level_e level,
                                    bxilog_file_handler_param_p data,
@@ -175,13 +303,27 @@ static void _record_new_error(bxilog_file_handler_param_p data, bxierr_p * err);
 // The various log levels specific characters
 const char BXILOG_FILE_HANDLER_LOG_LEVEL_STR[] = { '-', 'P', 'A', 'C', 'E', 'W', 'N', 'O',
                                                    'I', 'D', 'F', 'T', 'L'};
-// The log format used by the IHT when writing
+// The log format used by the IHT when writing is produced by _mkprefix()
 // WARNING: If you change this format, change also different #define above
 // along with FIXED_LOG_SIZE
+
+// Two decimal digits at a time
+static const char DIGIT_PAIRS[] = "00010203040506070809"
+                                  "10111213141516171819"
+                                  "20212223242526272829"
+                                  "30313233343536373839"
+                                  "40414243444546474849"
+                                  "50515253545556575859"
+                                  "60616263646566676869"
+                                  "70717273747576777879"
+                                  "80818283848586878889"
+                                  "90919293949596979899";
+
+static const uint32_t POW10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000,
+                                  10000000, 100000000, 1000000000 };
+
 #ifdef __linux__
-static const char LOG_FMT[] = "%c|%0*d%0*d%0*dT%0*d%0*d%0*d.%0*ld|%0*u.%0*u=%0*" PRIxPTR ":%s|%s:%d@%s|%s|";
-#else
-static const char LOG_FMT[] = "%c|%0*d%0*d%0*dT%0*d%0*d%0*d.%0*ld|%0*u.%0*u:%s|%s:%d@%s|%s|";
+static const char HEX_DIGITS[] = "0123456789abcdef";
 #endif
 
 static const bxilog_handler_s BXILOG_FILE_HANDLER_S = {
@@ -194,6 +336,8 @@ static const bxilog_handler_s BXILOG_FILE_HANDLER_S = {
                                                char * loggername,
                                                char * logmsg,
                                                bxilog_handler_param_p param)) _process_log,
+                  .process_logs = (bxierr_p (*)(bxilog_log_p, size_t,
+                                                bxilog_handler_param_p)) _process_logs,
                   .process_ierr = (bxierr_p (*) (bxierr_p*, bxilog_handler_param_p)) _process_ierr,
                   .process_implicit_flush = (bxierr_p (*) (bxilog_handler_param_p)) _process_implicit_flush,
                   .process_explicit_flush = (bxierr_p (*) (bxilog_handler_param_p)) _process_explicit_flush,
@@ -203,6 +347,28 @@ static const bxilog_handler_s BXILOG_FILE_HANDLER_S = {
 };
 const bxilog_handler_p BXILOG_FILE_HANDLER = (bxilog_handler_p) &BXILOG_FILE_HANDLER_S;
 
+// Same as the file handler, but records are written in the format of binary_impl.h
+static const bxilog_handler_s BXILOG_BINARY_FILE_HANDLER_S = {
+                  .name = "BXI Logging Binary File Handler",
+                  .param_new = _binary_param_new,
+                  .init = (bxierr_p (*) (bxilog_handler_param_p)) _init,
+                  .process_log = (bxierr_p (*)(bxilog_record_p record,
+                                               char * filename,
+                                               char * funcname,
+                                               char * loggername,
+                                               char * logmsg,
+                                               bxilog_handler_param_p param)) _process_log,
+                  .process_logs = (bxierr_p (*)(bxilog_log_p, size_t,
+                                                bxilog_handler_param_p)) _process_logs,
+                  .process_ierr = (bxierr_p (*) (bxierr_p*, bxilog_handler_param_p)) _process_ierr,
+                  .process_implicit_flush = (bxierr_p (*) (bxilog_handler_param_p)) _process_implicit_flush,
+                  .process_explicit_flush = (bxierr_p (*) (bxilog_handler_param_p)) _process_explicit_flush,
+                  .process_exit = (bxierr_p (*) (bxilog_handler_param_p)) _process_exit,
+                  .process_cfg = (bxierr_p (*) (bxilog_handler_param_p)) _process_cfg,
+                  .param_destroy = (bxierr_p (*) (bxilog_handler_param_p*)) _param_destroy,
+};
+const bxilog_handler_p BXILOG_BINARY_FILE_HANDLER = (bxilog_handler_p) &BXILOG_BINARY_FILE_HANDLER_S;
+
 //*********************************************************************************
 //********************************** Implementation    ****************************
 //*********************************************************************************
@@ -211,7 +377,7 @@ bxilog_handler_param_p _param_new(bxilog_handler_p self,
                                   bxilog_filters_p filters,
                                   va_list ap) {
 
-    bxiassert(BXILOG_FILE_HANDLER == self);
+    bxiassert(BXILOG_FILE_HANDLER == self || BXILOG_BINARY_FILE_HANDLER == self);
 
     char * progname = va_arg(ap, char *);
     char * filename = va_arg(ap, char *);
@@ -225,6 +391,21 @@ bxilog_handler_param_p _param_new(bxilog_handler_p self,
     result->open_flags = open_flags;
     result->progname = strdup(progname);
     result->progname_len = strlen(progname) + 1; // Include the NULL terminal byte
+    result->progname_frag = bxistr_new(":%s|", progname);
+    result->progname_frag_len = result->progname_len + 1;
+
+    return (bxilog_handler_param_p) result;
+}
+
+bxilog_handler_param_p _binary_param_new(bxilog_handler_p self,
+                                         bxilog_filters_p filters,
+                                         va_list ap) {
+
+    bxiassert(BXILOG_BINARY_FILE_HANDLER == self);
+
+    bxilog_file_handler_param_p result;
+    result = (bxilog_file_handler_param_p) _param_new(self, filters, ap);
+    result->binary = true;
 
     return (bxilog_handler_param_p) result;
 }
@@ -249,6 +430,7 @@ bxierr_p _init(bxilog_file_handler_param_p data) {
     data->bytes_lost = 0;
     data->bytes_written = 0;
     data->dirty = false;
+    _line_fmt_init(&data->fmt);
 
     err2 = _get_file_fd(data);
     BXIERR_CHAIN(err, err2);
@@ -262,7 +444,10 @@ bxierr_p _init(bxilog_file_handler_param_p data) {
         data->buf_size = 4 * 1024  * sizeof(*data->buf) * DEFAULT_BLOCKS_NB;
     } else {
         data->buf_size = ((size_t) st.st_blksize) * sizeof(*data->buf) * DEFAULT_BLOCKS_NB;
+        // An appended file is rotated as if it had been written by us
+        data->seg_bytes = (size_t) st.st_size;
     }
+    data->seg_start = time(NULL);
 //    data->buf_size = 241 * sizeof(*data->buf) * DEFAULT_BLOCKS_NB;
     size_t align = (size_t) sysconf(_SC_PAGESIZE);
 
@@ -274,8 +459,47 @@ bxierr_p _init(bxilog_file_handler_param_p data) {
         BXIERR_CHAIN(err, err2);
     }
 
+    if (0 < data->generic.compress_level && NULL != data->buf) {
+        err2 = _start_zstream(data);
+        BXIERR_CHAIN(err, err2);
+    }
+
+    data->io_bufs_nb = (0 == data->generic.write_buffers_nb) ?
+                            1 : data->generic.write_buffers_nb;
+    if (1 < data->io_bufs_nb && NULL != data->buf) {
+        err2 = _start_writer(data);
+        BXIERR_CHAIN(err, err2);
+    }
+
     _tune_io(data);
 
+    if (data->binary && NULL != data->buf) {
+        data->binenc = bxilog__binenc_new(data->progname);
+        err2 = _encode_header(data);
+        BXIERR_CHAIN(err, err2);
+    }
+
+    // Standard output and error can't be renamed
+    data->rotate = STDOUT_FILENO != data->fd && STDERR_FILENO != data->fd &&
+                   (0 < data->generic.rotate_size || 0 < data->generic.rotate_period_s);
+    // Rotated files are compressed already when the file itself is
+    const bool rotate_compress = data->generic.rotate_compress && NULL == data->zstream;
+    if (data->rotate && (0 < data->generic.rotate_keep || rotate_compress)) {
+        err2 = bxilog__archiver_new(data->filename,
+                                    data->generic.rotate_keep,
+                                    rotate_compress,
+                                    &data->archiver);
+        BXIERR_CHAIN(err, err2);
+    }
+
+    data->workers_nb = (0 == data->generic.workers_nb) ? 1 : data->generic.workers_nb;
+    // Each record is encoded according to the previous ones
+    if (data->binary) data->workers_nb = 1;
+    if (1 < data->workers_nb && NULL != data->buf) {
+        err2 = _start_workers(data);
+        BXIERR_CHAIN(err, err2);
+    }
+
 //    fprintf(stderr, "%d.%d: Initialization: ok\n", data->pid, data->tid);
     return err;
 }
@@ -283,7 +507,18 @@ bxierr_p _init(bxilog_file_handler_param_p data) {
 bxierr_p _process_exit(bxilog_file_handler_param_p data) {
     bxierr_p err = BXIERR_OK, err2;
 
+    // The last batch has been written already
+    _stop_workers(data);
+
+    // So has been the last buffer submitted
+    err2 = _stop_writer(data);
+    BXIERR_CHAIN(err, err2);
+
     if (0 < data->fd) {
+        // A file ending with a complete gzip member is read without error
+        err2 = _close_frame(data);
+        BXIERR_CHAIN(err, err2);
+
 //        err2 = _ilog(BXILOG_TRACE, data,
 //                     "Total of %zu bytes written (excluding this message)",
 //                     data->bytes_written);
@@ -308,6 +543,10 @@ bxierr_p _process_exit(bxilog_file_handler_param_p data) {
         }
     }
 
+    // Rotated files not processed yet are, before returning
+    err2 = bxilog__archiver_destroy(&data->archiver);
+    BXIERR_CHAIN(err, err2);
+
     if (data->bytes_lost > 0) {
         char * str = bxistr_new("BXI Log File Handler Error Summary:\n"
                                 "\tNumber of bytes written: %zu\n"
@@ -329,6 +568,13 @@ bxierr_p _process_exit(bxilog_file_handler_param_p data) {
         bxierr_set_destroy(&data->errset);
     }
     BXIFREE(data->buf);
+    BXIFREE(data->fmt.prefix);
+    bxilog__binenc_destroy(&data->binenc);
+    if (NULL != data->zstream) {
+        deflateEnd(data->zstream);
+        BXIFREE(data->zstream);
+    }
+    BXIFREE(data->zbuf);
 
 //    fprintf(stderr, "%d.%d: process_exit: ok\n", data->pid, data->tid);
     return err;
@@ -337,9 +583,13 @@ bxierr_p _process_exit(bxilog_file_handler_param_p data) {
 inline bxierr_p _process_implicit_flush(bxilog_file_handler_param_p data) {
     bxierr_p err = BXIERR_OK, err2;
 
-    err2 = _flush(data);
+    // Readers of a compressed file get everything flushed so far
+    err2 = _end_frame(data);
     BXIERR_CHAIN(err, err2);
 
+    // Nothing may have been flushed for a while
+    if (_rotation_due(data)) _rotate(data);
+
     err2 = _sync(data);
     BXIERR_CHAIN(err, err2);
 
@@ -353,10 +603,14 @@ inline bxierr_p _process_explicit_flush(bxilog_file_handler_param_p data) {
 //    err2 = _ilog(BXILOG_TRACE, data, "Flushing requested");
 //    BXIERR_CHAIN(err, err2);
 //    fprintf(stderr, "Flushing\n");
-    err2 = _flush(data);
+    err2 = _end_frame(data);
 //    fprintf(stderr, "Flushed\n");
     BXIERR_CHAIN(err, err2);
 
+    // Logs produced before the request must have been written when it returns
+    err2 = _drain(data);
+    BXIERR_CHAIN(err, err2);
+
     err2 = _sync(data);
     BXIERR_CHAIN(err, err2);
 
@@ -373,12 +627,31 @@ inline bxierr_p _process_log(bxilog_record_p record,
                              char * logmsg,
                              bxilog_file_handler_param_p data) {
 
+    if (NULL != data->binenc) {
+        return _encode_log(record, filename, funcname, loggername, logmsg, data);
+    }
+    return _format_log(record, filename, funcname, loggername, logmsg, data, NULL);
+}
+
+inline bxierr_p _format_log(bxilog_record_p record,
+                            char * filename,
+                            char * funcname,
+                            char * loggername,
+                            char * logmsg,
+                            bxilog_file_handler_param_p data,
+                            file_worker_p worker) {
+
+    // Lines of a multi-line message share the same prefix
+    line_fmt_p fmt = (NULL == worker) ? &data->fmt : &worker->fmt;
+    const size_t prefix_len = _mkprefix(data, fmt, record,
+                                        filename, funcname, loggername);
+
     log_single_line_param_s param = {
                                      .data = data,
+                                     .worker = worker,
                                      .record = record,
-                                     .filename = filename,
-                                     .funcname = funcname,
-                                     .loggername = loggername,
+                                     .prefix = fmt->prefix,
+                                     .prefix_len = prefix_len,
                                      .logmsg = logmsg,
     };
 //    fprintf(stderr, "Processing log\n");
@@ -392,6 +665,49 @@ inline bxierr_p _process_log(bxilog_record_p record,
 
 }
 
+inline bxierr_p _encode_log(bxilog_record_p record,
+                            char * filename,
+                            char * funcname,
+                            char * loggername,
+                            char * logmsg,
+                            bxilog_file_handler_param_p data) {
+
+    // The header of a new file resets the encoder: rotate between two records
+    if (_rotation_due(data)) _rotate(data);
+
+    const char * buf;
+    const size_t len = bxilog__binenc_record(data->binenc, record,
+                                             filename, funcname, loggername, logmsg,
+                                             &buf);
+    return _append(data, buf, len);
+}
+
+// Each file starts with a header: it can be read on its own
+bxierr_p _encode_header(bxilog_file_handler_param_p data) {
+    const char * buf;
+    const size_t len = bxilog__binenc_header(data->binenc, &buf);
+    data->seg_base = data->seg_bytes + len;
+    return _append(data, buf, len);
+}
+
+bxierr_p _process_logs(bxilog_log_p logs, size_t logs_nb,
+                       bxilog_file_handler_param_p data) {
+
+    if (1 < data->workers_nb && WORKERS_BATCH_MIN <= logs_nb) {
+        return _process_logs_sharded(logs, logs_nb, data);
+    }
+
+    bxierr_p err = BXIERR_OK, err2;
+    for (size_t i = 0; i < logs_nb; i++) {
+        err2 = _process_log(logs[i].record,
+                            logs[i].filename, logs[i].funcname, logs[i].loggername,
+                            logs[i].logmsg,
+                            data);
+        BXIERR_CHAIN(err, err2);
+    }
+    return err;
+}
+
 
 bxierr_p _process_ierr(bxierr_p *err, bxilog_file_handler_param_p data) {
     bxierr_p result = BXIERR_OK;
@@ -444,6 +760,7 @@ inline bxierr_p _param_destroy(bxilog_file_handler_param_p * data_p) {
     bxilog_handler_clean_param(&data->generic);
 
     BXIFREE(data->progname);
+    BXIFREE(data->progname_frag);
     BXIFREE(data->filename);
     bximem_destroy((char**) data_p);
     return BXIERR_OK;
@@ -456,47 +773,40 @@ bxierr_p _log_single_line(char * line,
 
     UNUSED(last);
     bxilog_file_handler_param_p data = param->data;
-    bxilog_record_p record = param->record;
 
-    const size_t prefix_size = FIXED_LOG_SIZE + \
-            // Exclude NULL terminating byte from preprocessed length
-            data->progname_len - 1 + \
-            record->filename_len -1 + \
-            record->funcname_len - 1 + \
-            record->logname_len - 1 + \
-            bxistr_digits_nb(record->line_nb);
-
-    size_t size = prefix_size + line_len;
-
-    if (data->buf_size - data->next_char <= size) {
-        bxierr_p err = _flush(data);
-        bxierr_abort_ifko(err);
-    }
+    const size_t size = param->prefix_len + line_len + 1; // Include the '\n'
 
+    file_worker_p worker = param->worker;
     char * buf;
-    if (size > data->buf_size) {
-        buf = bximem_calloc(size + 1); // Include the NULL terminating byte since we
-                                       // use a specific buffer.
+    if (NULL != worker) {
+        // The whole share of the batch is kept, it is written by the handler thread
+        if (worker->buf_size - worker->next_char < size) {
+            size_t new_size = 2 * worker->buf_size + size;
+            worker->buf = bximem_realloc(worker->buf, worker->buf_size, new_size);
+            worker->buf_size = new_size;
+        }
+        buf = worker->buf + worker->next_char;
     } else {
-        buf = data->buf + data->next_char;
+        if (data->buf_size - data->next_char < size) {
+            bxierr_p err = _flush(data);
+            bxierr_abort_ifko(err);
+        }
+
+        if (size > data->buf_size) {
+            buf = bximem_calloc(size);
+        } else {
+            buf = data->buf + data->next_char;
+        }
     }
 
-    // Include the NULL terminating byte in the size given to
-    // underlying snprintf() call, it is required.
-    _mkmsg(prefix_size + 1, buf,
-           BXILOG_FILE_HANDLER_LOG_LEVEL_STR[record->level],
-           &record->detail_time,
-           record->pid,
-#ifdef __linux__
-           record->tid,
-#endif
-           record->thread_rank,
-           data->progname,
-           param->filename,
-           record->line_nb,
-           param->funcname,
-           param->loggername,
-           line, line_len);
+    memcpy(buf, param->prefix, param->prefix_len);
+    memcpy(buf + param->prefix_len, line, line_len);
+    buf[size - 1] = '\n';
+
+    if (NULL != worker) {
+        worker->next_char += size;
+        return BXIERR_OK;
+    }
 
     if (size > data->buf_size) {
         bxierr_p err = _write(data, buf, size);
@@ -504,67 +814,318 @@ bxierr_p _log_single_line(char * line,
         return err;
     }
 
-    data->next_char += (size_t) size;
+    data->next_char += size;
     data->dirty = true;
     bxiassert(data->next_char <= data->buf_size);
 
     return BXIERR_OK;
 }
 
+void _line_fmt_init(line_fmt_p fmt) {
+    fmt->prefix = NULL;
+    fmt->prefix_size = 0;
+    // Fill the cache with the date of second 0
+    fmt->sec = 1;
+    _date(fmt, 0);
+}
 
-size_t _mkmsg(const size_t n, char buf[n],
-               const char level,
-               const struct timespec * const detail_time,
-               const pid_t pid,
-#ifdef __linux__
-               const pid_t tid,
-#endif
-               const uintptr_t thread_rank,
-               const char * const progname,
-               const char * const filename,
-               const int line_nb,
-               const char * const funcname,
-               const char * const loggername,
-               const char * const logmsg,
-               size_t logmsg_len) {
+const char * _date(line_fmt_p fmt, time_t sec) {
+    if (sec == fmt->sec) return fmt->date;
 
     errno = 0;
-    struct tm dummy, *now;
-    now = localtime_r(&detail_time->tv_sec, &dummy);
+    struct tm tm;
+    struct tm * now = localtime_r(&sec, &tm);
     bxiassert(NULL != now);
 
-    int written = snprintf(buf, n, LOG_FMT,
-                           level,
-                           YEAR_SIZE, now->tm_year + 1900,
-                           MONTH_SIZE, now->tm_mon + 1,
-                           DAY_SIZE, now->tm_mday,
-                           HOUR_SIZE, now->tm_hour,
-                           MINUTE_SIZE, now->tm_min,
-                           SECOND_SIZE, now->tm_sec,
-                           SUBSECOND_SIZE, detail_time->tv_nsec,
-                           PID_SIZE, pid,
+    char * p = fmt->date;
+    _put_dec(p, YEAR_SIZE, (uint32_t) (tm.tm_year + 1900));
+    p += YEAR_SIZE;
+    _put_dec(p, MONTH_SIZE, (uint32_t) (tm.tm_mon + 1));
+    p += MONTH_SIZE;
+    _put_dec(p, DAY_SIZE, (uint32_t) tm.tm_mday);
+    p += DAY_SIZE;
+    *p++ = 'T';
+    _put_dec(p, HOUR_SIZE, (uint32_t) tm.tm_hour);
+    p += HOUR_SIZE;
+    _put_dec(p, MINUTE_SIZE, (uint32_t) tm.tm_min);
+    p += MINUTE_SIZE;
+    _put_dec(p, SECOND_SIZE, (uint32_t) tm.tm_sec);
+    fmt->sec = sec;
+
+    return fmt->date;
+}
+
+// O|20140918T090752.472145261|0011297.0011302=01792:unit_t|unit_t.c:308@_dummy|bxiclib.test|
+//
+// Numbers are zero padded to their *_SIZE, or wider when they do not fit, as
+// printf("%0*d") would do. Strings are copied with the lengths given in the record.
+size_t _mkprefix(bxilog_file_handler_param_p data,
+                 line_fmt_p fmt,
+                 const bxilog_record_p record,
+                 const char * filename,
+                 const char * funcname,
+                 const char * loggername) {
+
+    const size_t max = FIXED_LOG_SIZE + PREFIX_SLACK + data->progname_frag_len +
+                       record->filename_len + record->funcname_len + record->logname_len;
+    if (fmt->prefix_size < max) {
+        fmt->prefix = bximem_realloc(fmt->prefix, fmt->prefix_size, max);
+        fmt->prefix_size = max;
+    }
+
+    char * p = fmt->prefix;
+    size_t width;
+
+    *p++ = BXILOG_FILE_HANDLER_LOG_LEVEL_STR[record->level];
+    *p++ = '|';
+    memcpy(p, _date(fmt, record->detail_time.tv_sec), DATE_SIZE);
+    p += DATE_SIZE;
+    *p++ = '.';
+    _put_dec(p, SUBSECOND_SIZE, (uint32_t) record->detail_time.tv_nsec);
+    p += SUBSECOND_SIZE;
+    *p++ = '|';
+
+    width = _dec_width((uint32_t) record->pid, PID_SIZE);
+    _put_dec(p, width, (uint32_t) record->pid);
+    p += width;
+    *p++ = '.';
+#ifdef __linux__
+    width = _dec_width((uint32_t) record->tid, TID_SIZE);
+    _put_dec(p, width, (uint32_t) record->tid);
+    p += width;
+    *p++ = '=';
+    width = _hex_width(record->thread_rank, THREAD_RANK_SIZE);
+    _put_hex(p, width, record->thread_rank);
+    p += width;
+#else
+    width = _dec_width((uint32_t) record->thread_rank, THREAD_RANK_SIZE);
+    _put_dec(p, width, (uint32_t) record->thread_rank);
+    p += width;
+#endif
+
+    memcpy(p, data->progname_frag, data->progname_frag_len);
+    p += data->progname_frag_len;
+    // Exclude NULL terminating bytes from the lengths given in the record
+    memcpy(p, filename, record->filename_len - 1);
+    p += record->filename_len - 1;
+    *p++ = ':';
+    uint32_t line_nb = (uint32_t) record->line_nb;
+    if (0 > record->line_nb) {
+        *p++ = '-';
+        line_nb = -line_nb;
+    }
+    width = _dec_width(line_nb, 1);
+    _put_dec(p, width, line_nb);
+    p += width;
+    *p++ = '@';
+    memcpy(p, funcname, record->funcname_len - 1);
+    p += record->funcname_len - 1;
+    *p++ = '|';
+    memcpy(p, loggername, record->logname_len - 1);
+    p += record->logname_len - 1;
+    *p++ = '|';
+
+    const size_t len = (size_t) (p - fmt->prefix);
+    bxiassert(len <= max);
+    return len;
+}
+
+inline size_t _dec_width(uint32_t value, size_t min) {
+    size_t width = min;
+    while (width < ARRAYLEN(POW10) && value >= POW10[width]) width++;
+    return width;
+}
+
+inline void _put_dec(char * p, size_t width, uint32_t value) {
+    // From the last digit, two at a time
+    char * q = p + width;
+    while (q - p >= 2) {
+        q -= 2;
+        memcpy(q, DIGIT_PAIRS + 2 * (value % 100), 2);
+        value /= 100;
+    }
+    if (q > p) *--q = (char) ('0' + value % 10);
+}
+
+#ifdef __linux__
+inline size_t _hex_width(uintptr_t value, size_t min) {
+    if (0 == value) return min;
+    const size_t bits = 8 * sizeof(unsigned long) - (size_t) __builtin_clzl(value);
+    const size_t width = (bits + 3) / 4;
+    return (width < min) ? min : width;
+}
+
+inline void _put_hex(char * p, size_t width, uintptr_t value) {
+    for (char * q = p + width; q > p; value >>= 4) *--q = HEX_DIGITS[value & 0xf];
+}
+#endif
+
+bxierr_p _start_workers(bxilog_file_handler_param_p data) {
+    bxierr_p err = BXIERR_OK;
+
+    int rc = pthread_mutex_init(&data->workers_mutex, NULL);
+    bxiassert(0 == rc);
+    rc = pthread_cond_init(&data->workers_start, NULL);
+    bxiassert(0 == rc);
+    rc = pthread_cond_init(&data->workers_done, NULL);
+    bxiassert(0 == rc);
+    data->workers_gen = 0;
+    data->workers_pending = 0;
+    data->workers_exit = false;
+
+    // Workers must not receive signals: they are masked in the handler thread only
+    // once initialized
+    sigset_t mask, old_mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+
+    const size_t workers_nb = data->workers_nb;
+    data->workers = bximem_calloc(workers_nb * sizeof(*data->workers));
+    for (size_t k = 0; k < workers_nb; k++) {
+        file_worker_p worker = &data->workers[k];
+        worker->data = data;
+        worker->err = BXIERR_OK;
+        worker->buf_size = data->buf_size;
+        worker->buf = bximem_calloc(worker->buf_size);
+        _line_fmt_init(&worker->fmt);
+
+        // The first worker is the handler thread itself
+        if (0 == k) continue;
+
+        rc = pthread_create(&worker->thread, NULL,
+                            (void * (*) (void*)) _worker_main, worker);
+        if (0 != rc) {
+            err = bxierr_fromidx(rc, NULL,
+                                 "Calling pthread_create() failed (rc=%d), "
+                                 "%zu formatting threads out of %zu",
+                                 rc, k, workers_nb);
+            BXIFREE(worker->buf);
+            data->workers_nb = k;
+            break;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+
+    return err;
+}
+
+void _stop_workers(bxilog_file_handler_param_p data) {
+    if (NULL == data->workers) return;
+
+    pthread_mutex_lock(&data->workers_mutex);
+    data->workers_exit = true;
+    pthread_cond_broadcast(&data->workers_start);
+    pthread_mutex_unlock(&data->workers_mutex);
+
+    for (size_t k = 0; k < data->workers_nb; k++) {
+        file_worker_p worker = &data->workers[k];
+        if (0 < k) pthread_join(worker->thread, NULL);
+        BXIFREE(worker->buf);
+        BXIFREE(worker->fmt.prefix);
+        BXIFREE(worker->logs);
+        bxierr_destroy(&worker->err);
+    }
+    pthread_cond_destroy(&data->workers_done);
+    pthread_cond_destroy(&data->workers_start);
+    pthread_mutex_destroy(&data->workers_mutex);
+    BXIFREE(data->workers);
+    data->workers_nb = 1;
+}
+
+void * _worker_main(file_worker_p worker) {
+    bxilog_file_handler_param_p data = worker->data;
+    size_t gen = 0;
+
+    pthread_mutex_lock(&data->workers_mutex);
+    while (true) {
+        while (gen == data->workers_gen && !data->workers_exit) {
+            pthread_cond_wait(&data->workers_start, &data->workers_mutex);
+        }
+        if (data->workers_exit) break;
+        gen = data->workers_gen;
+        pthread_mutex_unlock(&data->workers_mutex);
+
+        _worker_format(worker);
+
+        pthread_mutex_lock(&data->workers_mutex);
+        data->workers_pending--;
+        if (0 == data->workers_pending) pthread_cond_signal(&data->workers_done);
+    }
+    pthread_mutex_unlock(&data->workers_mutex);
+
+    return NULL;
+}
+
+void _worker_format(file_worker_p worker) {
+    bxierr_p err = BXIERR_OK, err2;
+
+    for (size_t i = 0; i < worker->logs_nb; i++) {
+        bxilog_log_p log = worker->logs[i];
+        err2 = _format_log(log->record,
+                           log->filename, log->funcname, log->loggername,
+                           log->logmsg,
+                           worker->data, worker);
+        BXIERR_CHAIN(err, err2);
+    }
+    worker->err = err;
+}
+
+size_t _worker_of(bxilog_file_handler_param_p data, bxilog_record_p record) {
+    // Records of a thread of a given process always go to the same worker
 #ifdef __linux__
-                           TID_SIZE, tid,
+    size_t key = (size_t) record->pid * 31 + (size_t) record->tid;
+#else
+    size_t key = (size_t) record->pid * 31 + (size_t) record->thread_rank;
 #endif
-                           THREAD_RANK_SIZE, thread_rank,
-                           progname,
-                           filename,
-                           line_nb,
-                           funcname,
-                           loggername);
-    memcpy(buf + written, logmsg, logmsg_len);
-    buf[(size_t) written + logmsg_len] = '\n';
+    return key % data->workers_nb;
+}
+
+bxierr_p _process_logs_sharded(bxilog_log_p logs, size_t logs_nb,
+                               bxilog_file_handler_param_p data) {
+
+    bxierr_p err = BXIERR_OK, err2;
+
+    for (size_t k = 0; k < data->workers_nb; k++) {
+        data->workers[k].logs_nb = 0;
+        data->workers[k].next_char = 0;
+    }
+    for (size_t i = 0; i < logs_nb; i++) {
+        file_worker_p worker = &data->workers[_worker_of(data, logs[i].record)];
+        if (worker->logs_nb == worker->logs_max) {
+            size_t new_max = (0 == worker->logs_max) ? logs_nb : 2 * worker->logs_max;
+            worker->logs = bximem_realloc(worker->logs,
+                                          worker->logs_max * sizeof(*worker->logs),
+                                          new_max * sizeof(*worker->logs));
+            worker->logs_max = new_max;
+        }
+        worker->logs[worker->logs_nb++] = &logs[i];
+    }
 
+    pthread_mutex_lock(&data->workers_mutex);
+    data->workers_gen++;
+    data->workers_pending = data->workers_nb - 1;
+    pthread_cond_broadcast(&data->workers_start);
+    pthread_mutex_unlock(&data->workers_mutex);
 
-    // WARNING: Truncation can happen if the logmsg is part of a larger string.
-    // Therefore the assertion below might not be true.
-    // If we want to guarantee that no truncation can happen, the logmsg in the
-    // original record string must be copied, and each '\n' might then be replaced by
-    // an '\0'. For speed reason, we don't do that: no copy -> faster.
-    //    bxiassert(written < (int)n);
+    _worker_format(&data->workers[0]);
 
-    bxiassert(written >= 0);
-    return (size_t) written + logmsg_len;
+    pthread_mutex_lock(&data->workers_mutex);
+    while (0 < data->workers_pending) {
+        pthread_cond_wait(&data->workers_done, &data->workers_mutex);
+    }
+    pthread_mutex_unlock(&data->workers_mutex);
+
+    // Single writer: the order of the lines of each business code thread is kept
+    // since all of them have been formatted by the same worker
+    for (size_t k = 0; k < data->workers_nb; k++) {
+        file_worker_p worker = &data->workers[k];
+        BXIERR_CHAIN(err, worker->err);
+        worker->err = BXIERR_OK;
+        err2 = _append(data, worker->buf, worker->next_char);
+        BXIERR_CHAIN(err, err2);
+    }
+
+    return err;
 }
 
 bxierr_p _get_file_fd(bxilog_file_handler_param_p data) {
@@ -588,20 +1149,51 @@ void _tune_io(bxilog_file_handler_param_p data) {
     int rc;
     // We just tune, so we don't care on error
     rc = posix_fadvise(data->fd, 0, 0, POSIX_FADV_DONTNEED);
-    rc = posix_madvise(data->buf, data->buf_size, POSIX_MADV_SEQUENTIAL);
+    if (NULL == data->io_bufs) {
+        rc = posix_madvise(data->buf, data->buf_size, POSIX_MADV_SEQUENTIAL);
+    } else {
+        for (size_t k = 0; k < data->io_bufs_nb; k++) {
+            rc = posix_madvise(data->io_bufs[k], data->buf_size, POSIX_MADV_SEQUENTIAL);
+        }
+    }
     UNUSED(rc);
 }
 
 inline bxierr_p _flush(bxilog_file_handler_param_p data) {
     if (!data->dirty) return BXIERR_OK;
 
-    bxierr_p err = _write(data, data->buf, data->next_char);
-    data->next_char = 0;
-    data->dirty = false;
+    bxierr_p err;
+    if (NULL != data->io_bufs) {
+        err = _submit(data);
+    } else {
+        err = _write(data, data->buf, data->next_char);
+        data->next_char = 0;
+        data->dirty = false;
+    }
+    // Buffers hold whole lines: none is split between two files. A binary record
+    // may still be pending though: it is rotated by _encode_log()
+    if (NULL == data->binenc && bxierr_isok(err) && _rotation_due(data)) _rotate(data);
     return err;
 }
 
 bxierr_p _write(bxilog_file_handler_param_p data, const void * buf, size_t count) {
+    // Lines larger than a buffer are written directly: after the pending ones
+    if (NULL != data->io_bufs) {
+        bxierr_p err = _drain(data);
+        if (bxierr_isko(err)) return err;
+    }
+
+    data->seg_bytes += count;
+
+    if (NULL != data->zstream) {
+        const bool finish = data->frame_end;
+        data->frame_end = false;
+        data->zlen = 0;
+        _deflate(data, buf, count, finish);
+        // A partial write would make the rest of the file unreadable
+        return _write_zbuf(data);
+    }
+
     // Do not write more bytes than expected.
     ssize_t written = write(data->fd, buf, count);
 
@@ -623,6 +1215,251 @@ bxierr_p _write(bxilog_file_handler_param_p data, const void * buf, size_t count
     return BXIERR_OK;
 }
 
+bxierr_p _append(bxilog_file_handler_param_p data, const char * buf, size_t count) {
+    if (0 == count) return BXIERR_OK;
+
+    bxierr_p err = BXIERR_OK, err2;
+    if (data->buf_size - data->next_char < count) {
+        err2 = _flush(data);
+        BXIERR_CHAIN(err, err2);
+    }
+    if (data->buf_size < count) {
+        err2 = _write(data, buf, count);
+        BXIERR_CHAIN(err, err2);
+        return err;
+    }
+    memcpy(data->buf + data->next_char, buf, count);
+    data->next_char += count;
+    data->dirty = true;
+
+    return err;
+}
+
+bxierr_p _start_writer(bxilog_file_handler_param_p data) {
+    const size_t align = (size_t) sysconf(_SC_PAGESIZE);
+
+    data->io_bufs = bximem_calloc(data->io_bufs_nb * sizeof(*data->io_bufs));
+    data->io_lens = bximem_calloc(data->io_bufs_nb * sizeof(*data->io_lens));
+    data->io_finish = bximem_calloc(data->io_bufs_nb * sizeof(*data->io_finish));
+    data->io_bufs[0] = data->buf;
+    for (size_t k = 1; k < data->io_bufs_nb; k++) {
+        errno = 0;
+        int rc = posix_memalign((void**) &data->io_bufs[k], align, data->buf_size);
+        if (0 != rc) {
+            bxierr_p err = bxierr_errno("Calling posix_memalign(%ld, %zu) failed, "
+                                        "%zu output buffers out of %zu",
+                                        align, data->buf_size, k, data->io_bufs_nb);
+            data->io_bufs_nb = k;
+            if (1 == k) {
+                BXIFREE(data->io_bufs);
+                BXIFREE(data->io_lens);
+                BXIFREE(data->io_finish);
+                return err;
+            }
+            bxierr_destroy(&err);
+            break;
+        }
+    }
+
+    int rc = pthread_mutex_init(&data->io_mutex, NULL);
+    bxiassert(0 == rc);
+    rc = pthread_cond_init(&data->io_submit_cond, NULL);
+    bxiassert(0 == rc);
+    rc = pthread_cond_init(&data->io_complete_cond, NULL);
+    bxiassert(0 == rc);
+    data->io_submitted = 0;
+    data->io_completed = 0;
+    data->io_err = BXIERR_OK;
+    data->io_fatal = BXIERR_OK;
+    data->io_exit = false;
+
+    // See _start_workers()
+    sigset_t mask, old_mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+    rc = pthread_create(&data->io_thread, NULL,
+                        (void * (*) (void*)) _writer_main, data);
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    if (0 != rc) {
+        // Back to writes from the handler thread
+        for (size_t k = 1; k < data->io_bufs_nb; k++) BXIFREE(data->io_bufs[k]);
+        BXIFREE(data->io_bufs);
+        BXIFREE(data->io_lens);
+        BXIFREE(data->io_finish);
+        data->io_bufs_nb = 1;
+        pthread_cond_destroy(&data->io_complete_cond);
+        pthread_cond_destroy(&data->io_submit_cond);
+        pthread_mutex_destroy(&data->io_mutex);
+        return bxierr_fromidx(rc, NULL,
+                              "Calling pthread_create() failed (rc=%d), "
+                              "writing from the handler thread", rc);
+    }
+
+    return BXIERR_OK;
+}
+
+bxierr_p _stop_writer(bxilog_file_handler_param_p data) {
+    if (NULL == data->io_bufs) return BXIERR_OK;
+
+    pthread_mutex_lock(&data->io_mutex);
+    data->io_exit = true;
+    pthread_cond_signal(&data->io_submit_cond);
+    pthread_mutex_unlock(&data->io_mutex);
+    // The writer thread writes all pending buffers before exiting
+    pthread_join(data->io_thread, NULL);
+
+    pthread_mutex_lock(&data->io_mutex);
+    bxierr_p err = _io_report(data);
+
+    for (size_t k = 0; k < data->io_bufs_nb; k++) BXIFREE(data->io_bufs[k]);
+    BXIFREE(data->io_bufs);
+    BXIFREE(data->io_lens);
+    BXIFREE(data->io_finish);
+    data->buf = NULL;
+    pthread_cond_destroy(&data->io_complete_cond);
+    pthread_cond_destroy(&data->io_submit_cond);
+    pthread_mutex_destroy(&data->io_mutex);
+
+    return err;
+}
+
+void * _writer_main(bxilog_file_handler_param_p data) {
+    pthread_mutex_lock(&data->io_mutex);
+    while (true) {
+        while (data->io_completed == data->io_submitted && !data->io_exit) {
+            pthread_cond_wait(&data->io_submit_cond, &data->io_mutex);
+        }
+        if (data->io_completed == data->io_submitted) break;
+
+        // All buffers submitted so far are written at once
+        const size_t first = data->io_completed;
+        const size_t last = data->io_submitted;
+        pthread_mutex_unlock(&data->io_mutex);
+
+        struct iovec iov[last - first];
+        int iovcnt = (int) (last - first);
+        size_t count = 0;
+        if (NULL == data->zstream) {
+            for (size_t i = first; i < last; i++) {
+                const size_t k = i % data->io_bufs_nb;
+                iov[i - first].iov_base = data->io_bufs[k];
+                iov[i - first].iov_len = data->io_lens[k];
+                count += data->io_lens[k];
+            }
+        } else {
+            // Compressed here: the handler thread goes on with the next buffer
+            data->zlen = 0;
+            for (size_t i = first; i < last; i++) {
+                const size_t k = i % data->io_bufs_nb;
+                _deflate(data, data->io_bufs[k], data->io_lens[k], data->io_finish[k]);
+            }
+            iov[0].iov_base = data->zbuf;
+            iov[0].iov_len = data->zlen;
+            iovcnt = 1;
+            count = data->zlen;
+        }
+        size_t written = 0;
+        bxierr_p err = (0 == count) ? BXIERR_OK : _writev(data, iov, iovcnt, &written);
+
+        pthread_mutex_lock(&data->io_mutex);
+        data->bytes_written += written;
+        if (bxierr_isko(err)) {
+            if (EPIPE == err->code) {
+                BXIERR_CHAIN(data->io_fatal, err);
+            } else {
+                data->bytes_lost += count - written;
+                BXIERR_CHAIN(data->io_err, err);
+            }
+        }
+        data->io_completed = last;
+        pthread_cond_signal(&data->io_complete_cond);
+    }
+    pthread_mutex_unlock(&data->io_mutex);
+
+    return NULL;
+}
+
+bxierr_p _writev(bxilog_file_handler_param_p data,
+                 struct iovec * iov, int iovcnt,
+                 size_t * written) {
+
+    *written = 0;
+    while (0 < iovcnt) {
+        errno = 0;
+        ssize_t n = writev(data->fd, iov, iovcnt);
+        if (0 > n && EINTR == errno) continue;
+        if (0 > n && EPIPE == errno) {
+            return bxierr_errno("Can't write to pipe (fd=%d, name=%s). "
+                                "Exiting. Some messages will be lost.",
+                                data->fd, data->filename);
+        }
+        if (0 >= n) {
+            return bxierr_errno("Calling writev(fd=%d, name=%s) "
+                                "failed (written=%zd)",
+                                data->fd, data->filename, n);
+        }
+        *written += (size_t) n;
+
+        // Skip what has been written
+        size_t left = (size_t) n;
+        while (0 < iovcnt && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (0 < iovcnt) {
+            iov->iov_base = (char *) iov->iov_base + left;
+            iov->iov_len -= left;
+        }
+    }
+    return BXIERR_OK;
+}
+
+bxierr_p _submit(bxilog_file_handler_param_p data) {
+    data->seg_bytes += data->next_char;
+
+    pthread_mutex_lock(&data->io_mutex);
+    data->io_lens[data->io_submitted % data->io_bufs_nb] = data->next_char;
+    data->io_finish[data->io_submitted % data->io_bufs_nb] = data->frame_end;
+    data->frame_end = false;
+    data->io_submitted++;
+    pthread_cond_signal(&data->io_submit_cond);
+    // The next buffer to fill must have been written
+    while (data->io_submitted - data->io_completed >= data->io_bufs_nb) {
+        pthread_cond_wait(&data->io_complete_cond, &data->io_mutex);
+    }
+    bxierr_p err = _io_report(data);
+
+    data->buf = data->io_bufs[data->io_submitted % data->io_bufs_nb];
+    data->next_char = 0;
+    data->dirty = false;
+
+    return err;
+}
+
+bxierr_p _drain(bxilog_file_handler_param_p data) {
+    if (NULL == data->io_bufs) return BXIERR_OK;
+
+    pthread_mutex_lock(&data->io_mutex);
+    while (data->io_completed != data->io_submitted) {
+        pthread_cond_wait(&data->io_complete_cond, &data->io_mutex);
+    }
+    return _io_report(data);
+}
+
+// Called with io_mutex held, released on return: errors of the writer thread are
+// recorded by the handler thread only, which owns the error set
+bxierr_p _io_report(bxilog_file_handler_param_p data) {
+    bxierr_p err = data->io_err;
+    bxierr_p fatal = data->io_fatal;
+    data->io_err = BXIERR_OK;
+    data->io_fatal = BXIERR_OK;
+    pthread_mutex_unlock(&data->io_mutex);
+
+    if (bxierr_isko(err)) _record_new_error(data, &err);
+    return fatal;
+}
+
 bxierr_p _sync(bxilog_file_handler_param_p data) {
     errno = 0;
 
@@ -642,6 +1479,191 @@ bxierr_p _sync(bxilog_file_handler_param_p data) {
 }
 
 
+bxierr_p _start_zstream(bxilog_file_handler_param_p data) {
+    const int level = (Z_BEST_COMPRESSION < data->generic.compress_level) ?
+                            Z_BEST_COMPRESSION : data->generic.compress_level;
+
+    data->zstream = bximem_calloc(sizeof(*data->zstream));
+    // 16 added to the window bits: gzip members instead of a zlib stream
+    int rc = deflateInit2(data->zstream, level, Z_DEFLATED, 15 + 16, 8,
+                          Z_DEFAULT_STRATEGY);
+    if (Z_OK != rc) {
+        BXIFREE(data->zstream);
+        return bxierr_gen("Calling deflateInit2(level=%d) failed (rc=%d), "
+                          "writing %s uncompressed", level, rc, data->filename);
+    }
+    data->zbuf_size = data->buf_size;
+    data->zbuf = bximem_calloc(data->zbuf_size);
+    data->zlen = 0;
+    data->zopen = false;
+    data->frame_end = false;
+
+    return BXIERR_OK;
+}
+
+// Append the compressed bytes of the given ones to zbuf. Called by the writer thread
+// when there is one, by the handler thread once it is idle otherwise.
+void _deflate(bxilog_file_handler_param_p data,
+              const void * in, size_t len, bool finish) {
+
+    if (0 == len && (!finish || !data->zopen)) return;
+
+    z_stream * zs = data->zstream;
+    zs->next_in = (Bytef *) in;
+    zs->avail_in = (uInt) len;
+    while (true) {
+        if (data->zlen == data->zbuf_size) {
+            data->zbuf = bximem_realloc(data->zbuf, data->zbuf_size,
+                                        2 * data->zbuf_size);
+            data->zbuf_size *= 2;
+        }
+        zs->next_out = (Bytef *) data->zbuf + data->zlen;
+        zs->avail_out = (uInt) (data->zbuf_size - data->zlen);
+        int rc = deflate(zs, finish ? Z_FINISH : Z_NO_FLUSH);
+        bxiassert(Z_OK == rc || Z_STREAM_END == rc || Z_BUF_ERROR == rc);
+        data->zlen = data->zbuf_size - zs->avail_out;
+
+        if (Z_STREAM_END == rc) break;
+        if (!finish && 0 == zs->avail_in && 0 < zs->avail_out) break;
+    }
+    if (finish) {
+        deflateReset(zs);
+        data->zopen = false;
+    } else {
+        data->zopen = true;
+    }
+}
+
+// Flush, the last buffer ending the current gzip member
+bxierr_p _end_frame(bxilog_file_handler_param_p data) {
+    if (NULL == data->zstream) return _flush(data);
+
+    data->frame_end = true;
+    if (data->dirty) return _flush(data);
+
+    data->frame_end = false;
+    return _close_frame(data);
+}
+
+// Wait for the pending buffers, then end the current gzip member if any
+bxierr_p _close_frame(bxilog_file_handler_param_p data) {
+    bxierr_p err = _drain(data);
+    if (NULL == data->zstream || !data->zopen || bxierr_isko(err)) return err;
+
+    data->zlen = 0;
+    _deflate(data, NULL, 0, true);
+
+    return _write_zbuf(data);
+}
+
+// Write the compressed bytes from the handler thread
+bxierr_p _write_zbuf(bxilog_file_handler_param_p data) {
+    if (0 == data->zlen) return BXIERR_OK;
+
+    struct iovec iov = { .iov_base = data->zbuf, .iov_len = data->zlen };
+    size_t written;
+    bxierr_p err = _writev(data, &iov, 1, &written);
+    data->bytes_written += written;
+    if (bxierr_isko(err)) {
+        if (EPIPE == err->code) return err;
+        data->bytes_lost += data->zlen - written;
+        _record_new_error(data, &err);
+    }
+    return BXIERR_OK;
+}
+
+bool _rotation_due(bxilog_file_handler_param_p data) {
+    // A file without any record is never rotated
+    if (!data->rotate || data->seg_base >= data->seg_bytes) return false;
+    if (0 < data->generic.rotate_size && data->seg_bytes >= data->generic.rotate_size) {
+        return true;
+    }
+    return 0 < data->generic.rotate_period_s &&
+           time(NULL) - data->seg_start >= data->generic.rotate_period_s;
+}
+
+// Errors are not fatal: logs keep going to the current file, and the rotation is
+// tried again once it is due again
+void _rotate(bxilog_file_handler_param_p data) {
+    // All records encoded so far must go to the file being rotated, which must
+    // end with a complete gzip member when compressed
+    bxierr_p err = _flush(data);
+    if (bxierr_isko(err)) _record_new_error(data, &err);
+    err = _close_frame(data);
+    if (bxierr_isko(err)) _record_new_error(data, &err);
+
+    char * segment = _segment_name(data);
+    data->seg_bytes = 0;
+    data->seg_base = 0;
+    data->seg_start = time(NULL);
+
+    errno = 0;
+    if (0 != rename(data->filename, segment)) {
+        err = bxierr_errno("Can't rename %s to %s", data->filename, segment);
+        _record_new_error(data, &err);
+        BXIFREE(segment);
+        return;
+    }
+
+    errno = 0;
+    int fd = open(data->filename,
+                  O_WRONLY | O_CREAT | data->open_flags,
+                  S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (-1 == fd) {
+        // Logs go on to the renamed file, which is not handed over to the archiver
+        err = bxierr_errno("Can't open %s", data->filename);
+        _record_new_error(data, &err);
+        BXIFREE(segment);
+        return;
+    }
+    // The writer thread is idle: it uses the new one from the next submission on
+    const int old_fd = data->fd;
+    data->fd = fd;
+    int rc = posix_fadvise(data->fd, 0, 0, POSIX_FADV_DONTNEED);
+    UNUSED(rc);
+    if (NULL != data->binenc) {
+        err = _encode_header(data);
+        if (bxierr_isko(err)) _record_new_error(data, &err);
+    }
+
+    errno = 0;
+    if (0 != close(old_fd)) {
+        err = bxierr_errno("Closing logging file '%s' failed", segment);
+        _record_new_error(data, &err);
+    }
+
+    if (NULL == data->archiver) {
+        BXIFREE(segment);
+    } else {
+        bxilog__archiver_add(data->archiver, segment);
+    }
+}
+
+char * _segment_name(bxilog_file_handler_param_p data) {
+    struct tm tm;
+    char suffix[32];
+    localtime_r(&data->seg_start, &tm);
+    strftime(suffix, sizeof(suffix), SEGMENT_SUFFIX_FMT, &tm);
+
+    // A compressed file is a gzip member already: named as the archiver would
+    const char * gz_suffix = (NULL == data->zstream) ? "" : BXILOG__ARCHIVER_GZ_SUFFIX;
+    char * stem = bxistr_new("%s.%s", data->filename, suffix);
+    // Files rotated within the same second
+    for (size_t n = 1; ; n++) {
+        char * name = bxistr_new("%s%s", stem, gz_suffix);
+        char * gz = bxistr_new("%s%s", stem, BXILOG__ARCHIVER_GZ_SUFFIX);
+        const bool taken = 0 == access(stem, F_OK) || 0 == access(gz, F_OK);
+        BXIFREE(gz);
+        if (!taken) {
+            BXIFREE(stem);
+            return name;
+        }
+        BXIFREE(name);
+        BXIFREE(stem);
+        stem = bxistr_new("%s.%s.%zu", data->filename, suffix, n);
+    }
+}
+
 bxierr_p _internal_log_func(bxilog_level_e level,
                             bxilog_file_handler_param_p data,
                             const char * funcname,
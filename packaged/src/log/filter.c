@@ -11,8 +11,8 @@
  ###############################################################################
  */
 
+#include <stdint.h>
 #include <string.h>
-#include <search.h>
 
 #include "bxi/base/err.h"
 #include "bxi/base/mem.h"
@@ -28,15 +28,56 @@
 //********************************** Defines **************************************
 //*********************************************************************************
 
+// Level of a trie node no filter ends at
+#define TRIE_NO_LEVEL -1
+
 //*********************************************************************************
 //********************************** Types ****************************************
 //*********************************************************************************
 
+/*
+ * A node of a prefix trie: the path from the root spells the prefix.
+ *
+ * Nodes are stored in an array and linked by index since it might be reallocated.
+ * The root is node 0, so 0 also means no node.
+ */
+typedef struct {
+    uint32_t child;                 // First child
+    uint32_t sibling;               // Next sibling, siblings are sorted by byte
+    int8_t level;                   // Level of the filter ending here, or TRIE_NO_LEVEL
+    unsigned char byte;             // The byte leading to this node from its parent
+} trie_node_s;
+
+typedef trie_node_s * trie_node_p;
+
+struct bxilog_filters_trie_s {
+    trie_node_p nodes;
+    size_t nodes_nb;
+    size_t nodes_size;              // Allocated nodes
+    size_t depth;                   // Length of the longest prefix
+};
+
+/*
+ * The state of a merge (see bxilog_filters_merge()).
+ */
+typedef struct {
+    bxilog_filters_trie_p trie;     // All prefixes of all sets
+    size_t sets_nb;
+    int8_t * levels;                // The level each set gives to each node
+    int8_t * inherited;             // The level each set gives to each prefix
+                                    // of the current node
+    char * prefix;                  // The prefix of the current node
+    bxilog_filters_p result;
+} merge_s;
+
+typedef merge_s * merge_p;
+
 //*********************************************************************************
 //********************************** Static Functions  ****************************
 //*********************************************************************************
-//static int _filter_compar(const void * filter1, const void* filter2);
-//static void _merge_filter_visitor(const void *nodep, const VISIT which, const int depth);
+static bxilog_filters_trie_p _trie_new(void);
+static uint32_t _trie_insert(bxilog_filters_trie_p trie, const char * prefix);
+static void _merge_visit(merge_p merge, uint32_t node, size_t depth);
 
 //*********************************************************************************
 //********************************** Global Variables  ****************************
@@ -213,173 +254,169 @@ QUIT:
     return err;
 }
 
-void bxilog_filter_add_merge_to(bxilog_filter_p filter1, bxilog_filter_p filter2,
-                                bxilog_filters_p * result) {
+bxilog_filters_p bxilog_filters_merge(bxilog_filters_p * filters_array, size_t n) {
+    bxiassert(NULL != filters_array || 0 == n);
 
-    bxiassert(NULL != filter1);
-    bxiassert(NULL != filter2);
+    // All prefixes are inserted in a single trie, the level given by each set to
+    // each prefix is then computed by a single walk from the root
+    merge_s merge = {.trie = _trie_new(), .sets_nb = n, .result = bxilog_filters_new()};
+    for (size_t i = 0; i < n; i++) {
+        bxilog_filters_p filters = filters_array[i];
+        for (size_t k = 0; k < filters->nb; k++) {
+            if (NULL == filters->list[k]) break;
+            _trie_insert(merge.trie, filters->list[k]->prefix);
+        }
+    }
+    if (0 == n) goto QUIT;
 
-    const size_t f1_len = strlen(filter1->prefix);
-    const size_t f2_len = strlen(filter2->prefix);
+    merge.levels = bximem_calloc(merge.trie->nodes_nb * n * sizeof(*merge.levels));
+    memset(merge.levels, TRIE_NO_LEVEL, merge.trie->nodes_nb * n * sizeof(*merge.levels));
+    for (size_t i = 0; i < n; i++) {
+        bxilog_filters_p filters = filters_array[i];
+        for (size_t k = 0; k < filters->nb; k++) {
+            bxilog_filter_p filter = filters->list[k];
+            if (NULL == filter) break;
+            // Already inserted: the trie is left unchanged
+            const uint32_t node = _trie_insert(merge.trie, filter->prefix);
+            merge.levels[node * n + i] = (int8_t) filter->level;
+        }
+    }
+    merge.inherited = bximem_calloc((merge.trie->depth + 1) * n * sizeof(*merge.inherited));
+    merge.prefix = bximem_calloc(merge.trie->depth + 1);
 
-    bxilog_filter_p shortest, longest;
-    size_t shortest_len;
+    _merge_visit(&merge, 0, 0);
 
-    // It is preferable to keep the order so we use '<=' instead of '<'
-    if (f1_len <= f2_len) {
-        shortest = filter1;
-        longest = filter2;
-        shortest_len = f1_len;
-    } else {
-        shortest = filter2;
-        longest = filter1;
-        shortest_len = f2_len;
+    BXIFREE(merge.levels);
+    BXIFREE(merge.inherited);
+    BXIFREE(merge.prefix);
+QUIT:
+    bxilog_filters_trie_destroy(&merge.trie);
+    return merge.result;
+}
+
+bxilog_filters_trie_p bxilog_filters_compile(bxilog_filters_p filters) {
+    bxiassert(NULL != filters);
+
+    bxilog_filters_trie_p trie = _trie_new();
+    for (size_t i = 0; i < filters->nb; i++) {
+        bxilog_filter_p filter = filters->list[i];
+        if (NULL == filter) break;
+        const uint32_t node = _trie_insert(trie, filter->prefix);
+        trie->nodes[node].level = (int8_t) filter->level;
     }
+    return trie;
+}
 
-    const int cmp = strncmp(shortest->prefix, longest->prefix, shortest_len);
+void bxilog_filters_trie_destroy(bxilog_filters_trie_p * trie_p) {
+    bxiassert(NULL != trie_p);
 
-    if (cmp == 0) {
-        bxilog_level_e highest_level = (shortest->level > longest->level) ?
-                                                       shortest->level : longest->level;
-        if (f1_len == f2_len) {
-            // Equals prefix: merge result is the one with the highest level
+    if (NULL == *trie_p) return;
+    BXIFREE((*trie_p)->nodes);
+    BXIFREE(*trie_p);
+}
 
-            bxilog_filters_add(result, shortest->prefix, highest_level);
-            return;
-        }
-        // Shortest is a prefix
-        bxilog_filters_add(result, shortest->prefix, highest_level);
-        bxilog_filters_add(result, longest->prefix, highest_level);
-        return;
+bool bxilog_filters_trie_match(bxilog_filters_trie_p trie,
+                               const char * name, bxilog_level_e * level) {
+    bxiassert(NULL != trie);
+    bxiassert(NULL != name);
+    bxiassert(NULL != level);
+
+    const trie_node_p nodes = trie->nodes;
+    int8_t found = nodes[0].level;
+    uint32_t node = 0;
+    for (const unsigned char * c = (const unsigned char *) name; '\0' != *c; c++) {
+        uint32_t child = nodes[node].child;
+        while (0 != child && nodes[child].byte < *c) child = nodes[child].sibling;
+        if (0 == child || nodes[child].byte != *c) break;
+        node = child;
+        if (TRIE_NO_LEVEL != nodes[node].level) found = nodes[node].level;
     }
+    if (TRIE_NO_LEVEL == found) return false;
 
-    // No prefix found, add both of them with their own level
-     bxilog_filters_add(result, shortest->prefix, shortest->level);
-     bxilog_filters_add(result, longest->prefix, longest->level);
-     return;
+    *level = (bxilog_level_e) found;
+    return true;
 }
 
+//*********************************************************************************
+//********************************** Static Helpers Implementation ****************
+//*********************************************************************************
 
-bxilog_filters_p bxilog_filters_merge(bxilog_filters_p * filters_array, size_t n) {
-    bxiassert(NULL != filters_array || 0 == n);
-
-    bxilog_filters_p result = bxilog_filters_new();
+bxilog_filters_trie_p _trie_new(void) {
+    bxilog_filters_trie_p trie = bximem_calloc(sizeof(*trie));
+    trie->nodes_size = 16;
+    trie->nodes = bximem_calloc(trie->nodes_size * sizeof(*trie->nodes));
+    trie->nodes[0].level = TRIE_NO_LEVEL;
+    trie->nodes_nb = 1;
 
-    for (size_t i = 0; i < n; i++) {
-        bxilog_filters_p filters = filters_array[i];
-        for (size_t k = 0; k < filters->nb; k++) {
-            bxilog_filter_p filter = filters->list[k];
+    return trie;
+}
 
-            // Then compare with other filters
-            for (size_t j = i + 1; j < n; j++) {
-                bxilog_filters_p other_filters = filters_array[j];
-                for (size_t l = 0; l < other_filters->nb; l++) {
-                    bxilog_filter_p other_filter = other_filters->list[l];
+uint32_t _trie_insert(bxilog_filters_trie_p trie, const char * prefix) {
+    uint32_t node = 0;
+    size_t depth = 0;
+    for (const unsigned char * c = (const unsigned char *) prefix; '\0' != *c; c++) {
+        // Find the child, or where to link it to keep siblings sorted
+        uint32_t * link = &trie->nodes[node].child;
+        while (0 != *link && trie->nodes[*link].byte < *c) {
+            link = &trie->nodes[*link].sibling;
+        }
+        depth++;
+        if (0 != *link && trie->nodes[*link].byte == *c) {
+            node = *link;
+            continue;
+        }
 
-                    bxilog_filter_add_merge_to(filter, other_filter, &result);
-               }
-            }
+        if (trie->nodes_nb == trie->nodes_size) {
+            // The link points into the nodes array which is about to move
+            const size_t link_offset = (size_t) ((char *) link - (char *) trie->nodes);
+            trie->nodes = bximem_realloc(trie->nodes,
+                                         trie->nodes_size * sizeof(*trie->nodes),
+                                         2 * trie->nodes_size * sizeof(*trie->nodes));
+            trie->nodes_size *= 2;
+            link = (uint32_t *) ((char *) trie->nodes + link_offset);
         }
+        bxiassert(UINT32_MAX > trie->nodes_nb);
+        const uint32_t child = (uint32_t) trie->nodes_nb++;
+        trie->nodes[child].child = 0;
+        trie->nodes[child].sibling = *link;
+        trie->nodes[child].level = TRIE_NO_LEVEL;
+        trie->nodes[child].byte = *c;
+        *link = child;
+        node = child;
     }
+    if (depth > trie->depth) trie->depth = depth;
 
-    return result;
+    return node;
 }
 
-//bxilog_filters_p bxilog_filters_merge(bxilog_filters_p * filters_array, size_t n) {
-//    bxiassert(NULL != filters_array || 0 == n);
-//
-//    // We first copy all filters into a new array. Two reasons:
-//    // 1. some filters might have been statically allocated and are therefore not
-//    //    modifiable
-//    // 2. we will destroy a binary tree at the end, and therefore, all filters inserted
-//    //    into it.
-//    // Therefore, it is better to use our own copy
-//    bxilog_filters_p * copied = bximem_calloc(n * sizeof(*copied));
-//    for (size_t i = 0; i < n; i++) {
-//        bxilog_filters_p filters = filters_array[i];
-//        copied[i] = bxilog_filters_dup(filters);
-//    }
-//
-//    bxilog_filters_p result = bxilog_filters_new();
-//    // tsearch root node
-//    void * root = NULL;
-//
-//    for (size_t i = 0; i < n; i++) {
-//        bxilog_filters_p filters = copied[i];
-//
-//        for (size_t k = 0; k < filters->nb; k++) {
-//            bxilog_filter_p filter = filters->list[k];
-//            void * val = tsearch(filter, &root, _filter_compar);
-//            bxiassert(NULL != val);
-//            bxilog_filter_p found = *(bxilog_filter_p *) val;
-//            found->level = found->level > filter->level ? found->level : filter->level;
-//            found->reserved = &result;
-//        }
-//    }
-//
-//    // Sort all filters and populate the result
-//    twalk(root, _merge_filter_visitor);
-//
-//#ifdef _GNU_SOURCE
-//    tdestroy(root, NULL);
-//#else
-//    while (NULL != root) {
-//        bxilog_filter_p filter = *(bxilog_filter_p *) root;
-//        tdelete(filter, &root, _filter_compar);
-//    }
-//#endif
-//
-//    for (size_t i = 0; i < n; i++) {
-//        bxilog_filters_destroy(&copied[i]);
-//    }
-//    BXIFREE(copied);
-//
-//    return result;
-//}
+void _merge_visit(merge_p merge, uint32_t node, size_t depth) {
+    const size_t n = merge->sets_nb;
+    int8_t * const inherited = merge->inherited + depth * n;
+    const int8_t * const parent = (0 == depth) ? NULL : inherited - n;
+    const int8_t * const levels = merge->levels + node * n;
 
-//*********************************************************************************
-//********************************** Static Helpers Implementation ****************
-//*********************************************************************************
-//int _filter_compar(const void * filter1, const void * filter2) {
-//    bxiassert(NULL != filter1);
-//    bxiassert(NULL != filter2);
-//
-//    bxilog_filter_p f1 = (bxilog_filter_p) filter1;
-//    bxilog_filter_p f2 = (bxilog_filter_p) filter2;
-//    size_t f1_len = strlen(f1->prefix);
-//    size_t f2_len = strlen(f2->prefix);
-//
-//    size_t shortest = (f1_len < f2_len) ? f1_len : f2_len;
-//    int cmp = strncmp(f1->prefix, f2->prefix, shortest);
-//    int result;
-//    if (cmp == 0) {
-//        result = (int) (f1_len - f2_len);
-//    } else {
-//        result = cmp;
-//    }
-//
-//    printf("pref(%s:%zu, %s:%zu)=%d %zu\n", f1->prefix, f1_len, f2->prefix, f2_len, result, shortest);
-//    return result;
-//}
-
-//void _merge_filter_visitor(const void *nodep, const VISIT which, const int depth) {
-//    UNUSED(depth);
-//    bxilog_filter_p filter = *(bxilog_filter_p *) nodep;
-//    bxilog_filters_p * result = (bxilog_filters_p *) filter->reserved;
-//
-//    switch (which) {
-//        case preorder:
-//            break;
-//        case postorder:
-//            printf("%s\n", filter->prefix);
-//            bxilog_filters_add(result, (char*) filter->prefix, filter->level);
-//            break;
-//        case endorder:
-//            break;
-//        case leaf:
-//            printf("%s\n", filter->prefix);
-//            bxilog_filters_add(result, (char*) filter->prefix, filter->level);
-//            break;
-//    }
-//}
+    // Each set gives the level of its longest prefix of the current node
+    bool filtered = false;
+    int8_t level = TRIE_NO_LEVEL;
+    for (size_t i = 0; i < n; i++) {
+        if (TRIE_NO_LEVEL != levels[i]) {
+            inherited[i] = levels[i];
+            filtered = true;
+        } else {
+            inherited[i] = (NULL == parent) ? TRIE_NO_LEVEL : parent[i];
+        }
+        if (inherited[i] > level) level = inherited[i];
+    }
+    if (filtered) {
+        merge->prefix[depth] = '\0';
+        bxilog_filters_add(&merge->result, merge->prefix, (bxilog_level_e) level);
+    }
 
+    // Children are visited by increasing byte: the result is sorted
+    for (uint32_t child = merge->trie->nodes[node].child;
+         0 != child;
+         child = merge->trie->nodes[child].sibling) {
+        merge->prefix[depth] = (char) merge->trie->nodes[child].byte;
+        _merge_visit(merge, child, depth + 1);
+    }
+}
@@ -15,6 +15,7 @@
 #include <unistd.h>
 #include <sys/syscall.h>
 #include <pthread.h>
+#include <sched.h>
 #include <sysexits.h>
 #include <string.h>
 
@@ -29,12 +30,34 @@
 
 #include "handler_impl.h"
 #include "log_impl.h"
+#include "callsite_impl.h"
+#include "deferred_impl.h"
+#include "record_impl.h"
+#include "placement_impl.h"
 
 
 //*********************************************************************************
 //********************************** Defines **************************************
 //*********************************************************************************
 
+// Maximum number of records processed from a given ring before switching to the next
+// one so a single verbose thread does not starve the others
+#define RING_BATCH_MAX 256
+
+// Maximum number of logs given at once to a handler processing logs by batch
+#define BATCH_MAX 256
+
+// Rebuilt records are aligned in the format buffer
+#define RECORD_ALIGN(len) (((len) + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1))
+
+// Level of a logger not computed yet in handler_data_s.level_by_logger_id
+#define LEVEL_UNKNOWN UINT8_MAX
+
+// Initial number of loggers in handler_data_s.level_by_logger_id
+#define LEVEL_BY_LOGGER_ID_DEFAULT_SIZE 256
+
+// Logger name of the records reporting dropped records
+#define OVERFLOW_LOGGER_NAME BXILOG_LIB_PREFIX "bxilog.overflow"
 
 //*********************************************************************************
 //********************************** Types ****************************************
@@ -43,6 +66,30 @@
 typedef struct {
     void * ctrl_zocket;
     void * data_zocket;
+    void * prio_zocket;                     // NULL without a priority queue
+    bxilog__ring_set_p rings;               // NULL unless the ring transport is used
+    char * fmt_buf;                         // Records rebuilt by this thread
+    size_t fmt_buf_size;                    // (deferred formatting and callsites)
+    size_t fmt_buf_used;                    // Used by the rebuilt records of the batch
+
+    // Logs given to process_logs(), NULL if the handler does not define it
+    bxilog_log_p batch;
+    size_t * batch_offsets;                 // Offset of each record in fmt_buf,
+                                            // SIZE_MAX if it has not been rebuilt
+    size_t batch_nb;
+    zmq_msg_t * batch_zmsgs;                // Messages received since the last batch
+    size_t batch_zmsgs_nb;                  // (zmq transport)
+    bxilog__ring_p * batch_rings;           // Rings holding records of the batch
+    size_t batch_rings_nb;                  // (ring transport)
+    bxilog__ring_p ring;                    // The ring being drained
+
+    bxilog_filters_trie_p filters_trie;     // The handler filters, compiled
+
+    // The level of each registered logger according to the handler filters,
+    // indexed by logger identifier. A level is computed the first time a record
+    // of the logger is received, and forgotten when filters are reconfigured.
+    uint8_t * level_by_logger_id;
+    size_t level_by_logger_id_size;
 
 #ifdef __linux__
     pid_t tid;                              // the thread pid
@@ -64,6 +111,9 @@ static bxierr_p _bind_ctrl_zocket(bxilog_handler_p,
 static bxierr_p _bind_data_zocket(bxilog_handler_p,
                                   bxilog_handler_param_p,
                                   handler_data_p);
+static bxierr_p _bind_prio_zocket(bxilog_handler_p,
+                                  bxilog_handler_param_p,
+                                  handler_data_p);
 static bxierr_p _init_handler(bxilog_handler_p,
                               bxilog_handler_param_p,
                               handler_data_p);
@@ -82,12 +132,50 @@ static bxierr_p _internal_flush(bxilog_handler_p,
 static bxierr_p _process_ierr(bxilog_handler_p handler,
                               bxilog_handler_param_p,
                               bxierr_p err);
+static bxierr_p _process_log_records(bxilog_handler_p,
+                                     bxilog_handler_param_p,
+                                     handler_data_p);
 static bxierr_p _process_log_record(bxilog_handler_p,
                                     bxilog_handler_param_p,
-                                    handler_data_p);
+                                    handler_data_p,
+                                    void * zocket);
 static bxierr_p _process_log_zmsg(bxilog_handler_p handler,
                                   bxilog_handler_param_p param,
-                                  handler_data_p data, zmq_msg_t zmsg);
+                                  handler_data_p data, zmq_msg_t * zmsg);
+static bxierr_p _process_log_data(bxilog_handler_p handler,
+                                  bxilog_handler_param_p param,
+                                  handler_data_p data, bxilog_record_p record);
+static void _set_filters(handler_data_p data, bxilog_filters_p filters);
+static bxilog_level_e _filters_level(handler_data_p data, const char * loggername);
+static bxilog_level_e _logger_level(handler_data_p data,
+                                    size_t logger_id, const char * loggername);
+static bxilog_record_p _expand_record(handler_data_p data,
+                                      bxilog_record_p record,
+                                      bxilog__callsite_entry_p callsite);
+static void _fmt_buf_reserve(handler_data_p data, size_t size);
+static bxierr_p _batch_add(bxilog_handler_p handler,
+                           bxilog_handler_param_p param,
+                           handler_data_p data,
+                           bxilog_record_p record,
+                           bxilog__callsite_entry_p callsite);
+static bxierr_p _batch_process(bxilog_handler_p handler,
+                               bxilog_handler_param_p param,
+                               handler_data_p data);
+static bxierr_p _process_rings(bxilog_handler_p handler,
+                               bxilog_handler_param_p param,
+                               handler_data_p data,
+                               size_t * processed_nb);
+static bxierr_p _process_ring_list(bxilog_handler_p handler,
+                                   bxilog_handler_param_p param,
+                                   handler_data_p data,
+                                   bool prio,
+                                   size_t * processed_nb);
+static bxierr_p _report_dropped(bxilog_handler_p handler,
+                                bxilog_handler_param_p param,
+                                handler_data_p data);
+static bxierr_p _report_misplaced(bxilog_handler_p handler,
+                                  bxilog_handler_param_p param,
+                                  handler_data_p data);
 static bxierr_p _process_ctrl_cmd(bxilog_handler_p,
                                   bxilog_handler_param_p,
                                   handler_data_p);
@@ -97,6 +185,9 @@ static bxierr_p _process_implicit_flush(bxilog_handler_p,
 static bxierr_p _process_explicit_flush(bxilog_handler_p,
                                         bxilog_handler_param_p,
                                         handler_data_p);
+static bxierr_p _process_filters(bxilog_handler_p,
+                                 bxilog_handler_param_p,
+                                 handler_data_p);
 static bxierr_p _process_exit(bxilog_handler_p,
                               bxilog_handler_param_p,
                               handler_data_p);
@@ -105,6 +196,10 @@ static bxierr_p _process_exit(bxilog_handler_p,
 //********************************** Global Variables  ****************************
 //*********************************************************************************
 
+static const char * const OVERFLOW_POLICY_NAMES[] = {
+    "block", "drop-newest", "drop-oldest", "drop-below-level",
+};
+
 //*********************************************************************************
 //********************************** Implementation    ****************************
 //*********************************************************************************
@@ -117,6 +212,25 @@ void bxilog_handler_init_param(bxilog_handler_p handler,
     param->data_hwm = 1000;
     param->ctrl_hwm = 1000;
     param->flush_freq_ms = 1000;
+    param->overflow_policy = BXILOG_OVERFLOW_BLOCK;
+    param->overflow_level = BXILOG_WARNING;
+    // No priority queue unless asked for: it costs a second ring or zocket per
+    // producer thread, and records of both queues are not kept in order
+    param->prio_level = BXILOG_OFF;
+    param->prio_hwm = 1000;
+    param->prio_overflow_policy = BXILOG_OVERFLOW_BLOCK;
+    param->cpus = NULL;
+    param->sched_policy = SCHED_OTHER;
+    param->sched_priority = 0;
+    param->nice = 0;
+    param->numa_node = -1;
+    param->workers_nb = 1;
+    param->write_buffers_nb = 1;
+    param->rotate_size = 0;
+    param->rotate_period_s = 0;
+    param->rotate_keep = 0;
+    param->rotate_compress = false;
+    param->compress_level = 0;
     param->ierr_max = 10;
     param->filters = filters;
 
@@ -124,11 +238,14 @@ void bxilog_handler_init_param(bxilog_handler_p handler,
     // the same handler
     param->ctrl_url = bxistr_new("inproc://%s/%p.ctrl", handler->name, param);
     param->data_url = bxistr_new("inproc://%s/%p.data", handler->name, param);
+    param->prio_url = bxistr_new("inproc://%s/%p.prio", handler->name, param);
 }
 
 void bxilog_handler_clean_param(bxilog_handler_param_p param) {
     BXIFREE(param->ctrl_url);
     BXIFREE(param->data_url);
+    BXIFREE(param->prio_url);
+    BXIFREE(param->cpus);
     bxilog_filters_destroy(&param->filters);
     // Do not free param since it has not been allocated by init()
     // BXIFREE(param);
@@ -145,15 +262,31 @@ bxierr_p bxilog__handler_start(bxilog__handler_thread_bundle_p bundle) {
     handler_data_s data;
     memset(&data, 0, sizeof(data));
 
+    // Before any allocation: the handler buffers are placed with the thread
+    bxierr_p placement_err = bxilog__placement_apply(param);
+
     // Constants for the IHT
 #ifdef __linux__
     data.tid = (pid_t) syscall(SYS_gettid);
 #endif
+    data.rings = (NULL == BXILOG__GLOBALS->ring_sets) ?
+                    NULL :
+                    &BXILOG__GLOBALS->ring_sets[param->rank];
+    _set_filters(&data, param->filters);
+    if (NULL != handler->process_logs) {
+        data.batch = bximem_calloc(BATCH_MAX * sizeof(*data.batch));
+        data.batch_offsets = bximem_calloc(BATCH_MAX * sizeof(*data.batch_offsets));
+        data.batch_zmsgs = bximem_calloc(BATCH_MAX * sizeof(*data.batch_zmsgs));
+        data.batch_rings = bximem_calloc(BATCH_MAX * sizeof(*data.batch_rings));
+    }
 
     eerr2 = _init_handler(handler, param, &data);
     BXIERR_CHAIN(eerr, eerr2);
     // Do not quit immediately, we need to send a ready message to BC.
 
+    eerr2 = _process_ierr(handler, param, placement_err);
+    BXIERR_CHAIN(eerr, eerr2);
+
     ierr = _create_zockets(handler, param, &data);
     eerr2 = _process_ierr(handler, param, ierr);
     BXIERR_CHAIN(eerr, eerr2);
@@ -225,9 +358,17 @@ bxierr_p _create_zockets(bxilog_handler_p handler,
     err2 = _bind_ctrl_zocket(handler, param, data);
     BXIERR_CHAIN(err, err2);
 
+    // With the ring transport, records do not go through zmq
+    if (NULL != data->rings) return err;
+
     err2 = _bind_data_zocket(handler, param, data);
     BXIERR_CHAIN(err, err2);
 
+    if (BXILOG_OFF == param->prio_level) return err;
+
+    err2 = _bind_prio_zocket(handler, param, data);
+    BXIERR_CHAIN(err, err2);
+
     return err;
 }
 
@@ -294,6 +435,43 @@ bxierr_p _bind_data_zocket(bxilog_handler_p handler,
     return err;
 }
 
+bxierr_p _bind_prio_zocket(bxilog_handler_p handler,
+                           bxilog_handler_param_p param,
+                           handler_data_p data) {
+    UNUSED(handler);
+    bxierr_p err = BXIERR_OK, err2;
+
+    bxiassert(NULL == data->prio_zocket);
+
+    err2 = bxizmq_zocket_create(BXILOG__GLOBALS->zmq_ctx,
+                                ZMQ_DEALER,
+                                &data->prio_zocket);
+    BXIERR_CHAIN(err, err2);
+
+    // Business code threads use the same ROUTER zocket for both queues
+    const size_t identity = BXILOG__PRIO_IDENTITY(param->rank);
+    err2 = bxizmq_zocket_setopt(data->prio_zocket,
+                                ZMQ_IDENTITY,
+                                &identity,
+                                sizeof(identity));
+    BXIERR_CHAIN(err, err2);
+
+    err2 = bxizmq_zocket_setopt(data->prio_zocket,
+                                ZMQ_RCVHWM,
+                                &param->prio_hwm,
+                                sizeof(param->prio_hwm));
+    BXIERR_CHAIN(err, err2);
+
+    int affected_port;
+
+    err2 = bxizmq_zocket_bind(data->prio_zocket,
+                              param->prio_url,
+                              &affected_port);
+    BXIERR_CHAIN(err, err2);
+
+    return err;
+}
+
 bxierr_p _init_handler(bxilog_handler_p handler,
                        bxilog_handler_param_p param,
                        handler_data_p data) {
@@ -353,14 +531,25 @@ bxierr_p _loop(bxilog_handler_p handler,
 
     bxierr_p err = BXIERR_OK, err2;
 
-    size_t items_nb = 2 + param->private_items_nb;
+    // The priority zocket, if any, follows the data one
+    const size_t private_first = (NULL == data->prio_zocket) ? 2 : 3;
+    size_t items_nb = private_first + param->private_items_nb;
     zmq_pollitem_t items[items_nb];
     items[0].socket = data->ctrl_zocket;
     items[0].events = ZMQ_POLLIN;
-    items[1].socket = data->data_zocket;
+    if (NULL == data->rings) {
+        items[1].socket = data->data_zocket;
+    } else {
+        items[1].socket = NULL;
+        items[1].fd = data->rings->wakeup_fd;
+    }
     items[1].events = ZMQ_POLLIN;
+    if (NULL != data->prio_zocket) {
+        items[2].socket = data->prio_zocket;
+        items[2].events = ZMQ_POLLIN;
+    }
     for (size_t i = 0; i < param->private_items_nb; i++) {
-        memcpy(items + 2 + i, param->private_items + i, sizeof(items[2+i]));
+        memcpy(items + private_first + i, param->private_items + i, sizeof(items[0]));
     }
 
 
@@ -370,8 +559,18 @@ bxierr_p _loop(bxilog_handler_p handler,
     if (bxierr_isko(err2)) bxierr_report(&err2, STDERR_FILENO);
 
     while (true) {
+        bool pending = false;
+        if (NULL != data->rings) {
+            size_t processed_nb;
+            err2 = _process_rings(handler, param, data, &processed_nb);
+            BXIERR_CHAIN(err, err2);
+            err = _process_ierr(handler, param, err);
+            if (bxierr_isko(err)) goto QUIT;
+            // Do not sleep if producers have been faster than us
+            pending = !bxilog__ring_set_wait(data->rings);
+        }
         errno = 0;
-        int rc = zmq_poll(items, (int) items_nb, actual_timeout);
+        int rc = zmq_poll(items, (int) items_nb, pending ? 0 : actual_timeout);
 
         if (-1 == rc) {
             if (EINTR == errno) continue; // One interruption happened
@@ -394,6 +593,9 @@ bxierr_p _loop(bxilog_handler_p handler,
 
         actual_timeout = param->flush_freq_ms - duration_since_last_flush;
 
+        // Not a timeout: some records are still waiting in the rings
+        if (0 == rc && pending && 0 < actual_timeout) continue;
+
 //        fprintf(stderr,
 //                "Duration: %ld, Actual Timeout:  %ld\n",
 //                duration_since_last_flush, actual_timeout);
@@ -432,24 +634,22 @@ bxierr_p _loop(bxilog_handler_p handler,
             err = _process_ierr(handler, param, err);
             if (bxierr_isko(err)) goto QUIT;
         }
-        if (items[1].revents & ZMQ_POLLIN) {
+        const bool prio_in = NULL != data->prio_zocket && (items[2].revents & ZMQ_POLLIN);
+        if ((items[1].revents & ZMQ_POLLIN) && NULL != data->rings) {
+            // Rings are drained at the beginning of the loop
+            bxilog__ring_set_awake(data->rings);
+        } else if ((items[1].revents & ZMQ_POLLIN) || prio_in) {
             // Process data, this is the normal case
-            err2 = _process_log_record(handler, param, data);
-
-            if (EAGAIN == err2->code) {
-                // Might happened on interruption!
-                bxierr_destroy(&err2);
-                err2 = BXIERR_OK;
-            }
+            err2 = _process_log_records(handler, param, data);
             BXIERR_CHAIN(err, err2);
 
             err = _process_ierr(handler, param, err);
             if (bxierr_isko(err)) goto QUIT;
         }
         for (size_t i = 0; i < param->private_items_nb; i++) {
-            if (0 != items[2+i].revents) {
+            if (0 != items[private_first + i].revents) {
                 if (NULL != param->cbs[i]) {
-                    err2 = param->cbs[i](param, items[2+i].revents);
+                    err2 = param->cbs[i](param, items[private_first + i].revents);
                     if (bxierr_isko(err)) goto QUIT;
                 }
             }
@@ -468,12 +668,27 @@ bxierr_p _cleanup(bxilog_handler_p handler,
 
     bxierr_p err = BXIERR_OK, err2;
 
+    // From now on, producers drop records sent to this handler
+    if (NULL != data->rings) bxilog__ring_set_close(data->rings);
+
     err2 =  bxizmq_zocket_destroy(&data->data_zocket);
     BXIERR_CHAIN(err, err2);
 
+    err2 =  bxizmq_zocket_destroy(&data->prio_zocket);
+    BXIERR_CHAIN(err, err2);
+
     err2 = bxizmq_zocket_destroy(&data->ctrl_zocket);
     BXIERR_CHAIN(err, err2);
 
+    BXIFREE(data->fmt_buf);
+    data->fmt_buf_size = 0;
+    BXIFREE(data->batch);
+    BXIFREE(data->batch_offsets);
+    BXIFREE(data->batch_zmsgs);
+    BXIFREE(data->batch_rings);
+    BXIFREE(data->level_by_logger_id);
+    bxilog_filters_trie_destroy(&data->filters_trie);
+
     return err;
 }
 
@@ -483,42 +698,98 @@ bxierr_p _internal_flush(bxilog_handler_p handler,
 
 
     bxierr_p err = BXIERR_OK;
-    while(true) {
-        err = _process_log_record(handler, param, data);
-        if (bxierr_isko(err)) break;
+    if (NULL != data->rings) {
+        size_t processed_nb;
+        do {
+            bxierr_p err2 = _process_rings(handler, param, data, &processed_nb);
+            BXIERR_CHAIN(err, err2);
+        } while (0 < processed_nb);
+        return err;
     }
-    if (EAGAIN == err->code) {
-        bxierr_destroy(&err);
-        err = BXIERR_OK;
+    // The priority queue first
+    void * zockets[] = {data->prio_zocket, data->data_zocket};
+    for (size_t i = 0; i < ARRAYLEN(zockets) && bxierr_isok(err); i++) {
+        if (NULL == zockets[i]) continue;
+        while(true) {
+            err = _process_log_record(handler, param, data, zockets[i]);
+            if (bxierr_isko(err)) break;
+        }
+        if (EAGAIN == err->code) {
+            bxierr_destroy(&err);
+            err = BXIERR_OK;
+        }
     }
+    bxierr_p err2 = _batch_process(handler, param, data);
+    BXIERR_CHAIN(err, err2);
+
+    return err;
+}
+
+bxierr_p _process_log_records(bxilog_handler_p handler,
+                              bxilog_handler_param_p param,
+                              handler_data_p data) {
+
+    bxierr_p err = BXIERR_OK, err2;
+
+    // Drain what has already been received, without blocking, up to a batch:
+    // the priority queue first so serious records never wait behind other ones
+    void * zockets[] = {data->prio_zocket, data->data_zocket};
+    for (size_t z = 0; z < ARRAYLEN(zockets) && bxierr_isok(err); z++) {
+        if (NULL == zockets[z]) continue;
+        for (size_t i = 0; i < BATCH_MAX; i++) {
+            err2 = _process_log_record(handler, param, data, zockets[z]);
+            if (EAGAIN == err2->code) {
+                // Might happened on interruption!
+                bxierr_destroy(&err2);
+                break;
+            }
+            BXIERR_CHAIN(err, err2);
+            if (bxierr_isko(err)) break;
+        }
+    }
+    err2 = _batch_process(handler, param, data);
+    BXIERR_CHAIN(err, err2);
 
     return err;
 }
 
 bxierr_p _process_log_record(bxilog_handler_p handler,
                              bxilog_handler_param_p param,
-                             handler_data_p data) {
-    zmq_msg_t zmsg;
+                             handler_data_p data,
+                             void * zocket) {
+    // Messages holding records of the batch are released once it has been processed
+    zmq_msg_t single;
+    zmq_msg_t * zmsg = (NULL == data->batch) ?
+                            &single :
+                            &data->batch_zmsgs[data->batch_zmsgs_nb];
     errno = 0;
-    int rc = zmq_msg_init(&zmsg);
+    int rc = zmq_msg_init(zmsg);
     bxiassert(0 == rc);
 
     bxierr_p err = BXIERR_OK, err2;
 
-    err2 = bxizmq_msg_rcv(data->data_zocket, &zmsg, ZMQ_DONTWAIT);
+    err2 = bxizmq_msg_rcv(zocket, zmsg, ZMQ_DONTWAIT);
     BXIERR_CHAIN(err, err2);
 
     if (bxierr_isko(err)) {
-        err2 = bxizmq_msg_close(&zmsg);
+        err2 = bxizmq_msg_close(zmsg);
         BXIERR_CHAIN(err, err2);
         return err;
     }
 
+    if (NULL != data->batch) data->batch_zmsgs_nb++;
+
     err2 = _process_log_zmsg(handler, param, data, zmsg);
     BXIERR_CHAIN(err, err2);
-    /* Release */
-    err2 = bxizmq_msg_close(&zmsg);
-    BXIERR_CHAIN(err, err2);
+
+    if (NULL == data->batch) {
+        /* Release */
+        err2 = bxizmq_msg_close(zmsg);
+        BXIERR_CHAIN(err, err2);
+    } else if (BATCH_MAX == data->batch_zmsgs_nb) {
+        err2 = _batch_process(handler, param, data);
+        BXIERR_CHAIN(err, err2);
+    }
 
     return err;
 }
@@ -526,14 +797,22 @@ bxierr_p _process_log_record(bxilog_handler_p handler,
 bxierr_p _process_log_zmsg(bxilog_handler_p handler,
                            bxilog_handler_param_p param,
                            handler_data_p data,
-                           zmq_msg_t zmsg) {
+                           zmq_msg_t * zmsg) {
 
 
     // bxiassert we received enough data
 //    const size_t received_size = zmq_msg_size(&zmsg);
 //    bxiassert(received_size >= BXILOG__GLOBALS->RECORD_MINIMUM_SIZE);
 
-    bxilog_record_s * record = zmq_msg_data(&zmsg);
+    bxilog_record_s * record = zmq_msg_data(zmsg);
+
+    return _process_log_data(handler, param, data, record);
+}
+
+bxierr_p _process_log_data(bxilog_handler_p handler,
+                           bxilog_handler_param_p param,
+                           handler_data_p data,
+                           bxilog_record_p record) {
 
     // Fetch other strings: filename, funcname, loggername, logmsg
     char * filename = (char *) record + sizeof(*record);
@@ -541,35 +820,357 @@ bxierr_p _process_log_zmsg(bxilog_handler_p handler,
     char * loggername = funcname + record->funcname_len;
     char * logmsg = loggername + record->logname_len;
 
-    bxilog_level_e filter_level = BXILOG_OFF;
+    // The strings of a registered callsite are in the callsite table
+    bxilog__callsite_entry_p callsite = NULL;
+    if (BXILOG__RECORD_CALLSITE & record->flags) {
+        callsite = bxilog__callsite_get(record->callsite_id);
+        loggername = callsite->logname;
+    }
 
-    for (size_t i = 0; i < param->filters->nb; i++) {
-        bxilog_filter_p filter = param->filters->list[i];
-        if (NULL == filter) break;
+    const bxilog_level_e filter_level = _logger_level(data, record->logger_id, loggername);
+    if (record->level > filter_level) return BXIERR_OK;
+    if (NULL != data->batch) return _batch_add(handler, param, data, record, callsite);
 
-        if (0 == strncmp(filter->prefix, loggername, strlen(filter->prefix))) {
-            filter_level = filter->level;
-//            fprintf(stderr, "%d.%d: %s MATCH [%zu] %s:%d\n",
-//                                    record->pid, record->tid, loggername,
-//                                    i, filter->prefix, filter->level);
-        } else {
-//            fprintf(stderr, "%d.%d: %s MISMATCH [%zu] %s:%d\n",
-//                                                record->pid, record->tid, loggername,
-//                                                i, filter->prefix, filter->level);
-        }
-    }
     bxierr_p err = BXIERR_OK;
-    if ((record->level <= filter_level) && (NULL != handler->process_log)) {
+    if (NULL != handler->process_log) {
+            if (0 != record->flags) {
+                // Only records actually processed are rebuilt
+                record = _expand_record(data, record, callsite);
+                filename = (char *) record + sizeof(*record);
+                funcname = filename + record->filename_len;
+                loggername = funcname + record->funcname_len;
+                logmsg = loggername + record->logname_len;
+            }
             err = handler->process_log(record,
                                        filename, funcname, loggername, logmsg,
                                        param);
+    }
+
+    return err;
+}
+
+void _set_filters(handler_data_p data, bxilog_filters_p filters) {
+    bxilog_filters_trie_destroy(&data->filters_trie);
+    data->filters_trie = bxilog_filters_compile(filters);
+    // Levels are computed again on the next record of each logger
+    if (NULL == data->level_by_logger_id) return;
+    memset(data->level_by_logger_id, LEVEL_UNKNOWN, data->level_by_logger_id_size);
+}
+
+bxilog_level_e _filters_level(handler_data_p data, const char * loggername) {
+    // The most precise filter gives the level, records are dropped without any
+    bxilog_level_e level = BXILOG_OFF;
+    bxilog_filters_trie_match(data->filters_trie, loggername, &level);
+    return level;
+}
+
+bxilog_level_e _logger_level(handler_data_p data,
+                             size_t logger_id, const char * loggername) {
+
+    // Records of unregistered loggers, or coming from other processes
+    if (0 == logger_id) return _filters_level(data, loggername);
+
+    if (logger_id >= data->level_by_logger_id_size) {
+        // Loggers registered after this thread started
+        const size_t old_size = data->level_by_logger_id_size;
+        size_t new_size = (0 == old_size) ? LEVEL_BY_LOGGER_ID_DEFAULT_SIZE : old_size;
+        while (logger_id >= new_size) new_size *= 2;
+        data->level_by_logger_id = bximem_realloc(data->level_by_logger_id,
+                                                  old_size, new_size);
+        memset(data->level_by_logger_id + old_size, LEVEL_UNKNOWN, new_size - old_size);
+        data->level_by_logger_id_size = new_size;
+    }
+
+    uint8_t level = data->level_by_logger_id[logger_id];
+    if (LEVEL_UNKNOWN == level) {
+        level = (uint8_t) _filters_level(data, loggername);
+        data->level_by_logger_id[logger_id] = level;
+    }
+    return (bxilog_level_e) level;
+}
+
+bxilog_record_p _expand_record(handler_data_p data,
+                               bxilog_record_p record,
+                               bxilog__callsite_entry_p callsite) {
+    // Handlers are given a full record: the strings follow the header, and the
+    // message is formatted. The record might be shared with other handlers: it must
+    // not be modified, a copy is made in the thread buffer instead.
+    const char * strings = (char *) record + sizeof(*record);
+    size_t strings_len = record->filename_len + record->funcname_len + \
+                            record->logname_len;
+    if (NULL != callsite) {
+        strings_len = callsite->filename_len + callsite->funcname_len + \
+                        callsite->logname_len;
+    }
+    const size_t header_len = sizeof(*record) + strings_len;
+    const char * logmsg = (char *) record + sizeof(*record) + record->filename_len + \
+                            record->funcname_len + record->logname_len;
+
+    // The record is rebuilt after the ones pending in the batch, if any
+    const size_t base = data->fmt_buf_used;
+    _fmt_buf_reserve(data, base + header_len + 1);
+    size_t logmsg_len = record->logmsg_len;
+    if (BXILOG__RECORD_DEFERRED & record->flags) {
+        logmsg_len = bxilog__deferred_format(data->fmt_buf + base + header_len,
+                                             data->fmt_buf_size - base - header_len,
+                                             logmsg, record->logmsg_len);
+    }
+    if (base + header_len + logmsg_len > data->fmt_buf_size) {
+        _fmt_buf_reserve(data, base + header_len + logmsg_len);
+        if (BXILOG__RECORD_DEFERRED & record->flags) {
+            bxilog__deferred_format(data->fmt_buf + base + header_len, logmsg_len,
+                                    logmsg, record->logmsg_len);
+        }
+    }
+    if (!(BXILOG__RECORD_DEFERRED & record->flags)) {
+        memcpy(data->fmt_buf + base + header_len, logmsg, logmsg_len);
+    }
+
+    bxilog_record_p result = (bxilog_record_p) (data->fmt_buf + base);
+    memcpy(result, record, sizeof(*record));
+    char * dst = (char *) result + sizeof(*record);
+    if (NULL == callsite) {
+        memcpy(dst, strings, strings_len);
     } else {
-        UNUSED(data);
+        memcpy(dst, callsite->filename, callsite->filename_len);
+        dst += callsite->filename_len;
+        memcpy(dst, callsite->funcname, callsite->funcname_len);
+        dst += callsite->funcname_len;
+        memcpy(dst, callsite->logname, callsite->logname_len);
+        result->filename_len = callsite->filename_len;
+        result->funcname_len = callsite->funcname_len;
+        result->logname_len = callsite->logname_len;
+    }
+    if (BXILOG__RECORD_TICKS & record->flags) {
+        bxitime_fast_to_timespec((uint64_t) record->detail_time.tv_sec,
+                                 &result->detail_time);
+    }
+    result->flags = 0;
+    result->logmsg_len = logmsg_len;
+
+    return result;
+}
+
+void _fmt_buf_reserve(handler_data_p data, size_t size) {
+    if (size <= data->fmt_buf_size) return;
+
+    const size_t new_size = (size > 2 * data->fmt_buf_size) ? size : 2 * data->fmt_buf_size;
+    data->fmt_buf = bximem_realloc(data->fmt_buf, data->fmt_buf_size, new_size);
+    data->fmt_buf_size = new_size;
+}
+
+bxierr_p _batch_add(bxilog_handler_p handler,
+                    bxilog_handler_param_p param,
+                    handler_data_p data,
+                    bxilog_record_p record,
+                    bxilog__callsite_entry_p callsite) {
+
+    size_t offset = SIZE_MAX;
+    if (0 != record->flags) {
+        // The format buffer might move until the batch is processed: keep the offset
+        offset = data->fmt_buf_used;
+        record = _expand_record(data, record, callsite);
+        data->fmt_buf_used += RECORD_ALIGN(sizeof(*record) + record->filename_len + \
+                                           record->funcname_len + record->logname_len + \
+                                           record->logmsg_len);
+    }
+    data->batch[data->batch_nb].record = record;
+    data->batch_offsets[data->batch_nb] = offset;
+    data->batch_nb++;
+
+    // The ring entries must not be consumed before the batch has been processed
+    if (NULL != data->ring && !data->ring->batched) {
+        data->ring->batched = true;
+        data->batch_rings[data->batch_rings_nb++] = data->ring;
+    }
+
+    if (BATCH_MAX > data->batch_nb) return BXIERR_OK;
+
+    return _batch_process(handler, param, data);
+}
+
+bxierr_p _batch_process(bxilog_handler_p handler,
+                        bxilog_handler_param_p param,
+                        handler_data_p data) {
+
+    if (NULL == data->batch) return BXIERR_OK;
+
+    bxierr_p err = BXIERR_OK, err2;
+    if (0 < data->batch_nb) {
+        for (size_t i = 0; i < data->batch_nb; i++) {
+            bxilog_log_p log = &data->batch[i];
+            if (SIZE_MAX != data->batch_offsets[i]) {
+                log->record = (bxilog_record_p) (data->fmt_buf + data->batch_offsets[i]);
+            }
+            log->filename = (char *) log->record + sizeof(*log->record);
+            log->funcname = log->filename + log->record->filename_len;
+            log->loggername = log->funcname + log->record->funcname_len;
+            log->logmsg = log->loggername + log->record->logname_len;
+        }
+        err2 = handler->process_logs(data->batch, data->batch_nb, param);
+        BXIERR_CHAIN(err, err2);
+    }
+
+    for (size_t i = 0; i < data->batch_zmsgs_nb; i++) {
+        err2 = bxizmq_msg_close(&data->batch_zmsgs[i]);
+        BXIERR_CHAIN(err, err2);
+    }
+    for (size_t i = 0; i < data->batch_rings_nb; i++) {
+        bxilog__ring_consume(data->batch_rings[i]);
+        data->batch_rings[i]->batched = false;
+    }
+    data->batch_nb = 0;
+    data->batch_zmsgs_nb = 0;
+    data->batch_rings_nb = 0;
+    data->fmt_buf_used = 0;
+
+    return err;
+}
+
+bxierr_p _process_rings(bxilog_handler_p handler,
+                        bxilog_handler_param_p param,
+                        handler_data_p data,
+                        size_t * processed_nb) {
+
+    bxierr_p err = BXIERR_OK, err2;
+    *processed_nb = 0;
+
+    // Priority rings first: they are all drained below
+    bxilog__ring_set_prio_pending(data->rings);
+    err2 = _process_ring_list(handler, param, data, true, processed_nb);
+    BXIERR_CHAIN(err, err2);
+
+    err2 = _process_ring_list(handler, param, data, false, processed_nb);
+    BXIERR_CHAIN(err, err2);
+
+    err2 = _batch_process(handler, param, data);
+    BXIERR_CHAIN(err, err2);
+
+    return err;
+}
+
+bxierr_p _process_ring_list(bxilog_handler_p handler,
+                            bxilog_handler_param_p param,
+                            handler_data_p data,
+                            const bool prio,
+                            size_t * processed_nb) {
+
+    bxierr_p err = BXIERR_OK, err2;
+
+    bxilog__ring_p prev = NULL;
+    _Atomic(bxilog__ring_p) * head = prio ? &data->rings->prio_head : &data->rings->head;
+    bxilog__ring_p ring = atomic_load_explicit(head, memory_order_acquire);
+    while (NULL != ring) {
+        // Records committed meanwhile in priority rings do not wait for the other ones
+        if (!prio && bxilog__ring_set_prio_pending(data->rings)) {
+            err2 = _process_ring_list(handler, param, data, true, processed_nb);
+            BXIERR_CHAIN(err, err2);
+        }
+        bxilog__ring_p next = ring->next;
+        // Read before draining: once orphan, the producer never writes again
+        const bool orphan = atomic_load_explicit(&ring->orphan, memory_order_acquire);
+        size_t n = 0;
+        size_t len;
+        bxilog_record_p record;
+        data->ring = ring;
+        while ((orphan || n < RING_BATCH_MAX) &&
+               NULL != (record = bxilog__ring_peek(ring, &len))) {
+            err2 = _process_log_data(handler, param, data, record);
+            BXIERR_CHAIN(err, err2);
+            if (NULL == data->batch) bxilog__ring_consume(ring);
+            n++;
+        }
+        data->ring = NULL;
+        *processed_nb += n;
+
+        // Entries filtered out since the last batch can be released right now,
+        // unless some entries of this ring are in the batch, even if this walk has
+        // added none (priority rings are visited again between the other ones)
+        if (!ring->batched) {
+            bxilog__ring_consume(ring);
+        } else if (orphan) {
+            err2 = _batch_process(handler, param, data);
+            BXIERR_CHAIN(err, err2);
+        }
+
+        if (orphan) {
+            // The producing thread has exited, we are the last user of its ring
+            bxilog__ring_set_remove(data->rings, prev, ring);
+            BXIFREE(ring);
+        } else {
+            prev = ring;
+        }
+        ring = next;
     }
 
     return err;
 }
 
+// Producers place their rings themselves: the handler thread reports the errors
+bxierr_p _report_misplaced(bxilog_handler_p handler,
+                           bxilog_handler_param_p param,
+                           handler_data_p data) {
+
+    if (NULL == data->rings) return BXIERR_OK;
+    bxierr_p err = bxilog__ring_set_take_misplaced(data->rings);
+    return _process_ierr(handler, param, err);
+}
+
+bxierr_p _report_dropped(bxilog_handler_p handler,
+                         bxilog_handler_param_p param,
+                         handler_data_p data) {
+
+    if (NULL == data->rings) return BXIERR_OK;
+    const size_t dropped = atomic_exchange_explicit(&data->rings->dropped, 0,
+                                                    memory_order_relaxed);
+    if (0 == dropped) return BXIERR_OK;
+
+    // The report is processed as any other record, filters included
+    bxierr_p err = BXIERR_OK, err2;
+    const bxilog_overflow_policy_e policy = data->rings->overflow_policy;
+    char * logmsg = bxistr_new("%zu log records dropped by handler %s "
+                               "(overflow policy: %s)",
+                               dropped, handler->name,
+                               (policy < ARRAYLEN(OVERFLOW_POLICY_NAMES)) ?
+                                       OVERFLOW_POLICY_NAMES[policy] : "unknown");
+    const size_t logmsg_len = strlen(logmsg) + 1;
+    const size_t len = sizeof(bxilog_record_s) + ARRAYLEN(__FILE__) + \
+                        ARRAYLEN(__func__) + ARRAYLEN(OVERFLOW_LOGGER_NAME) + logmsg_len;
+    bxilog_record_p record = bximem_calloc(len);
+
+    record->level = BXILOG_WARNING;
+    err2 = bxitime_get(CLOCK_REALTIME, &record->detail_time);
+    BXIERR_CHAIN(err, err2);
+    record->pid = BXILOG__GLOBALS->pid;
+#ifdef __linux__
+    record->tid = data->tid;
+#endif
+    record->line_nb = __LINE__;
+    record->filename_len = ARRAYLEN(__FILE__);
+    record->funcname_len = ARRAYLEN(__func__);
+    record->logname_len = ARRAYLEN(OVERFLOW_LOGGER_NAME);
+    record->logmsg_len = logmsg_len;
+
+    char * dst = (char *) record + sizeof(*record);
+    memcpy(dst, __FILE__, ARRAYLEN(__FILE__));
+    dst += ARRAYLEN(__FILE__);
+    memcpy(dst, __func__, ARRAYLEN(__func__));
+    dst += ARRAYLEN(__func__);
+    memcpy(dst, OVERFLOW_LOGGER_NAME, ARRAYLEN(OVERFLOW_LOGGER_NAME));
+    dst += ARRAYLEN(OVERFLOW_LOGGER_NAME);
+    memcpy(dst, logmsg, logmsg_len);
+
+    err2 = _process_log_data(handler, param, data, record);
+    BXIERR_CHAIN(err, err2);
+    err2 = _batch_process(handler, param, data);
+    BXIERR_CHAIN(err, err2);
+
+    BXIFREE(record);
+    BXIFREE(logmsg);
+
+    return err;
+}
+
 bxierr_p _process_ctrl_cmd(bxilog_handler_p handler,
                            bxilog_handler_param_p param,
                            handler_data_p data) {
@@ -610,6 +1211,14 @@ bxierr_p _process_ctrl_cmd(bxilog_handler_p handler,
         BXIERR_CHAIN(err, err2);
         return err;
     }
+    if (0 == strncmp(FILTERS_CTRL_MSG_REQ, cmd, ARRAYLEN(FILTERS_CTRL_MSG_REQ))) {
+        BXIFREE(cmd);
+        err2 = _process_filters(handler, param, data);
+        BXIERR_CHAIN(err, err2);
+        err2 = bxizmq_str_snd(FILTERS_CTRL_MSG_REP, data->ctrl_zocket, 0, 0, 0);
+        BXIERR_CHAIN(err, err2);
+        return err;
+    }
     if (0 == strncmp(EXIT_CTRL_MSG_REQ, cmd, ARRAYLEN(EXIT_CTRL_MSG_REQ))) {
         BXIFREE(cmd);
 
@@ -637,6 +1246,12 @@ bxierr_p _process_implicit_flush(bxilog_handler_p handler,
     err2 = _internal_flush(handler, param, data);
     BXIERR_CHAIN(err, err2);
 
+    err2 = _report_dropped(handler, param, data);
+    BXIERR_CHAIN(err, err2);
+
+    err2 = _report_misplaced(handler, param, data);
+    BXIERR_CHAIN(err, err2);
+
     err2 = (NULL == handler->process_implicit_flush) ? BXIERR_OK :
             handler->process_implicit_flush(param);
 
@@ -654,6 +1269,12 @@ bxierr_p _process_explicit_flush(bxilog_handler_p handler,
     err2 = _internal_flush(handler, param, data);
     BXIERR_CHAIN(err, err2);
 
+    err2 = _report_dropped(handler, param, data);
+    BXIERR_CHAIN(err, err2);
+
+    err2 = _report_misplaced(handler, param, data);
+    BXIERR_CHAIN(err, err2);
+
     err2 = (NULL == handler->process_explicit_flush) ? BXIERR_OK :
             handler->process_explicit_flush(param);
 
@@ -662,6 +1283,19 @@ bxierr_p _process_explicit_flush(bxilog_handler_p handler,
     return err;
 }
 
+bxierr_p _process_filters(bxilog_handler_p handler,
+                          bxilog_handler_param_p param,
+                          handler_data_p data) {
+
+    // Records already sent have been accepted according to the previous filters:
+    // they are processed with them, in order, before the new ones are used
+    // (see bxilog_reconfigure_filters())
+    bxierr_p err = _internal_flush(handler, param, data);
+    _set_filters(data, param->filters);
+
+    return err;
+}
+
 bxierr_p _process_exit(bxilog_handler_p handler,
                        bxilog_handler_param_p param,
                        handler_data_p data) {
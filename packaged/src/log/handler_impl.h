@@ -26,6 +26,12 @@
 #define FLUSH_CTRL_MSG_REP "H->BC: flushed!"
 #define EXIT_CTRL_MSG_REQ "BC->H: exit?"
 #define EXIT_CTRL_MSG_REP "H->BC: exited!"
+#define FILTERS_CTRL_MSG_REQ "BC->H: filters?"
+#define FILTERS_CTRL_MSG_REP "H->BC: filtered!"
+
+// Identity of the priority zocket of the given handler rank: the data zocket
+// identity is the rank itself
+#define BXILOG__PRIO_IDENTITY(rank) ((rank) | ((size_t) 1 << (8 * sizeof(size_t) - 1)))
 
 
 //*********************************************************************************
@@ -19,6 +19,8 @@
 
 #include "bxi/base/log.h"
 
+#include "ring_impl.h"
+
 //*********************************************************************************
 //********************************** Defines **************************************
 //*********************************************************************************
@@ -61,8 +63,22 @@ typedef struct {
     /* Once-only initialisation of the tsd */
     pthread_once_t tsd_key_once;
 
+    /* Per handler arrays hold config->handlers_max entries: handlers are added
+     * without reallocating them since other threads read them without any lock */
     size_t internal_handlers_nb;
     pthread_t *handlers_threads;
+
+    /* One ring set per handler, NULL unless the ring transport is used */
+    bxilog__ring_set_p ring_sets;
+
+    /* The filters of each handler, compiled (see bxilog__config_loggers()),
+     * NULL for a removed handler */
+    bxilog_filters_trie_p * filters_tries;
+    size_t filters_tries_nb;
+
+    /* Incremented each time a handler is added or removed, threads update their
+     * connections on their next log when it changes (see bxilog__tsd_get()) */
+    size_t handlers_gen;
 } bxilog__core_globals_s;
 
 typedef bxilog__core_globals_s * bxilog__core_globals_p;
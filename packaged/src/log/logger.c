@@ -22,6 +22,7 @@
 #include <execinfo.h>
 #include <time.h>
 #include <errno.h>
+#include <inttypes.h>
 
 
 #include <limits.h>
@@ -47,35 +48,68 @@
 #include "bxi/base/log/logger.h"
 
 #include "log_impl.h"
+#include "handler_impl.h"
 #include "tsd_impl.h"
+#include "callsite_impl.h"
+#include "deferred_impl.h"
 #include "fork_impl.h"
+#include "record_impl.h"
 
 //*********************************************************************************
 //********************************** Defines **************************************
 //*********************************************************************************
-#define RETRIES_MAX 2u // We try once asynchronously, then back up to synchronous
 
-#define RETRY_DELAY 500000l
+// Handlers of higher ranks are not in bxilog_logger_s.handlers_skip: they receive
+// all records
+#define HANDLERS_SKIP_MAX 64
 
 //*********************************************************************************
 //********************************** Types ****************************************
 //*********************************************************************************
 
+/*
+ * The source of a log message: either a format with its arguments, or a raw string.
+ *
+ * This allows the message to be written directly at its final place. In deferred
+ * mode, the arguments are packed instead and the handler threads format them.
+ */
+typedef struct {
+    const char * fmt;               // The format, NULL if rawstr must be used
+    va_list ap;                     // The format arguments
+    bool deferred;                  // The arguments are packed, not formatted
+    const char * rawstr;            // The raw string
+    size_t rawstr_len;              // The raw string length (including the NULL
+                                    // terminating byte)
+} msg_src_s;
+
+typedef msg_src_s * msg_src_p;
+
+/*
+ * Where a log comes from: either a registered callsite, or the strings themselves.
+ */
+typedef struct {
+    bxilog_logger_p logger;
+    bxilog_level_e level;
+    size_t callsite_id;             // 0 if the strings must be copied in the record
+    const char * filename;
+    size_t filename_len;
+    const char * funcname;
+    size_t funcname_len;
+    int line;
+} record_src_s;
 
+typedef record_src_s * record_src_p;
 
 //*********************************************************************************
 //********************************** Static Functions  ****************************
 //*********************************************************************************
-static bxierr_p _send2handlers(const bxilog_logger_p logger, const bxilog_level_e level,
-                               void * log_channel,
-#ifdef __linux__
-                               pid_t tid,
-#endif
-                               uintptr_t thread_rank,
-                               const char * filename, size_t filename_len,
-                               const char * funcname, size_t funcname_len,
-                               int line,
-                               const char * rawstr, size_t rawstr_len);
+static bool _skipped(uint64_t skip, size_t rank);
+static bxierr_p _send2handlers(tsd_p tsd, record_src_p src, msg_src_p msg);
+static bxierr_p _send2zmq(tsd_p tsd, record_src_p src, msg_src_p msg);
+static bxierr_p _send2rings(tsd_p tsd, record_src_p src, msg_src_p msg);
+static size_t _header_len(record_src_p src);
+static char * _write_header(bxilog_record_p record, tsd_p tsd, record_src_p src);
+static size_t _write_msg(char * buf, size_t size, msg_src_p msg);
 //*********************************************************************************
 //********************************** Global Variables  ****************************
 //*********************************************************************************
@@ -100,28 +134,33 @@ void bxilog_logger_set_level(const bxilog_logger_p logger, const bxilog_level_e
 }
 
 void bxilog_logger_reconfigure(const bxilog_logger_p logger) {
-    if (NULL == BXILOG__GLOBALS || NULL == BXILOG__GLOBALS->config) return;
+    // The compiled filters are set by bxilog__config_loggers() which reconfigures
+    // all registered loggers
+    if (NULL == BXILOG__GLOBALS || NULL == BXILOG__GLOBALS->filters_tries) return;
     bxilog_level_e minimum_level = BXILOG_OFF; // The minimum level required for the current logger
                                                // across all handlers
-    for (size_t i = 0; i < BXILOG__GLOBALS->config->handlers_nb; i++) {
-        const bxilog_filters_p filters = BXILOG__GLOBALS->config->handlers_params[i]->filters;
-        size_t best_match_len = 0; // The length of the most precise matching filter
-                                   // inside each handler
-        bxilog_level_e best_match_level = BXILOG_LOWEST; // The best match level inside
-                                                         // each handler
+    uint64_t handlers_skip[BXILOG_LOWEST + 1] = {0};
+    const size_t tries_nb = __atomic_load_n(&BXILOG__GLOBALS->filters_tries_nb,
+                                            __ATOMIC_ACQUIRE);
+    for (size_t i = 0; i < tries_nb; i++) {
         // First, look after the most precise filter in the current handler
-        for (size_t f = 0; f < filters->nb; f++) {
-            const bxilog_filter_p filter = filters->list[f];
-            const size_t filter_pre_len = strlen(filter->prefix);
-            if (logger->name_length < filter_pre_len) continue;
-            if (0 != strncmp(filter->prefix, logger->name, filter_pre_len)) continue;
-            // This filter prefix matches the logger name
-            // Let see if it is the maximum match
-            if (best_match_len > filter_pre_len) continue;
-            // We found a new good match, make it the last best known
-            best_match_len = filter_pre_len;
-            best_match_level = filter->level;
+        bxilog_level_e best_match_level = BXILOG_OFF;
+        // Tries are replaced by bxilog_reconfigure_filters(), bxilog_add_handler()
+        // and bxilog_remove_handler()
+        bxilog_filters_trie_p trie = __atomic_load_n(&BXILOG__GLOBALS->filters_tries[i],
+                                                     __ATOMIC_ACQUIRE);
+        const bool found = (NULL != trie) &&
+                            bxilog_filters_trie_match(trie, logger->name,
+                                                      &best_match_level);
+        // Records the handler would drop are not sent to it (see handler.c)
+        for (int level = best_match_level + 1; level <= BXILOG_LOWEST; level++) {
+            if (i < HANDLERS_SKIP_MAX) handlers_skip[level] |= (uint64_t) 1 << i;
         }
+        // A removed handler has no requirement
+        if (NULL == trie) continue;
+        // Without any match, the logger is left at the most detailed level
+        if (!found) best_match_level = BXILOG_LOWEST;
+
         // At that stage, we know the most precise filter's level
         // However, other handlers might have other requirements
         // If another handler specifies a more detailed level, it must be set in
@@ -131,11 +170,15 @@ void bxilog_logger_reconfigure(const bxilog_logger_p logger) {
         if (best_match_level < minimum_level) continue;
         minimum_level = best_match_level;
     }
+    memcpy(logger->handlers_skip, handlers_skip, sizeof(handlers_skip));
     logger->level = minimum_level;
 }
 
 
 // Defined inline in bxilog.h
+extern bxilog_ratelimit_result_e bxilog_ratelimit_check(const bxilog_ratelimit_p ratelimit,
+                                                        const bxilog_ratelimit_e kind,
+                                                        const uint64_t n);
 extern bool bxilog_logger_is_enabled_for(const bxilog_logger_p logger,
                                          const bxilog_level_e level);
 
@@ -163,15 +206,14 @@ bxierr_p bxilog_logger_log_rawstr(const bxilog_logger_p logger, const bxilog_lev
     tsd_p tsd;
     bxierr_p err = bxilog__tsd_get(&tsd);
     if (bxierr_isko(err)) return err;
-    err = _send2handlers(logger, level, tsd->data_channel,
-#ifdef __linux__
-                    tsd->tid,
-#endif
-                    tsd->thread_rank,
-                    filename, filename_len,
-                    funcname, funcname_len,
-                    line,
-                    rawstr, rawstr_len);
+
+    record_src_s src = {.logger = logger, .level = level, .callsite_id = 0,
+                        .filename = filename, .filename_len = filename_len,
+                        .funcname = funcname, .funcname_len = funcname_len,
+                        .line = line};
+    msg_src_s msg = {.fmt = NULL, .deferred = false,
+                     .rawstr = rawstr, .rawstr_len = rawstr_len};
+    err = _send2handlers(tsd, &src, &msg);
     return err;
 }
 
@@ -190,65 +232,21 @@ bxierr_p bxilog_logger_vlog_nolevelcheck(const bxilog_logger_p logger,
     bxierr_p err = bxilog__tsd_get(&tsd);
     if (bxierr_isko(err)) return err;
 
-    // Start creating the logmsg so the length can be computed
-    // We start in the thread local buffer
-
-    char * logmsg = tsd->log_buf;
-    size_t logmsg_len = BXILOG__GLOBALS->config->tsd_log_buf_size;
-    bool logmsg_allocated = false; // When true,  means that a new special buffer has been
-                                   // allocated -> it will have to be freed
-    while (true) {
-        va_list arglist_copy;
-        va_copy(arglist_copy, arglist);
-        // Does not include the null terminated byte
-        int n = vsnprintf(logmsg, logmsg_len, fmt, arglist_copy);
-        va_end(arglist_copy);
-
-        // Check error
-        bxiassert(n >= 0);
-
-        // Ok
-        if ((size_t) n < logmsg_len) {
-            logmsg_len = (size_t) n + 1; // Record the actual size of the message
-            break;
-        }
-
-        if (logmsg_allocated) BXIFREE(logmsg);
-        // Not enough space, mallocate a new special buffer of the precise size
-        logmsg_len = (size_t) (n + 1);
-        logmsg = malloc(logmsg_len); // Include the null terminated byte
-        bxiassert(NULL != logmsg);
-        logmsg_allocated = true;
+    record_src_s src = {.logger = logger, .level = level, .callsite_id = 0,
+                        .funcname = funcname, .funcname_len = funcname_len,
+                        .line = line};
+    src.filename_len = bxistr_rsub(fullfilename, fullfilename_len, '/', &src.filename);
 
-        tsd->rsz_log_nb++;
+    // The message is formatted directly in its final place: the transport slot
+    // or the thread record buffer.
+    msg_src_s msg = {.fmt = fmt, .deferred = false, .rawstr = NULL, .rawstr_len = 0};
+    if (BXILOG__GLOBALS->config->deferred_format) {
+        msg.deferred = bxilog__deferred_supported(fmt);
     }
+    va_copy(msg.ap, arglist);
+    err = _send2handlers(tsd, &src, &msg);
+    va_end(msg.ap);
 
-    tsd->max_log_size = tsd->max_log_size > logmsg_len ? tsd->max_log_size : logmsg_len;
-    tsd->min_log_size = tsd->min_log_size < logmsg_len ? tsd->min_log_size : logmsg_len;
-    tsd->sum_log_size += logmsg_len;
-    tsd->log_nb++;
-
-    bxiassert(bxierr_isok(err));
-
-    const char * filename;
-    size_t filename_len = bxistr_rsub(fullfilename, fullfilename_len, '/', &filename);
-
-    err = _send2handlers(logger, level, tsd->data_channel,
-#ifdef __linux__
-                         tsd->tid,
-#endif
-                         tsd->thread_rank,
-                         filename, filename_len,
-                         funcname, funcname_len,
-                         line,
-                         logmsg, logmsg_len);
-
-    if (logmsg_allocated) BXIFREE(logmsg);
-    // Either record comes from the stack
-    // or it comes from a mallocated region that will be freed
-    // by bxizmq_snd_data_zc itself
-    // Therefore it should not be freed here
-    // FREE(record);
     return err;
 }
 
@@ -272,40 +270,281 @@ bxierr_p bxilog_logger_log_nolevelcheck(const bxilog_logger_p logger,
     return err;
 }
 
+bxierr_p bxilog_ratelimit_summary(const bxilog_logger_p logger,
+                                  const bxilog_level_e level,
+                                  const bxilog_callsite_p callsite,
+                                  const bxilog_ratelimit_p ratelimit) {
+
+    const uint64_t suppressed = __atomic_exchange_n(&ratelimit->suppressed, 0,
+                                                    __ATOMIC_RELAXED);
+    if (0 == suppressed) return BXIERR_OK;
+
+    return bxilog_logger_log_callsite(logger, level, callsite,
+                                      "%"PRIu64" similar logs suppressed by rate limit",
+                                      suppressed);
+}
+
+bxierr_p bxilog_logger_log_callsite(const bxilog_logger_p logger,
+                                    const bxilog_level_e level,
+                                    const bxilog_callsite_p callsite,
+                                    const char * const fmt, ...) {
+    if (INITIALIZED != BXILOG__GLOBALS->state) return BXIERR_OK;
+
+    va_list ap;
+    bxierr_p err;
+
+    va_start(ap, fmt);
+    const size_t id = bxilog__callsite_id(logger, callsite);
+    if (0 == id) {
+        // Not usable: send the strings
+        err = bxilog_logger_vlog_nolevelcheck(logger, level,
+                                              callsite->fullfilename,
+                                              callsite->fullfilename_len,
+                                              callsite->funcname,
+                                              callsite->funcname_len,
+                                              callsite->line,
+                                              fmt, ap);
+        va_end(ap);
+        return err;
+    }
+
+    tsd_p tsd;
+    err = bxilog__tsd_get(&tsd);
+    if (bxierr_isko(err)) {
+        va_end(ap);
+        return err;
+    }
+
+    record_src_s src = {.logger = logger, .level = level, .callsite_id = id,
+                        .filename = NULL, .filename_len = 0,
+                        .funcname = NULL, .funcname_len = 0,
+                        .line = callsite->line};
+    msg_src_s msg = {.fmt = fmt, .deferred = false, .rawstr = NULL, .rawstr_len = 0};
+    if (BXILOG__GLOBALS->config->deferred_format) {
+        msg.deferred = bxilog__deferred_supported(fmt);
+    }
+    va_copy(msg.ap, ap);
+    err = _send2handlers(tsd, &src, &msg);
+    va_end(msg.ap);
+    va_end(ap);
+
+    return err;
+}
+
 //*********************************************************************************
 //********************************** Static Helpers Implementation ****************
 //*********************************************************************************
 
-bxierr_p _send2handlers(const bxilog_logger_p logger,
-                        const bxilog_level_e level,
-                        void * const log_channel,
-#ifdef __linux__
-                        const pid_t tid,
-#endif
-                        const uintptr_t thread_rank,
-                        const char * const filename, const size_t filename_len,
-                        const char * const funcname, const size_t funcname_len,
-                        const int line,
-                        const char * const rawstr, const size_t rawstr_len) {
+bool _skipped(const uint64_t skip, const size_t rank) {
+    return rank < HANDLERS_SKIP_MAX && 0 != (skip & ((uint64_t) 1 << rank));
+}
+
+bxierr_p _send2handlers(const tsd_p tsd, const record_src_p src, const msg_src_p msg) {
+
+    bxiassert(BXILOG_LOWEST >= src->level);
+
+    // Nothing to do when all handlers would drop the record
+    const size_t handlers_nb = tsd->handlers_nb;
+    const uint64_t skip = src->logger->handlers_skip[src->level];
+    if (handlers_nb <= HANDLERS_SKIP_MAX && 0 != handlers_nb &&
+        skip == (UINT64_MAX >> (HANDLERS_SKIP_MAX - handlers_nb))) return BXIERR_OK;
+
+    if (NULL != tsd->rings) return _send2rings(tsd, src, msg);
+    return _send2zmq(tsd, src, msg);
+}
+
+bxierr_p _send2zmq(const tsd_p tsd, const record_src_p src, const msg_src_p msg) {
 
     bxierr_p err = BXIERR_OK, err2;
-    bxilog_record_p record;
-    char * data;
+    void * const log_channel = tsd->data_channel;
+
+    const size_t header_len = _header_len(src);
+
+    // The record is built in the thread record buffer which is reused from one log
+    // to the other: it is only reallocated when a larger record is produced
+    if (header_len >= tsd->log_buf_size) {
+        tsd->log_buf = bximem_realloc(tsd->log_buf, tsd->log_buf_size, 2 * header_len);
+        tsd->log_buf_size = 2 * header_len;
+        bxilog__stats_resized(&tsd->stats);
+    }
+    bxilog_record_p record = (bxilog_record_p) tsd->log_buf;
+    char * logmsg = _write_header(record, tsd, src);
+    size_t logmsg_len = _write_msg(logmsg, tsd->log_buf_size - header_len, msg);
+    if (header_len + logmsg_len > tsd->log_buf_size) {
+        // Not enough space: the header is kept by the reallocation,
+        // the message only has to be written again
+        tsd->log_buf = bximem_realloc(tsd->log_buf, tsd->log_buf_size,
+                                      header_len + logmsg_len);
+        tsd->log_buf_size = header_len + logmsg_len;
+        bxilog__stats_resized(&tsd->stats);
+        record = (bxilog_record_p) tsd->log_buf;
+        logmsg = tsd->log_buf + header_len;
+        _write_msg(logmsg, logmsg_len, msg);
+    }
+    if (msg->deferred) record->flags |= BXILOG__RECORD_DEFERRED;
+    record->logmsg_len = logmsg_len;
+    bxilog__stats_update(&tsd->stats, src->logger, src->level, logmsg_len);
+
+    const size_t data_len = header_len + logmsg_len;
+    const size_t handlers_nb = tsd->handlers_nb;
+    const uint64_t skip = src->logger->handlers_skip[src->level];
+    size_t targets_nb = 0;
+    for (size_t i = 0; i < handlers_nb; i++) {
+        if (tsd->connected[i] && !_skipped(skip, i)) targets_nb++;
+    }
+
+    // With several handlers, the record is copied once in a shared buffer sent
+    // with zero-copy to all of them: each handler releases its own reference.
+    // Otherwise, zmq makes the only copy of the thread buffer.
+    bxilog__shared_record_p shared = NULL;
+    if (1 < targets_nb) shared = bxilog__shared_record_new(record, data_len,
+                                                           targets_nb);
+
+    // The ROUTER zocket never blocks: records sent to a handler which has reached its
+    // high water mark are dropped. Retrying is useless, so is the error it produces.
+    bxilog_handler_param_p * const params = BXILOG__GLOBALS->config->handlers_params;
+    for (size_t i = 0; i< handlers_nb; i++) {
+        if (!tsd->connected[i] || _skipped(skip, i)) continue;
+
+        // Send the frame: serious records go to the priority zocket of the handler
+        const size_t identity = (src->level <= params[i]->prio_level) ?
+                                    BXILOG__PRIO_IDENTITY(i) : i;
+        err2 = bxizmq_data_snd(&identity, sizeof(identity),
+                               log_channel, ZMQ_DONTWAIT | ZMQ_SNDMORE,
+                               0, 0);
+        BXIERR_CHAIN(err, err2);
+
+        if (NULL == shared) {
+            err2 = bxizmq_data_snd(record, data_len,
+                                   log_channel, ZMQ_DONTWAIT,
+                                   0, 0);
+        } else {
+            // The reference is released even if the record has not been sent
+            err2 = bxizmq_data_snd_zc(shared->record, data_len,
+                                      log_channel, ZMQ_DONTWAIT,
+                                      0, 0,
+                                      bxilog__shared_record_release, shared);
+        }
+        BXIERR_CHAIN(err, err2);
+    }
+    return err;
+}
+
+bxierr_p _send2rings(const tsd_p tsd, const record_src_p src, const msg_src_p msg) {
+
+    bxierr_p err = BXIERR_OK;
+    bxilog_record_p first = NULL;     // The first record written in a ring
+    size_t data_len = 0;              // Its length
+
+    const size_t header_len = _header_len(src);
+    const uint64_t skip = src->logger->handlers_skip[src->level];
+
+    for (size_t i = 0; i < tsd->rings_nb; i++) {
+        bxilog__ring_set_p set = &BXILOG__GLOBALS->ring_sets[i];
+        // Serious records go to the priority ring, if any
+        bxilog__ring_p ring = (src->level <= set->prio_level && NULL != tsd->prio_rings[i]) ?
+                                tsd->prio_rings[i] : tsd->rings[i];
+        if (NULL == ring || _skipped(skip, i)) continue;
+
+        if (NULL != first) {
+            bxilog_record_p record = bxilog__ring_reserve(set, ring, data_len, src->level);
+            // The handler has exited, nobody will read this record
+            if (NULL == record) continue;
+            // Only this thread writes into its rings: the first record remains
+            // intact even if its handler has already processed it
+            memcpy(record, first, data_len);
+            bxilog__ring_commit(set, ring);
+            continue;
+        }
+
+        // A ring can not hold a record larger than half its size: the message
+        // might be truncated
+        const size_t max_len = bxilog__ring_max_len(ring);
+        if (max_len <= header_len) {
+            // Long logger, file or function names: the record is dropped
+            bxierr_p err2 = bxierr_gen("Can't log a record of %s (%s@%s) "
+                                       "with a header of %zu bytes in a ring "
+                                       "entry of %zu bytes at most: ring_size "
+                                       "must be increased",
+                                       src->logger->name, src->filename,
+                                       src->funcname, header_len, max_len);
+            BXIERR_CHAIN(err, err2);
+            continue;
+        }
+
+        // Reserve the size of a raw message, or the usual size of a formatted one:
+        // a larger one is reserved again once its size is known. The entry is
+        // shrunk to its actual size once the message has been written in place.
+        const size_t hint = (NULL == msg->fmt) ?
+                                msg->rawstr_len :
+                                BXILOG__GLOBALS->config->tsd_log_buf_size;
+        size_t reserved_len = (header_len + hint < max_len) ? header_len + hint : max_len;
+
+        bxilog_record_p record = bxilog__ring_reserve(set, ring, reserved_len, src->level);
+        if (NULL == record) continue;
+        char * logmsg = _write_header(record, tsd, src);
+        size_t logmsg_len = _write_msg(logmsg, reserved_len - header_len, msg);
+        if (msg->deferred && header_len + logmsg_len > max_len) {
+            // Packed arguments can not be truncated: format the message now
+            msg->deferred = false;
+            logmsg_len = _write_msg(logmsg, reserved_len - header_len, msg);
+        }
+
+        if (header_len + logmsg_len > reserved_len && reserved_len < max_len) {
+            // The entry has not been committed yet: reserve it again, larger
+            reserved_len = (header_len + logmsg_len < max_len) ?
+                                header_len + logmsg_len :
+                                max_len;
+            bxilog__stats_resized(&tsd->stats);
+            record = bxilog__ring_reserve(set, ring, reserved_len, src->level);
+            if (NULL == record) continue;
+            logmsg = _write_header(record, tsd, src);
+            _write_msg(logmsg, reserved_len - header_len, msg);
+        }
+        bxilog__stats_update(&tsd->stats, src->logger, src->level,
+                             logmsg_len);
+
+        if (header_len + logmsg_len > reserved_len) {
+            logmsg_len = reserved_len - header_len;
+            logmsg[logmsg_len - 1] = '\0';
+        }
+        if (msg->deferred) record->flags |= BXILOG__RECORD_DEFERRED;
+        record->logmsg_len = logmsg_len;
+        data_len = header_len + logmsg_len;
+        bxilog__ring_shrink(ring, data_len);
+        bxilog__ring_commit(set, ring);
+        first = record;
+    }
+
+    return err;
+}
+
+size_t _header_len(const record_src_p src) {
+    // Registered callsites are resolved by handlers
+    if (0 != src->callsite_id) return sizeof(bxilog_record_s);
+
+    return sizeof(bxilog_record_s) + src->filename_len + src->funcname_len + \
+            src->logger->name_length;
+}
 
-    size_t var_len = filename_len + funcname_len + logger->name_length;
-    size_t data_len = sizeof(*record) + var_len + rawstr_len;
+char * _write_header(bxilog_record_p record, const tsd_p tsd, const record_src_p src) {
+
+    bxierr_p err = BXIERR_OK, err2;
+    char * data;
+    int flags = 0;
 
-    // We need a mallocated buffer to prevent ZMQ from making its own copy
-    // We use malloc() instead of calloc() for performance reason
-    // This has been profiled! There is a significant gain doing this!
-    // If you change this, you must know what you are doing!
-    record = malloc(data_len);
-    bxiassert(NULL != record);
     // Fill the buffer
-    record->level = level;
+    record->level = src->level;
 
-    err2 = bxitime_get(CLOCK_REALTIME, &record->detail_time);
-    BXIERR_CHAIN(err, err2);
+    if (BXILOG__GLOBALS->config->fast_clock) {
+        // Handlers convert the ticks to the wall clock time
+        record->detail_time.tv_sec = (time_t) bxitime_fast_ticks();
+        record->detail_time.tv_nsec = 0;
+        flags |= BXILOG__RECORD_TICKS;
+    } else {
+        err2 = bxitime_get(CLOCK_REALTIME, &record->detail_time);
+        BXIERR_CHAIN(err, err2);
+    }
 
     if (bxierr_isko(err)) {
         char * err_str = bxierr_str(err);
@@ -317,58 +556,63 @@ bxierr_p _send2handlers(const bxilog_logger_p logger,
     }
     record->pid = BXILOG__GLOBALS->pid;
 #ifdef __linux__
-    record->tid = tid;
+    record->tid = tsd->tid;
 #endif
-    record->thread_rank = thread_rank;
-    record->line_nb = line;
-    record->filename_len = filename_len;
-    record->funcname_len = funcname_len;
-    record->logname_len = logger->name_length;
-    record->logmsg_len = rawstr_len;
-
-    // Now copy the rest after the record
+    record->thread_rank = tsd->thread_rank;
+    record->line_nb = src->line;
+    record->callsite_id = src->callsite_id;
+    record->logger_id = src->logger->id;
     data = (char *) record + sizeof(*record);
-    memcpy(data, filename, filename_len);
-    data += filename_len;
-    memcpy(data, funcname, funcname_len);
-    data += funcname_len;
-    memcpy(data, logger->name, logger->name_length);
-    data += logger->name_length;
-    memcpy(data, rawstr, rawstr_len);
-
-    for (size_t i = 0; i< BXILOG__GLOBALS->internal_handlers_nb; i++) {
-        // Send the frame
-        // normal version if record comes from the stack 'buf'
-        err2 = bxizmq_data_snd(&i, sizeof(i),
-                               log_channel, ZMQ_DONTWAIT | ZMQ_SNDMORE,
-                               RETRIES_MAX, RETRY_DELAY);
-        if (err2->code == BXIZMQ_RETRIES_MAX_ERR) {
-            bxierr_destroy(&err2);
-        } else {
-            BXIERR_CHAIN(err, err2);
-        }
 
-        err2 = bxizmq_data_snd(record, data_len,
-                               log_channel, ZMQ_DONTWAIT,
-                               RETRIES_MAX, RETRY_DELAY);
-        if (err2->code == BXIZMQ_RETRIES_MAX_ERR) {
-            bxierr_destroy(&err2);
-        } else {
-            BXIERR_CHAIN(err, err2);
-        }
+    if (0 != src->callsite_id) {
+        record->flags = flags | BXILOG__RECORD_CALLSITE;
+        record->filename_len = 0;
+        record->funcname_len = 0;
+        record->logname_len = 0;
+        return data;
+    }
 
-        // Zero-copy version (if record has been mallocated).
-//        err2 = bxizmq_data_snd_zc(record, data_len,
-//                                 log_channel[i], ZMQ_DONTWAIT,
-//                                 RETRIES_MAX, RETRY_DELAY,
-//                                 bxizmq_data_free, NULL);
+    record->flags = flags;
+    record->filename_len = src->filename_len;
+    record->funcname_len = src->funcname_len;
+    record->logname_len = src->logger->name_length;
 
-        if (err2->code == BXIZMQ_RETRIES_MAX_ERR) {
-            bxierr_destroy(&err2);
-        } else {
-            BXIERR_CHAIN(err, err2);
+    // Now copy the rest after the record
+    memcpy(data, src->filename, src->filename_len);
+    data += src->filename_len;
+    memcpy(data, src->funcname, src->funcname_len);
+    data += src->funcname_len;
+    memcpy(data, src->logger->name, src->logger->name_length);
+    data += src->logger->name_length;
+
+    // The message must be written here
+    return data;
+}
+size_t _write_msg(char * const buf, const size_t size, const msg_src_p msg) {
+    if (NULL == msg->fmt) {
+        if (msg->rawstr_len <= size) {
+            memcpy(buf, msg->rawstr, msg->rawstr_len);
+            buf[msg->rawstr_len - 1] = '\0';
+        } else if (0 < size) {
+            memcpy(buf, msg->rawstr, size - 1);
+            buf[size - 1] = '\0';
         }
+        return msg->rawstr_len;
     }
-    BXIFREE(record);
-    return err;
+
+    va_list ap;
+    va_copy(ap, msg->ap);
+    if (msg->deferred) {
+        size_t len = bxilog__deferred_pack(buf, size, msg->fmt, ap);
+        va_end(ap);
+        return len;
+    }
+    // Does not include the null terminated byte
+    int n = vsnprintf(buf, size, msg->fmt, ap);
+    va_end(ap);
+
+    // Check error
+    bxiassert(n >= 0);
+
+    return (size_t) n + 1;
 }
@@ -0,0 +1,250 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <unistd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#endif
+
+#include "bxi/base/err.h"
+#include "bxi/base/mem.h"
+#include "bxi/base/str.h"
+
+#include "placement_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// Where the kernel gives the CPUs of each NUMA node
+#define NODE_CPULIST_FMT "/sys/devices/system/node/node%d/cpulist"
+
+// Number of bits of a NUMA node mask word
+#define NODEMASK_WORD_BITS (8 * sizeof(unsigned long))
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Static Functions  ****************************
+//*********************************************************************************
+#ifdef __linux__
+static bxierr_p _parse_cpus(const char * cpus, cpu_set_t * set);
+static bxierr_p _node_cpus(int numa_node, cpu_set_t * set);
+static bxierr_p _set_affinity(bxilog_handler_param_p param);
+static bxierr_p _set_sched(bxilog_handler_param_p param);
+static bxierr_p _set_mempolicy(int numa_node);
+static unsigned long * _nodemask_new(int numa_node, unsigned long * maxnode);
+#endif
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Implementation    ****************************
+//*********************************************************************************
+
+bxierr_p bxilog__placement_apply(bxilog_handler_param_p param) {
+    bxiassert(NULL != param);
+
+#ifdef __linux__
+    bxierr_list_p errlist = bxierr_list_new();
+    bxierr_p err = _set_affinity(param);
+    if (bxierr_isko(err)) bxierr_list_append(errlist, err);
+
+    err = _set_sched(param);
+    if (bxierr_isko(err)) bxierr_list_append(errlist, err);
+
+    // Buffers allocated from now on by the handler thread are local
+    err = _set_mempolicy(param->numa_node);
+    if (bxierr_isko(err)) bxierr_list_append(errlist, err);
+
+    if (0 < errlist->errors_nb) {
+        return bxierr_from_list(BXIERR_GROUP_CODE, errlist,
+                                "Placing the handler thread failed");
+    }
+    bxierr_list_destroy(&errlist);
+    return BXIERR_OK;
+#else
+    if (NULL == param->cpus && 0 > param->numa_node) return BXIERR_OK;
+    return bxierr_gen("Handler thread placement is not supported on this platform");
+#endif
+}
+
+bxierr_p bxilog__placement_bind(void * addr, size_t len, int numa_node) {
+    if (0 > numa_node) return BXIERR_OK;
+    bxiassert(NULL != addr);
+
+#ifdef __linux__
+    // Whole pages only: the start is rounded down, the end up
+    const uintptr_t page_size = (uintptr_t) sysconf(_SC_PAGESIZE);
+    const uintptr_t start = (uintptr_t) addr & ~(page_size - 1);
+    const uintptr_t end = ((uintptr_t) addr + len + page_size - 1) & ~(page_size - 1);
+
+    unsigned long maxnode;
+    unsigned long * mask = _nodemask_new(numa_node, &maxnode);
+    errno = 0;
+    long rc = syscall(SYS_mbind, (void *) start, (unsigned long) (end - start),
+                      MPOL_PREFERRED, mask, maxnode, MPOL_MF_MOVE);
+    BXIFREE(mask);
+    if (0 != rc) return bxierr_errno("Calling mbind(%p, %zu, node %d) failed",
+                                     (void *) start, (size_t) (end - start), numa_node);
+    return BXIERR_OK;
+#else
+    UNUSED(len);
+    return bxierr_gen("NUMA placement is not supported on this platform");
+#endif
+}
+
+//*********************************************************************************
+//********************************** Static Helpers Implementation ****************
+//*********************************************************************************
+
+#ifdef __linux__
+bxierr_p _parse_cpus(const char * cpus, cpu_set_t * set) {
+    // The kernel cpulist format: "0-3,8,10-11"
+    CPU_ZERO(set);
+    const char * s = cpus;
+    while ('\0' != *s && '\n' != *s) {
+        char * end;
+        errno = 0;
+        unsigned long first = strtoul(s, &end, 10);
+        if (end == s || 0 != errno) return bxierr_gen("Bad CPU list: '%s'", cpus);
+        unsigned long last = first;
+        if ('-' == *end) {
+            s = end + 1;
+            last = strtoul(s, &end, 10);
+            if (end == s || 0 != errno || last < first) {
+                return bxierr_gen("Bad CPU list: '%s'", cpus);
+            }
+        }
+        if (last >= CPU_SETSIZE) {
+            return bxierr_gen("CPU %lu out of range in '%s' (max: %d)",
+                              last, cpus, CPU_SETSIZE - 1);
+        }
+        for (unsigned long cpu = first; cpu <= last; cpu++) CPU_SET(cpu, set);
+        s = end;
+        if (',' == *s) s++;
+        else if ('\0' != *s && '\n' != *s) return bxierr_gen("Bad CPU list: '%s'", cpus);
+    }
+    if (0 == CPU_COUNT(set)) return bxierr_gen("Empty CPU list: '%s'", cpus);
+    return BXIERR_OK;
+}
+
+bxierr_p _node_cpus(int numa_node, cpu_set_t * set) {
+    char * path = bxistr_new(NODE_CPULIST_FMT, numa_node);
+    errno = 0;
+    FILE * file = fopen(path, "r");
+    if (NULL == file) {
+        bxierr_p err = bxierr_errno("Can't read CPUs of NUMA node %d from %s",
+                                    numa_node, path);
+        BXIFREE(path);
+        return err;
+    }
+    BXIFREE(path);
+
+    char * line = NULL;
+    size_t line_size = 0;
+    bxierr_p err;
+    if (-1 == getline(&line, &line_size, file)) {
+        err = bxierr_gen("No CPUs found for NUMA node %d", numa_node);
+    } else {
+        err = _parse_cpus(line, set);
+    }
+    free(line);
+    fclose(file);
+
+    return err;
+}
+
+bxierr_p _set_affinity(bxilog_handler_param_p param) {
+    cpu_set_t set;
+    bxierr_p err;
+    if (NULL != param->cpus) {
+        err = _parse_cpus(param->cpus, &set);
+    } else if (0 <= param->numa_node) {
+        // The thread runs where its buffers are
+        err = _node_cpus(param->numa_node, &set);
+    } else {
+        return BXIERR_OK;
+    }
+    if (bxierr_isko(err)) return err;
+
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (0 != rc) return bxierr_fromidx(rc, NULL,
+                                       "Calling pthread_setaffinity_np() failed (rc=%d)",
+                                       rc);
+    return BXIERR_OK;
+}
+
+bxierr_p _set_sched(bxilog_handler_param_p param) {
+    bxierr_p err = BXIERR_OK, err2;
+
+    if (SCHED_OTHER != param->sched_policy || 0 != param->sched_priority) {
+        struct sched_param sp;
+        memset(&sp, 0, sizeof(sp));
+        sp.sched_priority = param->sched_priority;
+        int rc = pthread_setschedparam(pthread_self(), param->sched_policy, &sp);
+        if (0 != rc) {
+            err2 = bxierr_fromidx(rc, NULL,
+                                  "Calling pthread_setschedparam(%d, %d) failed (rc=%d)",
+                                  param->sched_policy, param->sched_priority, rc);
+            BXIERR_CHAIN(err, err2);
+        }
+    }
+    // The nice value is per thread on Linux, 0 keeps the inherited one
+    if (0 != param->nice) {
+        errno = 0;
+        int rc = setpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid), param->nice);
+        if (0 != rc) {
+            err2 = bxierr_errno("Calling setpriority(%d) failed", param->nice);
+            BXIERR_CHAIN(err, err2);
+        }
+    }
+
+    return err;
+}
+
+bxierr_p _set_mempolicy(int numa_node) {
+    if (0 > numa_node) return BXIERR_OK;
+
+    unsigned long maxnode;
+    unsigned long * mask = _nodemask_new(numa_node, &maxnode);
+    errno = 0;
+    long rc = syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, maxnode);
+    BXIFREE(mask);
+    if (0 != rc) return bxierr_errno("Calling set_mempolicy(node %d) failed", numa_node);
+
+    return BXIERR_OK;
+}
+
+unsigned long * _nodemask_new(int numa_node, unsigned long * maxnode) {
+    const size_t words = (size_t) numa_node / NODEMASK_WORD_BITS + 1;
+    unsigned long * mask = bximem_calloc(words * sizeof(*mask));
+    mask[(size_t) numa_node / NODEMASK_WORD_BITS] = 1UL << (numa_node % NODEMASK_WORD_BITS);
+    // The kernel reads one bit less than the given number
+    *maxnode = words * NODEMASK_WORD_BITS + 1;
+    return mask;
+}
+#endif
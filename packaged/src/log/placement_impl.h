@@ -0,0 +1,55 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#ifndef BXILOG_PLACEMENT_IMPL_H
+#define BXILOG_PLACEMENT_IMPL_H
+
+#include <stddef.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/log/handler.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interface         ****************************
+//*********************************************************************************
+
+/*
+ * Handler thread: apply the CPU set, the scheduling policy, the nice value and the
+ * NUMA node of the given handler parameters to the calling thread.
+ *
+ * Memory allocated by the calling thread afterwards is placed on the NUMA node,
+ * if any. Each setting is applied even if another one fails.
+ */
+bxierr_p bxilog__placement_apply(bxilog_handler_param_p param);
+
+/*
+ * Place the pages of the given memory area on the given NUMA node, moving the ones
+ * already touched. Nothing is done if the node is negative.
+ *
+ * The whole pages are placed: the area should be page aligned and sized.
+ */
+bxierr_p bxilog__placement_bind(void * addr, size_t len, int numa_node);
+
+#endif
@@ -0,0 +1,68 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/mem.h"
+
+#include "record_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Static Functions  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Implementation    ****************************
+//*********************************************************************************
+
+bxilog__shared_record_p bxilog__shared_record_new(const void * const record,
+                                                  const size_t len,
+                                                  const size_t refs) {
+    bxiassert(NULL != record);
+    bxiassert(0 < refs);
+
+    // We use malloc() instead of calloc() since the whole record is overwritten
+    bxilog__shared_record_p shared = malloc(sizeof(*shared) + len);
+    bxiassert(NULL != shared);
+    atomic_init(&shared->refs, refs);
+    shared->len = len;
+    memcpy(shared->record, record, len);
+
+    return shared;
+}
+
+void bxilog__shared_record_release(void * const data, void * const hint) {
+    bxilog__shared_record_p shared = hint;
+    bxiassert(NULL != shared);
+    bxiassert((void *) shared->record == data);
+
+    // Pairs with the other releases: the last one sees all previous readings
+    // of the record done by the other handlers before freeing it
+    if (1 != atomic_fetch_sub_explicit(&shared->refs, 1, memory_order_acq_rel)) return;
+
+    BXIFREE(shared);
+}
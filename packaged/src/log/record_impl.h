@@ -0,0 +1,78 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#ifndef BXILOG_RECORD_IMPL_H
+#define BXILOG_RECORD_IMPL_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// bxilog_record_s.flags: the logmsg holds the packed format arguments
+// (see deferred_impl.h), handler threads format it before processing the record
+#define BXILOG__RECORD_DEFERRED 0x1
+
+// bxilog_record_s.flags: the record carries a callsite id instead of the file,
+// function and logger names (see callsite_impl.h)
+#define BXILOG__RECORD_CALLSITE 0x2
+
+// bxilog_record_s.flags: detail_time.tv_sec holds raw bxitime_fast_ticks(),
+// handler threads convert it to the wall clock time
+#define BXILOG__RECORD_TICKS 0x4
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+/*
+ * A record shared by all handlers: it is sent with zero-copy to each handler
+ * which owns a reference on it. The last reference released frees it.
+ *
+ * The record itself follows this header.
+ */
+typedef struct {
+    atomic_size_t refs;             // Number of references not yet released
+    size_t len;                     // Length of the record
+    max_align_t record[];           // The record (aligned for any type)
+} bxilog__shared_record_s;
+
+typedef bxilog__shared_record_s * bxilog__shared_record_p;
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interface         ****************************
+//*********************************************************************************
+
+/*
+ * Return a new shared copy of the given record, with refs references on it.
+ *
+ * Each reference must be released by bxilog__shared_record_release() exactly once.
+ */
+bxilog__shared_record_p bxilog__shared_record_new(const void * record, size_t len,
+                                                  size_t refs);
+
+/*
+ * Release a reference on the given shared record.
+ *
+ * The signature matches zmq_free_fn: the data is the record, the hint is the shared
+ * record itself. This function can be called from any thread.
+ */
+void bxilog__shared_record_release(void * data, void * hint);
+
+#endif
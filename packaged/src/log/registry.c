@@ -13,8 +13,10 @@
 
 
 #include <errno.h>
+#include <stdint.h>
 #include <string.h>
 #include <pthread.h>
+#include <sched.h>
 
 #include "bxi/base/err.h"
 #include "bxi/base/mem.h"
@@ -30,19 +32,46 @@
 //*********************************************************************************
 //********************************** Defines **************************************
 //*********************************************************************************
-#define REGISTERED_LOGGERS_DEFAULT_ARRAY_SIZE 64
+#define REGISTERED_LOGGERS_DEFAULT_TABLE_SIZE 64
+
+// A slot whose logger has been unregistered: lookups must go on
+#define DELETED ((bxilog_logger_p) &DELETED_S)
 
 //*********************************************************************************
 //********************************** Types ****************************************
 //*********************************************************************************
 
+/*
+ * An open-addressing hash table of loggers indexed by name, with linear probing.
+ *
+ * Readers look the table up without any lock: slots are only written under
+ * REGISTER_LOCK, with release stores, and a full table is replaced by a new one.
+ *
+ * Readers might still be walking a replaced table, or comparing the name of an
+ * unregistered logger: each lookup is counted in READERS, by parity of EPOCH, and
+ * writers wait for the lookups in progress (see _synchronize()) before freeing a
+ * table or returning from bxilog_registry_del().
+ */
+typedef struct registry_table_s registry_table_s;
+typedef registry_table_s * registry_table_p;
 
+struct registry_table_s {
+    size_t size;                    // Number of slots (a power of 2)
+    size_t used;                    // Slots not NULL (loggers and DELETED)
+    bxilog_logger_p slots[];
+};
 
 //*********************************************************************************
 //********************************** Static Functions  ****************************
 //*********************************************************************************
 
-static void _sort(void);
+static uint64_t _hash(const char * name);
+static bxilog_logger_p _lookup(const char * name);
+static void _add(bxilog_logger_p logger);
+static void _insert(registry_table_p table, bxilog_logger_p logger);
+static void _grow(void);
+static void _synchronize(void);
+static void _reset_readers(void);
 static int _logger_compar(const void * l1, const void * l2);
 static void _reset_config();
 
@@ -50,21 +79,32 @@ static void _reset_config();
 //********************************** Global Variables  ****************************
 //*********************************************************************************
 
+static struct bxilog_logger_s DELETED_S;
+
 /**
- * Initial number of registered loggers array size
- */
-static size_t REGISTERED_LOGGERS_ARRAY_SIZE = REGISTERED_LOGGERS_DEFAULT_ARRAY_SIZE;
-/**
- * The array of registered loggers.
+ * The table of registered loggers, NULL until the first registration.
  */
-static bxilog_logger_p * REGISTERED_LOGGERS = NULL;
+static registry_table_p REGISTERED_LOGGERS = NULL;
 /**
  * Number of registered loggers.
  */
 static size_t REGISTERED_LOGGERS_NB = 0;
+/**
+ * The last logger identifier given.
+ */
+static size_t REGISTERED_LOGGERS_LAST_ID = 0;
 
 static pthread_mutex_t REGISTER_LOCK = PTHREAD_MUTEX_INITIALIZER;
 
+/**
+ * Lookups in progress, by parity of the epoch they started in.
+ */
+static size_t READERS[2] = { 0, 0 };
+/**
+ * Incremented by writers waiting for the lookups in progress.
+ */
+static size_t EPOCH = 0;
+
 //*********************************************************************************
 //********************************** Implementation    ****************************
 //*********************************************************************************
@@ -75,48 +115,8 @@ void bxilog_registry_add(bxilog_logger_p logger) {
     int rc = pthread_mutex_lock(&REGISTER_LOCK);
     bxiassert(0 == rc);
 
-    if (REGISTERED_LOGGERS == NULL) {
-        size_t bytes = REGISTERED_LOGGERS_ARRAY_SIZE * sizeof(*REGISTERED_LOGGERS);
-        REGISTERED_LOGGERS = bximem_calloc(bytes);
-        int rc = atexit(bxilog__wipeout);
-        bxiassert(0 == rc);
-
-    } else if (REGISTERED_LOGGERS_NB >= REGISTERED_LOGGERS_ARRAY_SIZE) {
-        size_t old_size = REGISTERED_LOGGERS_ARRAY_SIZE;
-        REGISTERED_LOGGERS_ARRAY_SIZE *= 2;
-        size_t bytes = REGISTERED_LOGGERS_ARRAY_SIZE * sizeof(*REGISTERED_LOGGERS);
-        REGISTERED_LOGGERS = bximem_realloc(REGISTERED_LOGGERS,
-                                            old_size * sizeof(*REGISTERED_LOGGERS),
-                                            bytes);
-
-        DBG("[I] Reallocation of %zu slots for (currently) "
-            "%zu registered loggers\n",
-            REGISTERED_LOGGERS_ARRAY_SIZE,
-            REGISTERED_LOGGERS_NB);
-    }
+    _add(logger);
 
-    size_t slot = REGISTERED_LOGGERS_NB;
-    for (size_t i = 0; i < REGISTERED_LOGGERS_ARRAY_SIZE; i++) {
-        // Find next free slot
-        if (NULL == REGISTERED_LOGGERS[i]) {
-            if (slot == REGISTERED_LOGGERS_NB) slot = i;
-
-        } else if (0 == strncmp(REGISTERED_LOGGERS[i]->name,
-                                logger->name,
-                                logger->name_length)) {
-            // TODO: provide something better here!
-            fprintf(stderr,
-                    "[W] Logger name '%s' already registered at position %zu, "
-                    "this can lead to various problems such as wrong logging level "
-                    "configuration or misleading messages!\n",
-                    logger->name, i);
-        }
-    }
-    DBG("Registering new logger[%zu]: %s\n", slot, logger->name);
-    REGISTERED_LOGGERS[slot] = logger;
-    REGISTERED_LOGGERS_NB++;
-    _sort();
-    bxilog_logger_reconfigure(logger);
     rc = pthread_mutex_unlock(&REGISTER_LOCK);
     bxiassert(0 == rc);
 }
@@ -125,68 +125,51 @@ void bxilog_registry_del(bxilog_logger_p logger) {
     bxiassert(logger != NULL);
     int rc = pthread_mutex_lock(&REGISTER_LOCK);
     bxiassert(0 == rc);
-    bool found = false;
     DBG("Nb Registered loggers: %zu\n", REGISTERED_LOGGERS_NB);
-    for (size_t i = 0; i < REGISTERED_LOGGERS_ARRAY_SIZE; i++) {
-        bxilog_logger_p current = REGISTERED_LOGGERS[i];
-        if (NULL == current) continue;
-        DBG("Logger[%zu]: %s\n", i, current->name);
-        if (current == logger) {
-         DBG("Unregistering loggers[%zu]: %s\n", i, current->name);
-            REGISTERED_LOGGERS[i] = NULL;
-            found = true;
+
+    registry_table_p table = REGISTERED_LOGGERS;
+    if (NULL != table) {
+        const size_t mask = table->size - 1;
+        for (size_t i = _hash(logger->name) & mask; NULL != table->slots[i]; i = (i + 1) & mask) {
+            if (table->slots[i] != logger) continue;
+            DBG("Unregistering loggers[%zu]: %s\n", i, logger->name);
+            // The slot remains used so lookups of colliding names go on
+            __atomic_store_n(&table->slots[i], DELETED, __ATOMIC_RELEASE);
+            REGISTERED_LOGGERS_NB--;
+            // The logger may go away once returned (e.g. with its library)
+            _synchronize();
+            break;
         }
     }
-    if (!found) {
-//        bxierr_p bxierr = bxierr_gen("[W] Can't find registered logger: %s\n",
-//                                     logger->name);
-//        char * str = NULL;
-//        if (err->str != NULL) {
-//            err_str = err->str(err);
-//        } else {
-//            err_str = bxierr_str(err);
-//        }
-//        _display_err_msg(str);
-//        BXIFREE(str);
-    } else REGISTERED_LOGGERS_NB--;
-
-    if (0 == REGISTERED_LOGGERS_NB) {
-        BXIFREE(REGISTERED_LOGGERS);
-    } else {
-        _sort();
-    }
+
     rc = pthread_mutex_unlock(&REGISTER_LOCK);
     bxiassert(0 == rc);
 }
 
 
 bxierr_p bxilog_registry_get(const char * logger_name, bxilog_logger_p * result) {
-    *result = NULL;
+    // Most of the time, the logger already exists: no lock is required
+    *result = _lookup(logger_name);
+    if (NULL != *result) return BXIERR_OK;
 
     int rc = pthread_mutex_lock(&REGISTER_LOCK);
     if (0 != rc) return bxierr_errno("Call to pthread_mutex_lock() failed (rc=%d)", rc);
 
-    for (size_t i = 0; i < REGISTERED_LOGGERS_ARRAY_SIZE; i++) {
-        bxilog_logger_p logger = REGISTERED_LOGGERS[i];
-        if (NULL == logger) continue;
-        if (strncmp(logger->name, logger_name, logger->name_length) == 0) {
-            *result = logger;
-            break;
-        }
-    }
-
-    rc = pthread_mutex_unlock(&REGISTER_LOCK);
-    if (0 != rc) return bxierr_errno("Call to pthread_mutex_unlock() failed (rc=%d)", rc);
-
+    // It might have been created concurrently
+    *result = _lookup(logger_name);
     if (NULL == *result) { // Not found
         bxilog_logger_p self = bximem_calloc(sizeof(*self));
         self->allocated = true;
         self->name = strdup(logger_name);
         self->name_length = strlen(logger_name) + 1;
         self->level = BXILOG_LOWEST;
-        bxilog_registry_add(self);
+        _add(self);
         *result = self;
     }
+
+    rc = pthread_mutex_unlock(&REGISTER_LOCK);
+    if (0 != rc) return bxierr_errno("Call to pthread_mutex_unlock() failed (rc=%d)", rc);
+
     DBG("Returning %s %d\n", (*result)->name, (*result)->level);
     return BXIERR_OK;
 }
@@ -198,12 +181,16 @@ size_t bxilog_registry_getall(bxilog_logger_p *loggers[]) {
     bxiassert(0 == rc);
     bxilog_logger_p * result = bximem_calloc(REGISTERED_LOGGERS_NB * sizeof(*result));
     size_t j = 0;
-    for (size_t i = 0; i < REGISTERED_LOGGERS_ARRAY_SIZE; i++) {
-        if (NULL == REGISTERED_LOGGERS[i]) continue;
-        result[j++] = REGISTERED_LOGGERS[i];
+    registry_table_p table = REGISTERED_LOGGERS;
+    for (size_t i = 0; NULL != table && i < table->size; i++) {
+        if (NULL == table->slots[i] || DELETED == table->slots[i]) continue;
+        result[j++] = table->slots[i];
     }
     rc = pthread_mutex_unlock(&REGISTER_LOCK);
     bxiassert(0 == rc);
+
+    // Sorted by name
+    qsort(result, j, sizeof(*result), _logger_compar);
     *loggers = result;
     return j;
 }
@@ -218,34 +205,161 @@ void bxilog_registry_reset() {
 }
 
 
+void bxilog__registry_reconfigure(void) {
+    int rc = pthread_mutex_lock(&REGISTER_LOCK);
+    bxiassert(0 == rc);
+
+    registry_table_p table = REGISTERED_LOGGERS;
+    for (size_t i = 0; NULL != table && i < table->size; i++) {
+        if (NULL == table->slots[i] || DELETED == table->slots[i]) continue;
+        bxilog_logger_reconfigure(table->slots[i]);
+    }
+
+    rc = pthread_mutex_unlock(&REGISTER_LOCK);
+    bxiassert(0 == rc);
+}
+
+
 void bxilog__cfg_release_loggers() {
-    if (NULL != REGISTERED_LOGGERS) {
-        DBG("Nb Registered loggers: %zu\n", REGISTERED_LOGGERS_NB);
-        for (size_t i = 0; i < REGISTERED_LOGGERS_ARRAY_SIZE; i++) {
-            if (NULL == REGISTERED_LOGGERS[i]) {
-                continue;
-            }
-            DBG("loggers[%zu]: %s\n", i, REGISTERED_LOGGERS[i]->name);
-            if (REGISTERED_LOGGERS[i]->allocated) {
-                DBG("[I] Destroying %s\n", REGISTERED_LOGGERS[i]->name);
-                bxilog_logger_destroy(&REGISTERED_LOGGERS[i]);
-            }
-            REGISTERED_LOGGERS[i] = NULL;
-            REGISTERED_LOGGERS_NB--;
+    registry_table_p table = REGISTERED_LOGGERS;
+    if (NULL == table) return;
+
+    DBG("Nb Registered loggers: %zu\n", REGISTERED_LOGGERS_NB);
+    __atomic_store_n(&REGISTERED_LOGGERS, NULL, __ATOMIC_SEQ_CST);
+    _synchronize();
+    for (size_t i = 0; i < table->size; i++) {
+        if (NULL == table->slots[i] || DELETED == table->slots[i]) continue;
+        DBG("loggers[%zu]: %s\n", i, table->slots[i]->name);
+        if (table->slots[i]->allocated) {
+            DBG("[I] Destroying %s\n", table->slots[i]->name);
+            bxilog_logger_destroy(&table->slots[i]);
         }
-        bxiassert(0 == REGISTERED_LOGGERS_NB);
-        DBG("[I] Removing registered loggers\n");
-        BXIFREE(REGISTERED_LOGGERS);
-        REGISTERED_LOGGERS_ARRAY_SIZE = 0;
+        REGISTERED_LOGGERS_NB--;
     }
+    bxiassert(0 == REGISTERED_LOGGERS_NB);
+    DBG("[I] Removing registered loggers\n");
+    BXIFREE(table);
 }
 
 //*********************************************************************************
 //********************************** Static Helpers Implementation ****************
 //*********************************************************************************
-void _sort(void) {
-    qsort(REGISTERED_LOGGERS, REGISTERED_LOGGERS_ARRAY_SIZE, sizeof(*REGISTERED_LOGGERS),
-          _logger_compar);
+uint64_t _hash(const char * name) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const unsigned char * c = (const unsigned char *) name; '\0' != *c; c++) {
+        hash ^= *c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bxilog_logger_p _lookup(const char * name) {
+    // Counted before the table is read: see _synchronize()
+    size_t * readers = &READERS[__atomic_load_n(&EPOCH, __ATOMIC_SEQ_CST) & 1];
+    __atomic_fetch_add(readers, 1, __ATOMIC_SEQ_CST);
+
+    bxilog_logger_p result = NULL;
+    registry_table_p table = __atomic_load_n(&REGISTERED_LOGGERS, __ATOMIC_SEQ_CST);
+    const size_t mask = (NULL == table) ? 0 : table->size - 1;
+    for (size_t i = _hash(name) & mask; NULL != table; i = (i + 1) & mask) {
+        bxilog_logger_p logger = __atomic_load_n(&table->slots[i], __ATOMIC_ACQUIRE);
+        if (NULL == logger) break;
+        if (DELETED == logger) continue;
+        if (0 == strcmp(logger->name, name)) {
+            result = logger;
+            break;
+        }
+    }
+
+    __atomic_fetch_sub(readers, 1, __ATOMIC_RELEASE);
+    return result;
+}
+
+void _add(bxilog_logger_p logger) {
+    bxilog_logger_p other = _lookup(logger->name);
+    if (NULL != other && other != logger) {
+        // TODO: provide something better here!
+        fprintf(stderr,
+                "[W] Logger name '%s' already registered, "
+                "this can lead to various problems such as wrong logging level "
+                "configuration or misleading messages!\n",
+                logger->name);
+    }
+
+    // Keep at least half of the slots free so probing sequences remain short
+    if (NULL == REGISTERED_LOGGERS ||
+        2 * (REGISTERED_LOGGERS->used + 1) > REGISTERED_LOGGERS->size) {
+        _grow();
+    }
+
+    // Handlers cache the level of each logger by identifier: an identifier is never
+    // given to another logger
+    if (0 == logger->id) logger->id = ++REGISTERED_LOGGERS_LAST_ID;
+    DBG("Registering new logger: %s (id: %zu)\n", logger->name, logger->id);
+    _insert(REGISTERED_LOGGERS, logger);
+    REGISTERED_LOGGERS_NB++;
+    bxilog_logger_reconfigure(logger);
+}
+
+void _insert(registry_table_p table, bxilog_logger_p logger) {
+    const size_t mask = table->size - 1;
+    size_t i = _hash(logger->name) & mask;
+    // Slots of unregistered loggers are not reused: they might be part of the
+    // probing sequence of a logger being looked up concurrently
+    while (NULL != table->slots[i]) i = (i + 1) & mask;
+    table->used++;
+    __atomic_store_n(&table->slots[i], logger, __ATOMIC_RELEASE);
+}
+
+void _grow(void) {
+    registry_table_p old = REGISTERED_LOGGERS;
+    if (NULL == old) {
+        int rc = atexit(bxilog__wipeout);
+        bxiassert(0 == rc);
+        // Lookups of other threads never end in the child
+        rc = pthread_atfork(NULL, NULL, _reset_readers);
+        bxiassert(0 == rc);
+    }
+
+    // Unregistered loggers are dropped: the new table might be as large as the old one
+    size_t size = REGISTERED_LOGGERS_DEFAULT_TABLE_SIZE;
+    while (4 * (REGISTERED_LOGGERS_NB + 1) > size) size *= 2;
+
+    registry_table_p table = bximem_calloc(sizeof(*table) + size * sizeof(table->slots[0]));
+    table->size = size;
+    for (size_t i = 0; NULL != old && i < old->size; i++) {
+        if (NULL == old->slots[i] || DELETED == old->slots[i]) continue;
+        _insert(table, old->slots[i]);
+    }
+    DBG("[I] Reallocation of %zu slots for (currently) "
+        "%zu registered loggers\n", size, REGISTERED_LOGGERS_NB);
+
+    __atomic_store_n(&REGISTERED_LOGGERS, table, __ATOMIC_SEQ_CST);
+
+    // Registrations are rare: the old table is freed right away
+    _synchronize();
+    BXIFREE(old);
+}
+
+// Wait for the lookups started before the call: the ones started afterwards see
+// the changes made before.
+//
+// A lookup might have read the epoch long ago: both parities are waited for. The
+// epoch is flipped before each wait so that new lookups are counted in the other
+// parity, and the wait ends.
+void _synchronize(void) {
+    for (size_t k = 0; k < 2; k++) {
+        const size_t epoch = __atomic_fetch_add(&EPOCH, 1, __ATOMIC_SEQ_CST);
+        while (0 != __atomic_load_n(&READERS[epoch & 1], __ATOMIC_SEQ_CST)) {
+            sched_yield();
+        }
+    }
+}
+
+void _reset_readers(void) {
+    READERS[0] = 0;
+    READERS[1] = 0;
 }
 
 int _logger_compar(const void * l1, const void * l2) {
@@ -254,11 +368,6 @@ int _logger_compar(const void * l1, const void * l2) {
 
     if (logger1 == logger2) return 0;
 
-    if (NULL == logger1) return -1; // l2 is different, therefore it is not NULL and greater
-    if (NULL == logger2) return 1; // Reverse case
-
-
-
     return strcmp(logger1->name, logger2->name);
 }
 
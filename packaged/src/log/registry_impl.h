@@ -32,5 +32,8 @@
 
 void bxilog__cfg_release_loggers();
 
+/* Reconfigure all registered loggers, see bxilog_logger_reconfigure() */
+void bxilog__registry_reconfigure(void);
+
 
 #endif
@@ -376,7 +376,6 @@ bxierr_p _process_log(bxilog_record_p record,
     return err;
 }
 
-
 bxierr_p _process_ierr(bxierr_p *err, bxilog_remote_handler_param_p data) {
     UNUSED(err);
     UNUSED(data);
@@ -23,6 +23,8 @@
 
 #include "tsd_impl.h"
 #include "log_impl.h"
+#include "handler_impl.h"
+#include "record_impl.h"
 
 
 SET_LOGGER(LOGGER, BXILOG_LIB_PREFIX "bxilog.remote");
@@ -593,28 +595,69 @@ bxierr_p _dispatch_log_record(tsd_p tsd, bxilog_record_p record, size_t data_len
 
     bxierr_p err = BXIERR_OK, err2;
 
+    // The logger identifier of another process is meaningless here
+    record->logger_id = 0;
+
     LOWEST(LOGGER,
            "Dispatching the log to all %zu handlers",
-           BXILOG__GLOBALS->internal_handlers_nb);
+           tsd->handlers_nb);
+
+    if (NULL != tsd->rings) {
+        for (size_t i = 0; i < tsd->rings_nb; i++) {
+            bxilog__ring_set_p set = &BXILOG__GLOBALS->ring_sets[i];
+            // Serious records go to the priority ring, if any (see logger.c)
+            bxilog__ring_p ring = (record->level <= set->prio_level &&
+                                   NULL != tsd->prio_rings[i]) ?
+                                        tsd->prio_rings[i] : tsd->rings[i];
+            if (NULL == ring) continue;
+            if (data_len > bxilog__ring_max_len(ring)) {
+                err2 = bxierr_gen("Record of %zu bytes too large for a %zu bytes ring, "
+                                  "it will be lost", data_len, ring->size);
+                BXIERR_CHAIN(err, err2);
+                break;
+            }
+            void * slot = bxilog__ring_reserve(set, ring, data_len, record->level);
+            if (NULL == slot) continue;
+            memcpy(slot, record, data_len);
+            bxilog__ring_commit(set, ring);
+        }
+        return err;
+    }
 
-    for (size_t i = 0; i < BXILOG__GLOBALS->internal_handlers_nb; i++) {
+    const size_t handlers_nb = tsd->handlers_nb;
+    size_t targets_nb = 0;
+    for (size_t i = 0; i < handlers_nb; i++) {
+        if (tsd->connected[i]) targets_nb++;
+    }
+    // Copy the record once for all handlers (see logger.c)
+    bxilog__shared_record_p shared = NULL;
+    if (1 < targets_nb) shared = bxilog__shared_record_new(record, data_len,
+                                                           targets_nb);
+
+    bxilog_handler_param_p * const params = BXILOG__GLOBALS->config->handlers_params;
+    for (size_t i = 0; i < handlers_nb; i++) {
+      if (!tsd->connected[i]) continue;
       // Send the frame
-      // normal version if record comes from the stack 'buf'
-      err2 = bxizmq_data_snd(&i, sizeof(i),
+      const size_t identity = (record->level <= params[i]->prio_level) ?
+                                BXILOG__PRIO_IDENTITY(i) : i;
+      err2 = bxizmq_data_snd(&identity, sizeof(identity),
                              tsd->data_channel, ZMQ_DONTWAIT|ZMQ_SNDMORE,
                              BXILOG_RECEIVER_RETRIES_MAX,
                              BXILOG_RECEIVER_RETRY_DELAY);
       BXIERR_CHAIN(err, err2);
-      err2 = bxizmq_data_snd(record, data_len,
-                             tsd->data_channel, ZMQ_DONTWAIT,
-                             BXILOG_RECEIVER_RETRIES_MAX,
-                             BXILOG_RECEIVER_RETRY_DELAY);
-
-      // Zero-copy version (if record has been mallocated).
-      //            err2 = bxizmq_data_snd_zc(record, data_len,
-      //                                      tsd->data_channel, ZMQ_DONTWAIT,
-      //                                      RETRIES_MAX, RETRY_DELAY,
-      //                                      bxizmq_data_free, NULL);
+      if (NULL == shared) {
+          err2 = bxizmq_data_snd(record, data_len,
+                                 tsd->data_channel, ZMQ_DONTWAIT,
+                                 BXILOG_RECEIVER_RETRIES_MAX,
+                                 BXILOG_RECEIVER_RETRY_DELAY);
+      } else {
+          // The reference is released even if the record has not been sent
+          err2 = bxizmq_data_snd_zc(shared->record, data_len,
+                                    tsd->data_channel, ZMQ_DONTWAIT,
+                                    BXILOG_RECEIVER_RETRIES_MAX,
+                                    BXILOG_RECEIVER_RETRY_DELAY,
+                                    bxilog__shared_record_release, shared);
+      }
       BXIERR_CHAIN(err, err2);
     }
 
@@ -0,0 +1,516 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/mem.h"
+#include "bxi/base/time.h"
+
+#include "ring_impl.h"
+#include "placement_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// Payload length used to tell the consumer the next entry starts at offset 0
+#define WRAP_MARKER SIZE_MAX
+
+#define ENTRY_ALIGN sizeof(size_t)
+
+#define ENTRY_SIZE(len) ((sizeof(size_t) + (len) + ENTRY_ALIGN - 1) & ~(ENTRY_ALIGN - 1))
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Static Functions  ****************************
+//*********************************************************************************
+static void _wakeup(bxilog__ring_set_p set);
+static bool _is_empty(bxilog__ring_p ring);
+static void * _try_reserve(bxilog__ring_p ring, size_t head, size_t len);
+static void * _drop_oldest(bxilog__ring_set_p set, bxilog__ring_p ring,
+                           size_t head, size_t len);
+static void * _take(bxilog__ring_p ring, size_t * len);
+static size_t * _entry_at(bxilog__ring_p ring, size_t pos, size_t * end);
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Implementation    ****************************
+//*********************************************************************************
+
+bxierr_p bxilog__ring_new(size_t size, int numa_node, bxilog__ring_p * result) {
+    bxiassert(NULL != result);
+
+    // Round up to the next power of 2
+    size_t actual_size = 2 * ENTRY_ALIGN;
+    while (actual_size < size) actual_size <<= 1;
+
+    // A placed ring has pages of its own: binding them moves nothing else
+    size_t align = BXILOG__RING_CACHELINE_SIZE;
+    size_t alloc_size = sizeof(bxilog__ring_s) + actual_size;
+    if (0 <= numa_node) {
+        align = (size_t) sysconf(_SC_PAGESIZE);
+        alloc_size = (alloc_size + align - 1) & ~(align - 1);
+    }
+
+    bxilog__ring_p ring = NULL;
+    errno = 0;
+    int rc = posix_memalign((void**) &ring, align, alloc_size);
+    if (0 != rc) {
+        *result = NULL;
+        return bxierr_fromidx(rc, NULL,
+                              "Calling posix_memalign(%zu, %zu) failed",
+                              align, alloc_size);
+    }
+    memset(ring, 0, sizeof(*ring));
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->orphan, false);
+    atomic_init(&ring->taken, 0);
+    ring->drop_oldest = false;
+    ring->size = actual_size;
+    ring->mask = actual_size - 1;
+    ring->prio = false;
+    ring->batched = false;
+    ring->next = NULL;
+    ring->data = (char *) ring + sizeof(*ring);
+
+    // Near the handler thread. A ring misplaced is still usable
+    *result = ring;
+    return bxilog__placement_bind(ring, alloc_size, numa_node);
+}
+
+void bxilog__ring_leave(bxilog__ring_p * ring_p) {
+    bxiassert(NULL != ring_p);
+    bxilog__ring_p ring = *ring_p;
+    if (NULL == ring) return;
+    *ring_p = NULL;
+    // The other side is still there, it will free the ring when leaving
+    if (!atomic_exchange(&ring->orphan, true)) return;
+
+    BXIFREE(ring);
+}
+
+size_t bxilog__ring_max_len(bxilog__ring_p ring) {
+    // Any entry not greater than half the ring can always be written at the end
+    // of the data area or at its beginning once the ring is empty
+    return ring->size / 2 - sizeof(size_t);
+}
+
+void * bxilog__ring_reserve(bxilog__ring_set_p set, bxilog__ring_p ring, size_t len,
+                            bxilog_level_e level) {
+    bxiassert(len <= bxilog__ring_max_len(ring));
+
+    const size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    void * entry = _try_reserve(ring, head, len);
+    if (NULL != entry) return entry;
+
+    if (atomic_load_explicit(&ring->orphan, memory_order_acquire)) return NULL;
+
+    bool drop = false;
+    switch (ring->prio ? set->prio_overflow_policy : set->overflow_policy) {
+        case BXILOG_OVERFLOW_DROP_NEWEST:
+            drop = true;
+            break;
+        case BXILOG_OVERFLOW_DROP_BELOW_LEVEL:
+            drop = level > set->overflow_level;
+            break;
+        case BXILOG_OVERFLOW_DROP_OLDEST:
+            entry = _drop_oldest(set, ring, head, len);
+            if (NULL != entry) return entry;
+            // The consumer holds the pending entries: dropping them makes no room
+            drop = true;
+            break;
+        case BXILOG_OVERFLOW_BLOCK:
+        default:
+            break;
+    }
+    if (drop) {
+        atomic_fetch_add_explicit(&set->dropped, 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    while (true) {
+        // Full: the consumer must be running otherwise we wait forever
+        if (atomic_load_explicit(&ring->orphan, memory_order_acquire)) return NULL;
+        _wakeup(set);
+        bxierr_p err = bxitime_sleep(CLOCK_MONOTONIC, 0, BXILOG__RING_RETRY_DELAY);
+        if (bxierr_isko(err)) bxierr_report(&err, STDERR_FILENO);
+
+        entry = _try_reserve(ring, head, len);
+        if (NULL != entry) return entry;
+    }
+}
+
+void bxilog__ring_shrink(bxilog__ring_p ring, size_t len) {
+    bxiassert(NULL != ring->prod_entry);
+    bxiassert(len <= *ring->prod_entry);
+
+    // The entry stays where it is: only its end moves back
+    ring->prod_head -= ENTRY_SIZE(*ring->prod_entry) - ENTRY_SIZE(len);
+    *ring->prod_entry = len;
+}
+
+void bxilog__ring_commit(bxilog__ring_set_p set, bxilog__ring_p ring) {
+    atomic_store_explicit(&ring->head, ring->prod_head, memory_order_release);
+    // The consumer drains priority rings between the other ones
+    if (ring->prio) atomic_store_explicit(&set->prio_pending, true, memory_order_release);
+
+    // Pairs with the fence in bxilog__ring_set_wait(): either the consumer sees
+    // our entry before sleeping, or we see it is waiting and we wake it up.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&set->waiting, memory_order_relaxed)) _wakeup(set);
+}
+
+void * bxilog__ring_peek(bxilog__ring_p ring, size_t * len) {
+    bxiassert(NULL != len);
+
+    if (ring->drop_oldest) return _take(ring, len);
+
+    // Entries already returned but not consumed yet are skipped
+    const size_t tail = ring->cons_tail;
+    if (tail == ring->cons_head) {
+        ring->cons_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail == ring->cons_head) return NULL;
+    }
+
+    size_t * entry = _entry_at(ring, tail, &ring->cons_tail);
+    *len = *entry;
+
+    return entry + 1;
+}
+
+void bxilog__ring_consume(bxilog__ring_p ring) {
+    if (!ring->drop_oldest) {
+        atomic_store_explicit(&ring->tail, ring->cons_tail, memory_order_release);
+        return;
+    }
+    // Entries dropped by the producer after the ones taken are released as well
+    const size_t taken = atomic_load_explicit(&ring->taken, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    while (tail < taken &&
+           !atomic_compare_exchange_weak_explicit(&ring->tail, &tail, taken,
+                                                  memory_order_release,
+                                                  memory_order_relaxed)) {
+        continue;
+    }
+}
+
+bxierr_p bxilog__ring_set_init(bxilog__ring_set_p set) {
+    bxiassert(NULL != set);
+
+    int rc = pthread_mutex_init(&set->lock, NULL);
+    if (0 != rc) return bxierr_fromidx(rc, NULL,
+                                       "Calling pthread_mutex_init() failed (rc=%d)",
+                                       rc);
+    atomic_init(&set->head, NULL);
+    atomic_init(&set->prio_head, NULL);
+    atomic_init(&set->prio_pending, false);
+    atomic_init(&set->waiting, false);
+    atomic_init(&set->dropped, 0);
+    set->placement_err = BXIERR_OK;
+    set->misplaced = 0;
+    set->overflow_policy = BXILOG_OVERFLOW_BLOCK;
+    set->overflow_level = BXILOG_LOWEST;
+    set->prio_level = BXILOG_OFF;
+    set->prio_overflow_policy = BXILOG_OVERFLOW_BLOCK;
+    set->closed = false;
+
+    errno = 0;
+    set->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (-1 == set->wakeup_fd) return bxierr_errno("Calling eventfd() failed");
+
+    return BXIERR_OK;
+}
+
+bxierr_p bxilog__ring_set_destroy(bxilog__ring_set_p set) {
+    bxiassert(NULL != set);
+    bxierr_p err = BXIERR_OK, err2;
+
+    // Rings might remain when the handler thread has not been started at all
+    bxilog__ring_set_close(set);
+
+    errno = 0;
+    if (-1 != set->wakeup_fd && 0 != close(set->wakeup_fd)) {
+        err2 = bxierr_errno("Calling close(%d) failed", set->wakeup_fd);
+        BXIERR_CHAIN(err, err2);
+    }
+    set->wakeup_fd = -1;
+
+    bxierr_destroy(&set->placement_err);
+
+    int rc = pthread_mutex_destroy(&set->lock);
+    if (0 != rc) {
+        err2 = bxierr_fromidx(rc, NULL,
+                              "Calling pthread_mutex_destroy() failed (rc=%d)", rc);
+        BXIERR_CHAIN(err, err2);
+    }
+
+    return err;
+}
+
+void bxilog__ring_set_add(bxilog__ring_set_p set, bxilog__ring_p ring) {
+    int rc = pthread_mutex_lock(&set->lock);
+    bxiassert(0 == rc);
+
+    if (set->closed) {
+        // Nobody will ever drain this ring
+        atomic_store(&ring->orphan, true);
+    } else {
+        _Atomic(bxilog__ring_p) * head = ring->prio ? &set->prio_head : &set->head;
+        const bxilog_overflow_policy_e policy = ring->prio ?
+                                                    set->prio_overflow_policy :
+                                                    set->overflow_policy;
+        ring->drop_oldest = BXILOG_OVERFLOW_DROP_OLDEST == policy;
+        ring->next = atomic_load_explicit(head, memory_order_relaxed);
+        atomic_store_explicit(head, ring, memory_order_release);
+    }
+
+    rc = pthread_mutex_unlock(&set->lock);
+    bxiassert(0 == rc);
+}
+
+void bxilog__ring_set_misplaced(bxilog__ring_set_p set, bxierr_p * err) {
+    bxiassert(NULL != err);
+    if (bxierr_isok(*err)) return;
+
+    int rc = pthread_mutex_lock(&set->lock);
+    bxiassert(0 == rc);
+
+    set->misplaced++;
+    if (bxierr_isok(set->placement_err)) {
+        set->placement_err = *err;
+        *err = BXIERR_OK;
+    }
+
+    rc = pthread_mutex_unlock(&set->lock);
+    bxiassert(0 == rc);
+    bxierr_destroy(err);
+}
+
+bxierr_p bxilog__ring_set_take_misplaced(bxilog__ring_set_p set) {
+    int rc = pthread_mutex_lock(&set->lock);
+    bxiassert(0 == rc);
+
+    bxierr_p err = set->placement_err;
+    const size_t misplaced = set->misplaced;
+    set->placement_err = BXIERR_OK;
+    set->misplaced = 0;
+
+    rc = pthread_mutex_unlock(&set->lock);
+    bxiassert(0 == rc);
+
+    if (1 < misplaced) {
+        bxierr_p err2 = bxierr_gen("%zu rings could not be placed on their NUMA node, "
+                                   "only the first error is given",
+                                   misplaced);
+        BXIERR_CHAIN(err, err2);
+    }
+    return err;
+}
+
+void bxilog__ring_set_remove(bxilog__ring_set_p set,
+                             bxilog__ring_p prev, bxilog__ring_p ring) {
+    int rc = pthread_mutex_lock(&set->lock);
+    bxiassert(0 == rc);
+
+    if (NULL == prev) {
+        // The ring was the head when the walk started, but producers might have
+        // pushed new rings since then
+        _Atomic(bxilog__ring_p) * head = ring->prio ? &set->prio_head : &set->head;
+        bxilog__ring_p current = atomic_load_explicit(head, memory_order_relaxed);
+        if (current == ring) {
+            atomic_store_explicit(head, ring->next, memory_order_release);
+        } else {
+            while (current->next != ring) current = current->next;
+            current->next = ring->next;
+        }
+    } else {
+        prev->next = ring->next;
+    }
+
+    rc = pthread_mutex_unlock(&set->lock);
+    bxiassert(0 == rc);
+}
+
+void bxilog__ring_set_close(bxilog__ring_set_p set) {
+    int rc = pthread_mutex_lock(&set->lock);
+    bxiassert(0 == rc);
+
+    set->closed = true;
+    _Atomic(bxilog__ring_p) * heads[] = {&set->head, &set->prio_head};
+    for (size_t i = 0; i < ARRAYLEN(heads); i++) {
+        bxilog__ring_p ring = atomic_load_explicit(heads[i], memory_order_relaxed);
+        atomic_store_explicit(heads[i], NULL, memory_order_release);
+        while (NULL != ring) {
+            bxilog__ring_p next = ring->next;
+            bxilog__ring_leave(&ring);
+            ring = next;
+        }
+    }
+
+    rc = pthread_mutex_unlock(&set->lock);
+    bxiassert(0 == rc);
+}
+
+bool bxilog__ring_set_wait(bxilog__ring_set_p set) {
+    atomic_store_explicit(&set->waiting, true, memory_order_relaxed);
+    // Pairs with the fence in bxilog__ring_commit()
+    atomic_thread_fence(memory_order_seq_cst);
+
+    _Atomic(bxilog__ring_p) * heads[] = {&set->prio_head, &set->head};
+    for (size_t i = 0; i < ARRAYLEN(heads); i++) {
+        for (bxilog__ring_p ring = atomic_load_explicit(heads[i], memory_order_acquire);
+             NULL != ring;
+             ring = ring->next) {
+            if (!_is_empty(ring)) {
+                atomic_store_explicit(&set->waiting, false, memory_order_relaxed);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool bxilog__ring_set_prio_pending(bxilog__ring_set_p set) {
+    // Cheap when nothing is pending: it is checked before draining each ring
+    if (!atomic_load_explicit(&set->prio_pending, memory_order_relaxed)) return false;
+    return atomic_exchange_explicit(&set->prio_pending, false, memory_order_acquire);
+}
+
+void bxilog__ring_set_awake(bxilog__ring_set_p set) {
+    atomic_store_explicit(&set->waiting, false, memory_order_relaxed);
+    uint64_t counter;
+    // Reset the eventfd counter, EAGAIN just means someone else did it
+    ssize_t n = read(set->wakeup_fd, &counter, sizeof(counter));
+    UNUSED(n);
+}
+
+//*********************************************************************************
+//********************************** Static Helpers Implementation ****************
+//*********************************************************************************
+
+void _wakeup(bxilog__ring_set_p set) {
+    // Only the first producer noticing the consumer is waiting pays the syscall
+    if (!atomic_exchange(&set->waiting, false)) return;
+    uint64_t one = 1;
+    ssize_t n = write(set->wakeup_fd, &one, sizeof(one));
+    // EAGAIN means the counter is already non-zero: the consumer will wake up anyway
+    UNUSED(n);
+}
+
+void * _try_reserve(bxilog__ring_p ring, const size_t head, const size_t len) {
+    const size_t entry_size = ENTRY_SIZE(len);
+    const size_t offset = head & ring->mask;
+    const size_t contiguous = ring->size - offset;
+    // When the entry does not fit before the end of the data area,
+    // the remaining bytes are lost and the entry starts at offset 0.
+    const size_t needed = (entry_size > contiguous) ?
+                            contiguous + entry_size :
+                            entry_size;
+
+    if (head + needed - ring->prod_tail > ring->size) {
+        // Refresh our copy of the tail: the consumer might have made some room
+        ring->prod_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head + needed - ring->prod_tail > ring->size) return NULL;
+    }
+
+    char * start = ring->data + offset;
+    if (entry_size > contiguous) {
+        *(size_t *) start = WRAP_MARKER;
+        start = ring->data;
+    }
+    *(size_t *) start = len;
+    ring->prod_entry = (size_t *) start;
+    ring->prod_head = head + needed;
+    return start + sizeof(size_t);
+}
+
+bool _is_empty(bxilog__ring_p ring) {
+    return atomic_load_explicit(&ring->head, memory_order_acquire) == \
+            atomic_load_explicit(&ring->tail, memory_order_relaxed);
+}
+
+// Drop the oldest entries not taken by the consumer until len bytes can be reserved.
+// Return NULL if the consumer holds some entries: they are released only once it
+// has processed them, dropping the following ones would make no room.
+void * _drop_oldest(bxilog__ring_set_p set, bxilog__ring_p ring,
+                    const size_t head, const size_t len) {
+    while (true) {
+        size_t taken = atomic_load_explicit(&ring->taken, memory_order_acquire);
+        if (taken != atomic_load_explicit(&ring->tail, memory_order_acquire)) return NULL;
+        // Empty: room is made by the consumer consuming what it has taken
+        if (taken == head) return NULL;
+
+        size_t end;
+        _entry_at(ring, taken, &end);
+        // The consumer has taken it meanwhile
+        if (!atomic_compare_exchange_strong_explicit(&ring->taken, &taken, end,
+                                                     memory_order_acq_rel,
+                                                     memory_order_acquire)) {
+            continue;
+        }
+        atomic_fetch_add_explicit(&set->dropped, 1, memory_order_relaxed);
+        // Fails only if the consumer has released it already
+        size_t tail = taken;
+        atomic_compare_exchange_strong_explicit(&ring->tail, &tail, end,
+                                                memory_order_release,
+                                                memory_order_relaxed);
+
+        void * entry = _try_reserve(ring, head, len);
+        if (NULL != entry) return entry;
+    }
+}
+
+// Take the oldest entry, unless the producer drops it first
+void * _take(bxilog__ring_p ring, size_t * len) {
+    size_t taken = atomic_load_explicit(&ring->taken, memory_order_acquire);
+    while (true) {
+        if (taken == atomic_load_explicit(&ring->head, memory_order_acquire)) return NULL;
+
+        // Read before being taken: meaningless if the producer has dropped the entry
+        // and written a new one in its place, but then the CAS fails
+        size_t end;
+        const size_t * entry = _entry_at(ring, taken, &end);
+        const size_t entry_len = *entry;
+        if (atomic_compare_exchange_weak_explicit(&ring->taken, &taken, end,
+                                                  memory_order_acq_rel,
+                                                  memory_order_acquire)) {
+            *len = entry_len;
+            return (void *) (entry + 1);
+        }
+    }
+}
+
+// Return the header of the entry published at the given position and set the
+// position of the next one
+size_t * _entry_at(bxilog__ring_p ring, size_t pos, size_t * end) {
+    char * start = ring->data + (pos & ring->mask);
+    if (WRAP_MARKER == *(size_t *) start) {
+        pos += ring->size - (pos & ring->mask);
+        start = ring->data;
+    }
+    *end = pos + ENTRY_SIZE(*(size_t *) start);
+    return (size_t *) start;
+}
@@ -0,0 +1,224 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#ifndef BXILOG_RING_IMPL_H
+#define BXILOG_RING_IMPL_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/log/handler.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// Avoid false sharing between the producer and the consumer
+#define BXILOG__RING_CACHELINE_SIZE 64
+
+// Used when a ring is full, we sleep for that amount of time (in ns) after having
+// woken up the handler.
+#define BXILOG__RING_RETRY_DELAY 50000l
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+/*
+ * A bounded single-producer/single-consumer ring of variable-size entries.
+ *
+ * The producer is a business code thread, the consumer is a handler thread.
+ * Each entry is made of a size_t header holding the payload length followed by the
+ * payload itself, padded so the next header is aligned.
+ *
+ * head and tail are byte counters that only grow: (head - tail) is the number of
+ * bytes currently in use, and (counter & mask) is the offset in the data area.
+ *
+ * With the drop-oldest policy, a full producer drops the oldest entries itself: the
+ * consumer and the producer take entries from the same counter (taken), and the
+ * producer moves tail only when the consumer holds no entry (tail == taken).
+ */
+typedef struct bxilog__ring_s bxilog__ring_s;
+typedef bxilog__ring_s * bxilog__ring_p;
+
+struct bxilog__ring_s {
+    // Producer side
+    _Alignas(BXILOG__RING_CACHELINE_SIZE)
+    atomic_size_t head;             // Published head, read by the consumer
+    size_t prod_head;               // Head once the pending entry is committed
+    size_t prod_tail;               // Producer copy of tail (refreshed when needed)
+    size_t * prod_entry;            // Header of the pending entry
+
+    // Consumer side
+    _Alignas(BXILOG__RING_CACHELINE_SIZE)
+    atomic_size_t tail;             // Published tail, read by the producer
+    size_t cons_tail;               // Tail once the entries returned are consumed
+    size_t cons_head;               // Consumer copy of head (refreshed when needed)
+    bool batched;                   // Entries peeked are still referenced by the
+                                    // batch of the handler thread: not consumed yet
+
+    // Shared, mostly read-only
+    _Alignas(BXILOG__RING_CACHELINE_SIZE)
+    atomic_bool orphan;             // Set by the first side leaving the ring
+    atomic_size_t taken;            // End of the entries taken so far, by the
+                                    // consumer (peek) or by the producer (drop),
+                                    // with a CAS (drop-oldest policy only)
+    bool drop_oldest;               // Whether the drop-oldest policy applies
+    bool prio;                      // In the priority list of the ring set
+    size_t size;                    // Size of the data area (a power of 2)
+    size_t mask;                    // size - 1
+    bxilog__ring_p next;            // Next ring in the handler ring set
+    char * data;                    // The data area
+};
+
+/*
+ * The set of rings drained by a given handler thread: one per producing thread,
+ * and a second one per producing thread for records of the priority queue
+ * (see bxilog_handler_param_s.prio_level).
+ *
+ * Rings are pushed by producers (when they create their thread-specific data)
+ * and removed by the handler thread only, both under the lock. The handler thread
+ * walks the lists without the lock.
+ */
+typedef struct {
+    pthread_mutex_t lock;           // Serializes additions and removals
+    _Atomic(bxilog__ring_p) head;   // The rings list
+    _Atomic(bxilog__ring_p) prio_head;  // The priority rings list
+    atomic_bool prio_pending;       // Set when a record is committed in a
+                                    // priority ring
+    bxilog_level_e prio_level;      // Records at least as important go to the
+                                    // priority rings
+    bxilog_overflow_policy_e prio_overflow_policy;  // Policy of the priority rings
+    bool closed;                    // Set when the handler thread has left
+    atomic_bool waiting;            // Set when the handler is about to sleep
+    bxilog_overflow_policy_e overflow_policy;   // What to do when a ring is full
+    bxilog_level_e overflow_level;  // Records less important are dropped
+                                    // (drop-below-level policy)
+    atomic_size_t dropped;          // Records dropped since the last report
+    bxierr_p placement_err;         // First ring placement error since the last
+                                    // report (under the lock)
+    size_t misplaced;               // Rings not placed since the last report
+                                    // (under the lock)
+    int wakeup_fd;                  // eventfd polled by the handler thread
+} bxilog__ring_set_s;
+
+typedef bxilog__ring_set_s * bxilog__ring_set_p;
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interface         ****************************
+//*********************************************************************************
+
+/*
+ * Create a new ring of (at least) the given size in bytes, placed on the given
+ * NUMA node (if not negative).
+ *
+ * A ring that can't be placed is still returned, usable, along with the error.
+ */
+bxierr_p bxilog__ring_new(size_t size, int numa_node, bxilog__ring_p * result);
+
+/*
+ * Leave the given ring: the first side (producer or consumer) leaving marks it
+ * orphan, the last one frees it.
+ */
+void bxilog__ring_leave(bxilog__ring_p * ring_p);
+
+/* Return the maximum payload length an entry can have in the given ring */
+size_t bxilog__ring_max_len(bxilog__ring_p ring);
+
+/*
+ * Producer: reserve len bytes in the ring for a record of the given level.
+ *
+ * When the ring is full, the overflow policy of the set applies: the producer
+ * either waits for the consumer or some records are dropped (and counted), the
+ * oldest ones or the one being produced.
+ * Return NULL if the record is dropped or if the consumer has left the ring.
+ */
+void * bxilog__ring_reserve(bxilog__ring_set_p set, bxilog__ring_p ring, size_t len,
+                            bxilog_level_e level);
+
+/*
+ * Producer: reduce the pending entry to len bytes (not greater than the reserved
+ * length) so the unused end of the reservation is given back to the ring.
+ */
+void bxilog__ring_shrink(bxilog__ring_p ring, size_t len);
+
+/* Producer: publish the entry previously reserved and wake up the consumer if needed */
+void bxilog__ring_commit(bxilog__ring_set_p set, bxilog__ring_p ring);
+
+/*
+ * Consumer: return the entry following the last one returned and its length,
+ * NULL if there is none.
+ *
+ * Entries remain valid until they are consumed, several of them can be processed
+ * at once.
+ */
+void * bxilog__ring_peek(bxilog__ring_p ring, size_t * len);
+
+/* Consumer: release all the entries returned by bxilog__ring_peek() so far */
+void bxilog__ring_consume(bxilog__ring_p ring);
+
+/* Initialize the given ring set */
+bxierr_p bxilog__ring_set_init(bxilog__ring_set_p set);
+
+/* Destroy the given ring set: no thread must use it anymore */
+bxierr_p bxilog__ring_set_destroy(bxilog__ring_set_p set);
+
+/* Producer: add the given ring to the set */
+void bxilog__ring_set_add(bxilog__ring_set_p set, bxilog__ring_p ring);
+
+/*
+ * Producer: keep the given placement error of one of its rings (see
+ * bxilog__ring_new()) until the handler thread reports it. Only the first one is
+ * kept, the others are counted.
+ */
+void bxilog__ring_set_misplaced(bxilog__ring_set_p set, bxierr_p * err);
+
+/*
+ * Handler thread: return the placement errors kept since the last call.
+ */
+bxierr_p bxilog__ring_set_take_misplaced(bxilog__ring_set_p set);
+
+/*
+ * Consumer: remove the given ring from the set, prev is its predecessor (or NULL)
+ * in the list the ring belongs to.
+ */
+void bxilog__ring_set_remove(bxilog__ring_set_p set,
+                             bxilog__ring_p prev, bxilog__ring_p ring);
+
+/*
+ * Consumer: return true if a record has been committed in a priority ring since
+ * the last call.
+ */
+bool bxilog__ring_set_prio_pending(bxilog__ring_set_p set);
+
+/* Consumer: leave all rings of the set, producers will drop their records */
+void bxilog__ring_set_close(bxilog__ring_set_p set);
+
+/*
+ * Consumer: arm the wakeup before sleeping.
+ *
+ * Return false if some records are pending: the consumer must not sleep.
+ */
+bool bxilog__ring_set_wait(bxilog__ring_set_p set);
+
+/* Consumer: acknowledge a wakeup */
+void bxilog__ring_set_awake(bxilog__ring_set_p set);
+
+#endif
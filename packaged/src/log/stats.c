@@ -0,0 +1,339 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/mem.h"
+
+#include "stats_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+#define ENTRIES_INITIAL_SIZE 16
+
+_Static_assert(BXILOG_STATS_LEVELS_NB == BXILOG_LOWEST + 1,
+               "BXILOG_STATS_LEVELS_NB does not match the number of levels");
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Static Functions  ****************************
+//*********************************************************************************
+
+static bxilog__stats_entry_p _lookup(bxilog__stats_p stats, bxilog_logger_p logger);
+static bxilog__stats_entry_p _insert(bxilog__stats_p stats, bxilog_logger_p logger);
+static bxilog__stats_entry_p _slot(bxilog__stats_entry_p entries, size_t size,
+                                   bxilog_logger_p logger);
+static void _add(size_t * counter, size_t n);
+static size_t _merge(bxilog_logger_stats_p loggers, size_t nb);
+static int _name_compar(const void * a, const void * b);
+static void _lock(void);
+static void _unlock(void);
+static void __stats_init__(void);
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+// Protects everything below and the tables of all living threads
+static pthread_mutex_t STATS_LOCK = PTHREAD_MUTEX_INITIALIZER;
+
+// The statistics of living threads
+static bxilog__stats_p LIVING = NULL;
+
+// The statistics of exited threads, loggers are sorted by name
+static size_t FOLDED_THREADS_NB = 0;
+static size_t FOLDED_RSZ_LOG_NB = 0;
+static size_t FOLDED_MAX_LOG_SIZE = 0;
+static size_t FOLDED_MIN_LOG_SIZE = SIZE_MAX;
+static bxilog_logger_stats_p FOLDED_LOGGERS = NULL;
+static size_t FOLDED_LOGGERS_NB = 0;
+
+//*********************************************************************************
+//********************************** Implementation    ****************************
+//*********************************************************************************
+
+bxierr_p bxilog_stats_get(bxilog_stats_p * const result) {
+    bxiassert(NULL != result);
+
+    bxilog_stats_p stats = bximem_calloc(sizeof(*stats));
+
+    _lock();
+    size_t nb = FOLDED_LOGGERS_NB;
+    for (bxilog__stats_p thread = LIVING; NULL != thread; thread = thread->next) {
+        nb += thread->entries_nb;
+    }
+    bxilog_logger_stats_p loggers = bximem_calloc((nb + 1) * sizeof(*loggers));
+
+    // Names are copied: the thread owning them might exit once the lock is released
+    size_t n = 0;
+    for (size_t i = 0; i < FOLDED_LOGGERS_NB; i++, n++) {
+        loggers[n] = FOLDED_LOGGERS[i];
+        loggers[n].name = strdup(FOLDED_LOGGERS[i].name);
+    }
+    stats->threads_nb = FOLDED_THREADS_NB;
+    stats->rsz_log_nb = FOLDED_RSZ_LOG_NB;
+    stats->max_log_size = FOLDED_MAX_LOG_SIZE;
+    stats->min_log_size = FOLDED_MIN_LOG_SIZE;
+
+    for (bxilog__stats_p thread = LIVING; NULL != thread; thread = thread->next) {
+        for (size_t i = 0; i < thread->entries_size; i++) {
+            bxilog__stats_entry_p entry = &thread->entries[i];
+            if (NULL == entry->logger) continue;
+            loggers[n].name = strdup(entry->name);
+            loggers[n].log_nb = __atomic_load_n(&entry->log_nb, __ATOMIC_RELAXED);
+            loggers[n].bytes = __atomic_load_n(&entry->bytes, __ATOMIC_RELAXED);
+            for (size_t l = 0; l < BXILOG_STATS_LEVELS_NB; l++) {
+                loggers[n].level_nb[l] = __atomic_load_n(&entry->level_nb[l],
+                                                         __ATOMIC_RELAXED);
+            }
+            n++;
+        }
+        stats->threads_nb++;
+        stats->rsz_log_nb += __atomic_load_n(&thread->rsz_log_nb, __ATOMIC_RELAXED);
+        size_t max = __atomic_load_n(&thread->max_log_size, __ATOMIC_RELAXED);
+        size_t min = __atomic_load_n(&thread->min_log_size, __ATOMIC_RELAXED);
+        if (max > stats->max_log_size) stats->max_log_size = max;
+        if (min < stats->min_log_size) stats->min_log_size = min;
+    }
+    _unlock();
+    bxiassert(n == nb);
+
+    stats->loggers_nb = _merge(loggers, nb);
+    stats->loggers = loggers;
+    for (size_t i = 0; i < stats->loggers_nb; i++) {
+        stats->log_nb += loggers[i].log_nb;
+        stats->bytes += loggers[i].bytes;
+        for (size_t l = 0; l < BXILOG_STATS_LEVELS_NB; l++) {
+            stats->level_nb[l] += loggers[i].level_nb[l];
+        }
+    }
+    if (0 == stats->log_nb) stats->min_log_size = 0;
+
+    *result = stats;
+
+    return BXIERR_OK;
+}
+
+void bxilog_stats_destroy(bxilog_stats_p * const stats_p) {
+    bxiassert(NULL != stats_p);
+
+    bxilog_stats_p stats = *stats_p;
+    if (NULL == stats) return;
+
+    for (size_t i = 0; i < stats->loggers_nb; i++) BXIFREE(stats->loggers[i].name);
+    BXIFREE(stats->loggers);
+    bximem_destroy((char **) stats_p);
+}
+
+void bxilog__stats_init(const bxilog__stats_p stats) {
+    bxiassert(NULL != stats);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->min_log_size = SIZE_MAX;
+}
+
+void bxilog__stats_register(const bxilog__stats_p stats) {
+    bxiassert(NULL != stats && !stats->registered);
+
+    _lock();
+    stats->prev = NULL;
+    stats->next = LIVING;
+    if (NULL != LIVING) LIVING->prev = stats;
+    LIVING = stats;
+    stats->registered = true;
+    _unlock();
+}
+
+void bxilog__stats_fold(const bxilog__stats_p stats) {
+    bxiassert(NULL != stats);
+
+    _lock();
+    if (stats->registered) {
+        if (NULL != stats->prev) stats->prev->next = stats->next;
+        else LIVING = stats->next;
+        if (NULL != stats->next) stats->next->prev = stats->prev;
+        stats->registered = false;
+        FOLDED_THREADS_NB++;
+    }
+
+    if (0 < stats->entries_nb) {
+        const size_t nb = FOLDED_LOGGERS_NB + stats->entries_nb;
+        FOLDED_LOGGERS = bximem_realloc(FOLDED_LOGGERS,
+                                        FOLDED_LOGGERS_NB * sizeof(*FOLDED_LOGGERS),
+                                        nb * sizeof(*FOLDED_LOGGERS));
+        size_t n = FOLDED_LOGGERS_NB;
+        for (size_t i = 0; i < stats->entries_size; i++) {
+            bxilog__stats_entry_p entry = &stats->entries[i];
+            if (NULL == entry->logger) continue;
+            // The name is given to the folded statistics
+            FOLDED_LOGGERS[n].name = entry->name;
+            FOLDED_LOGGERS[n].log_nb = entry->log_nb;
+            FOLDED_LOGGERS[n].bytes = entry->bytes;
+            memcpy(FOLDED_LOGGERS[n].level_nb, entry->level_nb,
+                   sizeof(FOLDED_LOGGERS[n].level_nb));
+            entry->name = NULL;
+            n++;
+        }
+        bxiassert(n == nb);
+        // Keep one entry per logger name whatever the number of exited threads
+        FOLDED_LOGGERS_NB = _merge(FOLDED_LOGGERS, nb);
+    }
+    FOLDED_RSZ_LOG_NB += stats->rsz_log_nb;
+    if (stats->max_log_size > FOLDED_MAX_LOG_SIZE) {
+        FOLDED_MAX_LOG_SIZE = stats->max_log_size;
+    }
+    if (stats->min_log_size < FOLDED_MIN_LOG_SIZE) {
+        FOLDED_MIN_LOG_SIZE = stats->min_log_size;
+    }
+    _unlock();
+
+    BXIFREE(stats->entries);
+    bxilog__stats_init(stats);
+}
+
+void bxilog__stats_update(const bxilog__stats_p stats,
+                          const bxilog_logger_p logger, const bxilog_level_e level,
+                          const size_t logmsg_len) {
+    bxiassert(level < BXILOG_STATS_LEVELS_NB);
+
+    bxilog__stats_entry_p entry = _lookup(stats, logger);
+    _add(&entry->log_nb, 1);
+    _add(&entry->bytes, logmsg_len);
+    _add(&entry->level_nb[level], 1);
+
+    if (logmsg_len > stats->max_log_size) {
+        __atomic_store_n(&stats->max_log_size, logmsg_len, __ATOMIC_RELAXED);
+    }
+    if (logmsg_len < stats->min_log_size) {
+        __atomic_store_n(&stats->min_log_size, logmsg_len, __ATOMIC_RELAXED);
+    }
+}
+
+void bxilog__stats_resized(const bxilog__stats_p stats) {
+    _add(&stats->rsz_log_nb, 1);
+}
+
+//*********************************************************************************
+//********************************** Static Helpers Implementation ****************
+//*********************************************************************************
+
+bxilog__stats_entry_p _lookup(const bxilog__stats_p stats, const bxilog_logger_p logger) {
+    if (0 < stats->entries_size) {
+        bxilog__stats_entry_p entry = _slot(stats->entries, stats->entries_size, logger);
+        if (NULL != entry->logger) return entry;
+    }
+    return _insert(stats, logger);
+}
+
+bxilog__stats_entry_p _insert(const bxilog__stats_p stats, const bxilog_logger_p logger) {
+    bxilog__stats_entry_p old = NULL;
+    bxilog__stats_entry_p entries = stats->entries;
+    size_t size = stats->entries_size;
+
+    if (2 * (stats->entries_nb + 1) > size) {
+        // Only this thread writes its table: it is copied without the lock
+        size = (0 == size) ? ENTRIES_INITIAL_SIZE : 2 * size;
+        entries = bximem_calloc(size * sizeof(*entries));
+        for (size_t i = 0; i < stats->entries_size; i++) {
+            if (NULL == stats->entries[i].logger) continue;
+            *_slot(entries, size, stats->entries[i].logger) = stats->entries[i];
+        }
+        old = stats->entries;
+    }
+
+    bxilog__stats_entry_p entry = _slot(entries, size, logger);
+    char * name = strdup(logger->name);
+
+    _lock();
+    stats->entries = entries;
+    stats->entries_size = size;
+    entry->name = name;
+    entry->logger = logger;
+    stats->entries_nb++;
+    _unlock();
+
+    BXIFREE(old);
+
+    return entry;
+}
+
+bxilog__stats_entry_p _slot(const bxilog__stats_entry_p entries, const size_t size,
+                            const bxilog_logger_p logger) {
+
+    const size_t mask = size - 1;
+    // Loggers are at least 8-byte aligned, low bits are useless
+    size_t i = (((uintptr_t) logger >> 3) * 0x9E3779B97F4A7C15ull) & mask;
+    while (NULL != entries[i].logger && logger != entries[i].logger) i = (i + 1) & mask;
+
+    return &entries[i];
+}
+
+void _add(size_t * const counter, const size_t n) {
+    // Single writer: no need for an atomic read-modify-write
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n,
+                     __ATOMIC_RELAXED);
+}
+
+size_t _merge(const bxilog_logger_stats_p loggers, const size_t nb) {
+    if (0 == nb) return 0;
+
+    qsort(loggers, nb, sizeof(*loggers), _name_compar);
+    size_t n = 0;
+    for (size_t i = 1; i < nb; i++) {
+        if (0 != strcmp(loggers[n].name, loggers[i].name)) {
+            loggers[++n] = loggers[i];
+            continue;
+        }
+        loggers[n].log_nb += loggers[i].log_nb;
+        loggers[n].bytes += loggers[i].bytes;
+        for (size_t l = 0; l < BXILOG_STATS_LEVELS_NB; l++) {
+            loggers[n].level_nb[l] += loggers[i].level_nb[l];
+        }
+        BXIFREE(loggers[i].name);
+    }
+
+    return n + 1;
+}
+
+int _name_compar(const void * const a, const void * const b) {
+    const bxilog_logger_stats_s * const s1 = a;
+    const bxilog_logger_stats_s * const s2 = b;
+
+    return strcmp(s1->name, s2->name);
+}
+
+void _lock(void) {
+    int rc = pthread_mutex_lock(&STATS_LOCK);
+    bxiassert(0 == rc);
+}
+
+void _unlock(void) {
+    int rc = pthread_mutex_unlock(&STATS_LOCK);
+    bxiassert(0 == rc);
+}
+
+__attribute__((constructor)) void __stats_init__(void) {
+    // Installed before any bxilog_init(): the bxilog fork preparation (which
+    // frees the forking thread statistics) runs before the lock is taken
+    int rc = pthread_atfork(_lock, _unlock, _unlock);
+    bxiassert(0 == rc);
+}
@@ -0,0 +1,98 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2018 Bull S.A.S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P. 68, 78340 Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#ifndef BXILOG_STATS_IMPL_H
+#define BXILOG_STATS_IMPL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "bxi/base/log/logger.h"
+#include "bxi/base/log/stats.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+/*
+ * The counters of a given logger in a given thread.
+ *
+ * Only the owner thread writes counters, with relaxed atomic stores: readers
+ * (bxilog_stats_get()) use relaxed atomic loads.
+ */
+typedef struct {
+    bxilog_logger_p logger;                     // The key, NULL if the entry is free
+    char * name;                                // A copy of the logger name
+    size_t log_nb;
+    size_t bytes;
+    size_t level_nb[BXILOG_STATS_LEVELS_NB];
+} bxilog__stats_entry_s;
+
+typedef bxilog__stats_entry_s * bxilog__stats_entry_p;
+
+typedef struct bxilog__stats_s bxilog__stats_s;
+typedef bxilog__stats_s * bxilog__stats_p;
+
+/*
+ * The statistics of a given thread.
+ *
+ * Entries are an open-addressing table keyed by logger address. The owner thread
+ * looks up its table without any lock: entries are added, and the table is
+ * replaced, under the global statistics lock only so readers holding it always
+ * see a consistent table.
+ */
+struct bxilog__stats_s {
+    size_t rsz_log_nb;                  // Number of record buffer resizing
+    size_t max_log_size;                // Largest message size
+    size_t min_log_size;                // Smallest message size
+    bxilog__stats_entry_p entries;      // The table
+    size_t entries_size;                // Its size (a power of 2)
+    size_t entries_nb;                  // Number of used entries
+    bool registered;                    // Set once in the list of living threads
+    bxilog__stats_p prev;               // The list of living threads
+    bxilog__stats_p next;
+};
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interface         ****************************
+//*********************************************************************************
+
+/* Initialize the given thread statistics */
+void bxilog__stats_init(bxilog__stats_p stats);
+
+/* Make the given thread statistics visible to bxilog_stats_get() */
+void bxilog__stats_register(bxilog__stats_p stats);
+
+/*
+ * Owner thread: add the given thread statistics to the global total and
+ * release them.
+ */
+void bxilog__stats_fold(bxilog__stats_p stats);
+
+/* Owner thread: count a log of the given message length */
+void bxilog__stats_update(bxilog__stats_p stats,
+                          bxilog_logger_p logger, bxilog_level_e level,
+                          size_t logmsg_len);
+
+/* Owner thread: count a record buffer resizing */
+void bxilog__stats_resized(bxilog__stats_p stats);
+
+#endif
@@ -79,6 +79,8 @@ static bxierr_p _process_log(bxilog_record_p record,
                              char * loggername,
                              char * logmsg,
                              bxilog_syslog_handler_param_p data);
+static bxierr_p _process_logs(bxilog_log_p logs, size_t logs_nb,
+                              bxilog_syslog_handler_param_p data);
 static bxierr_p _process_ierr(bxierr_p * err, bxilog_syslog_handler_param_p data);
 static bxierr_p _process_implicit_flush(bxilog_syslog_handler_param_p data);
 static bxierr_p _process_explicit_flush(bxilog_syslog_handler_param_p data);
@@ -112,6 +114,8 @@ static const bxilog_handler_s BXILOG_SYSLOG_HANDLER_S = {
                                                char * loggername,
                                                char * logmsg,
                                                bxilog_handler_param_p param)) _process_log,
+                  .process_logs = (bxierr_p (*)(bxilog_log_p, size_t,
+                                                bxilog_handler_param_p)) _process_logs,
                   .process_ierr = (bxierr_p (*) (bxierr_p*, bxilog_handler_param_p)) _process_ierr,
                   .process_implicit_flush = (bxierr_p (*) (bxilog_handler_param_p)) _process_implicit_flush,
                   .process_explicit_flush = (bxierr_p (*) (bxilog_handler_param_p)) _process_explicit_flush,
@@ -243,6 +247,22 @@ inline bxierr_p _process_log(bxilog_record_p record,
     return err;
 }
 
+bxierr_p _process_logs(bxilog_log_p logs, size_t logs_nb,
+                       bxilog_syslog_handler_param_p data) {
+
+    bxierr_p err = BXIERR_OK, err2;
+    for (size_t i = 0; i < logs_nb; i++) {
+        // Do not even split the message of a level syslog ignores
+        if (LOG_IGNORE == BXILOG2SYSLOG_LEVELS[logs[i].record->level]) continue;
+        err2 = _process_log(logs[i].record,
+                            logs[i].filename, logs[i].funcname, logs[i].loggername,
+                            logs[i].logmsg,
+                            data);
+        BXIERR_CHAIN(err, err2);
+    }
+    return err;
+}
+
 
 bxierr_p _process_ierr(bxierr_p *err, bxilog_syslog_handler_param_p data) {
     bxierr_p result = BXIERR_OK;
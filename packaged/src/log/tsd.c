@@ -37,6 +37,9 @@
 //*********************************************************************************
 //********************************** Static Functions  ****************************
 //*********************************************************************************
+static bxierr_p _update(tsd_p tsd);
+static bxierr_p _connect(tsd_p tsd, size_t rank);
+static bxierr_p _disconnect(tsd_p tsd, size_t rank);
 
 //*********************************************************************************
 //********************************** Global Variables  ****************************
@@ -55,7 +58,7 @@
 void bxilog__tsd_free(void * const data) {
     const tsd_p tsd = (tsd_p) data;
 
-    if (NULL != tsd->data_channel) {
+    if (NULL != tsd->data_channel || NULL != tsd->ctrl_channel) {
         bxierr_p err = BXIERR_OK, err2;
         err2 = bxizmq_zocket_destroy(&tsd->data_channel);
         BXIERR_CHAIN(err, err2);
@@ -63,7 +66,16 @@ void bxilog__tsd_free(void * const data) {
         BXIERR_CHAIN(err, err2);
         if (bxierr_isko(err)) bxierr_report(&err, STDERR_FILENO);
     }
+    for (size_t i = 0; i < tsd->rings_nb; i++) {
+        // The handler frees the ring once drained if it is still running
+        bxilog__ring_leave(&tsd->rings[i]);
+        bxilog__ring_leave(&tsd->prio_rings[i]);
+    }
+    BXIFREE(tsd->rings);
+    BXIFREE(tsd->prio_rings);
+    BXIFREE(tsd->connected);
     BXIFREE(tsd->log_buf);
+    bxilog__stats_fold(&tsd->stats);
     BXIFREE(tsd);
 }
 
@@ -82,7 +94,10 @@ bxierr_p bxilog__tsd_get(tsd_p * result) {
     tsd_p tsd = pthread_getspecific(BXILOG__GLOBALS->tsd_key);
     if (NULL != tsd) {
         *result = tsd;
-        return BXIERR_OK;
+        // Handlers have not been added or removed since the last call
+        if (tsd->handlers_gen == __atomic_load_n(&BXILOG__GLOBALS->handlers_gen,
+                                                 __ATOMIC_ACQUIRE)) return BXIERR_OK;
+        return _update(tsd);
     }
 
     if (NULL == BXILOG__GLOBALS->config) {
@@ -99,18 +114,120 @@ bxierr_p bxilog__tsd_get(tsd_p * result) {
     }
     errno = 0;
     tsd = bximem_calloc(sizeof(*tsd));
-    tsd->min_log_size = SIZE_MAX;
+    bxilog__stats_init(&tsd->stats);
 
     bxiassert(NULL != BXILOG__GLOBALS->config->handlers);
     bxiassert(0 < BXILOG__GLOBALS->config->tsd_log_buf_size);
-    tsd->log_buf = bximem_calloc(BXILOG__GLOBALS->config->tsd_log_buf_size);
+    tsd->log_buf_size = BXILOG__GLOBALS->config->tsd_log_buf_size;
+    tsd->log_buf = bximem_calloc(tsd->log_buf_size);
+
+    bxierr_p err = _update(tsd);
+    if (bxierr_isko(err)) {
+        *result = tsd;
+        return err;
+    }
+
+#ifdef __linux__
+    tsd->tid = (pid_t) syscall(SYS_gettid);
+#endif
+    // Do not try to return the kernel TID here, they might not be the same
+    // Linux relies on a 1:1 mapping between kernel threads and user threads
+    // but this is an NTPL implementation choice. Let's assume it might change
+    // in the future.
+    tsd->thread_rank = (uint16_t) (uintptr_t) pthread_self();
+    bxilog__stats_register(&tsd->stats);
+    int rc = pthread_setspecific(BXILOG__GLOBALS->tsd_key, tsd);
+    // Nothing to do otherwise. Using a log will add a recursive call... Bad.
+    // And the man page specified that there is
+    bxiassert(0 == rc);
+
+    *result = tsd;
+
+    return BXIERR_OK;
+}
+
+
+//*********************************************************************************
+//********************************** Static Helpers Implementation ****************
+//*********************************************************************************
+
+bxierr_p _update(tsd_p tsd) {
+    // Read before the handlers: a change made meanwhile is seen on the next call
+    const size_t gen = __atomic_load_n(&BXILOG__GLOBALS->handlers_gen, __ATOMIC_ACQUIRE);
+    const bxilog_config_p config = BXILOG__GLOBALS->config;
+    const size_t handlers_nb = __atomic_load_n(&config->handlers_nb, __ATOMIC_ACQUIRE);
+
+    if (handlers_nb > tsd->handlers_nb) {
+        tsd->connected = bximem_realloc(tsd->connected,
+                                        tsd->handlers_nb * sizeof(*tsd->connected),
+                                        handlers_nb * sizeof(*tsd->connected));
+        if (BXILOG_TRANSPORT_RING == config->transport) {
+            bxiassert(NULL != BXILOG__GLOBALS->ring_sets);
+            tsd->rings = bximem_realloc(tsd->rings,
+                                        tsd->rings_nb * sizeof(*tsd->rings),
+                                        handlers_nb * sizeof(*tsd->rings));
+            tsd->prio_rings = bximem_realloc(tsd->prio_rings,
+                                             tsd->rings_nb * sizeof(*tsd->prio_rings),
+                                             handlers_nb * sizeof(*tsd->prio_rings));
+            tsd->rings_nb = handlers_nb;
+        }
+        tsd->handlers_nb = handlers_nb;
+    }
 
     bxierr_list_p errlist = bxierr_list_new();
-    for (size_t i = 0; i < BXILOG__GLOBALS->config->handlers_nb; i++) {
-        char * url = BXILOG__GLOBALS->config->handlers_params[i]->data_url;
-        bxiassert(NULL != url);
-        bxierr_p err = BXIERR_OK, err2;
+    for (size_t i = 0; i < handlers_nb; i++) {
+        bxilog_handler_param_p param = config->handlers_params[i];
+        const bool removed = BXI_LOG_HANDLER_REMOVED == __atomic_load_n(&param->status,
+                                                                        __ATOMIC_ACQUIRE);
+        // Up to date: connected to running handlers only
+        if (removed ? !tsd->connected[i] : tsd->connected[i]) continue;
+
+        bxierr_p err = removed ? _disconnect(tsd, i) : _connect(tsd, i);
+        if (bxierr_isko(err)) bxierr_list_append(errlist, err);
+    }
+    tsd->handlers_gen = gen;
+
+    if (0 < errlist->errors_nb) {
+        return bxierr_from_list(BXIERR_GROUP_CODE,
+                                 errlist,
+                                 "At least one error occured "
+                                 "while connecting to one of %zu handlers",
+                                 handlers_nb);
+    }
+    bxierr_list_destroy(&errlist);
+
+    return BXIERR_OK;
+}
+
+bxierr_p _connect(tsd_p tsd, size_t rank) {
+    bxilog_handler_param_p param = BXILOG__GLOBALS->config->handlers_params[rank];
+    char * url = param->data_url;
+    bxiassert(NULL != url);
+    bxierr_p err = BXIERR_OK, err2;
+
+    if (NULL != tsd->rings) {
+        bxilog__ring_set_p set = &BXILOG__GLOBALS->ring_sets[rank];
+        err2 = bxilog__ring_new(BXILOG__GLOBALS->config->ring_size, param->numa_node,
+                                &tsd->rings[rank]);
+        if (NULL != tsd->rings[rank]) {
+            // A misplaced ring is reported by the handler thread: logging goes on
+            bxilog__ring_set_misplaced(set, &err2);
+            bxilog__ring_set_add(set, tsd->rings[rank]);
+        }
+        BXIERR_CHAIN(err, err2);
 
+        if (BXILOG_OFF != param->prio_level) {
+            err2 = bxilog__ring_new(BXILOG__GLOBALS->config->ring_size,
+                                    param->numa_node,
+                                    &tsd->prio_rings[rank]);
+            if (NULL != tsd->prio_rings[rank]) {
+                bxilog__ring_set_misplaced(set, &err2);
+                tsd->prio_rings[rank]->prio = true;
+                bxilog__ring_set_add(set, tsd->prio_rings[rank]);
+            }
+            BXIERR_CHAIN(err, err2);
+        }
+    } else {
         if (NULL == tsd->data_channel) {
             err2 = bxizmq_zocket_create(BXILOG__GLOBALS->zmq_ctx,
                                         ZMQ_ROUTER,
@@ -127,56 +244,69 @@ bxierr_p bxilog__tsd_get(tsd_p * result) {
         err2 = bxizmq_zocket_connect(tsd->data_channel, url);
         BXIERR_CHAIN(err, err2);
 
-        url = BXILOG__GLOBALS->config->handlers_params[i]->ctrl_url;
+        if (BXILOG_OFF != param->prio_level) {
+            // The high water mark is the one of the zocket when the connection is made
+            err2 = bxizmq_zocket_setopt(tsd->data_channel,
+                                        ZMQ_SNDHWM,
+                                        &param->prio_hwm,
+                                        sizeof(param->prio_hwm));
+            BXIERR_CHAIN(err, err2);
 
-        if (NULL == tsd->ctrl_channel) {
-            err2 = bxizmq_zocket_create(BXILOG__GLOBALS->zmq_ctx,
-                                        ZMQ_REQ,
-                                        &tsd->ctrl_channel);
+            err2 = bxizmq_zocket_connect(tsd->data_channel, param->prio_url);
             BXIERR_CHAIN(err, err2);
 
-            err2 = bxizmq_zocket_setopt(tsd->ctrl_channel,
-            	                        ZMQ_SNDHWM,
-                                        &BXILOG__GLOBALS->config->ctrl_hwm,
-                                        sizeof(BXILOG__GLOBALS->config->ctrl_hwm));
+            err2 = bxizmq_zocket_setopt(tsd->data_channel,
+                                        ZMQ_SNDHWM,
+                                        &BXILOG__GLOBALS->config->data_hwm,
+                                        sizeof(BXILOG__GLOBALS->config->data_hwm));
             BXIERR_CHAIN(err, err2);
         }
+    }
+
+    url = param->ctrl_url;
 
-        err2 = bxizmq_zocket_connect(tsd->ctrl_channel, url);
+    if (NULL == tsd->ctrl_channel) {
+        err2 = bxizmq_zocket_create(BXILOG__GLOBALS->zmq_ctx,
+                                    ZMQ_REQ,
+                                    &tsd->ctrl_channel);
         BXIERR_CHAIN(err, err2);
-        if (bxierr_isko(err)) bxierr_list_append(errlist, err);
-    }
 
-    if (0 < errlist->errors_nb) {
-        *result = tsd;
-        return bxierr_from_list(BXIERR_GROUP_CODE,
-                                 errlist,
-                                 "At least one error occured "
-                                 "while connecting to one of %zu handlers",
-                                 BXILOG__GLOBALS->config->handlers_nb);
+        err2 = bxizmq_zocket_setopt(tsd->ctrl_channel,
+                                    ZMQ_SNDHWM,
+                                    &BXILOG__GLOBALS->config->ctrl_hwm,
+                                    sizeof(BXILOG__GLOBALS->config->ctrl_hwm));
+        BXIERR_CHAIN(err, err2);
     }
-    bxierr_list_destroy(&errlist);
 
-#ifdef __linux__
-    tsd->tid = (pid_t) syscall(SYS_gettid);
-#endif
-    // Do not try to return the kernel TID here, they might not be the same
-    // Linux relies on a 1:1 mapping between kernel threads and user threads
-    // but this is an NTPL implementation choice. Let's assume it might change
-    // in the future.
-    tsd->thread_rank = (uint16_t) (uintptr_t) pthread_self();
-    int rc = pthread_setspecific(BXILOG__GLOBALS->tsd_key, tsd);
-    // Nothing to do otherwise. Using a log will add a recursive call... Bad.
-    // And the man page specified that there is
-    bxiassert(0 == rc);
+    err2 = bxizmq_zocket_connect(tsd->ctrl_channel, url);
+    BXIERR_CHAIN(err, err2);
 
-    *result = tsd;
+    tsd->connected[rank] = true;
 
-    return BXIERR_OK;
+    return err;
 }
 
+bxierr_p _disconnect(tsd_p tsd, size_t rank) {
+    bxilog_handler_param_p param = BXILOG__GLOBALS->config->handlers_params[rank];
+    bxierr_p err = BXIERR_OK, err2;
+
+    tsd->connected[rank] = false;
+    if (NULL != tsd->rings) {
+        // Freed by the handler if it has not exited yet
+        bxilog__ring_leave(&tsd->rings[rank]);
+        bxilog__ring_leave(&tsd->prio_rings[rank]);
+    } else if (NULL != tsd->data_channel) {
+        err2 = bxizmq_disconnect(tsd->data_channel, param->data_url);
+        BXIERR_CHAIN(err, err2);
+        if (BXILOG_OFF != param->prio_level) {
+            err2 = bxizmq_disconnect(tsd->data_channel, param->prio_url);
+            BXIERR_CHAIN(err, err2);
+        }
+    }
+    if (NULL != tsd->ctrl_channel) {
+        err2 = bxizmq_disconnect(tsd->ctrl_channel, param->ctrl_url);
+        BXIERR_CHAIN(err, err2);
+    }
 
-//*********************************************************************************
-//********************************** Static Helpers Implementation ****************
-//*********************************************************************************
-
+    return err;
+}
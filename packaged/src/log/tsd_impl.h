@@ -15,10 +15,14 @@
 #define BXILOG_TSD_IMPL_H
 
 #include <unistd.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "bxi/base/err.h"
 
+#include "ring_impl.h"
+#include "stats_impl.h"
+
 //*********************************************************************************
 //********************************** Defines **************************************
 //*********************************************************************************
@@ -28,15 +32,20 @@
 //*********************************************************************************
 
 struct tsd_s {
-    size_t log_nb;
-    size_t rsz_log_nb;
-    size_t max_log_size;
-    size_t min_log_size;
-    size_t sum_log_size;
+    bxilog__stats_s stats;          // The thread logging statistics
 
-    char *  log_buf;                 // The per-thread log buffer
+    char *  log_buf;                 // The per-thread record buffer
+    size_t log_buf_size;            // Its size (it only grows)
     void * data_channel;             // The thread-specific zmq logging socket;
     void *  ctrl_channel;             // The thread-specific zmq controlling socket;
+    bxilog__ring_p * rings;         // The thread-specific rings, one per handler
+                                    // (ring transport only)
+    bxilog__ring_p * prio_rings;    // The priority rings, one per handler, NULL
+                                    // for a handler without a priority queue
+    size_t rings_nb;                // Number of rings (of each kind)
+    size_t handlers_nb;             // Number of handlers known by the thread
+    bool * connected;               // Whether records are sent to each of them
+    size_t handlers_gen;            // See bxilog__core_globals_s.handlers_gen
 #ifdef __linux__
     pid_t tid;                      // Cache the tid on Linux since we assume NPTL
                                     // and therefore a 1:1 thread implementation.
@@ -60,7 +69,12 @@ void bxilog__tsd_free(void * const data);
 /* Allocate the tsd key */
 void bxilog__tsd_key_new();
 
-/* Return the thread-specific data.*/
+/*
+ * Return the thread-specific data.
+ *
+ * The thread connects to the handlers added, and disconnects from the ones removed,
+ * since its last call.
+ */
 bxierr_p bxilog__tsd_get(tsd_p * result);
 
 
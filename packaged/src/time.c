@@ -15,6 +15,12 @@
 #include <errno.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
 
 #include "bxi/base/mem.h"
 #include "bxi/base/str.h"
@@ -25,18 +31,58 @@
 // ********************************** Defines **************************************
 // *********************************************************************************
 
+// Fixed point arithmetic: nanoseconds = (ticks * mult) >> FAST_SHIFT
+#define FAST_SHIFT 32
+
+// Duration of the initial fast clock calibration, in ns
+#define FAST_CALIBRATION_DELAY 1000000l
+
+#define NS_PER_S 1000000000l
+
 // *********************************************************************************
 // ********************************** Types ****************************************
 // *********************************************************************************
 
+typedef enum {
+    FAST_UNKNOWN = 0,           // Not calibrated yet
+    FAST_COUNTER,               // CPU counter (TSC, CNTVCT)
+    FAST_CLOCK,                 // CLOCK_MONOTONIC_RAW: 1 tick = 1 ns
+} fast_source_e;
+
+// The reference point used to convert fast clock ticks to wall clock time.
+// It is protected by a sequence lock: fields are atomics read with relaxed ordering.
+typedef struct {
+    atomic_uint seq;                // Odd while the anchor is being updated
+    _Atomic uint64_t ticks;         // Fast clock value at the anchor
+    _Atomic int64_t realtime_ns;    // CLOCK_REALTIME at the anchor
+    _Atomic int64_t raw_ns;         // CLOCK_MONOTONIC_RAW at the anchor
+    _Atomic uint64_t mult;          // Nanoseconds per tick << FAST_SHIFT
+} fast_anchor_s;
+
 // *********************************************************************************
 // **************************** Static function declaration ************************
 // *********************************************************************************
 
+static uint64_t _fast_read_counter(void);
+static int64_t _fast_read_clock(clockid_t clk_id);
+static bool _fast_counter_usable(void);
+static void _fast_calibrate(void);
+static uint64_t _fast_read(fast_source_e source);
+static int64_t _fast_scale(int64_t delta, uint64_t mult);
+static uint64_t _fast_mult(int64_t ns, uint64_t ticks);
+static void _fast_anchor(fast_source_e source, uint64_t mult);
+static void _fast_reanchor(void);
+
 // *********************************************************************************
 // ********************************** Global Variables *****************************
 // *********************************************************************************
 
+static atomic_int FAST_SOURCE = FAST_UNKNOWN;
+static pthread_once_t FAST_ONCE = PTHREAD_ONCE_INIT;
+// Serializes anchor updates
+static pthread_mutex_t FAST_LOCK = PTHREAD_MUTEX_INITIALIZER;
+static fast_anchor_s FAST_ANCHOR;
+
 // *********************************************************************************
 // ********************************** Implementation   *****************************
 // *********************************************************************************
@@ -147,7 +193,166 @@ char * bxitime_duration_str(const double duration){
 }
 
 
+uint64_t bxitime_fast_ticks(void) {
+    const fast_source_e source = atomic_load_explicit(&FAST_SOURCE, memory_order_relaxed);
+    if (FAST_UNKNOWN != source) return _fast_read(source);
+
+    pthread_once(&FAST_ONCE, _fast_calibrate);
+    return _fast_read(atomic_load_explicit(&FAST_SOURCE, memory_order_relaxed));
+}
+
+void bxitime_fast_calibrate(void) {
+    pthread_once(&FAST_ONCE, _fast_calibrate);
+}
+
+void bxitime_fast_to_timespec(const uint64_t ticks, struct timespec * const time) {
+    if (FAST_UNKNOWN == atomic_load_explicit(&FAST_SOURCE, memory_order_acquire)) {
+        pthread_once(&FAST_ONCE, _fast_calibrate);
+    }
+
+    uint64_t anchor_ticks, mult;
+    int64_t realtime_ns;
+    unsigned seq;
+    do {
+        seq = atomic_load_explicit(&FAST_ANCHOR.seq, memory_order_acquire);
+        anchor_ticks = atomic_load_explicit(&FAST_ANCHOR.ticks, memory_order_relaxed);
+        realtime_ns = atomic_load_explicit(&FAST_ANCHOR.realtime_ns, memory_order_relaxed);
+        mult = atomic_load_explicit(&FAST_ANCHOR.mult, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+    } while ((seq & 1) || seq != atomic_load_explicit(&FAST_ANCHOR.seq,
+                                                      memory_order_relaxed));
+
+    // Ticks might be taken before the anchor: the difference is signed
+    const int64_t delta = (int64_t) (ticks - anchor_ticks);
+    const int64_t delta_ns = _fast_scale(delta, mult);
+    const int64_t ns = realtime_ns + delta_ns;
+    time->tv_sec = (time_t) (ns / NS_PER_S);
+    time->tv_nsec = (long) (ns % NS_PER_S);
+
+    if (delta_ns > BXITIME_FAST_ANCHOR_PERIOD) _fast_reanchor();
+}
+
 // *********************************************************************************
 // ********************************** Static Functions  ****************************
 // *********************************************************************************
 
+// Read the given source directly: FAST_SOURCE is published after the anchor
+uint64_t _fast_read(const fast_source_e source) {
+    if (FAST_COUNTER == source) return _fast_read_counter();
+    return (uint64_t) _fast_read_clock(CLOCK_MONOTONIC_RAW);
+}
+
+uint64_t _fast_read_counter(void) {
+#if defined(__x86_64__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    __asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r" (value) : : "memory");
+    return value;
+#else
+    return (uint64_t) _fast_read_clock(CLOCK_MONOTONIC_RAW);
+#endif
+}
+
+// (delta * mult) >> FAST_SHIFT: the product does not fit in 64 bits
+int64_t _fast_scale(const int64_t delta, const uint64_t mult) {
+#ifdef __SIZEOF_INT128__
+    return (int64_t) (((__int128) delta * mult) >> FAST_SHIFT);
+#else
+    return (int64_t) ((long double) delta * (long double) mult /
+                      (long double) ((uint64_t) 1 << FAST_SHIFT));
+#endif
+}
+
+// Nanoseconds per tick << FAST_SHIFT, given a positive duration in both units
+uint64_t _fast_mult(const int64_t ns, const uint64_t ticks) {
+#ifdef __SIZEOF_INT128__
+    return (uint64_t) (((unsigned __int128) ns << FAST_SHIFT) / ticks);
+#else
+    return (uint64_t) ((long double) ns * (long double) ((uint64_t) 1 << FAST_SHIFT) /
+                       (long double) ticks);
+#endif
+}
+
+int64_t _fast_read_clock(const clockid_t clk_id) {
+    struct timespec now;
+    int rc = clock_gettime(clk_id, &now);
+    bxiassert(0 == rc);
+    return (int64_t) now.tv_sec * NS_PER_S + now.tv_nsec;
+}
+
+bool _fast_counter_usable(void) {
+#if defined(__x86_64__)
+    // The TSC must be invariant: constant rate across P/C-states and cores
+    unsigned eax, ebx, ecx, edx;
+    if (0 == __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+    return 0 != (edx & (1u << 8));
+#elif defined(__aarch64__)
+    // The generic timer virtual counter has a constant frequency
+    return true;
+#else
+    return false;
+#endif
+}
+
+void _fast_calibrate(void) {
+    uint64_t mult = (uint64_t) 1 << FAST_SHIFT;
+    fast_source_e source = FAST_CLOCK;
+
+    if (_fast_counter_usable()) {
+        const int64_t start_ns = _fast_read_clock(CLOCK_MONOTONIC_RAW);
+        const uint64_t start = _fast_read_counter();
+        bxierr_p err = bxitime_sleep(CLOCK_MONOTONIC, 0, FAST_CALIBRATION_DELAY);
+        bxierr_abort_ifko(err);
+        const int64_t end_ns = _fast_read_clock(CLOCK_MONOTONIC_RAW);
+        const uint64_t end = _fast_read_counter();
+        if (end > start) {
+            mult = _fast_mult(end_ns - start_ns, end - start);
+            source = FAST_COUNTER;
+        }
+    }
+    // Published once anchored: a known source implies a valid anchor.
+    // Pairs with the acquire load in bxitime_fast_to_timespec()
+    _fast_anchor(source, mult);
+    atomic_store_explicit(&FAST_SOURCE, source, memory_order_release);
+}
+
+void _fast_anchor(const fast_source_e source, const uint64_t mult) {
+    const uint64_t ticks = _fast_read(source);
+    const int64_t realtime_ns = _fast_read_clock(CLOCK_REALTIME);
+    const int64_t raw_ns = _fast_read_clock(CLOCK_MONOTONIC_RAW);
+
+    unsigned seq = atomic_load_explicit(&FAST_ANCHOR.seq, memory_order_relaxed);
+    atomic_store_explicit(&FAST_ANCHOR.seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&FAST_ANCHOR.ticks, ticks, memory_order_relaxed);
+    atomic_store_explicit(&FAST_ANCHOR.realtime_ns, realtime_ns, memory_order_relaxed);
+    atomic_store_explicit(&FAST_ANCHOR.raw_ns, raw_ns, memory_order_relaxed);
+    atomic_store_explicit(&FAST_ANCHOR.mult, mult, memory_order_relaxed);
+    atomic_store_explicit(&FAST_ANCHOR.seq, seq + 2, memory_order_release);
+}
+
+void _fast_reanchor(void) {
+    // Another thread is already doing it
+    if (0 != pthread_mutex_trylock(&FAST_LOCK)) return;
+
+    const uint64_t prev_ticks = atomic_load_explicit(&FAST_ANCHOR.ticks,
+                                                     memory_order_relaxed);
+    const int64_t prev_raw_ns = atomic_load_explicit(&FAST_ANCHOR.raw_ns,
+                                                     memory_order_relaxed);
+    uint64_t mult = atomic_load_explicit(&FAST_ANCHOR.mult, memory_order_relaxed);
+    const fast_source_e source = atomic_load_explicit(&FAST_SOURCE, memory_order_relaxed);
+
+    // Measure the frequency again over the whole period to compensate the drift
+    // of the initial calibration
+    const uint64_t ticks = _fast_read(source);
+    const int64_t raw_ns = _fast_read_clock(CLOCK_MONOTONIC_RAW);
+    if (ticks > prev_ticks && raw_ns > prev_raw_ns) {
+        mult = _fast_mult(raw_ns - prev_raw_ns, ticks - prev_ticks);
+    }
+    _fast_anchor(source, mult);
+
+    int rc = pthread_mutex_unlock(&FAST_LOCK);
+    bxiassert(0 == rc);
+}
+
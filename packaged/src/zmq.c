@@ -662,7 +662,12 @@ bxierr_p bxizmq_data_snd_zc(const void * const data, const size_t size,
     zmq_msg_t msg;
     errno = 0;
     int rc = zmq_msg_init_data(&msg, (void *)data, size, ffn, hint);
-    if (0 != rc) return bxizmq_err(errno, "Calling zmq_msg_init_data() failed");
+    if (0 != rc) {
+        bxierr_p err = bxizmq_err(errno, "Calling zmq_msg_init_data() failed");
+        // The message does not own the data: release it as promised
+        if (NULL != ffn) ffn((void *) data, hint);
+        return err;
+    }
 
     bxierr_p current = bxizmq_msg_snd(&msg, zocket, flags, retries_max, delay_ns);
     bxierr_p new = bxizmq_msg_close(&msg);
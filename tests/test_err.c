@@ -12,6 +12,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include <CUnit/Basic.h>
@@ -146,3 +147,27 @@ void test_bxierr_chain() {
     bxierr_destroy(&err);
 }
 
+
+void test_bxierr_lazy_backtrace() {
+    bxierr_p err = bxierr_gen("Lazy backtrace");
+    CU_ASSERT_PTR_NULL(err->backtrace);
+    CU_ASSERT_TRUE(0 < err->bt_pcs_nb);
+
+    // Symbolized on first use, then kept
+    char * str = bxierr_str(err);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(err->backtrace);
+    CU_ASSERT_PTR_NOT_NULL(strstr(str, "Backtrace end"));
+    char * str2 = bxierr_str(err);
+    CU_ASSERT_STRING_EQUAL(str, str2);
+    BXIFREE(str);
+    BXIFREE(str2);
+    bxierr_destroy(&err);
+
+    err = bxierr_new(BXIERR_NO_BACKTRACE | 42, NULL, NULL, NULL, NULL, "No backtrace");
+    CU_ASSERT_EQUAL(err->code, 42);
+    CU_ASSERT_EQUAL(err->bt_pcs_nb, 0);
+    str = bxierr_str(err);
+    CU_ASSERT_PTR_NULL(err->backtrace);
+    BXIFREE(str);
+    bxierr_destroy(&err);
+}
@@ -18,6 +18,7 @@
 #include <string.h>
 #include <pthread.h>
 #include <libgen.h>
+#include <dirent.h>
 #include <sysexits.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -29,6 +30,7 @@
 #include <signal.h>
 #include <syslog.h>
 #include <inttypes.h>
+#include <zlib.h>
 
 #include <CUnit/Basic.h>
 
@@ -38,6 +40,7 @@
 
 #include "bxi/base/log/console_handler.h"
 #include "bxi/base/log/file_handler.h"
+#include "bxi/base/log/binary_reader.h"
 #include "bxi/base/log/syslog_handler.h"
 #include "bxi/base/log/remote_handler.h"
 #include "bxi/base/log/null_handler.h"
@@ -526,6 +529,19 @@ void test_registry(void) {
     CU_ASSERT_TRUE(bxierr_isok(err));
     CU_ASSERT_PTR_NOT_NULL_FATAL(logger_ab);
 
+    // Each logger has its own identifier
+    CU_ASSERT_NOT_EQUAL(logger_a->id, 0);
+    CU_ASSERT_NOT_EQUAL(logger_a2->id, 0);
+    CU_ASSERT_NOT_EQUAL(logger_ab->id, 0);
+    CU_ASSERT_NOT_EQUAL(logger_a->id, logger_a2->id);
+    CU_ASSERT_NOT_EQUAL(logger_a->id, logger_ab->id);
+    CU_ASSERT_NOT_EQUAL(logger_a2->id, logger_ab->id);
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("a", &logger);
+    CU_ASSERT_TRUE(bxierr_isok(err));
+    CU_ASSERT_EQUAL(logger->id, logger_a->id);
+
     err = bxilog_finalize(true);
     CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
     bxilog_registry_reset();
@@ -735,43 +751,62 @@ void test_filters_symetric() {
 }
 
 void test_filters_complex() {
-//    char filters1_format[] = ":trace,a.b:debug,a.b.z:fine";
-//    bxilog_filters_p filters1 = NULL;
-//    bxierr_p err = bxilog_filters_parse(filters1_format, &filters1);
-//    CU_ASSERT_TRUE(bxierr_isok(err));
-//
-//    char filters2_format[] = "~:info,bar:out,a:critical";
-//    bxilog_filters_p filters2 = NULL;
-//    err = bxilog_filters_parse(filters2_format, &filters2);
-//    CU_ASSERT_TRUE(bxierr_isok(err));
-//
-//    bxilog_filters_p array[2] = {filters1, filters2};
-//    bxilog_filters_p merged_filters = bxilog_filters_merge(array, 2);
-//    CU_ASSERT_TRUE(bxierr_isok(err));
-//    CU_ASSERT_PTR_NOT_NULL_FATAL(merged_filters);
-//    CU_ASSERT_EQUAL(merged_filters->nb, 6);
-//
-//    CU_ASSERT_EQUAL(strcmp("", merged_filters->list[0]->prefix), 0);
-//    CU_ASSERT_EQUAL(BXILOG_TRACE, merged_filters->list[0]->level);
-//
-//    CU_ASSERT_EQUAL(strcmp("a", merged_filters->list[1]->prefix), 0);
-//    CU_ASSERT_EQUAL(BXILOG_TRACE, merged_filters->list[1]->level);
-//
-//    CU_ASSERT_EQUAL(strcmp("a.b", merged_filters->list[2]->prefix), 0);
-//    CU_ASSERT_EQUAL(BXILOG_DEBUG, merged_filters->list[2]->level);
-//
-//    CU_ASSERT_EQUAL(strcmp("a.b.z", merged_filters->list[3]->prefix), 0);
-//    CU_ASSERT_EQUAL(BXILOG_FINE, merged_filters->list[3]->level);
-//
-//    CU_ASSERT_EQUAL(strcmp("bar", merged_filters->list[4]->prefix), 0);
-//    CU_ASSERT_EQUAL(BXILOG_TRACE, merged_filters->list[4]->level);
-//
-//    CU_ASSERT_EQUAL(strcmp("~", merged_filters->list[5]->prefix), 0);
-//    CU_ASSERT_EQUAL(BXILOG_TRACE, merged_filters->list[5]->level);
-//
-//    bxilog_filters_destroy(&merged_filters);
-//    bxilog_filters_destroy(&filters1);
-//    bxilog_filters_destroy(&filters2);
+    char filters1_format[] = ":trace,a.b:debug,a.b.z:fine";
+    bxilog_filters_p filters1 = NULL;
+    bxierr_p err = bxilog_filters_parse(filters1_format, &filters1);
+    CU_ASSERT_TRUE(bxierr_isok(err));
+
+    char filters2_format[] = "~:info,bar:out,a:critical";
+    bxilog_filters_p filters2 = NULL;
+    err = bxilog_filters_parse(filters2_format, &filters2);
+    CU_ASSERT_TRUE(bxierr_isok(err));
+
+    bxilog_filters_p array[2] = {filters1, filters2};
+    bxilog_filters_p merged_filters = bxilog_filters_merge(array, 2);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(merged_filters);
+    CU_ASSERT_EQUAL(merged_filters->nb, 6);
+
+    CU_ASSERT_EQUAL(strcmp("", merged_filters->list[0]->prefix), 0);
+    CU_ASSERT_EQUAL(BXILOG_TRACE, merged_filters->list[0]->level);
+
+    CU_ASSERT_EQUAL(strcmp("a", merged_filters->list[1]->prefix), 0);
+    CU_ASSERT_EQUAL(BXILOG_TRACE, merged_filters->list[1]->level);
+
+    CU_ASSERT_EQUAL(strcmp("a.b", merged_filters->list[2]->prefix), 0);
+    CU_ASSERT_EQUAL(BXILOG_DEBUG, merged_filters->list[2]->level);
+
+    CU_ASSERT_EQUAL(strcmp("a.b.z", merged_filters->list[3]->prefix), 0);
+    CU_ASSERT_EQUAL(BXILOG_FINE, merged_filters->list[3]->level);
+
+    CU_ASSERT_EQUAL(strcmp("bar", merged_filters->list[4]->prefix), 0);
+    CU_ASSERT_EQUAL(BXILOG_TRACE, merged_filters->list[4]->level);
+
+    CU_ASSERT_EQUAL(strcmp("~", merged_filters->list[5]->prefix), 0);
+    CU_ASSERT_EQUAL(BXILOG_TRACE, merged_filters->list[5]->level);
+
+    // The most precise filter gives the level
+    bxilog_filters_trie_p trie = bxilog_filters_compile(filters1);
+    bxilog_level_e level;
+    CU_ASSERT_TRUE(bxilog_filters_trie_match(trie, "a.b.z.y", &level));
+    CU_ASSERT_EQUAL(BXILOG_FINE, level);
+    CU_ASSERT_TRUE(bxilog_filters_trie_match(trie, "a.b.y", &level));
+    CU_ASSERT_EQUAL(BXILOG_DEBUG, level);
+    CU_ASSERT_TRUE(bxilog_filters_trie_match(trie, "a", &level));
+    CU_ASSERT_EQUAL(BXILOG_TRACE, level);
+    bxilog_filters_trie_destroy(&trie);
+    CU_ASSERT_PTR_NULL(trie);
+
+    trie = bxilog_filters_compile(filters2);
+    level = BXILOG_OUTPUT;
+    CU_ASSERT_FALSE(bxilog_filters_trie_match(trie, "b", &level));
+    CU_ASSERT_EQUAL(BXILOG_OUTPUT, level);
+    CU_ASSERT_TRUE(bxilog_filters_trie_match(trie, "bar.foo", &level));
+    CU_ASSERT_EQUAL(BXILOG_OUTPUT, level);
+    bxilog_filters_trie_destroy(&trie);
+
+    bxilog_filters_destroy(&merged_filters);
+    bxilog_filters_destroy(&filters1);
+    bxilog_filters_destroy(&filters2);
 }
 
 
@@ -882,7 +917,7 @@ void * logging_thread(void * data) {
     return (void *) log_nb;
 }
 
-void test_logger_threads(void) {
+static void _test_logger_threads(bxilog_transport_e transport) {
     // Create N threads, each thread logs into its own logger
     // Create N file handlers, one for each thread/logger
     // Each thread do logs and returns the total number of logs produced
@@ -905,6 +940,7 @@ void test_logger_threads(void) {
 
     // Create the normal configuration
     bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = transport;
     bxilog_config_add_handler(config,
                               BXILOG_FILE_HANDLER,
                               BXILOG_FILTERS_ALL_ALL,
@@ -992,6 +1028,203 @@ void test_logger_threads(void) {
 
 }
 
+void test_logger_threads(void) {
+    _test_logger_threads(BXILOG_TRANSPORT_ZMQ);
+}
+
+void test_logger_threads_ring(void) {
+    _test_logger_threads(BXILOG_TRANSPORT_RING);
+}
+
+static void _test_logger_deferred(bxilog_transport_e transport) {
+    char * filename = strdup("/tmp/test_logger_deferred.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = transport;
+    config->deferred_format = true;
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              BXILOG_FILTERS_ALL_ALL,
+                              PROGNAME, FULLFILENAME, BXI_APPEND_OPEN_FLAGS);
+    bxilog_filters_p filters = bxilog_filters_new();
+    bxilog_filters_add(&filters, "", BXILOG_OFF);
+    bxilog_filters_add(&filters, "test.deferred", BXILOG_ALL);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.deferred", &logger);
+    bxierr_abort_ifko(err);
+
+    // The string argument is freed before the handler formats the message
+    char * str = strdup("a dynamic string");
+    OUT(logger, "int=%d long=%ld size=%zu str='%s' prec='%.3s' dbl=%.2f pct=%d%%",
+        -42, 1234567890123L, (size_t) 17, str, "abcdef", 3.14159, 100);
+    BXIFREE(str);
+    // Not supported in deferred mode: formatted by the current thread
+    OUT(logger, "errno: %m");
+    err = bxilog_flush();
+    bxierr_abort_ifko(err);
+
+    const size_t size = 4096;
+    char buf[size];
+    ssize_t n = pread(fd, buf, size - 1, 0);
+    CU_ASSERT_TRUE_FATAL(0 < n);
+    buf[n] = '\0';
+
+    CU_ASSERT_PTR_NOT_NULL(strstr(buf, "int=-42 long=1234567890123 size=17 "
+                                       "str='a dynamic string' prec='abc' "
+                                       "dbl=3.14 pct=100%"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(buf, "errno: "));
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+    close(fd);
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+void test_logger_deferred(void) {
+    _test_logger_deferred(BXILOG_TRANSPORT_ZMQ);
+    _test_logger_deferred(BXILOG_TRANSPORT_RING);
+}
+
+static void _test_logger_batch(bxilog_transport_e transport) {
+    char * filename = strdup("/tmp/test_logger_batch.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = transport;
+    // Rebuilt records are gathered in the handler format buffer
+    config->deferred_format = true;
+    bxilog_filters_p filters = bxilog_filters_new();
+    bxilog_filters_add(&filters, "", BXILOG_OFF);
+    bxilog_filters_add(&filters, "test.batch", BXILOG_ALL);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger, other;
+    err = bxilog_registry_get("test.batch", &logger);
+    bxierr_abort_ifko(err);
+    err = bxilog_registry_get("test.nobatch", &other);
+    bxierr_abort_ifko(err);
+
+    // Several batches with records filtered out in the middle, staying below the
+    // zmq high water mark (records beyond it would be dropped)
+    const int logs_nb = 600;
+    for (int i = 0; i < logs_nb; i++) {
+        OUT(logger, "batched record %d of %s", i, "a batch");
+        if (0 == i % 7) OUT(other, "filtered out record %d", i);
+    }
+    err = bxilog_flush();
+    bxierr_abort_ifko(err);
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    FILE * file = fdopen(fd, "r");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    int expected = 0;
+    char * line = NULL;
+    size_t line_size = 0;
+    while (-1 != getline(&line, &line_size, file)) {
+        CU_ASSERT_PTR_NULL(strstr(line, "filtered out"));
+        char * msg = strstr(line, "|batched record ");
+        if (NULL == msg) continue;
+        int i = -1;
+        CU_ASSERT_EQUAL(sscanf(msg, "|batched record %d of a batch", &i), 1);
+        // Records of a single thread are processed in order
+        CU_ASSERT_EQUAL(i, expected);
+        expected++;
+    }
+    free(line);
+    fclose(file);
+    CU_ASSERT_EQUAL(expected, logs_nb);
+
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+void test_logger_batch(void) {
+    _test_logger_batch(BXILOG_TRANSPORT_ZMQ);
+    _test_logger_batch(BXILOG_TRANSPORT_RING);
+}
+
+static void _log_from_callsite(bxilog_logger_p logger, int i) {
+    // The same callsite, used with several loggers
+    OUT(logger, "callsite message %d", i);
+}
+
+void test_logger_callsite(void) {
+    char * filename = strdup("/tmp/test_logger_callsite.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_filters_p filters = bxilog_filters_new();
+    bxilog_filters_add(&filters, "", BXILOG_OFF);
+    bxilog_filters_add(&filters, "test.callsite", BXILOG_ALL);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p first, second;
+    err = bxilog_registry_get("test.callsite.first", &first);
+    bxierr_abort_ifko(err);
+    err = bxilog_registry_get("test.callsite.second", &second);
+    bxierr_abort_ifko(err);
+
+    for (int i = 0; i < 3; i++) {
+        _log_from_callsite(first, i);
+        _log_from_callsite(second, i);
+    }
+    err = bxilog_flush();
+    bxierr_abort_ifko(err);
+
+    const size_t size = 4096;
+    char buf[size];
+    ssize_t n = pread(fd, buf, size - 1, 0);
+    CU_ASSERT_TRUE_FATAL(0 < n);
+    buf[n] = '\0';
+
+    // Each record must be resolved with the logger actually used
+    size_t first_nb = 0, second_nb = 0;
+    for (char * line = strtok(buf, "\n"); NULL != line; line = strtok(NULL, "\n")) {
+        CU_ASSERT_PTR_NOT_NULL(strstr(line, "callsite message"));
+        CU_ASSERT_PTR_NOT_NULL(strstr(line, "_log_from_callsite"));
+        CU_ASSERT_PTR_NOT_NULL(strstr(line, "test_logger.c"));
+        if (NULL != strstr(line, "test.callsite.first")) first_nb++;
+        if (NULL != strstr(line, "test.callsite.second")) second_nb++;
+    }
+    CU_ASSERT_EQUAL(first_nb, 3);
+    CU_ASSERT_EQUAL(second_nb, 3);
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+    close(fd);
+    unlink(filename);
+    BXIFREE(filename);
+}
+
 void test_handlers(void) {
     bxilog_config_p config = bxilog_config_new(PROGNAME);
 
@@ -1190,3 +1423,1086 @@ void test_handlers(void) {
 //    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
 //}
 //
+
+void test_logger_overflow(void) {
+    char * filename = strdup("/tmp/test_logger_overflow.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = BXILOG_TRANSPORT_RING;
+    // A tiny ring fills up quickly
+    config->ring_size = 4096;
+    bxilog_filters_p filters = bxilog_filters_new();
+    bxilog_filters_add(&filters, "", BXILOG_OFF);
+    bxilog_filters_add(&filters, "test.overflow", BXILOG_ALL);
+    bxilog_filters_add(&filters, BXILOG_LIB_PREFIX "bxilog.overflow", BXILOG_ALL);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    config->handlers_params[0]->overflow_policy = BXILOG_OVERFLOW_DROP_NEWEST;
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.overflow", &logger);
+    bxierr_abort_ifko(err);
+
+    const size_t records_nb = 10000;
+    for (size_t i = 0; i < records_nb; i++) {
+        OUT(logger, "overflow message %zu", i);
+    }
+    err = bxilog_flush();
+    bxierr_abort_ifko(err);
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    // Each record is either in the file, or counted in a drop report
+    FILE * file = fdopen(fd, "r");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    size_t logged_nb = 0, dropped_nb = 0;
+    char * line = NULL;
+    size_t line_size = 0;
+    while (-1 != getline(&line, &line_size, file)) {
+        if (NULL != strstr(line, "overflow message ")) logged_nb++;
+        const char * report = strstr(line, "|");
+        size_t n;
+        while (NULL != report) {
+            if (1 == sscanf(report, "|%zu log records dropped", &n)) dropped_nb += n;
+            report = strstr(report + 1, "|");
+        }
+    }
+    free(line);
+    fclose(file);
+
+    CU_ASSERT_EQUAL(logged_nb + dropped_nb, records_nb);
+
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+void test_logger_ratelimit(void) {
+    char * filename = strdup("/tmp/test_logger_ratelimit.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_filters_p filters = bxilog_filters_new();
+    bxilog_filters_add(&filters, "", BXILOG_OFF);
+    bxilog_filters_add(&filters, "test.ratelimit", BXILOG_ALL);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.ratelimit", &logger);
+    bxierr_abort_ifko(err);
+
+    for (size_t i = 0; i < 100; i++) {
+        LOG_EVERY_N(logger, BXILOG_OUTPUT, 10, "every n %zu", i);
+        LOG_FIRST_N(logger, BXILOG_OUTPUT, 3, "first n %zu", i);
+        LOG_PER_SECOND(logger, BXILOG_OUTPUT, 5, "per second %zu", i);
+        LOG_SAMPLED(logger, BXILOG_OUTPUT, 1, "sampled %zu", i);
+    }
+    err = bxilog_flush();
+    bxierr_abort_ifko(err);
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    FILE * file = fdopen(fd, "r");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    size_t every_n = 0, first_n = 0, per_second = 0, sampled = 0, summaries = 0;
+    char * line = NULL;
+    size_t line_size = 0;
+    while (-1 != getline(&line, &line_size, file)) {
+        if (NULL != strstr(line, "|every n ")) every_n++;
+        if (NULL != strstr(line, "|first n ")) first_n++;
+        if (NULL != strstr(line, "|per second ")) per_second++;
+        if (NULL != strstr(line, "|sampled ")) sampled++;
+        if (NULL != strstr(line, "similar logs suppressed")) summaries++;
+    }
+    free(line);
+    fclose(file);
+
+    CU_ASSERT_EQUAL(every_n, 10);
+    CU_ASSERT_EQUAL(first_n, 3);
+    // The loop might run across a second boundary
+    CU_ASSERT_TRUE(5 <= per_second && per_second <= 10);
+    CU_ASSERT_EQUAL(sampled, 100);
+    // Suppressed calls of LOG_EVERY_N() are reported with the next log
+    CU_ASSERT_TRUE(9 <= summaries);
+
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+static size_t _stats_log_nb(bxilog_stats_p stats, const char * name, bxilog_level_e level) {
+    for (size_t i = 0; i < stats->loggers_nb; i++) {
+        if (0 == strcmp(name, stats->loggers[i].name)) {
+            return stats->loggers[i].level_nb[level];
+        }
+    }
+    return 0;
+}
+
+static void * _stats_thread(void * data) {
+    bxilog_logger_p logger = data;
+    for (size_t i = 0; i < 7; i++) ERROR(logger, "From a thread %zu", i);
+    return NULL;
+}
+
+void test_logger_stats(void) {
+    bxilog_filters_p filters = bxilog_filters_new();
+    bxilog_filters_add(&filters, "", BXILOG_OFF);
+    bxilog_filters_add(&filters, "test.stats", BXILOG_ALL);
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config, BXILOG_NULL_HANDLER, filters);
+
+    // Statistics are kept across bxilog_init()/bxilog_finalize(): compare with
+    // what previous tests have produced
+    bxilog_stats_p before;
+    bxierr_p err = bxilog_stats_get(&before);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.stats", &logger);
+    bxierr_abort_ifko(err);
+
+    for (size_t i = 0; i < 10; i++) OUT(logger, "Some output %zu", i);
+    for (size_t i = 0; i < 3; i++) WARNING(logger, "Some warning %zu", i);
+
+    // Counters of an exited thread are kept
+    pthread_t thread;
+    int rc = pthread_create(&thread, NULL, _stats_thread, logger);
+    CU_ASSERT_EQUAL_FATAL(rc, 0);
+    rc = pthread_join(thread, NULL);
+    CU_ASSERT_EQUAL_FATAL(rc, 0);
+
+    bxilog_stats_p after;
+    err = bxilog_stats_get(&after);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    CU_ASSERT_EQUAL(_stats_log_nb(after, "test.stats", BXILOG_OUTPUT) -
+                    _stats_log_nb(before, "test.stats", BXILOG_OUTPUT), 10);
+    CU_ASSERT_EQUAL(_stats_log_nb(after, "test.stats", BXILOG_WARNING) -
+                    _stats_log_nb(before, "test.stats", BXILOG_WARNING), 3);
+    CU_ASSERT_EQUAL(_stats_log_nb(after, "test.stats", BXILOG_ERROR) -
+                    _stats_log_nb(before, "test.stats", BXILOG_ERROR), 7);
+    CU_ASSERT_TRUE(after->log_nb >= before->log_nb + 20);
+    CU_ASSERT_TRUE(after->bytes > before->bytes);
+    CU_ASSERT_TRUE(after->threads_nb > before->threads_nb);
+    CU_ASSERT_TRUE(0 < after->min_log_size);
+    CU_ASSERT_TRUE(after->min_log_size <= after->max_log_size);
+    for (size_t i = 1; i < after->loggers_nb; i++) {
+        CU_ASSERT_TRUE(0 > strcmp(after->loggers[i - 1].name, after->loggers[i].name));
+    }
+
+    bxilog_stats_destroy(&before);
+    bxilog_stats_destroy(&after);
+    CU_ASSERT_PTR_NULL(after);
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+}
+
+// The whole file is read, whatever its size
+static size_t _count_lines(const char * filename, const char * pattern) {
+    FILE * file = fopen(filename, "r");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+
+    size_t result = 0;
+    char * line = NULL;
+    size_t line_size = 0;
+    while (-1 != getline(&line, &line_size, file)) {
+        if (NULL != strstr(line, pattern)) result++;
+    }
+    free(line);
+    fclose(file);
+    return result;
+}
+
+static void _test_logger_routing(bxilog_transport_e transport) {
+    char * verbose_name = strdup("/tmp/test_logger_routing.verbose.XXXXXX");
+    int verbose_fd = mkstemp(verbose_name);
+    bxiassert(0 < verbose_fd);
+    char * quiet_name = strdup("/tmp/test_logger_routing.quiet.XXXXXX");
+    int quiet_fd = mkstemp(quiet_name);
+    bxiassert(0 < quiet_fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = transport;
+    bxilog_filters_p filters = bxilog_filters_new();
+    bxilog_filters_add(&filters, "", BXILOG_OFF);
+    bxilog_filters_add(&filters, "test.routing", BXILOG_DEBUG);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, verbose_name, BXI_APPEND_OPEN_FLAGS);
+    filters = bxilog_filters_new();
+    bxilog_filters_add(&filters, "", BXILOG_OFF);
+    bxilog_filters_add(&filters, "test.routing", BXILOG_OUTPUT);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, quiet_name, BXI_APPEND_OPEN_FLAGS);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.routing", &logger);
+    bxierr_abort_ifko(err);
+
+    // Debug records are only sent to the first handler, lower levels to none
+    CU_ASSERT_EQUAL(logger->handlers_skip[BXILOG_OUTPUT], 0);
+    CU_ASSERT_EQUAL(logger->handlers_skip[BXILOG_DEBUG], 0x2);
+    CU_ASSERT_EQUAL(logger->handlers_skip[BXILOG_LOWEST], 0x3);
+
+    for (int i = 0; i < 5; i++) DEBUG(logger, "routed debug %d", i);
+    for (int i = 0; i < 3; i++) OUT(logger, "routed output %d", i);
+    for (int i = 0; i < 2; i++) bxilog_logger_log_nolevelcheck(logger, BXILOG_TRACE,
+                                                                __FILE__,
+                                                                ARRAYLEN(__FILE__),
+                                                                __func__,
+                                                                ARRAYLEN(__func__),
+                                                                __LINE__,
+                                                                "routed trace %d", i);
+    err = bxilog_flush();
+    bxierr_abort_ifko(err);
+
+    CU_ASSERT_EQUAL(_count_lines(verbose_name, "routed debug"), 5);
+    CU_ASSERT_EQUAL(_count_lines(verbose_name, "routed output"), 3);
+    CU_ASSERT_EQUAL(_count_lines(verbose_name, "routed trace"), 0);
+    CU_ASSERT_EQUAL(_count_lines(quiet_name, "routed debug"), 0);
+    CU_ASSERT_EQUAL(_count_lines(quiet_name, "routed output"), 3);
+    CU_ASSERT_EQUAL(_count_lines(quiet_name, "routed trace"), 0);
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+    close(verbose_fd);
+    unlink(verbose_name);
+    BXIFREE(verbose_name);
+    close(quiet_fd);
+    unlink(quiet_name);
+    BXIFREE(quiet_name);
+}
+
+void test_logger_routing(void) {
+    _test_logger_routing(BXILOG_TRANSPORT_ZMQ);
+    _test_logger_routing(BXILOG_TRANSPORT_RING);
+}
+
+static void _test_logger_fanout(bxilog_transport_e transport) {
+    // Each record is shared by all handlers: each one must write all of them
+    char * names[3];
+    int fds[ARRAYLEN(names)];
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = transport;
+    for (size_t i = 0; i < ARRAYLEN(names); i++) {
+        names[i] = strdup("/tmp/test_logger_fanout.XXXXXX");
+        fds[i] = mkstemp(names[i]);
+        bxiassert(0 < fds[i]);
+        bxilog_filters_p filters = bxilog_filters_new();
+        bxilog_filters_add(&filters, "", BXILOG_OFF);
+        bxilog_filters_add(&filters, "test.fanout", BXILOG_LOWEST);
+        bxilog_config_add_handler(config,
+                                  BXILOG_FILE_HANDLER,
+                                  filters,
+                                  PROGNAME, names[i], BXI_APPEND_OPEN_FLAGS);
+    }
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.fanout", &logger);
+    bxierr_abort_ifko(err);
+
+    // Kept under the high water mark: records over it may be dropped
+    const size_t records_nb = 100;
+    for (size_t i = 0; i < records_nb; i++) OUT(logger, "fanout record %zu", i);
+    err = bxilog_flush();
+    bxierr_abort_ifko(err);
+
+    char * last = bxistr_new("fanout record %zu", records_nb - 1);
+    for (size_t i = 0; i < ARRAYLEN(names); i++) {
+        CU_ASSERT_EQUAL(_count_lines(names[i], "fanout record"), records_nb);
+        CU_ASSERT_EQUAL(_count_lines(names[i], last), 1);
+    }
+    BXIFREE(last);
+
+    // Shared records not released are reported by valgrind
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+    for (size_t i = 0; i < ARRAYLEN(names); i++) {
+        close(fds[i]);
+        unlink(names[i]);
+        BXIFREE(names[i]);
+    }
+}
+
+void test_logger_fanout(void) {
+    _test_logger_fanout(BXILOG_TRANSPORT_ZMQ);
+    _test_logger_fanout(BXILOG_TRANSPORT_RING);
+}
+
+static void _test_logger_reconfigure_filters(bxilog_transport_e transport) {
+    char * name = strdup("/tmp/test_logger_reconfigure_filters.XXXXXX");
+    int fd = mkstemp(name);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = transport;
+    bxilog_filters_p filters;
+    bxierr_p err = bxilog_filters_parse(":off,test.reconfigure:output", &filters);
+    bxierr_abort_ifko(err);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, name, BXI_APPEND_OPEN_FLAGS);
+
+    err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.reconfigure", &logger);
+    bxierr_abort_ifko(err);
+    CU_ASSERT_EQUAL(logger->level, BXILOG_OUTPUT);
+
+    for (int i = 0; i < 4; i++) DEBUG(logger, "quiet debug %d", i);
+
+    // Raise the level while running
+    err = bxilog_filters_parse(":off,test.reconfigure:debug", &filters);
+    bxierr_abort_ifko(err);
+    err = bxilog_reconfigure_filters(0, filters);
+    CU_ASSERT_TRUE(bxierr_isok(err));
+    CU_ASSERT_EQUAL(logger->level, BXILOG_DEBUG);
+    CU_ASSERT_EQUAL(logger->handlers_skip[BXILOG_DEBUG], 0);
+
+    for (int i = 0; i < 5; i++) DEBUG(logger, "verbose debug %d", i);
+
+    // Records sent before the reconfiguration are not lost
+    err = bxilog_filters_parse(":off,test.reconfigure:output", &filters);
+    bxierr_abort_ifko(err);
+    err = bxilog_reconfigure_filters(0, filters);
+    CU_ASSERT_TRUE(bxierr_isok(err));
+    CU_ASSERT_EQUAL(logger->level, BXILOG_OUTPUT);
+
+    for (int i = 0; i < 3; i++) DEBUG(logger, "quiet again debug %d", i);
+    OUT(logger, "quiet again output");
+
+    // No such handler: its filters are released anyway
+    err = bxilog_filters_parse(":lowest", &filters);
+    bxierr_abort_ifko(err);
+    err = bxilog_reconfigure_filters(1, filters);
+    CU_ASSERT_TRUE(bxierr_isko(err));
+    bxierr_destroy(&err);
+    CU_ASSERT_EQUAL(logger->level, BXILOG_OUTPUT);
+
+    err = bxilog_flush();
+    bxierr_abort_ifko(err);
+
+    CU_ASSERT_EQUAL(_count_lines(name, "quiet debug"), 0);
+    CU_ASSERT_EQUAL(_count_lines(name, "verbose debug"), 5);
+    CU_ASSERT_EQUAL(_count_lines(name, "quiet again debug"), 0);
+    CU_ASSERT_EQUAL(_count_lines(name, "quiet again output"), 1);
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    // Only allowed while the library is initialized
+    err = bxilog_filters_parse(":lowest", &filters);
+    bxierr_abort_ifko(err);
+    err = bxilog_reconfigure_filters(0, filters);
+    CU_ASSERT_EQUAL(err->code, BXILOG_ILLEGAL_STATE_ERR);
+    bxierr_destroy(&err);
+
+    close(fd);
+    unlink(name);
+    BXIFREE(name);
+}
+
+void test_logger_reconfigure_filters(void) {
+    _test_logger_reconfigure_filters(BXILOG_TRANSPORT_ZMQ);
+    _test_logger_reconfigure_filters(BXILOG_TRANSPORT_RING);
+}
+
+static void _test_logger_hot_handlers(bxilog_transport_e transport) {
+    char * name = strdup("/tmp/test_logger_hot_handlers.XXXXXX");
+    int fd = mkstemp(name);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = transport;
+    config->handlers_max = 2;
+    bxilog_filters_p filters;
+    bxierr_p err = bxilog_filters_parse(":off,test.hot:output", &filters);
+    bxierr_abort_ifko(err);
+    bxilog_config_add_handler(config, BXILOG_NULL_HANDLER, filters);
+
+    err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.hot", &logger);
+    bxierr_abort_ifko(err);
+    CU_ASSERT_EQUAL(logger->level, BXILOG_OUTPUT);
+
+    for (int i = 0; i < 4; i++) DEBUG(logger, "before debug %d", i);
+
+    // Add a handler while running
+    err = bxilog_filters_parse(":off,test.hot:debug", &filters);
+    bxierr_abort_ifko(err);
+    size_t rank = 0;
+    err = bxilog_add_handler(BXILOG_FILE_HANDLER, filters, &rank,
+                             PROGNAME, name, BXI_APPEND_OPEN_FLAGS);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+    CU_ASSERT_EQUAL(rank, 1);
+    CU_ASSERT_EQUAL(logger->level, BXILOG_DEBUG);
+
+    for (int i = 0; i < 5; i++) DEBUG(logger, "added debug %d", i);
+
+    // No room left
+    err = bxilog_filters_parse(":lowest", &filters);
+    bxierr_abort_ifko(err);
+    size_t other_rank;
+    err = bxilog_add_handler(BXILOG_NULL_HANDLER, filters, &other_rank);
+    CU_ASSERT_TRUE(bxierr_isko(err));
+    bxierr_destroy(&err);
+
+    // Records sent before the removal are written
+    err = bxilog_remove_handler(rank);
+    CU_ASSERT_TRUE(bxierr_isok(err));
+    CU_ASSERT_EQUAL(logger->level, BXILOG_OUTPUT);
+    CU_ASSERT_EQUAL(_count_lines(name, "added debug"), 5);
+
+    for (int i = 0; i < 3; i++) DEBUG(logger, "removed debug %d", i);
+    OUT(logger, "removed output");
+
+    err = bxilog_remove_handler(rank);
+    CU_ASSERT_TRUE(bxierr_isko(err));
+    bxierr_destroy(&err);
+    err = bxilog_remove_handler(2);
+    CU_ASSERT_TRUE(bxierr_isko(err));
+    bxierr_destroy(&err);
+
+    err = bxilog_flush();
+    bxierr_abort_ifko(err);
+
+    CU_ASSERT_EQUAL(_count_lines(name, "before debug"), 0);
+    CU_ASSERT_EQUAL(_count_lines(name, "added debug"), 5);
+    CU_ASSERT_EQUAL(_count_lines(name, "removed debug"), 0);
+    CU_ASSERT_EQUAL(_count_lines(name, "removed output"), 0);
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    // Only allowed while the library is initialized
+    err = bxilog_remove_handler(0);
+    CU_ASSERT_EQUAL(err->code, BXILOG_ILLEGAL_STATE_ERR);
+    bxierr_destroy(&err);
+
+    close(fd);
+    unlink(name);
+    BXIFREE(name);
+}
+
+void test_logger_hot_handlers(void) {
+    _test_logger_hot_handlers(BXILOG_TRANSPORT_ZMQ);
+    _test_logger_hot_handlers(BXILOG_TRANSPORT_RING);
+}
+
+static void _test_logger_priority(bxilog_transport_e transport) {
+    char * filename = strdup("/tmp/test_logger_priority.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = transport;
+    // The bulk queue fills up quickly and drops records
+    config->ring_size = 4096;
+    config->data_hwm = 10;
+    bxilog_filters_p filters = bxilog_filters_new();
+    bxilog_filters_add(&filters, "", BXILOG_OFF);
+    bxilog_filters_add(&filters, "test.priority", BXILOG_ALL);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    config->handlers_params[0]->data_hwm = 10;
+    config->handlers_params[0]->overflow_policy = BXILOG_OVERFLOW_DROP_NEWEST;
+    CU_ASSERT_EQUAL(config->handlers_params[0]->prio_level, BXILOG_OFF);
+    config->handlers_params[0]->prio_level = BXILOG_ERROR;
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.priority", &logger);
+    bxierr_abort_ifko(err);
+
+    // Serious records are neither dropped nor delayed by the debug ones
+    const size_t records_nb = 10000;
+    size_t errors_nb = 0;
+    for (size_t i = 0; i < records_nb; i++) {
+        if (0 == i % 100) {
+            ERROR(logger, "priority message %zu", i);
+            errors_nb++;
+        } else {
+            DEBUG(logger, "bulk message %zu", i);
+        }
+    }
+    err = bxilog_flush();
+    bxierr_abort_ifko(err);
+
+    CU_ASSERT_EQUAL(_count_lines(filename, "priority message "), errors_nb);
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    close(fd);
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+void test_logger_priority(void) {
+    _test_logger_priority(BXILOG_TRANSPORT_ZMQ);
+    _test_logger_priority(BXILOG_TRANSPORT_RING);
+}
+
+static void _test_logger_placement(bxilog_transport_e transport) {
+    char * filename = strdup("/tmp/test_logger_placement.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = transport;
+    bxilog_filters_p filters = bxilog_filters_new();
+    bxilog_filters_add(&filters, "", BXILOG_OFF);
+    bxilog_filters_add(&filters, "test.placement", BXILOG_ALL);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    CU_ASSERT_PTR_NULL(config->handlers_params[0]->cpus);
+    CU_ASSERT_EQUAL(config->handlers_params[0]->numa_node, -1);
+    // CPU 0 always exists
+    config->handlers_params[0]->cpus = strdup("0");
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.placement", &logger);
+    bxierr_abort_ifko(err);
+
+    const size_t records_nb = 100;
+    for (size_t i = 0; i < records_nb; i++) {
+        OUT(logger, "placed message %zu", i);
+    }
+    err = bxilog_flush();
+    bxierr_abort_ifko(err);
+
+    CU_ASSERT_EQUAL(_count_lines(filename, "placed message "), records_nb);
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    close(fd);
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+void test_logger_placement(void) {
+    _test_logger_placement(BXILOG_TRANSPORT_ZMQ);
+    _test_logger_placement(BXILOG_TRANSPORT_RING);
+}
+
+#define SHARDED_THREADS_NB 4
+#define SHARDED_RECORDS_NB 2000
+
+static void * _sharded_thread(void * arg) {
+    const int rank = (int) (intptr_t) arg;
+
+    bxilog_logger_p logger;
+    bxierr_p err = bxilog_registry_get("test.sharded", &logger);
+    bxierr_abort_ifko(err);
+
+    for (int i = 0; i < SHARDED_RECORDS_NB; i++) {
+        OUT(logger, "sharded message %d %d", rank, i);
+    }
+    return NULL;
+}
+
+static void _test_logger_sharded(bxilog_transport_e transport) {
+    char * filename = strdup("/tmp/test_logger_sharded.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = transport;
+    bxilog_filters_p filters = bxilog_filters_new();
+    bxilog_filters_add(&filters, "", BXILOG_OFF);
+    bxilog_filters_add(&filters, "test.sharded", BXILOG_ALL);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    CU_ASSERT_EQUAL(config->handlers_params[0]->workers_nb, 1);
+    config->handlers_params[0]->workers_nb = 4;
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    pthread_t threads[SHARDED_THREADS_NB];
+    for (intptr_t t = 0; t < SHARDED_THREADS_NB; t++) {
+        int rc = pthread_create(&threads[t], NULL, _sharded_thread, (void *) t);
+        bxiassert(0 == rc);
+    }
+    for (size_t t = 0; t < SHARDED_THREADS_NB; t++) pthread_join(threads[t], NULL);
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    // Lines of each thread are in the order they have been produced
+    int next[SHARDED_THREADS_NB] = { 0 };
+    int lines[SHARDED_THREADS_NB] = { 0 };
+    bool ordered = true;
+    FILE * file = fopen(filename, "r");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    char * line = NULL;
+    size_t line_size = 0;
+    while (-1 != getline(&line, &line_size, file)) {
+        const char * msg = strstr(line, "sharded message ");
+        if (NULL == msg) continue;
+        int rank, i;
+        int rc = sscanf(msg, "sharded message %d %d", &rank, &i);
+        CU_ASSERT_EQUAL_FATAL(rc, 2);
+        CU_ASSERT_FATAL(0 <= rank && SHARDED_THREADS_NB > rank);
+        if (next[rank] > i) ordered = false;
+        next[rank] = i + 1;
+        lines[rank]++;
+    }
+    free(line);
+    fclose(file);
+    CU_ASSERT_TRUE(ordered);
+    // The zmq transport drops records silently above the high water mark
+    if (BXILOG_TRANSPORT_RING == transport) {
+        for (size_t t = 0; t < SHARDED_THREADS_NB; t++) {
+            CU_ASSERT_EQUAL(lines[t], SHARDED_RECORDS_NB);
+        }
+    }
+
+    close(fd);
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+void test_logger_sharded(void) {
+    _test_logger_sharded(BXILOG_TRANSPORT_ZMQ);
+    _test_logger_sharded(BXILOG_TRANSPORT_RING);
+}
+
+static void _test_logger_async_write(bxilog_transport_e transport) {
+    char * filename = strdup("/tmp/test_logger_async_write.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = transport;
+    bxilog_filters_p filters = bxilog_filters_new();
+    bxilog_filters_add(&filters, "", BXILOG_OFF);
+    bxilog_filters_add(&filters, "test.async", BXILOG_ALL);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    CU_ASSERT_EQUAL(config->handlers_params[0]->write_buffers_nb, 1);
+    config->handlers_params[0]->write_buffers_nb = 4;
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.async", &logger);
+    bxierr_abort_ifko(err);
+
+    // Enough to fill all buffers several times, and a line larger than all of them
+    char padding[256];
+    memset(padding, 'x', sizeof(padding) - 1);
+    padding[sizeof(padding) - 1] = '\0';
+    const size_t records_nb = 800;
+    for (size_t i = 0; i < records_nb; i++) {
+        OUT(logger, "async message %zu %s", i, padding);
+    }
+    const size_t large_size = 1024 * 1024;
+    char * large = bximem_calloc(large_size);
+    memset(large, 'y', large_size - 1);
+    OUT(logger, "async large message %s", large);
+    BXIFREE(large);
+    OUT(logger, "async last message");
+
+    // Written once flushed
+    err = bxilog_flush();
+    bxierr_abort_ifko(err);
+    CU_ASSERT_EQUAL(_count_lines(filename, "async message "), records_nb);
+    CU_ASSERT_EQUAL(_count_lines(filename, "async large message "), 1);
+    CU_ASSERT_EQUAL(_count_lines(filename, "async last message"), 1);
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    close(fd);
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+void test_logger_async_write(void) {
+    _test_logger_async_write(BXILOG_TRANSPORT_ZMQ);
+    _test_logger_async_write(BXILOG_TRANSPORT_RING);
+}
+
+static void _test_logger_rotation(bxilog_transport_e transport) {
+    // Rotated files are counted in a directory of their own
+    char * dirname = strdup("/tmp/test_logger_rotation.XXXXXX");
+    bxiassert(NULL != mkdtemp(dirname));
+    char * filename = bxistr_new("%s/%s", dirname, "test.log");
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = transport;
+    bxilog_filters_p filters = bxilog_filters_new();
+    bxilog_filters_add(&filters, "", BXILOG_OFF);
+    bxilog_filters_add(&filters, "test.rotation", BXILOG_ALL);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, filename, BXI_TRUNC_OPEN_FLAGS);
+    CU_ASSERT_EQUAL(config->handlers_params[0]->rotate_size, 0);
+    CU_ASSERT_EQUAL(config->handlers_params[0]->rotate_period_s, 0);
+    config->handlers_params[0]->rotate_size = 16 * 1024;
+    config->handlers_params[0]->rotate_keep = 2;
+    config->handlers_params[0]->rotate_compress = true;
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.rotation", &logger);
+    bxierr_abort_ifko(err);
+
+    // Far more than the rotation size
+    char padding[256];
+    memset(padding, 'x', sizeof(padding) - 1);
+    padding[sizeof(padding) - 1] = '\0';
+    for (size_t i = 0; i < 800; i++) {
+        OUT(logger, "rotation message %zu %s", i, padding);
+    }
+
+    // Rotated files are all processed on exit
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    size_t active_nb = 0, rotated_nb = 0, others_nb = 0;
+    DIR * dir = opendir(dirname);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(dir);
+    struct dirent * entry;
+    while (NULL != (entry = readdir(dir))) {
+        if ('.' == entry->d_name[0]) continue;
+        const size_t len = strlen(entry->d_name);
+        if (0 == strcmp("test.log", entry->d_name)) {
+            active_nb++;
+        } else if (0 == strncmp("test.log.", entry->d_name, ARRAYLEN("test.log.") - 1)
+                   && 0 == strcmp(".gz", entry->d_name + len - ARRAYLEN(".gz") + 1)) {
+            rotated_nb++;
+        } else {
+            others_nb++;
+        }
+        char * path = bxistr_new("%s/%s", dirname, entry->d_name);
+        unlink(path);
+        BXIFREE(path);
+    }
+    closedir(dir);
+    CU_ASSERT_EQUAL(active_nb, 1);
+    CU_ASSERT_TRUE(1 <= rotated_nb && rotated_nb <= 2);
+    CU_ASSERT_EQUAL(others_nb, 0);
+
+    rmdir(dirname);
+    BXIFREE(filename);
+    BXIFREE(dirname);
+}
+
+void test_logger_rotation(void) {
+    _test_logger_rotation(BXILOG_TRANSPORT_ZMQ);
+    _test_logger_rotation(BXILOG_TRANSPORT_RING);
+}
+
+static void _test_logger_binary(bxilog_transport_e transport) {
+    char * filename = strdup("/tmp/test_logger_binary.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = transport;
+    bxilog_filters_p filters = bxilog_filters_new();
+    bxilog_filters_add(&filters, "", BXILOG_OFF);
+    bxilog_filters_add(&filters, "test.binary", BXILOG_ALL);
+    bxilog_config_add_handler(config,
+                              BXILOG_BINARY_FILE_HANDLER,
+                              filters,
+                              PROGNAME, filename, BXI_TRUNC_OPEN_FLAGS);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.binary", &logger);
+    bxierr_abort_ifko(err);
+
+    const size_t records_nb = 500;
+    for (size_t i = 0; i < records_nb; i++) {
+        OUT(logger, "binary message %zu", i);
+    }
+    WARNING(logger, "binary multi-line message\nsecond line");
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    bxilog_binary_reader_p reader;
+    err = bxilog_binary_reader_new(filename, &reader);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    size_t n = 0;
+    char * text = NULL;
+    size_t text_size = 0;
+    while (true) {
+        bxilog_binary_entry_p entry;
+        err = bxilog_binary_reader_next(reader, &entry);
+        CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+        if (NULL == entry) break;
+
+        CU_ASSERT_STRING_EQUAL(entry->progname, PROGNAME);
+        CU_ASSERT_STRING_EQUAL(entry->loggername, "test.binary");
+        CU_ASSERT_EQUAL(entry->pid, (uint32_t) getpid());
+        if (n < records_nb) {
+            char * expected = bxistr_new("binary message %zu", n);
+            CU_ASSERT_EQUAL(entry->level, BXILOG_OUTPUT);
+            CU_ASSERT_STRING_EQUAL(entry->logmsg, expected);
+            BXIFREE(expected);
+        } else {
+            // One text line per line of the message
+            CU_ASSERT_EQUAL(entry->level, BXILOG_WARNING);
+            size_t len = bxilog_binary_entry_text(entry, &text, &text_size);
+            CU_ASSERT_EQUAL(text[0], 'W');
+            CU_ASSERT_EQUAL(text[len - 1], '\n');
+            CU_ASSERT_PTR_NOT_NULL(strstr(text, "|test.binary|binary multi-line message\n"));
+            CU_ASSERT_PTR_NOT_NULL(strstr(text, "|test.binary|second line\n"));
+        }
+        n++;
+    }
+    CU_ASSERT_EQUAL(n, records_nb + 1);
+    BXIFREE(text);
+
+    err = bxilog_binary_reader_destroy(&reader);
+    CU_ASSERT_TRUE(bxierr_isok(err));
+
+    close(fd);
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+void test_logger_binary(void) {
+    _test_logger_binary(BXILOG_TRANSPORT_ZMQ);
+    _test_logger_binary(BXILOG_TRANSPORT_RING);
+}
+
+// Read back the given binary file, each record seen being marked in the given array
+static size_t _binary_records_nb(const char * filename, bool * seen, size_t seen_nb) {
+    bxilog_binary_reader_p reader;
+    bxierr_p err = bxilog_binary_reader_new(filename, &reader);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    size_t n = 0;
+    size_t last = SIZE_MAX;
+    while (true) {
+        bxilog_binary_entry_p entry;
+        err = bxilog_binary_reader_next(reader, &entry);
+        CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+        if (NULL == entry) break;
+
+        CU_ASSERT_STRING_EQUAL(entry->progname, PROGNAME);
+        CU_ASSERT_STRING_EQUAL(entry->loggername, "test.binary.rotation");
+        CU_ASSERT_STRING_EQUAL(entry->funcname, "_test_logger_binary_rotation");
+        CU_ASSERT_EQUAL(entry->level, BXILOG_OUTPUT);
+        size_t i;
+        CU_ASSERT_EQUAL_FATAL(sscanf(entry->logmsg, "binary rotation message %zu", &i), 1);
+        CU_ASSERT_FATAL(i < seen_nb);
+        // Records of a file are in order, and none is in two files
+        CU_ASSERT_TRUE(SIZE_MAX == last || last < i);
+        CU_ASSERT_FALSE(seen[i]);
+        seen[i] = true;
+        last = i;
+        n++;
+    }
+
+    err = bxilog_binary_reader_destroy(&reader);
+    CU_ASSERT_TRUE(bxierr_isok(err));
+    return n;
+}
+
+static void _test_logger_binary_rotation(bxilog_transport_e transport) {
+    // Each rotated file must be readable on its own
+    char * dirname = strdup("/tmp/test_logger_binary_rotation.XXXXXX");
+    bxiassert(NULL != mkdtemp(dirname));
+    char * filename = bxistr_new("%s/%s", dirname, "test.bin");
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = transport;
+    bxilog_filters_p filters = bxilog_filters_new();
+    bxilog_filters_add(&filters, "", BXILOG_OFF);
+    bxilog_filters_add(&filters, "test.binary.rotation", BXILOG_ALL);
+    bxilog_config_add_handler(config,
+                              BXILOG_BINARY_FILE_HANDLER,
+                              filters,
+                              PROGNAME, filename, BXI_TRUNC_OPEN_FLAGS);
+    config->handlers_params[0]->rotate_size = 16 * 1024;
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.binary.rotation", &logger);
+    bxierr_abort_ifko(err);
+
+    // Far more than the rotation size
+    char padding[256];
+    memset(padding, 'x', sizeof(padding) - 1);
+    padding[sizeof(padding) - 1] = '\0';
+    const size_t records_nb = 4000;
+    for (size_t i = 0; i < records_nb; i++) {
+        OUT(logger, "binary rotation message %zu %s", i, padding);
+    }
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    bool * seen = bximem_calloc(records_nb * sizeof(*seen));
+    size_t files_nb = 0, n = 0;
+    DIR * dir = opendir(dirname);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(dir);
+    struct dirent * entry;
+    while (NULL != (entry = readdir(dir))) {
+        if ('.' == entry->d_name[0]) continue;
+        char * path = bxistr_new("%s/%s", dirname, entry->d_name);
+        n += _binary_records_nb(path, seen, records_nb);
+        files_nb++;
+        unlink(path);
+        BXIFREE(path);
+    }
+    closedir(dir);
+    CU_ASSERT_TRUE(2 < files_nb);
+    CU_ASSERT_EQUAL(n, records_nb);
+    BXIFREE(seen);
+
+    rmdir(dirname);
+    BXIFREE(filename);
+    BXIFREE(dirname);
+}
+
+void test_logger_binary_rotation(void) {
+    _test_logger_binary_rotation(BXILOG_TRANSPORT_ZMQ);
+    _test_logger_binary_rotation(BXILOG_TRANSPORT_RING);
+}
+
+// Count the lines of the given compressed file, all of them being complete
+static size_t _gz_lines_nb(const char * filename) {
+    gzFile file = gzopen(filename, "r");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    char line[512];
+    size_t n = 0;
+    while (NULL != gzgets(file, line, sizeof(line))) {
+        CU_ASSERT_PTR_NOT_NULL(strstr(line, "|test.compressed|compressed message "));
+        CU_ASSERT_EQUAL(line[strlen(line) - 1], '\n');
+        n++;
+    }
+    int errnum;
+    gzerror(file, &errnum);
+    CU_ASSERT_EQUAL(errnum, Z_OK);
+    gzclose(file);
+    return n;
+}
+
+static void _test_logger_compressed(bxilog_transport_e transport) {
+    char * filename = strdup("/tmp/test_logger_compressed.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = transport;
+    bxilog_filters_p filters = bxilog_filters_new();
+    bxilog_filters_add(&filters, "", BXILOG_OFF);
+    bxilog_filters_add(&filters, "test.compressed", BXILOG_ALL);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, filename, BXI_TRUNC_OPEN_FLAGS);
+    CU_ASSERT_EQUAL(config->handlers_params[0]->compress_level, 0);
+    config->handlers_params[0]->compress_level = 6;
+    // Compressed by the writer thread
+    config->handlers_params[0]->write_buffers_nb = 2;
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.compressed", &logger);
+    bxierr_abort_ifko(err);
+
+    for (size_t i = 0; i < 300; i++) {
+        OUT(logger, "compressed message %zu", i);
+    }
+    // The file being written is readable up to the last flush
+    err = bxilog_flush();
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+    CU_ASSERT_EQUAL(_gz_lines_nb(filename), 300);
+
+    for (size_t i = 300; i < 500; i++) {
+        OUT(logger, "compressed message %zu", i);
+    }
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+    CU_ASSERT_EQUAL(_gz_lines_nb(filename), 500);
+
+    close(fd);
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+void test_logger_compressed(void) {
+    _test_logger_compressed(BXILOG_TRANSPORT_ZMQ);
+    _test_logger_compressed(BXILOG_TRANSPORT_RING);
+}
@@ -34,3 +34,29 @@ void test_time(void) {
     CU_ASSERT_PTR_NOT_NULL_FATAL(time_char);
     free(time_char);
 }
+
+void test_time_fast(void) {
+    uint64_t first = bxitime_fast_ticks();
+    struct timespec before;
+    bxierr_p err = bxitime_get(CLOCK_REALTIME, &before);
+    CU_ASSERT_TRUE(bxierr_isok(err));
+    bxierr_destroy(&err);
+
+    uint64_t ticks = bxitime_fast_ticks();
+    CU_ASSERT_TRUE(ticks >= first);
+
+    struct timespec after;
+    err = bxitime_get(CLOCK_REALTIME, &after);
+    CU_ASSERT_TRUE(bxierr_isok(err));
+    bxierr_destroy(&err);
+
+    // The converted time must be close to the wall clock one
+    struct timespec fast;
+    bxitime_fast_to_timespec(ticks, &fast);
+    double before_s = before.tv_sec + before.tv_nsec * 1e-9;
+    double after_s = after.tv_sec + after.tv_nsec * 1e-9;
+    double fast_s = fast.tv_sec + fast.tv_nsec * 1e-9;
+    CU_ASSERT_TRUE(fast_s > before_s - 1e-3);
+    CU_ASSERT_TRUE(fast_s < after_s + 1e-3);
+    CU_ASSERT_TRUE(0 <= fast.tv_nsec && fast.tv_nsec < 1000000000l);
+}
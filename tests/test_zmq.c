@@ -14,6 +14,7 @@
 #include <stdlib.h>
 #include <time.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
@@ -25,6 +26,8 @@
 #include "bxi/base/zmq.h"
 #include "bxi/base/time.h"
 
+#include "log/record_impl.h"
+
 SET_LOGGER(LOGGER, "test.bxizmq");
 
 
@@ -810,3 +813,77 @@ void test_1pub_1sub_sync_fork() {
     unlink(quit_tmp_file);
     BXIFREE(quit_tmp_file);
 }
+
+// Number of releases of shared records done by zmq
+static atomic_size_t _releases_nb;
+
+static void _counting_release(void * data, void * hint) {
+    atomic_fetch_add(&_releases_nb, 1);
+    bxilog__shared_record_release(data, hint);
+}
+
+void test_bxizmq_data_snd_zc_shared() {
+    atomic_store(&_releases_nb, 0);
+
+    void * ctx;
+    bxierr_p err = bxizmq_context_new(&ctx);
+    BXIABORT_IFKO(LOGGER, err);
+
+    // A shared record sent to 2 handlers, and to a third one which refuses it
+    void * pulls[2], * pushes[2];
+    const size_t handlers_nb = ARRAYLEN(pulls);
+    for (size_t i = 0; i < handlers_nb; i++) {
+        char * url = bxistr_new("inproc://%s-%zu", __FUNCTION__, i);
+        err = bxizmq_zocket_create_binded(ctx, ZMQ_PULL, url, NULL, &pulls[i]);
+        BXIABORT_IFKO(LOGGER, err);
+        err = bxizmq_zocket_create_connected(ctx, ZMQ_PUSH, url, &pushes[i]);
+        BXIABORT_IFKO(LOGGER, err);
+        BXIFREE(url);
+    }
+    // A REP zocket can't send before having received: zmq_msg_send() fails with EFSM
+    void * refusing;
+    err = bxizmq_zocket_create(ctx, ZMQ_REP, &refusing);
+    BXIABORT_IFKO(LOGGER, err);
+
+    const char data[] = "A shared record";
+    bxilog__shared_record_p shared = bxilog__shared_record_new(data, sizeof(data),
+                                                               handlers_nb + 1);
+    for (size_t i = 0; i < handlers_nb; i++) {
+        err = bxizmq_data_snd_zc(shared->record, shared->len, pushes[i], 0, 0, 0,
+                                 _counting_release, shared);
+        CU_ASSERT_TRUE(bxierr_isok(err));
+        bxierr_destroy(&err);
+    }
+    // The reference must be released even if the record has not been sent
+    err = bxizmq_data_snd_zc(shared->record, shared->len, refusing, ZMQ_DONTWAIT, 0, 0,
+                             _counting_release, shared);
+    CU_ASSERT_TRUE(bxierr_isko(err));
+    bxierr_destroy(&err);
+    CU_ASSERT_EQUAL(atomic_load(&_releases_nb), 1);
+
+    // Each handler receives the whole record
+    for (size_t i = 0; i < handlers_nb; i++) {
+        char * result = NULL;
+        size_t received_size = 0;
+        err = bxizmq_data_rcv((void **) &result, 0, pulls[i], 0, false, &received_size);
+        CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+        CU_ASSERT_EQUAL(received_size, sizeof(data));
+        CU_ASSERT_STRING_EQUAL(result, data);
+        BXIFREE(result);
+    }
+
+    for (size_t i = 0; i < handlers_nb; i++) {
+        err = bxizmq_zocket_destroy(&pushes[i]);
+        BXIABORT_IFKO(LOGGER, err);
+        err = bxizmq_zocket_destroy(&pulls[i]);
+        BXIABORT_IFKO(LOGGER, err);
+    }
+    err = bxizmq_zocket_destroy(&refusing);
+    BXIABORT_IFKO(LOGGER, err);
+    // Terminating the context waits for all messages to be freed: the last release
+    // has freed the shared record (valgrind reports it otherwise)
+    err = bxizmq_context_destroy(&ctx);
+    BXIABORT_IFKO(LOGGER, err);
+
+    CU_ASSERT_EQUAL(atomic_load(&_releases_nb), handlers_nb + 1);
+}
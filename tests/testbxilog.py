@@ -321,6 +321,42 @@ class BXILogTest(unittest.TestCase):
         self._check_log_produced(FILENAME, bxilog.output,
                                  "This message must also appear in file %s", FILENAME)
 
+    def test_binary_file(self):
+        """Test logging in a binary file read back with the binary reader"""
+        import bxi.base.log.binary_reader as bxilog_binaryreader
+
+        fd, name = tempfile.mkstemp(suffix='.bxilog')
+        os.close(fd)
+        conf = {'handlers': ['out'],
+                'setsighandler': True,
+                'out': {'module': 'bxi.base.log.file_handler',
+                        'filters': ':output',
+                        'path': name,
+                        'append': False,
+                        'format': 'binary'},
+                }
+        bxilog.set_config(configobj.ConfigObj(conf))
+        bxilog.init()
+        for i in range(10):
+            bxilog.output("Binary message %d", i)
+        bxilog.output("Binary multi-line message\nsecond line")
+        bxilog.cleanup()
+
+        with bxilog_binaryreader.BinaryReader(name) as reader:
+            entries = list(reader)
+        os.unlink(name)
+
+        self.assertEquals(len(entries), 11)
+        for i in range(10):
+            self.assertEquals(entries[i].level, bxilog.OUTPUT)
+            self.assertEquals(entries[i].logmsg, "Binary message %d" % i)
+            self.assertEquals(entries[i].pid, os.getpid())
+        lines = entries[10].text.splitlines()
+        self.assertEquals(len(lines), 2)
+        self.assertTrue(lines[0].startswith('O|'))
+        self.assertTrue(lines[0].endswith('|Binary multi-line message'))
+        self.assertTrue(lines[1].endswith('|second line'))
+
     def test_threading(self):
         threads = []
         for i in range(multiprocessing.cpu_count() * 2):
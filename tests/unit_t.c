@@ -58,9 +58,11 @@ void test_bxistr_hex(void);
 // From test_err.c
 void test_bxierr(void);
 void test_bxierr_chain(void);
+void test_bxierr_lazy_backtrace(void);
 
 // From test_time.c
 void test_time(void);
+void test_time_fast(void);
 
 // From test_zmq.c
 void test_bxizmq_generate_url(void);
@@ -68,6 +70,7 @@ void test_1pub_1sub_sync(void);
 void test_2pub_1sub_sync(void);
 void test_2pub_2sub_sync(void);
 void test_1pub_1sub_sync_fork(void);
+void test_bxizmq_data_snd_zc_shared(void);
 
 // From test_logger.c
 void test_logger_init(void);
@@ -89,6 +92,25 @@ void test_filters_simple(void);
 void test_filters_symetric(void);
 void test_filters_complex(void);
 void test_logger_threads(void);
+void test_logger_threads_ring(void);
+void test_logger_deferred(void);
+void test_logger_callsite(void);
+void test_logger_overflow(void);
+void test_logger_ratelimit(void);
+void test_logger_stats(void);
+void test_logger_batch(void);
+void test_logger_routing(void);
+void test_logger_fanout(void);
+void test_logger_reconfigure_filters(void);
+void test_logger_hot_handlers(void);
+void test_logger_priority(void);
+void test_logger_placement(void);
+void test_logger_sharded(void);
+void test_logger_async_write(void);
+void test_logger_rotation(void);
+void test_logger_binary(void);
+void test_logger_binary_rotation(void);
+void test_logger_compressed(void);
 void test_handlers(void);
 void test_very_long_log(void);
 void test_strange_log(void);
@@ -231,6 +253,8 @@ int main(int argc, char * argv[]) {
                 || (NULL == CU_add_test(bxierr_suite, "test bxierr", test_bxierr))
                 || (NULL == CU_add_test(bxierr_suite,
                                         "test bxierr_chain", test_bxierr_chain))
+                || (NULL == CU_add_test(bxierr_suite, "test bxierr lazy backtrace",
+                                        test_bxierr_lazy_backtrace))
                                         || false) {
             CU_cleanup_registry();
             return (CU_get_error());
@@ -249,6 +273,7 @@ int main(int argc, char * argv[]) {
         /* add the tests to the suite */
         if (false
                 || (NULL == CU_add_test(bxitime_suite, "test time", test_time))
+                || (NULL == CU_add_test(bxitime_suite, "test fast time", test_time_fast))
                 || false) {
             CU_cleanup_registry();
             return (CU_get_error());
@@ -272,6 +297,7 @@ int main(int argc, char * argv[]) {
                 || (NULL == CU_add_test(bxizmq_suite, "test bxizmq 2pub/1sub sync", test_2pub_1sub_sync))
                 || (NULL == CU_add_test(bxizmq_suite, "test bxizmq 2pub/2sub sync", test_2pub_2sub_sync))
                 || (NULL == CU_add_test(bxizmq_suite, "test bxizmq 1pub/1sub sync fork", test_1pub_1sub_sync_fork))
+                || (NULL == CU_add_test(bxizmq_suite, "test bxizmq zero-copy shared data", test_bxizmq_data_snd_zc_shared))
                 || false) {
             CU_cleanup_registry();
             return (CU_get_error());
@@ -304,6 +330,25 @@ int main(int argc, char * argv[]) {
         || (NULL == CU_add_test(bxilog_suite, "test logger filters complex", test_filters_complex))
         || (NULL == CU_add_test(bxilog_suite, "test handlers", test_handlers))
         || (NULL == CU_add_test(bxilog_suite, "test logger threads", test_logger_threads))
+        || (NULL == CU_add_test(bxilog_suite, "test logger threads ring", test_logger_threads_ring))
+        || (NULL == CU_add_test(bxilog_suite, "test logger deferred", test_logger_deferred))
+        || (NULL == CU_add_test(bxilog_suite, "test logger callsite", test_logger_callsite))
+        || (NULL == CU_add_test(bxilog_suite, "test logger overflow", test_logger_overflow))
+        || (NULL == CU_add_test(bxilog_suite, "test logger ratelimit", test_logger_ratelimit))
+        || (NULL == CU_add_test(bxilog_suite, "test logger stats", test_logger_stats))
+        || (NULL == CU_add_test(bxilog_suite, "test logger batch", test_logger_batch))
+        || (NULL == CU_add_test(bxilog_suite, "test logger routing", test_logger_routing))
+        || (NULL == CU_add_test(bxilog_suite, "test logger fanout", test_logger_fanout))
+        || (NULL == CU_add_test(bxilog_suite, "test logger reconfigure filters", test_logger_reconfigure_filters))
+        || (NULL == CU_add_test(bxilog_suite, "test logger hot handlers", test_logger_hot_handlers))
+        || (NULL == CU_add_test(bxilog_suite, "test logger priority", test_logger_priority))
+        || (NULL == CU_add_test(bxilog_suite, "test logger placement", test_logger_placement))
+        || (NULL == CU_add_test(bxilog_suite, "test logger sharded", test_logger_sharded))
+        || (NULL == CU_add_test(bxilog_suite, "test logger async write", test_logger_async_write))
+        || (NULL == CU_add_test(bxilog_suite, "test logger rotation", test_logger_rotation))
+        || (NULL == CU_add_test(bxilog_suite, "test logger binary", test_logger_binary))
+        || (NULL == CU_add_test(bxilog_suite, "test logger binary rotation", test_logger_binary_rotation))
+        || (NULL == CU_add_test(bxilog_suite, "test logger compressed", test_logger_compressed))
         || (NULL == CU_add_test(bxilog_suite, "test logger fork", test_logger_fork))
 //        || (NULL == CU_add_test(bxilog_suite, "test logger signal", test_logger_signal))
 